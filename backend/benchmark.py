@@ -0,0 +1,656 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline 基准测试
+覆盖 ImageProcessor / NormalMapGenerator / SAMSegmenter / InpaintingProcessor 各操作（512 到 8K），
+按命名前缀运行完整 WorkflowManager 流程，并对 FastAPI 接口做压测（延迟分位数、吞吐量、峰值 RSS/显存）
+
+结果写入 JSON，阈值中的绝对上限（max_ms / max_error_rate）每次都检查，指定基线时再按比例比较，出现回归时以退出码 1 结束：
+
+    python backend/benchmark.py --output bench.json
+    python backend/benchmark.py --baseline bench.json --output new.json --thresholds backend/benchmark_thresholds.json
+    python backend/benchmark.py --suites api --url http://localhost:8000 --api-requests 500 --concurrency 16
+"""
+
+import os
+import sys
+import json
+import time
+import shutil
+import socket
+import fnmatch
+import logging
+import argparse
+import platform
+import tempfile
+import threading
+import subprocess
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+from datetime import datetime, timezone
+from PIL import Image
+import numpy as np
+
+# 添加项目根目录到Python路径
+ROOT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+sys.path.append(ROOT_DIR)
+
+from config import Config
+
+# 配置日志
+logging.basicConfig(level=logging.WARNING)
+logger = logging.getLogger("benchmark")
+
+SCHEMA_VERSION = 1
+ALL_SUITES = ["image", "normal", "sam", "inpaint", "workflow", "api"]
+DEFAULT_SIZES = [512, 1024, 2048, 4096, 8192]
+SAMPLE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "Sorted")
+# SAM 启动探测子进程在模型不可用时的退出码
+SAM_PROBE_UNAVAILABLE = 3
+
+
+class SkipCase(Exception):
+    """
+    当前环境无法运行该用例（如未安装模型）
+    """
+
+
+class PeakMonitor:
+    """
+    采样进程 RSS 和 CUDA 显存峰值
+    """
+
+    def __init__(self, interval: float = 0.01):
+        self.interval = interval
+        self.peak_rss = 0
+        self._stop = threading.Event()
+        self._thread = None
+        self._torch = None
+
+    def __enter__(self):
+        self.peak_rss = current_rss()
+        self._stop.clear()
+        self._thread = threading.Thread(target=self._sample, daemon=True)
+        self._thread.start()
+        try:
+            import torch
+            if torch.cuda.is_available():
+                torch.cuda.synchronize()
+                torch.cuda.reset_peak_memory_stats()
+                self._torch = torch
+        except ImportError:
+            pass
+        return self
+
+    def __exit__(self, *exc):
+        self._stop.set()
+        self._thread.join()
+        self.peak_rss = max(self.peak_rss, current_rss())
+
+    def _sample(self):
+        while not self._stop.wait(self.interval):
+            self.peak_rss = max(self.peak_rss, current_rss())
+
+    @property
+    def peak_rss_mb(self) -> float:
+        return round(self.peak_rss / (1024 * 1024), 1)
+
+    @property
+    def peak_vram_mb(self):
+        if self._torch is None:
+            return None
+        self._torch.cuda.synchronize()
+        return round(self._torch.cuda.max_memory_allocated() / (1024 * 1024), 1)
+
+
+def current_rss() -> int:
+    """
+    当前进程常驻内存（字节）
+    """
+    try:
+        with open("/proc/self/statm") as f:
+            return int(f.read().split()[1]) * os.sysconf("SC_PAGE_SIZE")
+    except (OSError, ValueError, AttributeError):
+        try:
+            import psutil
+            return psutil.Process().memory_info().rss
+        except ImportError:
+            import resource
+            return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024
+
+
+def summarize(times_ms: list) -> dict:
+    """
+    计算耗时统计
+    """
+    values = np.asarray(times_ms, dtype=np.float64)
+    return {
+        "min_ms": round(float(values.min()), 3),
+        "median_ms": round(float(np.median(values)), 3),
+        "p90_ms": round(float(np.percentile(values, 90)), 3),
+        "p95_ms": round(float(np.percentile(values, 95)), 3),
+        "p99_ms": round(float(np.percentile(values, 99)), 3),
+        "mean_ms": round(float(values.mean()), 3),
+        "max_ms": round(float(values.max()), 3)
+    }
+
+
+def create_test_image(size: int, seed: int) -> np.ndarray:
+    """
+    创建可复现的 RGBA 测试图像：渐变、噪声、圆形主体，四周透明
+    """
+    rng = np.random.default_rng(seed + size)
+    yy, xx = np.mgrid[0:size, 0:size].astype(np.float32)
+    rgba = np.empty((size, size, 4), dtype=np.uint8)
+    rgba[:, :, 0] = (xx * (255.0 / max(1, size - 1))).astype(np.uint8)
+    rgba[:, :, 1] = (yy * (255.0 / max(1, size - 1))).astype(np.uint8)
+    rgba[:, :, 2] = ((np.sin(xx / 17.0) * np.cos(yy / 23.0) + 1.0) * 127.5).astype(np.uint8)
+    rgba[:, :, :3] = np.clip(rgba[:, :, :3].astype(np.int16) + rng.integers(-12, 13, (size, size, 3)), 0, 255)
+    circle = (xx - size / 2) ** 2 + (yy - size * 0.55) ** 2 < (size * 0.35) ** 2
+    rgba[:, :, 3] = np.where(circle, 255, 0).astype(np.uint8)
+    return rgba
+
+
+def create_test_mask(size: int) -> np.ndarray:
+    """
+    修复遮罩：两块矩形，约占图像面积5%
+    """
+    mask = np.zeros((size, size), dtype=np.uint8)
+    s = size // 16
+    mask[4 * s:6 * s, 3 * s:7 * s] = 255
+    mask[9 * s:11 * s, 8 * s:11 * s] = 255
+    return mask
+
+
+class BenchmarkRunner:
+    """
+    基准测试执行器
+    """
+
+    def __init__(self, args):
+        self.args = args
+        self.config = Config()
+        self.results = {}
+        self._images = {}
+
+    def image(self, size: int) -> np.ndarray:
+        if size not in self._images:
+            self._images = {size: create_test_image(size, self.args.seed)}
+        return self._images[size]
+
+    def measure(self, name: str, fn, repeat: int = None, warmup: int = None, **meta):
+        """
+        运行一个用例并记录结果
+
+        Args:
+            name: 用例名（"suite.op@size"）
+            fn: 无参可调用对象
+            repeat: 计时次数
+            warmup: 预热次数（不计时）
+        """
+        repeat = self.args.repeat if repeat is None else repeat
+        warmup = self.args.warmup if warmup is None else warmup
+        entry = {"repeat": repeat, **meta}
+        try:
+            for _ in range(warmup):
+                fn()
+            times = []
+            with PeakMonitor() as monitor:
+                for _ in range(repeat):
+                    start = time.perf_counter()
+                    fn()
+                    times.append((time.perf_counter() - start) * 1000.0)
+            entry.update(summarize(times))
+            entry.update({"status": "ok", "peak_rss_mb": monitor.peak_rss_mb, "peak_vram_mb": monitor.peak_vram_mb})
+            print(f"  {name:<48} median {entry['median_ms']:>10.2f} ms   p95 {entry['p95_ms']:>10.2f} ms")
+        except SkipCase as e:
+            entry.update({"status": "skipped", "reason": str(e)})
+            print(f"  {name:<48} skipped: {e}")
+        except Exception as e:
+            logger.exception(f"Benchmark case {name} failed")
+            entry.update({"status": "failed", "error": str(e)})
+            print(f"  {name:<48} FAILED: {e}")
+        self.results[name] = entry
+        return entry
+
+    # ------------------------------------------------------------------ 各模块操作
+
+    def run_image(self):
+        from modules.image_processing import ImageProcessor
+        processor = ImageProcessor(self.config)
+        for size in self.args.sizes:
+            image = Image.fromarray(self.image(size), "RGBA")
+            rgb_image = image.convert("RGB")
+            ops = {
+                "resize_half": lambda: processor.resize(image, (size // 2, size // 2)),
+                "convert_to_grayscale": lambda: processor.convert_to_grayscale(image),
+                "add_alpha_channel": lambda: processor.add_alpha_channel(rgb_image),
+                "invert_colors": lambda: processor.invert_colors(image),
+                "align_bottom": lambda: processor.align_bottom(image),
+                "generate_shadow": lambda: processor.generate_shadow(image),
+                "resize_square": lambda: processor.resize_square(image, 512),
+                "sharpen": lambda: processor.sharpen(image),
+                "make_seamless": lambda: processor.make_seamless(image),
+                "gen_lod": lambda: processor.gen_lod(image),
+                "gen_mip_chain": lambda: processor.gen_mip_chain(image),
+                "box_collision": lambda: processor.box_collision(image),
+                "adjust_brightness_contrast": lambda: processor.adjust_brightness_contrast(image, 0.1, 0.2)
+            }
+            for op, fn in ops.items():
+                self.measure(f"image.{op}@{size}", fn, size=size)
+
+    def run_normal(self):
+        from modules.normal_map import NormalMapGenerator
+        generator = NormalMapGenerator(self.config)
+        for size in self.args.sizes:
+            rgba = self.image(size)
+            self.measure(f"normal.generate_array@{size}", lambda: generator.generate_array(rgba), size=size)
+
+    def run_sam(self):
+        from modules.segmentation import SAMSegmenter
+
+        def startup():
+            # 每次在新的子进程中从启动计到第一张掩码，当前进程中已加载的模块和权重不影响结果
+            proc = subprocess.run(
+                [sys.executable, os.path.abspath(__file__), "--sam-startup-probe"],
+                cwd=ROOT_DIR, capture_output=True, text=True
+            )
+            if proc.returncode == SAM_PROBE_UNAVAILABLE:
+                raise SkipCase("SAM2 model not available")
+            if proc.returncode != 0:
+                raise RuntimeError(f"startup probe exited with {proc.returncode}: {proc.stderr.strip()[-500:]}")
+
+        # 预热的子进程生成模型缓存（首次运行时），计时的是后续进程读取缓存的冷启动
+        self.measure("sam.startup_to_first_mask", startup, repeat=min(self.args.repeat, 3), warmup=1,
+                     model_cache=bool(getattr(self.config, "sam_model_cache_dir", "")), subprocess=True)
+        if self.results["sam.startup_to_first_mask"]["status"] == "skipped":
+            segmenters = []
+        else:
+            segmenter = SAMSegmenter(self.config)
+            blank = np.zeros((64, 64, 3), dtype=np.uint8)
+            segmenters = [segmenter] if segmenter.predict_mask(blank, [(32, 32)], [1]) is not None else []
+            segmenter.embedding_cache.clear()
+        if not segmenters:
+            for size in self.args.sizes:
+                self.measure(f"sam.segment_array@{size}", self._skip("SAM2 model not available"), size=size)
+            return
+        segmenter = segmenters[0]
+        for size in self.args.sizes:
+            rgb = np.ascontiguousarray(self.image(size)[:, :, :3])
+            center = [(size // 2, size // 2)]
+
+            def cold():
+                # 每次换一张图，测编码器 + 解码器
+                segmenter.embedding_cache.clear()
+                return segmenter.segment_array(rgb, center, [1])
+
+            self.measure(f"sam.segment_array@{size}", cold, size=size)
+            # 同一图像的后续点提示命中嵌入缓存，只运行掩码解码器
+            self.measure(f"sam.point_prompt_cached@{size}", lambda: segmenter.segment_array(rgb, center, [1]), size=size)
+
+    def run_inpaint(self):
+        from modules.inpainting import InpaintingProcessor
+        processor = InpaintingProcessor(self.config)
+        methods = [m for m in ("telea", "ns", "lama") if m in processor.get_available_methods()]
+        for size in self.args.sizes:
+            rgb = np.ascontiguousarray(self.image(size)[:, :, :3])
+            mask = create_test_mask(size)
+            for method in methods:
+                self.measure(
+                    f"inpaint.{method}@{size}",
+                    lambda: processor.inpaint_array(rgb, mask, method=method),
+                    size=size
+                )
+
+    # ------------------------------------------------------------------ 完整工作流
+
+    def run_workflow(self):
+        """
+        每个命名前缀运行完整流程：样例素材原尺寸，以及 --workflow-sizes 指定的合成图像
+        在临时目录中执行，不影响项目的 Sorted/Processed 目录和任务队列
+        """
+        from modules.workflow_manager import WorkflowManager
+        workdir = tempfile.mkdtemp(prefix="amber_bench_")
+        try:
+            config = Config()
+            for attr in ("raw_dir", "sorted_dir", "processed_dir", "compiled_dir", "temp_dir"):
+                setattr(config, attr, os.path.join(workdir, attr))
+            config.watch_dir = config.sorted_dir
+            config.output_dir = config.processed_dir
+            config.workflow_queue_path = os.path.join(workdir, "jobs.db")
+            config.incremental_build = False
+            manager = WorkflowManager(config)
+
+            samples = {}
+            if os.path.isdir(SAMPLE_DIR):
+                for filename in sorted(os.listdir(SAMPLE_DIR)):
+                    prefix = filename.split("_", 1)[0]
+                    if filename.lower().endswith(".png") and prefix not in samples:
+                        samples[prefix] = os.path.join(SAMPLE_DIR, filename)
+
+            for prefix in ("CHR", "UI", "ENV", "PRP"):
+                cases = []
+                if prefix in samples:
+                    cases.append(("sample", samples[prefix]))
+                for size in self.args.workflow_sizes:
+                    path = os.path.join(workdir, f"{prefix}_bench{size}.png")
+                    Image.fromarray(create_test_image(size, self.args.seed), "RGBA").save(path)
+                    cases.append((size, path))
+
+                for label, source in cases:
+                    counter = [0]
+
+                    def run():
+                        # 每次使用新文件名，避免命中历史记录
+                        counter[0] += 1
+                        filename = f"{prefix}_Bench{label}_v1_{counter[0]:02d}.png"
+                        shutil.copyfile(source, os.path.join(config.watch_dir, filename))
+                        result = manager.process_file(filename)
+                        if result.get("status") != "completed":
+                            raise RuntimeError(result.get("error") or "workflow failed")
+
+                    self.measure(f"workflow.{prefix}@{label}", run, repeat=self.args.workflow_repeat, warmup=0,
+                                 size=label)
+        finally:
+            shutil.rmtree(workdir, ignore_errors=True)
+
+    # ------------------------------------------------------------------ API 压测
+
+    def run_api(self):
+        """
+        对运行中的服务压测；未指定 --url 时在子进程中启动 backend/server.py
+        """
+        server = None
+        url = self.args.url
+        if not url:
+            port = free_port()
+            url = f"http://127.0.0.1:{port}"
+            server = subprocess.Popen(
+                [sys.executable, "-m", "uvicorn", "server:app", "--host", "127.0.0.1", "--port", str(port),
+                 "--log-level", "warning"],
+                cwd=os.path.dirname(os.path.abspath(__file__))
+            )
+            if not wait_for(url, timeout=120):
+                server.terminate()
+                for name in ("api.root", "api.workflow_status", "api.binary_normal", "api.binary_inpaint"):
+                    self.measure(name, self._skip("local server did not start"))
+                return
+        try:
+            size = self.args.api_size
+            rgba = self.image(size)
+            mask = create_test_mask(size)
+            requests = {
+                "api.root": ("GET", "/", None),
+                "api.inpaint_methods": ("GET", "/inpaint/methods", None),
+                "api.workflow_status": ("GET", "/workflow/status?history_limit=20", None),
+                "api.binary_normal": ("POST", f"/binary/generate-normal-map?width={size}&height={size}&channels=4",
+                                      rgba.tobytes()),
+                "api.binary_inpaint": ("POST", f"/binary/inpaint?width={size}&height={size}&channels=3&method=telea",
+                                       np.ascontiguousarray(rgba[:, :, :3]).tobytes() + mask.tobytes()),
+                "api.binary_segment": ("POST", f"/binary/segment?width={size}&height={size}&channels=4",
+                                       rgba.tobytes())
+            }
+            for name, (method, path, body) in requests.items():
+                self.load_test(name, url + path, method, body)
+        finally:
+            if server is not None:
+                server.terminate()
+                server.wait(timeout=30)
+
+    def load_test(self, name: str, url: str, method: str, body: bytes = None):
+        """
+        固定并发下发送 --api-requests 个请求，记录延迟分位数、吞吐量和错误数
+        """
+        total = self.args.api_requests
+        concurrency = self.args.concurrency
+
+        def one(_):
+            request = urllib.request.Request(url, data=body, method=method)
+            if body is not None:
+                request.add_header("Content-Type", "application/octet-stream")
+            start = time.perf_counter()
+            try:
+                with urllib.request.urlopen(request, timeout=300) as response:
+                    response.read()
+                    status = response.status
+            except urllib.error.HTTPError as e:
+                status = e.code
+            except Exception:
+                status = 0
+            return (time.perf_counter() - start) * 1000.0, status
+
+        entry = {"requests": total, "concurrency": concurrency}
+        try:
+            one(0)  # 预热
+            with PeakMonitor() as monitor:
+                start = time.perf_counter()
+                with ThreadPoolExecutor(max_workers=concurrency) as pool:
+                    samples = list(pool.map(one, range(total)))
+                elapsed = time.perf_counter() - start
+            ok = [ms for ms, status in samples if 200 <= status < 300]
+            statuses = {}
+            for _, status in samples:
+                statuses[str(status)] = statuses.get(str(status), 0) + 1
+            if not ok:
+                raise SkipCase(f"no successful responses (status counts: {statuses})")
+            entry.update(summarize(ok))
+            entry.update({
+                "status": "ok",
+                "errors": total - len(ok),
+                "status_counts": statuses,
+                "throughput_rps": round(len(ok) / elapsed, 2),
+                # 本地启动的服务在子进程中，这里只反映客户端；服务端内存见 /inference/stats
+                "peak_rss_mb": monitor.peak_rss_mb
+            })
+            print(f"  {name:<48} p50 {entry['median_ms']:>9.2f} ms  p99 {entry['p99_ms']:>9.2f} ms  "
+                  f"{entry['throughput_rps']:>8.1f} req/s  errors {entry['errors']}")
+        except SkipCase as e:
+            entry.update({"status": "skipped", "reason": str(e)})
+            print(f"  {name:<48} skipped: {e}")
+        except Exception as e:
+            entry.update({"status": "failed", "error": str(e)})
+            print(f"  {name:<48} FAILED: {e}")
+        self.results[name] = entry
+
+    @staticmethod
+    def _skip(reason: str):
+        def fn():
+            raise SkipCase(reason)
+        return fn
+
+    def run(self) -> dict:
+        for suite in self.args.suites:
+            print(f"[{suite}]")
+            getattr(self, f"run_{suite}")()
+        return {
+            "schema": SCHEMA_VERSION,
+            "created": datetime.now(timezone.utc).isoformat(),
+            "environment": environment_info(),
+            "settings": {
+                "suites": self.args.suites,
+                "sizes": self.args.sizes,
+                "repeat": self.args.repeat,
+                "warmup": self.args.warmup,
+                "seed": self.args.seed
+            },
+            "results": self.results
+        }
+
+
+def sam_startup_probe() -> int:
+    """
+    sam.startup_to_first_mask 的子进程入口：新建分割器并产出第一张掩码
+    """
+    from modules.segmentation import SAMSegmenter
+    segmenter = SAMSegmenter(Config())
+    blank = np.zeros((64, 64, 3), dtype=np.uint8)
+    if segmenter.predict_mask(blank, [(32, 32)], [1]) is None:
+        return SAM_PROBE_UNAVAILABLE
+    return 0
+
+
+def free_port() -> int:
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def wait_for(url: str, timeout: float) -> bool:
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            with urllib.request.urlopen(url + "/", timeout=2):
+                return True
+        except Exception:
+            time.sleep(0.5)
+    return False
+
+
+def environment_info() -> dict:
+    """
+    记录运行环境，比较结果时用于确认两次测试可比
+    """
+    info = {
+        "python": platform.python_version(),
+        "platform": platform.platform(),
+        "processor": platform.processor() or platform.machine(),
+        "cpu_count": os.cpu_count(),
+        "numpy": np.__version__
+    }
+    try:
+        info["git_commit"] = subprocess.check_output(
+            ["git", "rev-parse", "HEAD"], cwd=ROOT_DIR, stderr=subprocess.DEVNULL, text=True
+        ).strip()
+    except Exception:
+        info["git_commit"] = None
+    try:
+        import torch
+        info["torch"] = torch.__version__
+        info["cuda_device"] = torch.cuda.get_device_name(0) if torch.cuda.is_available() else None
+    except ImportError:
+        info["torch"] = None
+    return info
+
+
+def load_thresholds(path: str) -> dict:
+    if not path:
+        return {"default": {"metric": "median_ms", "max_ratio": 1.15, "min_delta_ms": 1.0}, "cases": {}}
+    with open(path, "r", encoding="utf-8") as f:
+        return json.load(f)
+
+
+def threshold_for(thresholds: dict, name: str) -> dict:
+    """
+    用例阈值：默认值 + 按出现顺序匹配的通配规则（后者覆盖前者）
+    """
+    rule = dict(thresholds.get("default", {}))
+    for pattern, override in thresholds.get("cases", {}).items():
+        if fnmatch.fnmatchcase(name, pattern):
+            rule.update(override)
+    return rule
+
+
+def compare(current: dict, baseline: dict, thresholds: dict) -> list:
+    """
+    按阈值检查结果：绝对上限总是检查，基线中有对应用例时再按比例比较
+
+    Args:
+        baseline: 基线结果，无基线时为 None
+
+    Returns:
+        回归列表，每项包含用例名、指标、基线值、当前值和比例
+    """
+    regressions = []
+    base_results = baseline.get("results", {}) if baseline else {}
+    for name, entry in current["results"].items():
+        rule = threshold_for(thresholds, name)
+        metric = rule.get("metric", "median_ms")
+        if entry.get("status") != "ok" or metric not in entry:
+            continue
+        value = entry[metric]
+        if "max_error_rate" in rule and entry.get("requests"):
+            error_rate = entry.get("errors", 0) / entry["requests"]
+            if error_rate > rule["max_error_rate"]:
+                regressions.append({"case": name, "metric": "error_rate", "limit": rule["max_error_rate"],
+                                    "current": round(error_rate, 4)})
+        if "max_ms" in rule and value > rule["max_ms"]:
+            regressions.append({"case": name, "metric": metric, "limit_ms": rule["max_ms"], "current": value})
+            continue
+        base = base_results.get(name)
+        if not base or base.get("status") != "ok" or metric not in base:
+            continue
+        ratio = value / base[metric] if base[metric] > 0 else float("inf")
+        entry["baseline_" + metric] = base[metric]
+        entry["ratio"] = round(ratio, 3)
+        if ratio > rule.get("max_ratio", 1.15) and value - base[metric] > rule.get("min_delta_ms", 1.0):
+            regressions.append({"case": name, "metric": metric, "baseline": base[metric],
+                                "current": value, "ratio": round(ratio, 3)})
+    return regressions
+
+
+def parse_args(argv=None):
+    parser = argparse.ArgumentParser(description="AmberPipeline benchmark suite")
+    int_list = lambda s: [int(v) for v in s.split(",") if v]
+    parser.add_argument("--suites", type=lambda s: s.split(","), default=ALL_SUITES,
+                        help=f"逗号分隔的测试组: {','.join(ALL_SUITES)}")
+    parser.add_argument("--sizes", type=int_list, default=DEFAULT_SIZES, help="图像边长列表")
+    parser.add_argument("--quick", action="store_true", help="只测 512 和 1024，重复 3 次")
+    parser.add_argument("--repeat", type=int, default=5)
+    parser.add_argument("--warmup", type=int, default=1)
+    parser.add_argument("--seed", type=int, default=1234)
+    parser.add_argument("--workflow-sizes", type=int_list, default=[1024, 2048])
+    parser.add_argument("--workflow-repeat", type=int, default=3)
+    parser.add_argument("--url", default="", help="被压测的服务地址，默认在子进程中启动本地服务")
+    parser.add_argument("--api-requests", type=int, default=200)
+    parser.add_argument("--concurrency", type=int, default=8)
+    parser.add_argument("--api-size", type=int, default=512, help="二进制接口请求的图像边长")
+    parser.add_argument("--output", default="benchmark_results.json")
+    parser.add_argument("--baseline", default="", help="基线结果 JSON")
+    parser.add_argument("--thresholds", default=os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                             "benchmark_thresholds.json"))
+    parser.add_argument("--sam-startup-probe", action="store_true", help=argparse.SUPPRESS)
+    args = parser.parse_args(argv)
+    unknown = [s for s in args.suites if s not in ALL_SUITES]
+    if unknown:
+        parser.error(f"unknown suites: {unknown}")
+    if args.quick:
+        args.sizes = [s for s in args.sizes if s <= 1024] or [512]
+        args.repeat = min(args.repeat, 3)
+        args.workflow_sizes = [512]
+        args.api_requests = min(args.api_requests, 50)
+    return args
+
+
+def main(argv=None) -> int:
+    args = parse_args(argv)
+    if args.sam_startup_probe:
+        return sam_startup_probe()
+    report = BenchmarkRunner(args).run()
+
+    baseline = None
+    if args.baseline:
+        with open(args.baseline, "r", encoding="utf-8") as f:
+            baseline = json.load(f)
+        report["baseline"] = {"file": os.path.abspath(args.baseline), "created": baseline.get("created"),
+                              "git_commit": baseline.get("environment", {}).get("git_commit")}
+    # 无基线时仍检查 max_ms / max_error_rate 等绝对上限
+    thresholds = load_thresholds(args.thresholds if os.path.exists(args.thresholds) else "")
+    regressions = compare(report, baseline, thresholds)
+    report["regressions"] = regressions
+
+    exit_code = 0
+    if regressions:
+        exit_code = 1
+        print(f"\n{len(regressions)} regression(s):")
+        for r in regressions:
+            print(f"  {r['case']}: {r}")
+    else:
+        print("\nNo regressions against baseline" if baseline else "\nAll cases within absolute limits")
+
+    with open(args.output, "w", encoding="utf-8") as f:
+        json.dump(report, f, indent=2, ensure_ascii=False)
+    print(f"Results written to {os.path.abspath(args.output)}")
+    return exit_code
+
+
+if __name__ == "__main__":
+    sys.exit(main())
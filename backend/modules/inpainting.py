@@ -5,11 +5,17 @@ Inpainting Module - 图像修复模块
 """
 
 import os
+import time
 import logging
+import concurrent.futures
 import numpy as np
 from PIL import Image
 import cv2
 
+from modules import metrics
+from modules.admission import CostModel, PROCESS_COSTS
+from modules.inpainting_engine import InpaintingEngine, LamaBackend
+
 logger = logging.getLogger(__name__)
 
 
@@ -30,10 +36,15 @@ class InpaintingProcessor:
         self.config = config
         self.use_lama = use_lama
         self.lama_model = None
+        self.engine = InpaintingEngine(max_workers=getattr(config, "inpaint_workers", 0))
         
         if use_lama:
             try:
-                self._load_lama_model()
+                started = time.perf_counter()
+                with metrics.span("model.load", model="lama"):
+                    self._load_lama_model()
+                if self.lama_model is not None:
+                    metrics.MODEL_LOAD_SECONDS.set(time.perf_counter() - started, model="lama")
             except Exception as e:
                 logger.warning(f"Failed to load LaMa model: {e}. Falling back to OpenCV inpainting.")
                 self.use_lama = False
@@ -42,16 +53,19 @@ class InpaintingProcessor:
     
     def _load_lama_model(self):
         """
-        加载 LaMa 模型
-        注意：这需要安装 lama-cleaner 或类似的库
+        加载 LaMa 模型（TorchScript 导出的 big-lama，按固定尺寸分块批量推理）
         """
         try:
-            # TODO: 集成 LaMa 模型
-            # from lama_cleaner.model_manager import ModelManager
-            # self.lama_model = ModelManager(name="lama", device="cuda" if torch.cuda.is_available() else "cpu")
+            self.lama_model = LamaBackend(
+                getattr(self.config, "inpaint_lama_model_path", "models/big-lama.pt"),
+                device=getattr(self.config, "inpaint_lama_device", "cuda"),
+                tile_size=getattr(self.config, "inpaint_lama_tile_size", 512),
+                batch_size=getattr(self.config, "inpaint_lama_batch_size", 4)
+            )
+            self.engine.lama = self.lama_model
             logger.info("LaMa model loaded successfully")
         except ImportError:
-            raise ImportError("LaMa model not available. Please install lama-cleaner package.")
+            raise ImportError("LaMa model not available. Please install torch.")
     
     def inpaint(self, image_path: str, mask_path: str, method: str = "telea", 
                 radius: int = 3, padding: int = 10) -> Image.Image:
@@ -79,58 +93,78 @@ class InpaintingProcessor:
             if mask is None:
                 raise ValueError(f"Failed to load mask: {mask_path}")
             
-            # 确保遮罩和图像尺寸一致
-            if mask.shape[:2] != image.shape[:2]:
-                mask = cv2.resize(mask, (image.shape[1], image.shape[0]))
-            
-            # 扩展遮罩（添加 padding）
-            if padding > 0:
-                kernel = np.ones((padding * 2 + 1, padding * 2 + 1), np.uint8)
-                mask = cv2.dilate(mask, kernel, iterations=1)
-            
-            # 二值化遮罩
-            _, mask = cv2.threshold(mask, 127, 255, cv2.THRESH_BINARY)
-            
-            # 执行修复
-            if method == "lama" and self.use_lama:
-                result = self._inpaint_with_lama(image, mask)
-            elif method == "ns":
-                result = cv2.inpaint(image, mask, radius, cv2.INPAINT_NS)
-            else:  # telea (default)
-                result = cv2.inpaint(image, mask, radius, cv2.INPAINT_TELEA)
-            
-            # 转换为 PIL Image
-            result_rgb = cv2.cvtColor(result, cv2.COLOR_BGR2RGB)
-            result_pil = Image.fromarray(result_rgb)
-            
-            logger.info(f"Inpainting completed using {method} method")
-            return result_pil
+            # 执行修复并转换为 PIL Image
+            result_rgb = self.inpaint_array(cv2.cvtColor(image, cv2.COLOR_BGR2RGB), mask, method, radius, padding)
+            return Image.fromarray(result_rgb)
             
         except Exception as e:
             logger.error(f"Inpainting failed: {str(e)}")
             raise
     
+    def inpaint_array(self, image: np.ndarray, mask: np.ndarray, method: str = "telea",
+                      radius: int = 3, padding: int = 10) -> np.ndarray:
+        """
+        对内存中的图像执行修复
+        
+        Args:
+            image: 原始图像 (H, W, 3) RGB uint8
+            mask: 遮罩 (H, W) uint8（非零区域将被修复）
+            method: 修复方法 ("telea", "ns", "lama")
+            radius: 修复半径（仅用于 OpenCV 方法）
+            padding: 遮罩扩展像素数
+            
+        Returns:
+            修复后的图像 (H, W, 3) RGB uint8
+        """
+        image, mask = self._prepare(image, mask, padding)
+        
+        # 只修复遮罩连通区域的外扩包围盒，各区域并行执行后拼回原图
+        if method == "lama" and self.use_lama:
+            result = self._inpaint_with_lama(image, mask)
+        else:
+            result = self.engine.inpaint(image, mask, "ns" if method == "ns" else "telea", radius)
+        
+        logger.info(f"Inpainting completed using {method} method")
+        return result
+    
+    @staticmethod
+    def _prepare(image: np.ndarray, mask: np.ndarray, padding: int) -> tuple:
+        """
+        统一图像/遮罩格式：RGB 图像，与图像同尺寸、扩展并二值化后的遮罩
+        """
+        if image.ndim == 3 and image.shape[2] == 4:
+            image = np.ascontiguousarray(image[:, :, :3])
+        if mask.ndim == 3:
+            mask = np.ascontiguousarray(mask[:, :, -1])
+        
+        # 确保遮罩和图像尺寸一致
+        if mask.shape[:2] != image.shape[:2]:
+            mask = cv2.resize(mask, (image.shape[1], image.shape[0]))
+        
+        # 扩展遮罩（添加 padding）
+        if padding > 0:
+            kernel = np.ones((padding * 2 + 1, padding * 2 + 1), np.uint8)
+            mask = cv2.dilate(mask, kernel, iterations=1)
+        
+        # 二值化遮罩
+        _, mask = cv2.threshold(mask, 127, 255, cv2.THRESH_BINARY)
+        return image, mask
+    
     def _inpaint_with_lama(self, image: np.ndarray, mask: np.ndarray) -> np.ndarray:
         """
         使用 LaMa 模型进行修复
         
         Args:
-            image: 输入图像 (BGR)
+            image: 输入图像 (RGB)
             mask: 遮罩图像 (灰度)
             
         Returns:
-            修复后的图像 (BGR)
+            修复后的图像 (RGB)
         """
         if self.lama_model is None:
             raise RuntimeError("LaMa model not loaded")
         
-        # TODO: 实现 LaMa 模型推理
-        # result = self.lama_model(image, mask)
-        # return result
-        
-        # 临时回退到 OpenCV
-        logger.warning("LaMa model not implemented, falling back to OpenCV")
-        return cv2.inpaint(image, mask, 3, cv2.INPAINT_TELEA)
+        return self.engine.inpaint(image, mask, "lama")
     
     def inpaint_with_preview(self, image_path: str, mask_path: str, 
                             method: str = "telea", radius: int = 3, 
@@ -189,25 +223,41 @@ class InpaintingProcessor:
         Returns:
             修复结果列表
         """
-        results = []
+        results = [None] * len(image_mask_pairs)
+        
+        def load(pair):
+            image_path, mask_path = pair
+            image = cv2.imread(image_path)
+            if image is None:
+                raise ValueError(f"Failed to load image: {image_path}")
+            mask = cv2.imread(mask_path, cv2.IMREAD_GRAYSCALE)
+            if mask is None:
+                raise ValueError(f"Failed to load mask: {mask_path}")
+            return self._prepare(cv2.cvtColor(image, cv2.COLOR_BGR2RGB), mask, padding)
         
-        for i, (image_path, mask_path) in enumerate(image_mask_pairs):
+        # 并行解码，所有图像的修复区域共享同一个工作池（LaMa 则共享批次）
+        loaded = []
+        with concurrent.futures.ThreadPoolExecutor(max_workers=self.engine.max_workers) as executor:
+            futures = [executor.submit(load, pair) for pair in image_mask_pairs]
+            for i, future in enumerate(futures):
+                try:
+                    loaded.append((i, future.result()))
+                except Exception as e:
+                    logger.error(f"Batch inpainting failed for item {i}: {str(e)}")
+                    results[i] = {"success": False, "error": str(e), "index": i}
+        
+        if loaded:
+            engine_method = method if (method != "lama" or self.use_lama) else "telea"
             try:
-                logger.info(f"Processing batch item {i+1}/{len(image_mask_pairs)}")
-                result = self.inpaint(image_path, mask_path, method, radius, padding)
-                results.append({
-                    "success": True,
-                    "image": result,
-                    "index": i
-                })
+                outputs = self.engine.inpaint_batch([item for _, item in loaded], engine_method, radius)
+                for (i, _), output in zip(loaded, outputs):
+                    results[i] = {"success": True, "image": Image.fromarray(output), "index": i}
             except Exception as e:
-                logger.error(f"Batch inpainting failed for item {i}: {str(e)}")
-                results.append({
-                    "success": False,
-                    "error": str(e),
-                    "index": i
-                })
+                logger.error(f"Batch inpainting failed: {str(e)}")
+                for i, _ in loaded:
+                    results[i] = {"success": False, "error": str(e), "index": i}
         
+        logger.info(f"Batch inpainting completed: {len(image_mask_pairs)} items")
         return results
     
     def get_available_methods(self) -> list:
@@ -222,6 +272,23 @@ class InpaintingProcessor:
             methods.append("lama")
         return methods
     
+    def estimate_cost(self, image_size: tuple, method: str = "telea") -> dict:
+        """
+        估算处理开销（与工作流准入调度器共用同一成本模型）
+        
+        Args:
+            image_size: 图像尺寸 (width, height)
+            method: 修复方法
+            
+        Returns:
+            包含 ram_mb、vram_mb、seconds 的字典
+        """
+        width, height = image_size
+        process = f"inpaint_{method}" if f"inpaint_{method}" in PROCESS_COSTS else "inpaint_telea"
+        # CPU 上运行的 LaMa 把显存开销计入内存
+        use_gpu = str(getattr(self.config, "inpaint_lama_device", "cuda")).startswith("cuda")
+        return CostModel(self.config, use_gpu=use_gpu).estimate(width, height, [process]).to_dict()
+    
     def estimate_processing_time(self, image_size: tuple, method: str = "telea") -> float:
         """
         估算处理时间
@@ -233,20 +300,7 @@ class InpaintingProcessor:
         Returns:
             估算的处理时间（秒）
         """
-        width, height = image_size
-        pixels = width * height
-        
-        # 基于经验的时间估算
-        if method == "lama":
-            # LaMa 模型较慢但效果好
-            return pixels / 100000  # 约 10 秒处理 1M 像素
-        elif method == "ns":
-            # Navier-Stokes 方法较慢
-            return pixels / 500000  # 约 2 秒处理 1M 像素
-        else:  # telea
-            # Telea 方法较快
-            return pixels / 1000000  # 约 1 秒处理 1M 像素
-
+        return self.estimate_cost(image_size, method)["seconds"]
 
 if __name__ == "__main__":
     # 测试代码
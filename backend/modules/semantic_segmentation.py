@@ -11,20 +11,25 @@ import os
 import tempfile
 from PIL import Image
 
+from modules.edge_snap import EdgeSnapIndex, EDGE_SNAP_EXTRA
+from modules.embedding_cache import EmbeddingCache
+
 class SemanticSegmentation:
     """
     语义分割类
     功能：实现语义涂抹、边缘自动吸附、关节补全等功能
     """
     
-    def __init__(self, model_path: str = None):
+    def __init__(self, model_path: str = None, embedding_cache: EmbeddingCache = None):
         """
         初始化语义分割模块
         
         Args:
             model_path (str, optional): 模型路径. Defaults to None.
+            embedding_cache (EmbeddingCache, optional): SAM 嵌入缓存，边缘吸附索引随嵌入一起缓存
         """
         self.model_path = model_path
+        self.embedding_cache = embedding_cache or EmbeddingCache(max_entries=4)
         self.parts_config = {
             'head': {'color': (255, 107, 107), 'label': 0},
             'body': {'color': (78, 205, 196), 'label': 1},
@@ -52,35 +57,66 @@ class SemanticSegmentation:
             if image is None:
                 return {'success': False, 'error': '无法读取图像'}
             
-            # 转换为灰度图
-            gray = cv2.cvtColor(image, cv2.COLOR_BGR2GRAY)
-            
-            # 计算边缘
-            edges = cv2.Canny(gray, 100, 200)
-            
-            # 查找每个点附近的边缘
-            snapped_points = []
-            for point in points:
-                x, y = int(point['x']), int(point['y'])
-                
-                # 在点周围查找边缘点
-                edge_points = self._find_closest_edge_points(edges, (x, y), radius=50)
-                
-                if edge_points:
-                    # 找到最近的边缘点
-                    closest_edge = min(edge_points, key=lambda p: self._distance((x, y), p))
-                    snapped_points.append({'x': closest_edge[0], 'y': closest_edge[1]})
-                else:
-                    # 如果没有找到边缘点，使用原始点
-                    snapped_points.append({'x': x, 'y': y})
-            
-            return {
-                'success': True,
-                'snappedPoints': snapped_points
-            }
+            return self.snap_points(cv2.cvtColor(image, cv2.COLOR_BGR2RGB), points)
         except Exception as e:
             return {'success': False, 'error': str(e)}
     
+    def get_snap_index(self, image: np.ndarray = None, image_id: str = None) -> EdgeSnapIndex:
+        """
+        获取图像的边缘吸附索引，每张图像只计算一次并随 SAM 嵌入缓存
+        
+        Args:
+            image (np.ndarray, optional): RGB 图像；省略时使用 image_id 对应的缓存图像
+            image_id (str, optional): 图像内容键（/segment/session 返回的 image_id）
+        
+        Returns:
+            EdgeSnapIndex，图像不可用时返回 None
+        """
+        if image_id is None:
+            if image is None:
+                return None
+            image_id = self.embedding_cache.hash_image(image)
+        
+        index = self.embedding_cache.get_extra(image_id, EDGE_SNAP_EXTRA)
+        if index is not None:
+            return index
+        
+        if image is None:
+            # 只有 image_id 时从 SAM 嵌入缓存中取回原图
+            entry = self.embedding_cache.get(image_id)
+            if entry is None or entry.get("image") is None:
+                return None
+            image = entry["image"]
+        
+        index = EdgeSnapIndex.build(image)
+        self.embedding_cache.put_extra(image_id, EDGE_SNAP_EXTRA, index)
+        return index
+    
+    def snap_points(self, image: np.ndarray, points: List[Dict[str, float]], radius: float = 50,
+                    image_id: str = None) -> Dict[str, Any]:
+        """
+        将点吸附到最近的边缘（O(1) 查表，远离边缘的点保持不变）
+        
+        Args:
+            image (np.ndarray): RGB 图像，提供 image_id 时可为 None
+            points (List[Dict[str, float]]): 点列表
+            radius (float): 吸附半径
+            image_id (str, optional): 图像内容键
+        
+        Returns:
+            Dict[str, Any]: 吸附结果
+        """
+        index = self.get_snap_index(image, image_id)
+        if index is None:
+            return {'success': False, 'error': '图像未缓存，请重新上传图像'}
+        
+        coords = np.array([[point['x'], point['y']] for point in points], dtype=np.float64)
+        snapped = index.snap(coords, radius) if len(coords) else np.zeros((0, 2), dtype=np.int64)
+        return {
+            'success': True,
+            'snappedPoints': [{'x': int(x), 'y': int(y)} for x, y in snapped]
+        }
+    
     def perform_joint_expansion(self, image_path: str, bbox: Dict[str, float], label: str) -> Dict[str, Any]:
         """
         执行关节补全
@@ -8,6 +8,10 @@ import os
 import sys
 import logging
 import base64
+import json
+import time
+import hmac
+import threading
 from io import BytesIO
 from PIL import Image
 import numpy as np
@@ -15,17 +19,24 @@ import numpy as np
 # 添加项目根目录到Python路径
 sys.path.append(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
 
-from fastapi import FastAPI, UploadFile, File, HTTPException, Query
+from fastapi import FastAPI, UploadFile, File, HTTPException, Query, Request, Response
+from fastapi.responses import JSONResponse, StreamingResponse, FileResponse
+from starlette.concurrency import run_in_threadpool
 from fastapi.middleware.cors import CORSMiddleware
 from pydantic import BaseModel
 
 # 导入现有的模块
 from config import Config
 from modules.segmentation import SAMSegmenter
+from modules.segmentation_engine import get_segmentation_engine
 from modules.normal_map import NormalMapGenerator
 from modules.workflow_manager import WorkflowManager
 from modules.inpainting import InpaintingProcessor
 from modules.semantic_segmentation import SemanticSegmentation
+from modules.brush_session import BrushSessionManager
+from modules.inference_executor import InferenceExecutor, QueueFullError, PRIORITIES
+from modules.cluster import LeaseLostError
+from modules import metrics
 
 # 配置日志
 logging.basicConfig(
@@ -46,8 +57,18 @@ sam_segmenter = None
 normal_generator = None
 inpainting_processor = None
 semantic_segmenter = None
+brush_sessions = BrushSessionManager()
+# 模型只创建一次，并发的首次请求通过锁串行化
+model_lock = threading.RLock()
 logger.info("AI models will be loaded on demand")
 
+# 推理执行器：每类负载一个有界优先级队列，交互请求优先于批量请求，队列满时返回429
+inference_executor = InferenceExecutor({
+    "segment": (config.inference_segment_workers, config.inference_queue_limit),
+    "normal": (config.inference_normal_workers, config.inference_queue_limit),
+    "inpaint": (config.inference_inpaint_workers, config.inference_queue_limit)
+})
+
 # 初始化工作流管理器
 logger.info("Initializing workflow manager...")
 workflow_manager = WorkflowManager(config)
@@ -60,6 +81,9 @@ app = FastAPI(
     version="1.0.0"
 )
 
+# 二进制传输端点使用的响应头（像素尺寸和通道数）
+RAW_IMAGE_HEADERS = ["X-Image-Width", "X-Image-Height", "X-Image-Channels", "X-Image-Id"]
+
 # 配置CORS
 app.add_middleware(
     CORSMiddleware,
@@ -67,8 +91,119 @@ app.add_middleware(
     allow_credentials=True,
     allow_methods=["*"],
     allow_headers=["*"],
+    expose_headers=RAW_IMAGE_HEADERS,
 )
 
+# 请求指标：按路由模板统计，避免路径参数造成标签爆炸
+HTTP_SECONDS = metrics.histogram("amber_http_request_duration_seconds", "HTTP request latency",
+                                 ["method", "route", "status"])
+HTTP_BYTES = metrics.histogram("amber_http_body_bytes", "HTTP request and response body sizes",
+                               ["direction", "route"], buckets=metrics.BYTE_BUCKETS)
+HTTP_IN_FLIGHT = metrics.gauge("amber_http_requests_in_flight", "HTTP requests being handled")
+
+@app.middleware("http")
+async def record_request_metrics(request: Request, call_next):
+    """
+    记录每个请求的延迟、请求/响应体大小，并在启用追踪时为请求创建span
+    """
+    started = time.perf_counter()
+    HTTP_IN_FLIGHT.inc()
+    status = 500
+    response = None
+    try:
+        with metrics.span(f"{request.method} {request.url.path}", method=request.method, path=request.url.path):
+            response = await call_next(request)
+        status = response.status_code
+        return response
+    finally:
+        HTTP_IN_FLIGHT.dec()
+        route = getattr(request.scope.get("route"), "path", "unmatched")
+        HTTP_SECONDS.observe(time.perf_counter() - started, method=request.method, route=route, status=status)
+        bytes_in = int(request.headers.get("content-length") or 0)
+        if bytes_in:
+            HTTP_BYTES.observe(bytes_in, direction="in", route=route)
+        # 流式响应没有Content-Length，不计入
+        bytes_out = int(response.headers.get("content-length") or 0) if response is not None else 0
+        if bytes_out:
+            HTTP_BYTES.observe(bytes_out, direction="out", route=route)
+
+def collect_server_metrics():
+    """
+    抓取时读取推理队列、嵌入缓存和批量分割引擎的统计（只读取已加载的组件）
+    """
+    stats = inference_executor.get_stats()
+    families = [
+        ("amber_inference_queue_pending", "gauge", "Requests waiting in each inference queue",
+         [({"queue": name}, s["pending"]) for name, s in stats.items()]),
+        ("amber_inference_queue_active", "gauge", "Requests running in each inference queue",
+         [({"queue": name}, s["active"]) for name, s in stats.items()]),
+        ("amber_inference_requests_total", "counter", "Finished inference requests",
+         [({"queue": name, "result": result}, s[result])
+          for name, s in stats.items() for result in ("completed", "failed", "rejected")])
+    ]
+    if sam_segmenter is not None:
+        cache = sam_segmenter.embedding_cache.get_stats()
+        families += [
+            ("amber_embedding_cache_lookups_total", "counter", "SAM2 embedding cache lookups",
+             [({"result": "hit"}, cache["hits"]), ({"result": "disk_hit"}, cache["disk_hits"]),
+              ({"result": "miss"}, cache["misses"])]),
+            ("amber_embedding_cache_hit_ratio", "gauge", "SAM2 embedding cache hit rate", [({}, cache["hit_rate"])]),
+            ("amber_embedding_cache_entries", "gauge", "SAM2 embeddings held in memory", [({}, cache["entries"])])
+        ]
+        families.append(("amber_sam_engine_queue_depth", "gauge", "Images waiting for a SAM2 batch",
+                         [({}, get_segmentation_engine(config).get_stats()["queue_depth"])]))
+    return families
+
+metrics.REGISTRY.register_collector("server", collect_server_metrics)
+
+@app.exception_handler(QueueFullError)
+async def queue_full_handler(request: Request, exc: QueueFullError):
+    """
+    推理队列已满：返回429，客户端稍后重试
+    """
+    return JSONResponse(
+        status_code=429,
+        content={"detail": str(exc), "queue": exc.queue_name},
+        headers={"Retry-After": "1"}
+    )
+
+@app.on_event("startup")
+def warm_up_models():
+    """
+    启动时在后台预热模型，避免首个请求承担模型加载和首次推理的开销
+    """
+    if config.sam_warmup:
+        # 创建分割器即开始后台加载SAM2（准备好的权重和编译缓存）
+        get_segmentation_engine(config)
+    if not config.server_warmup:
+        return
+    
+    def warm_up():
+        try:
+            blank = np.zeros((64, 64, 3), dtype=np.uint8)
+            get_normal_generator().generate_array(blank, None)
+            get_inpainting_processor()
+            get_semantic_segmenter()
+            segmenter = get_sam_segmenter()
+            segmenter.predict_mask(blank, [(32, 32)], [1])
+            logger.info("Model warm-up completed")
+        except Exception as e:
+            logger.warning(f"Model warm-up failed: {str(e)}")
+    
+    threading.Thread(target=warm_up, name="ModelWarmup", daemon=True).start()
+
+@app.on_event("startup")
+def configure_tracing():
+    """
+    按配置启用 OpenTelemetry 追踪
+    """
+    if config.tracing_enabled:
+        metrics.configure_tracing("amberpipeline-backend", config.tracing_otlp_endpoint)
+
+@app.on_event("shutdown")
+def shutdown_inference_executor():
+    inference_executor.shutdown()
+
 # 请求模型
 class SegmentationRequest(BaseModel):
     image_data: str
@@ -89,6 +224,34 @@ class InpaintingRequest(BaseModel):
 class BatchConfigRequest(BaseModel):
     max_parallel_tasks: int
 
+class ClusterWorkerRequest(BaseModel):
+    worker_id: str
+    host: str = ""
+    capabilities: list = ["cpu"]
+    slots: int = 1
+    stats: dict = {}
+
+class ClusterHeartbeatRequest(ClusterWorkerRequest):
+    job_ids: list = []
+
+class ClusterCompleteRequest(BaseModel):
+    worker_id: str
+    result: dict
+    output_root: str = None
+
+class ClusterReleaseRequest(BaseModel):
+    worker_id: str
+    error: str = ""
+
+class BrushSessionRequest(BaseModel):
+    width: int
+    height: int
+    blur_kernel: int = 15
+
+class BrushStrokesRequest(BaseModel):
+    strokes: list
+    base_revision: int = None
+
 # 辅助函数
 def base64_to_image(base64_str: str) -> Image.Image:
     """
@@ -143,6 +306,144 @@ def image_to_base64(image: Image.Image, format: str = 'PNG') -> str:
         logger.error(f"Failed to convert image to base64: {str(e)}")
         raise HTTPException(status_code=500, detail="Failed to process image")
 
+def get_sam_segmenter() -> SAMSegmenter:
+    """
+    获取SAM分割器，首次调用时加载（与工作流共享同一个模型实例）
+    
+    Returns:
+        SAMSegmenter实例
+    """
+    global sam_segmenter
+    if sam_segmenter is None:
+        with model_lock:
+            if sam_segmenter is None:
+                logger.info("Loading SAM segmenter model...")
+                sam_segmenter = get_segmentation_engine(config).segmenter
+                logger.info("SAM segmenter model loaded successfully")
+    return sam_segmenter
+
+def get_normal_generator() -> NormalMapGenerator:
+    """
+    获取法线贴图生成器，首次调用时创建
+    
+    Returns:
+        NormalMapGenerator实例
+    """
+    global normal_generator
+    if normal_generator is None:
+        with model_lock:
+            if normal_generator is None:
+                logger.info("Loading Normal Map Generator...")
+                normal_generator = NormalMapGenerator(config)
+                logger.info("Normal Map Generator loaded successfully")
+    return normal_generator
+
+def get_inpainting_processor() -> InpaintingProcessor:
+    """
+    获取Inpainting处理器，首次调用时创建
+    
+    Returns:
+        InpaintingProcessor实例
+    """
+    global inpainting_processor
+    if inpainting_processor is None:
+        with model_lock:
+            if inpainting_processor is None:
+                logger.info("Loading Inpainting Processor...")
+                inpainting_processor = InpaintingProcessor(config, use_lama=config.inpaint_use_lama)
+                logger.info("Inpainting Processor loaded successfully")
+    return inpainting_processor
+
+def get_semantic_segmenter() -> SemanticSegmentation:
+    """
+    获取语义分割模块，首次调用时创建；边缘吸附索引与 SAM 嵌入共用同一缓存
+    
+    Returns:
+        SemanticSegmentation实例
+    """
+    global semantic_segmenter
+    if semantic_segmenter is None:
+        with model_lock:
+            if semantic_segmenter is None:
+                logger.info("Loading Semantic Segmentation model...")
+                semantic_segmenter = SemanticSegmentation(config, embedding_cache=get_sam_segmenter().embedding_cache)
+                logger.info("Semantic Segmentation model loaded successfully")
+    return semantic_segmenter
+
+def parse_priority(priority: str) -> int:
+    """
+    解析请求优先级
+    
+    Args:
+        priority: "interactive"（默认，画布点击等）或 "batch"
+        
+    Returns:
+        推理队列优先级
+    """
+    if priority not in PRIORITIES:
+        raise HTTPException(status_code=400, detail=f"priority must be one of {list(PRIORITIES)}")
+    return PRIORITIES[priority]
+
+def parse_point_prompts(points: str, point_labels: str) -> tuple:
+    """
+    解析点提示查询参数
+    
+    Args:
+        points: 点坐标列表，格式："x1,y1;x2,y2;..."
+        point_labels: 点标签列表，格式："1;0;..."
+        
+    Returns:
+        (点坐标列表, 标签列表)
+    """
+    points_list = [tuple(map(int, map(float, p.split(',')))) for p in points.split(';') if p]
+    # 每个点取一个标签，兼容旧的 "1,0;..." 格式
+    labels_list = [int(l.split(',')[0]) for l in point_labels.split(';') if l]
+    if len(points_list) != len(labels_list):
+        raise HTTPException(status_code=400, detail="points and point_labels must have the same length")
+    return points_list, labels_list
+
+def decode_raw_image(body: bytes, width: int, height: int, channels: int) -> np.ndarray:
+    """
+    将原始像素字节解释为图像数组（不复制）
+    
+    Args:
+        body: 按行排列的uint8像素数据
+        width: 图像宽度
+        height: 图像高度
+        channels: 通道数（1、3或4）
+        
+    Returns:
+        只读的uint8数组，形状为(height, width, channels)，单通道时为(height, width)
+    """
+    if width <= 0 or height <= 0 or channels not in (1, 3, 4):
+        raise HTTPException(status_code=400, detail="Invalid image dimensions or channel count")
+    expected = width * height * channels
+    if len(body) != expected:
+        raise HTTPException(status_code=400, detail=f"Expected {expected} bytes of pixel data, got {len(body)}")
+    array = np.frombuffer(body, dtype=np.uint8)
+    return array.reshape((height, width)) if channels == 1 else array.reshape((height, width, channels))
+
+def raw_image_response(array: np.ndarray, image_id: str = None) -> Response:
+    """
+    将图像数组作为原始像素字节返回
+    
+    Args:
+        array: uint8数组，形状为(H, W)或(H, W, C)
+        image_id: 可选的图像ID，写入X-Image-Id响应头
+        
+    Returns:
+        application/octet-stream响应，尺寸信息放在X-Image-*响应头中
+    """
+    array = np.ascontiguousarray(array, dtype=np.uint8)
+    headers = {
+        "X-Image-Width": str(array.shape[1]),
+        "X-Image-Height": str(array.shape[0]),
+        "X-Image-Channels": str(array.shape[2] if array.ndim == 3 else 1)
+    }
+    if image_id:
+        headers["X-Image-Id"] = image_id
+    return Response(content=array.data, media_type="application/octet-stream", headers=headers)
+
 # API端点
 @app.get("/")
 def root():
@@ -155,89 +456,191 @@ def root():
         "endpoints": [
             "/docs",
             "/segment",
+            "/segment/session",
             "/generate-normal-map",
             "/inpaint",
-            "/inpaint/methods"
+            "/inpaint/methods",
+            "/binary/segment",
+            "/binary/generate-normal-map",
+            "/binary/inpaint",
+            "/inference/stats",
+            "/metrics",
+            "/cluster/status"
         ]
     }
 
 @app.post("/segment")
-def segment_image(
-    image: UploadFile = File(...),
+async def segment_image(
+    image: UploadFile = File(None),
     points: str = Query(None),
-    point_labels: str = Query(None)
+    point_labels: str = Query(None),
+    image_id: str = Query(None),
+    priority: str = Query("interactive")
 ):
     """
     执行图像分割（背景移除）
     
     Args:
-        image: 上传的图像文件
+        image: 上传的图像文件（提供image_id时可省略）
         points: 点坐标列表，格式："x1,y1;x2,y2;..."
-        point_labels: 点标签列表，格式："0,1;1,0;..."
+        point_labels: 点标签列表，格式："1;0;..."（每个点一个标签）
+        image_id: /segment/session 返回的图像ID，命中缓存时只运行掩码解码器
+        priority: 推理优先级（interactive 或 batch）
         
     Returns:
-        分割后的图像Base64字符串
+        分割后的图像Base64字符串和图像ID
     """
     try:
-        logger.info(f"Received segmentation request for image: {image.filename}")
-        
-        # 确保SAM模型已加载
-        global sam_segmenter
-        if sam_segmenter is None:
-            logger.info("Loading SAM segmenter model...")
-            from modules.segmentation import SAMSegmenter
-            sam_segmenter = SAMSegmenter(config)
-            logger.info("SAM segmenter model loaded successfully")
-        
-        # 读取图像文件
-        image_data = image.file.read()
-        image = Image.open(BytesIO(image_data))
+        level = parse_priority(priority)
+        image_data = await image.read() if image is not None else None
         
-        # 保存临时图像用于处理，使用唯一文件名避免冲突
-        temp_path = f"temp_segmentation_input_{id(image)}.png"
-        image.save(temp_path)
-        
-        # 处理点坐标
-        if points and point_labels:
-            # 解析点坐标
-            points_list = [tuple(map(int, p.split(','))) for p in points.split(';')]
-            # 解析点标签
-            labels_list = [tuple(map(int, l.split(','))) for l in point_labels.split(';')]
+        def run():
+            segmenter = get_sam_segmenter()
             
-            logger.info(f"Using point prompts: {points_list}, labels: {labels_list}")
+            # 使用缓存的图像嵌入，跳过上传和图像编码器
+            if image_id and points and point_labels:
+                points_list, labels_list = parse_point_prompts(points, point_labels)
+                logger.info(f"Segmenting cached image {image_id} with {len(points_list)} point prompts")
+                result = segmenter.segment_image_id(image_id, points_list, labels_list)
+                if result is None:
+                    if image_data is None:
+                        raise HTTPException(status_code=404, detail="Image embedding not cached, upload the image again")
+                else:
+                    return {
+                        "success": True,
+                        "image": image_to_base64(result),
+                        "image_id": image_id
+                    }
             
-            # 使用带有点提示的分割
-            result = sam_segmenter.segment_with_points(temp_path, points_list, labels_list)
-        else:
-            # 使用自动分割
-            result = sam_segmenter.segment(temp_path)
-        
-        # 删除临时文件
-        os.remove(temp_path)
+            if image_data is None:
+                raise HTTPException(status_code=400, detail="Either image or image_id with points is required")
+            
+            logger.info(f"Received segmentation request for image: {image.filename}")
+            
+            # 在内存中解码图像，不写临时文件
+            image_np = np.asarray(Image.open(BytesIO(image_data)).convert('RGB'))
+            current_image_id = segmenter.embedding_cache.hash_image(image_np)
+            
+            # 处理点坐标
+            points_list, labels_list = None, None
+            if points and point_labels:
+                points_list, labels_list = parse_point_prompts(points, point_labels)
+                logger.info(f"Using point prompts: {points_list}, labels: {labels_list}")
+            
+            # 执行分割（图像嵌入会被缓存）
+            result = segmenter.segment_array(image_np, points_list, labels_list)
+            
+            if result is None:
+                raise HTTPException(status_code=500, detail="Segmentation failed")
+            
+            logger.info(f"Segmentation completed successfully for image: {image.filename}")
+            
+            return {
+                "success": True,
+                "image": image_to_base64(Image.fromarray(result)),
+                "image_id": current_image_id
+            }
         
-        if result is None:
-            raise HTTPException(status_code=500, detail="Segmentation failed")
+        return await inference_executor.run("segment", run, priority=level)
         
-        # 转换为Base64
-        result_base64 = image_to_base64(result)
+    except (HTTPException, QueueFullError):
+        raise
+    except Exception as e:
+        logger.error(f"Segmentation error: {str(e)}")
+        raise HTTPException(status_code=500, detail=f"Segmentation failed: {str(e)}")
+
+@app.post("/segment/session")
+async def create_segmentation_session(image: UploadFile = File(...), priority: str = Query("interactive")):
+    """
+    上传图像并运行一次图像编码器，缓存嵌入供后续点提示使用
+    
+    Args:
+        image: 上传的图像文件
+        priority: 推理优先级（interactive 或 batch）
         
-        logger.info(f"Segmentation completed successfully for image: {image.filename}")
+    Returns:
+        图像ID和尺寸
+    """
+    try:
+        logger.info(f"Received segmentation session request for image: {image.filename}")
+        level = parse_priority(priority)
+        image_data = await image.read()
+        session = await inference_executor.run(
+            "segment", lambda: get_sam_segmenter().create_session(Image.open(BytesIO(image_data))), priority=level
+        )
+        if session is None:
+            raise HTTPException(status_code=500, detail="Failed to encode image")
         
         return {
             "success": True,
-            "image": result_base64
+            **session
         }
         
-    except HTTPException:
+    except (HTTPException, QueueFullError):
         raise
     except Exception as e:
-        logger.error(f"Segmentation error: {str(e)}")
-        raise HTTPException(status_code=500, detail=f"Segmentation failed: {str(e)}")
+        logger.error(f"Segmentation session error: {str(e)}")
+        raise HTTPException(status_code=500, detail=f"Failed to create session: {str(e)}")
+
+@app.get("/segment/cache-stats")
+def get_embedding_cache_stats():
+    """
+    获取图像嵌入缓存的统计信息
+    
+    Returns:
+        缓存条目数和命中率
+    """
+    try:
+        return {
+            "success": True,
+            "stats": get_sam_segmenter().embedding_cache.get_stats()
+        }
+    except Exception as e:
+        logger.error(f"Failed to get embedding cache stats: {str(e)}")
+        raise HTTPException(status_code=500, detail=f"Failed to get stats: {str(e)}")
+
+@app.get("/segment/engine-stats")
+def get_segmentation_engine_stats():
+    """
+    获取批量分割引擎的统计信息
+    
+    Returns:
+        每批延迟、吞吐量和队列深度
+    """
+    try:
+        return {
+            "success": True,
+            "stats": get_segmentation_engine(config).get_stats()
+        }
+    except Exception as e:
+        logger.error(f"Failed to get segmentation engine stats: {str(e)}")
+        raise HTTPException(status_code=500, detail=f"Failed to get stats: {str(e)}")
+
+@app.get("/inference/stats")
+def get_inference_stats():
+    """
+    获取推理执行器各队列的统计信息
+    
+    Returns:
+        每个队列的等待数、运行数、拒绝数和平均等待/运行时间
+    """
+    return {
+        "success": True,
+        "stats": inference_executor.get_stats()
+    }
+
+@app.get("/metrics")
+def get_metrics():
+    """
+    Prometheus 指标（文本格式）：请求延迟、各阶段耗时、队列深度、缓存命中率、显存等
+    """
+    return Response(content=metrics.REGISTRY.render(), media_type="text/plain; version=0.0.4; charset=utf-8")
 
 @app.post("/generate-normal-map")
-def generate_normal_map(
+async def generate_normal_map(
     image: UploadFile = File(...),
-    strength: float = Query(None)
+    strength: float = Query(None),
+    priority: str = Query("interactive")
 ):
     """
     生成法线贴图
@@ -245,41 +648,29 @@ def generate_normal_map(
     Args:
         image: 上传的图像文件
         strength: 法线强度
+        priority: 推理优先级（interactive 或 batch）
         
     Returns:
         生成的法线贴图Base64字符串
     """
     try:
         logger.info(f"Received normal map generation request for image: {image.filename}")
+        level = parse_priority(priority)
         
-        # 确保法线贴图生成器已加载
-        global normal_generator
-        if normal_generator is None:
-            logger.info("Loading Normal Map Generator...")
-            from modules.normal_map import NormalMapGenerator
-            normal_generator = NormalMapGenerator(config)
-            logger.info("Normal Map Generator loaded successfully")
-        
-        # 读取图像文件
-        image_data = image.file.read()
-        image = Image.open(BytesIO(image_data))
+        image_data = await image.read()
         
-        # 保存临时图像用于处理，使用唯一文件名避免冲突
-        temp_path = f"temp_normal_map_input_{id(image)}.png"
-        image.save(temp_path)
+        def run():
+            # 在推理线程中解码和转换，不占用事件循环
+            image_pil = Image.open(BytesIO(image_data))
+            if image_pil.mode not in ('L', 'RGB', 'RGBA'):
+                image_pil = image_pil.convert('RGBA')
+            result = get_normal_generator().generate_array(np.asarray(image_pil), strength)
+            return None if result is None else image_to_base64(Image.fromarray(result))
         
-        # 生成法线贴图
-        result = normal_generator.generate(temp_path, strength)
-        
-        # 删除临时文件
-        os.remove(temp_path)
-        
-        if result is None:
+        result_base64 = await inference_executor.run("normal", run, priority=level)
+        if result_base64 is None:
             raise HTTPException(status_code=500, detail="Normal map generation failed")
         
-        # 转换为Base64
-        result_base64 = image_to_base64(result)
-        
         logger.info(f"Normal map generated successfully for image: {image.filename}")
         
         return {
@@ -287,19 +678,20 @@ def generate_normal_map(
             "image": result_base64
         }
         
-    except HTTPException:
+    except (HTTPException, QueueFullError):
         raise
     except Exception as e:
         logger.error(f"Normal map generation error: {str(e)}")
         raise HTTPException(status_code=500, detail=f"Normal map generation failed: {str(e)}")
 
 @app.post("/inpaint")
-def inpaint_image(
+async def inpaint_image(
     image: UploadFile = File(...),
     mask: UploadFile = File(...),
     method: str = Query("telea", description="Inpainting method: telea, ns, or lama"),
     radius: int = Query(3, description="Inpainting radius (for OpenCV methods)"),
-    padding: int = Query(10, description="Mask padding in pixels")
+    padding: int = Query(10, description="Mask padding in pixels"),
+    priority: str = Query("interactive")
 ):
     """
     执行图像修复（Inpainting）
@@ -310,55 +702,35 @@ def inpaint_image(
         method: 修复方法 (telea, ns, lama)
         radius: 修复半径（仅用于 OpenCV 方法）
         padding: 遮罩扩展像素数
+        priority: 推理优先级（interactive 或 batch）
         
     Returns:
         修复后的图像Base64字符串
     """
     try:
         logger.info(f"Received inpainting request for image: {image.filename}, mask: {mask.filename}")
-        
-        # 确保 Inpainting 处理器已加载
-        global inpainting_processor
-        if inpainting_processor is None:
-            logger.info("Loading Inpainting Processor...")
-            from modules.inpainting import InpaintingProcessor
-            inpainting_processor = InpaintingProcessor(config, use_lama=False)
-            logger.info("Inpainting Processor loaded successfully")
-        
-        # 读取图像文件
-        image_data = image.file.read()
-        image_pil = Image.open(BytesIO(image_data))
-        
-        # 读取遮罩文件
-        mask_data = mask.file.read()
-        mask_pil = Image.open(BytesIO(mask_data))
-        
-        # 保存临时文件
-        temp_image_path = f"temp_inpaint_image_{id(image_pil)}.png"
-        temp_mask_path = f"temp_inpaint_mask_{id(mask_pil)}.png"
-        
-        image_pil.save(temp_image_path)
-        mask_pil.save(temp_mask_path)
-        
-        # 执行修复
-        result = inpainting_processor.inpaint(
-            temp_image_path, 
-            temp_mask_path, 
-            method=method,
-            radius=radius,
-            padding=padding
-        )
-        
-        # 删除临时文件
-        os.remove(temp_image_path)
-        os.remove(temp_mask_path)
-        
-        if result is None:
+        level = parse_priority(priority)
+        
+        image_data = await image.read()
+        mask_data = await mask.read()
+        
+        def run():
+            # 解码在推理线程中进行，大图上传不阻塞事件循环
+            image_np = np.asarray(Image.open(BytesIO(image_data)).convert('RGB'))
+            mask_np = np.asarray(Image.open(BytesIO(mask_data)).convert('L'))
+            result = get_inpainting_processor().inpaint_array(
+                image_np,
+                mask_np,
+                method=method,
+                radius=radius,
+                padding=padding
+            )
+            return None if result is None else image_to_base64(Image.fromarray(result))
+        
+        result_base64 = await inference_executor.run("inpaint", run, priority=level)
+        if result_base64 is None:
             raise HTTPException(status_code=500, detail="Inpainting failed")
         
-        # 转换为Base64
-        result_base64 = image_to_base64(result)
-        
         logger.info(f"Inpainting completed successfully using {method} method")
         
         return {
@@ -369,7 +741,7 @@ def inpaint_image(
             "padding": padding
         }
         
-    except HTTPException:
+    except (HTTPException, QueueFullError):
         raise
     except Exception as e:
         logger.error(f"Inpainting error: {str(e)}")
@@ -385,12 +757,7 @@ def get_inpainting_methods():
     """
     try:
         # 确保 Inpainting 处理器已加载
-        global inpainting_processor
-        if inpainting_processor is None:
-            from modules.inpainting import InpaintingProcessor
-            inpainting_processor = InpaintingProcessor(config, use_lama=False)
-        
-        methods = inpainting_processor.get_available_methods()
+        methods = get_inpainting_processor().get_available_methods()
         
         return {
             "success": True,
@@ -406,39 +773,217 @@ def get_inpainting_methods():
         logger.error(f"Failed to get inpainting methods: {str(e)}")
         raise HTTPException(status_code=500, detail=f"Failed to get methods: {str(e)}")
 
+# 二进制传输 API 端点
+# 请求体和响应体均为按行排列的uint8原始像素，跳过PNG编解码、Base64和临时文件
+@app.post("/binary/segment")
+async def segment_image_binary(
+    request: Request,
+    width: int = Query(0),
+    height: int = Query(0),
+    channels: int = Query(4),
+    points: str = Query(None),
+    point_labels: str = Query(None),
+    image_id: str = Query(None),
+    output: str = Query("alpha"),
+    priority: str = Query("interactive")
+):
+    """
+    执行图像分割，使用原始像素传输
+    
+    Args:
+        request: 请求体为原始像素（提供image_id时可为空）
+        width: 图像宽度
+        height: 图像高度
+        channels: 请求体通道数（1、3或4）
+        points: 点坐标列表，格式："x1,y1;x2,y2;..."
+        point_labels: 点标签列表，格式："1;0;..."
+        image_id: /segment/session 返回的图像ID，命中缓存时只运行掩码解码器
+        output: "alpha" 只返回单通道遮罩，"rgba" 返回带透明通道的图像
+        priority: 推理优先级（interactive 或 batch）
+        
+    Returns:
+        原始像素响应，X-Image-Id 响应头为图像ID
+    """
+    try:
+        if output not in ("alpha", "rgba"):
+            raise HTTPException(status_code=400, detail="output must be 'alpha' or 'rgba'")
+        
+        points_list, labels_list = None, None
+        if points and point_labels:
+            points_list, labels_list = parse_point_prompts(points, point_labels)
+        
+        level = parse_priority(priority)
+        body = await request.body()
+        
+        def run():
+            segmenter = get_sam_segmenter()
+            
+            # 使用缓存的图像嵌入，跳过图像编码器
+            if image_id and points_list:
+                cached = segmenter.predict_mask_image_id(image_id, points_list, labels_list, return_image=True)
+                if cached is not None:
+                    return cached[0], cached[1], image_id
+                if not body:
+                    raise HTTPException(status_code=404, detail="Image embedding not cached, upload the image again")
+            
+            rgb = segmenter.load_rgb(decode_raw_image(body, width, height, channels))
+            mask = segmenter.predict_mask(rgb, points_list, labels_list)
+            return mask, rgb, segmenter.embedding_cache.hash_image(rgb)
+        
+        mask, rgb, current_image_id = await inference_executor.run("segment", run, priority=level)
+        if mask is None:
+            raise HTTPException(status_code=500, detail="Segmentation failed")
+        
+        if output == "alpha":
+            return raw_image_response(mask, current_image_id)
+        
+        rgba = np.empty((mask.shape[0], mask.shape[1], 4), dtype=np.uint8)
+        rgba[:, :, :3] = rgb
+        rgba[:, :, 3] = mask
+        return raw_image_response(rgba, current_image_id)
+        
+    except (HTTPException, QueueFullError):
+        raise
+    except Exception as e:
+        logger.error(f"Binary segmentation error: {str(e)}")
+        raise HTTPException(status_code=500, detail=f"Segmentation failed: {str(e)}")
+
+@app.post("/binary/generate-normal-map")
+async def generate_normal_map_binary(
+    request: Request,
+    width: int = Query(...),
+    height: int = Query(...),
+    channels: int = Query(4),
+    strength: float = Query(None),
+    priority: str = Query("interactive")
+):
+    """
+    生成法线贴图，使用原始像素传输
+    
+    Args:
+        request: 请求体为原始像素
+        width: 图像宽度
+        height: 图像高度
+        channels: 请求体通道数（1、3或4）
+        strength: 法线强度
+        priority: 推理优先级（interactive 或 batch）
+        
+    Returns:
+        原始像素响应，输入带透明通道时为RGBA，否则为RGB
+    """
+    try:
+        level = parse_priority(priority)
+        image_np = decode_raw_image(await request.body(), width, height, channels)
+        result = await inference_executor.run(
+            "normal", lambda: get_normal_generator().generate_array(image_np, strength), priority=level
+        )
+        
+        if result is None:
+            raise HTTPException(status_code=500, detail="Normal map generation failed")
+        
+        return raw_image_response(result)
+        
+    except (HTTPException, QueueFullError):
+        raise
+    except Exception as e:
+        logger.error(f"Binary normal map generation error: {str(e)}")
+        raise HTTPException(status_code=500, detail=f"Normal map generation failed: {str(e)}")
+
+@app.post("/binary/inpaint")
+async def inpaint_image_binary(
+    request: Request,
+    width: int = Query(...),
+    height: int = Query(...),
+    channels: int = Query(4),
+    method: str = Query("lama"),
+    radius: int = Query(3),
+    padding: int = Query(10),
+    priority: str = Query("interactive")
+):
+    """
+    执行图像修复，使用原始像素传输
+    
+    Args:
+        request: 请求体为图像原始像素，后接 width*height 字节的单通道遮罩
+        width: 图像宽度
+        height: 图像高度
+        channels: 图像通道数（3或4）
+        method: 修复方法，可选值：lama, ns, telea
+        radius: 修复半径
+        padding: 遮罩边缘扩展像素数
+        priority: 推理优先级（interactive 或 batch）
+        
+    Returns:
+        原始像素响应，通道数与输入图像相同（透明通道原样保留）
+    """
+    try:
+        if channels not in (3, 4):
+            raise HTTPException(status_code=400, detail="channels must be 3 or 4")
+        
+        level = parse_priority(priority)
+        body = memoryview(await request.body())
+        image_size = width * height * channels
+        # 切片 memoryview 不复制像素数据
+        image_np = decode_raw_image(body[:image_size], width, height, channels)
+        mask_np = decode_raw_image(body[image_size:], width, height, 1)
+        
+        result = await inference_executor.run(
+            "inpaint",
+            lambda: get_inpainting_processor().inpaint_array(
+                image_np,
+                mask_np,
+                method=method,
+                radius=radius,
+                padding=padding
+            ),
+            priority=level
+        )
+        
+        if result is None:
+            raise HTTPException(status_code=500, detail="Inpainting failed")
+        
+        if channels == 4:
+            rgba = np.empty((height, width, 4), dtype=np.uint8)
+            rgba[:, :, :3] = result
+            rgba[:, :, 3] = image_np[:, :, 3]
+            result = rgba
+        
+        return raw_image_response(result)
+        
+    except (HTTPException, QueueFullError):
+        raise
+    except Exception as e:
+        logger.error(f"Binary inpainting error: {str(e)}")
+        raise HTTPException(status_code=500, detail=f"Inpainting failed: {str(e)}")
+
 # 语义分割 API 端点
 @app.post("/semantic/edge-snap")
 def edge_snap(
-    image: UploadFile = File(...),
+    image: UploadFile = File(None),
     points: str = Query(...),
-    labels: str = Query(...)
+    labels: str = Query(...),
+    image_id: str = Query(None),
+    radius: float = Query(50)
 ):
     """
     执行边缘自动吸附
+    边缘吸附索引每张图像只计算一次，与 SAM 嵌入共用缓存；之后的吸附请求只需 image_id
     
     Args:
-        image: 上传的图像文件
+        image: 上传的图像文件（提供image_id时可省略）
         points: 点坐标列表，格式："x1,y1;x2,y2;..."
         labels: 点标签列表，格式："foreground,background;..."
+        image_id: 图像ID（/segment/session 或上一次吸附返回）
+        radius: 吸附半径（像素）
         
     Returns:
         吸附后的边缘点列表
     """
     try:
-        logger.info(f"Received edge snap request for image: {image.filename}")
+        logger.info(f"Received edge snap request for image: {image.filename if image else image_id}")
         
         # 确保语义分割模型已加载
-        global semantic_segmenter
-        if semantic_segmenter is None:
-            logger.info("Loading Semantic Segmentation model...")
-            semantic_segmenter = SemanticSegmentation(config)
-            logger.info("Semantic Segmentation model loaded successfully")
-        
-        # 读取图像文件
-        image_data = image.file.read()
-        temp_path = f"temp_edge_snap_input_{id(image)}.png"
-        with open(temp_path, "wb") as f:
-            f.write(image_data)
+        semantic = get_semantic_segmenter()
         
         # 解析点坐标
         points_list = []
@@ -446,17 +991,24 @@ def edge_snap(
             x, y = point.split(',')
             points_list.append({'x': float(x), 'y': float(y)})
         
-        # 解析标签
-        label = labels.split(';')[0] if labels else 'foreground'
+        # 解码图像（内存中完成，不写临时文件）
+        image_np = None
+        if image is not None:
+            image_np = np.asarray(Image.open(BytesIO(image.file.read())).convert('RGB'))
+            image_id = semantic.embedding_cache.hash_image(image_np)
+        elif not image_id:
+            raise HTTPException(status_code=400, detail="Either image or image_id is required")
         
         # 执行边缘吸附
-        result = semantic_segmenter.perform_edge_snap(temp_path, points_list, label)
-        
-        # 删除临时文件
-        os.remove(temp_path)
+        result = semantic.snap_points(image_np, points_list, radius=radius, image_id=image_id)
+        if not result.get('success') and image_np is None:
+            raise HTTPException(status_code=404, detail="Image not cached, upload the image again")
+        result['image_id'] = image_id
         
         return result
         
+    except HTTPException:
+        raise
     except Exception as e:
         logger.error(f"Edge snap error: {str(e)}")
         raise HTTPException(status_code=500, detail=f"Edge snap failed: {str(e)}")
@@ -482,11 +1034,7 @@ def joint_expansion(
         logger.info(f"Received joint expansion request for image: {image.filename}")
         
         # 确保语义分割模型已加载
-        global semantic_segmenter
-        if semantic_segmenter is None:
-            logger.info("Loading Semantic Segmentation model...")
-            semantic_segmenter = SemanticSegmentation(config)
-            logger.info("Semantic Segmentation model loaded successfully")
+        semantic_segmenter = get_semantic_segmenter()
         
         # 读取图像文件
         image_data = image.file.read()
@@ -545,11 +1093,7 @@ def apply_preset(
         logger.info(f"Received apply preset request for image: {image.filename}, preset: {preset_id}")
         
         # 确保语义分割模型已加载
-        global semantic_segmenter
-        if semantic_segmenter is None:
-            logger.info("Loading Semantic Segmentation model...")
-            semantic_segmenter = SemanticSegmentation(config)
-            logger.info("Semantic Segmentation model loaded successfully")
+        semantic_segmenter = get_semantic_segmenter()
         
         # 读取图像文件
         image_data = image.file.read()
@@ -600,11 +1144,7 @@ def process_brush(
         logger.info(f"Received process brush request for image: {image.filename}")
         
         # 确保语义分割模型已加载
-        global semantic_segmenter
-        if semantic_segmenter is None:
-            logger.info("Loading Semantic Segmentation model...")
-            semantic_segmenter = SemanticSegmentation(config)
-            logger.info("Semantic Segmentation model loaded successfully")
+        semantic_segmenter = get_semantic_segmenter()
         
         # 读取图像文件
         image_data = image.file.read()
@@ -639,6 +1179,82 @@ def process_brush(
         logger.error(f"Process brush error: {str(e)}")
         raise HTTPException(status_code=500, detail=f"Process brush failed: {str(e)}")
 
+@app.post("/semantic/brush/session")
+def create_brush_session(request: BrushSessionRequest):
+    """
+    创建语义涂抹会话，遮罩常驻内存，后续只发送新增笔触
+    
+    Args:
+        request: 遮罩宽高与模糊核大小
+        
+    Returns:
+        会话ID
+    """
+    try:
+        if request.width <= 0 or request.height <= 0:
+            raise HTTPException(status_code=400, detail="width and height must be positive")
+        session_id = brush_sessions.create(request.width, request.height, request.blur_kernel)
+        return {"success": True, "session_id": session_id, "width": request.width, "height": request.height}
+    except HTTPException:
+        raise
+    except Exception as e:
+        logger.error(f"Create brush session error: {str(e)}")
+        raise HTTPException(status_code=500, detail=f"Create brush session failed: {str(e)}")
+
+@app.post("/semantic/brush/{session_id}/strokes")
+def append_brush_strokes(session_id: str, request: BrushStrokesRequest):
+    """
+    追加笔触，只重绘新笔触并仅对脏矩形重新模糊
+    
+    Args:
+        session_id: 会话ID
+        request: 新增笔触；base_revision 为客户端当前版本，不一致时返回409，客户端应重取完整遮罩
+        
+    Returns:
+        新版本号、脏矩形及其RLE编码像素
+    """
+    try:
+        session = brush_sessions.get(session_id)
+        if session is None:
+            raise HTTPException(status_code=404, detail="Brush session not found")
+        with session.lock:
+            if request.base_revision is not None and request.base_revision != session.revision:
+                raise HTTPException(status_code=409, detail=f"Revision mismatch, server is at {session.revision}")
+            rect = session.apply(request.strokes)
+            delta = session.delta(rect)
+        return {"success": True, **delta}
+    except HTTPException:
+        raise
+    except Exception as e:
+        logger.error(f"Append brush strokes error: {str(e)}")
+        raise HTTPException(status_code=500, detail=f"Append brush strokes failed: {str(e)}")
+
+@app.get("/semantic/brush/{session_id}/mask")
+def get_brush_mask(session_id: str):
+    """
+    获取会话的完整遮罩（单通道原始像素，用于初次同步或版本不一致后的恢复）
+    
+    Args:
+        session_id: 会话ID
+        
+    Returns:
+        原始像素响应，X-Image-Id 为当前版本号
+    """
+    session = brush_sessions.get(session_id)
+    if session is None:
+        raise HTTPException(status_code=404, detail="Brush session not found")
+    with session.lock:
+        return raw_image_response(session.mask.copy(), str(session.revision))
+
+@app.delete("/semantic/brush/{session_id}")
+def close_brush_session(session_id: str):
+    """
+    关闭语义涂抹会话
+    """
+    if not brush_sessions.close(session_id):
+        raise HTTPException(status_code=404, detail="Brush session not found")
+    return {"success": True}
+
 # 工作流相关API端点
 @app.post("/workflow/start")
 def start_workflow():
@@ -677,15 +1293,18 @@ def stop_workflow():
         raise HTTPException(status_code=500, detail=f"Failed to stop workflow: {str(e)}")
 
 @app.get("/workflow/status")
-def get_workflow_status():
+def get_workflow_status(history_limit: int = Query(None)):
     """
     获取自动工作流状态
     
+    Args:
+        history_limit: 只返回最近N条处理/失败记录（省略时返回全部），完整历史请使用 /workflow/history
+        
     Returns:
         工作流当前状态信息
     """
     try:
-        status = workflow_manager.get_workflow_status()
+        status = workflow_manager.get_workflow_status(history_limit)
         return {
             "success": True,
             "status": status
@@ -694,6 +1313,99 @@ def get_workflow_status():
         logger.error(f"Failed to get workflow status: {str(e)}")
         raise HTTPException(status_code=500, detail=f"Failed to get workflow status: {str(e)}")
 
+@app.get("/workflow/history")
+def get_workflow_history(
+    status: str = Query("completed"),
+    offset: int = Query(0),
+    limit: int = Query(50)
+):
+    """
+    分页获取工作流处理历史，最新的在前
+    
+    Args:
+        status: completed 或 failed
+        offset: 跳过的记录数
+        limit: 每页记录数（最多500）
+        
+    Returns:
+        当前页记录和总数
+    """
+    if status not in ("completed", "failed"):
+        raise HTTPException(status_code=400, detail="status must be 'completed' or 'failed'")
+    try:
+        return {
+            "success": True,
+            **workflow_manager.get_history(status, offset, min(limit, 500))
+        }
+    except Exception as e:
+        logger.error(f"Failed to get workflow history: {str(e)}")
+        raise HTTPException(status_code=500, detail=f"Failed to get workflow history: {str(e)}")
+
+def format_sse(event: dict) -> str:
+    """
+    将工作流事件编码为 Server-Sent Events 消息
+    """
+    data = json.dumps(event["data"], ensure_ascii=False, default=str)
+    return f"id: {event['id']}\nevent: {event['type']}\ndata: {data}\n\n"
+
+@app.get("/workflow/events")
+async def workflow_events(request: Request, history_limit: int = Query(5)):
+    """
+    工作流事件流（Server-Sent Events）
+    推送任务状态变化（job_queued、job_started、job_finished）和每个阶段的进度（stage_progress）。
+    新连接先收到一条 snapshot 事件；断线重连时浏览器带上 Last-Event-ID，缓冲区内的事件会被补发，
+    否则重新发送 snapshot。
+    
+    Args:
+        request: 请求（读取 Last-Event-ID 请求头）
+        history_limit: snapshot 中包含的最近记录数
+        
+    Returns:
+        text/event-stream 响应
+    """
+    last_event_id = request.headers.get("last-event-id")
+    try:
+        last_event_id = int(last_event_id) if last_event_id else None
+    except ValueError:
+        last_event_id = None
+    
+    subscription, replay = workflow_manager.events.subscribe(last_event_id)
+    
+    async def snapshot() -> str:
+        # 状态读取任务队列（SQLite），放到线程池中，避免队列繁忙时阻塞事件循环
+        status = await run_in_threadpool(workflow_manager.get_workflow_status, history_limit)
+        return format_sse({"id": status["last_event_id"], "type": "snapshot", "data": status})
+    
+    async def stream():
+        try:
+            # 断线重连时浏览器按 retry 间隔（毫秒）重试
+            yield "retry: 2000\n\n"
+            if replay is None:
+                yield await snapshot()
+            else:
+                for event in replay:
+                    yield format_sse(event)
+            
+            while not await request.is_disconnected():
+                event = await subscription.get(timeout=15.0)
+                if subscription.overflowed:
+                    # 客户端跟不上事件速度：丢弃积压并重新同步
+                    subscription.overflowed = False
+                    yield await snapshot()
+                elif event is None:
+                    # 心跳注释，保持代理和浏览器连接
+                    yield ": keep-alive\n\n"
+                else:
+                    yield format_sse(event)
+        finally:
+            workflow_manager.events.unsubscribe(subscription)
+    
+    return StreamingResponse(
+        stream(),
+        media_type="text/event-stream",
+        headers={"Cache-Control": "no-cache", "X-Accel-Buffering": "no"}
+    )
+
 @app.post("/workflow/process-file/{filename}")
 def process_file(filename: str):
     """
@@ -769,7 +1481,8 @@ def get_batch_config():
             "success": True,
             "config": {
                 "max_parallel_tasks": workflow_manager.max_parallel_tasks,
-                "current_running_tasks": workflow_manager.current_running_tasks
+                "current_running_tasks": workflow_manager.current_running_tasks,
+                "scheduler": workflow_manager.scheduler.get_stats()
             }
         }
     except Exception as e:
@@ -801,6 +1514,125 @@ def set_batch_config(config: BatchConfigRequest):
         logger.error(f"Failed to set batch configuration: {str(e)}")
         raise HTTPException(status_code=500, detail=f"Failed to set batch configuration: {str(e)}")
 
+# 集群相关API端点（仅 cluster_role 为 coordinator 时启用）
+def get_cluster(request: Request):
+    """
+    校验集群令牌并返回协调器
+    """
+    if workflow_manager.cluster is None:
+        raise HTTPException(status_code=404, detail="Cluster coordinator is not enabled")
+    if config.cluster_token and not hmac.compare_digest(request.headers.get("X-Cluster-Token", ""), config.cluster_token):
+        raise HTTPException(status_code=401, detail="Invalid cluster token")
+    return workflow_manager.cluster
+
+def held_job_errors(func, *args):
+    """
+    调用协调器方法，把租约错误转换为HTTP状态码（404未知任务，409租约已失效，400非法路径）
+    """
+    try:
+        return func(*args)
+    except KeyError:
+        raise HTTPException(status_code=404, detail="Job not found")
+    except LeaseLostError as e:
+        raise HTTPException(status_code=409, detail=str(e))
+    except ValueError as e:
+        raise HTTPException(status_code=400, detail=str(e))
+
+@app.post("/cluster/heartbeat")
+def cluster_heartbeat(body: ClusterHeartbeatRequest, request: Request):
+    """
+    工作节点心跳：注册/刷新节点信息并续租正在运行的任务
+    
+    Returns:
+        仍持有租约的任务ID（held）和租约时长
+    """
+    cluster = get_cluster(request)
+    info = body.model_dump(exclude={"worker_id", "job_ids"})
+    held = cluster.heartbeat(body.worker_id, [int(job_id) for job_id in body.job_ids], info)
+    return {"success": True, "held": held, "lease_seconds": cluster.lease_seconds}
+
+@app.post("/cluster/jobs/claim")
+def cluster_claim_job(body: ClusterWorkerRequest, request: Request):
+    """
+    工作节点领取任务：按节点能力（cpu/gpu）分配，带租约
+    
+    Returns:
+        任务信息，没有可领取的任务时为 null
+    """
+    cluster = get_cluster(request)
+    info = body.model_dump(exclude={"worker_id", "capabilities"})
+    job = cluster.claim(body.worker_id, list(body.capabilities), info)
+    return {"success": True, "job": job}
+
+@app.get("/cluster/jobs/{job_id}/source")
+def cluster_job_source(job_id: int, request: Request, worker_id: str = Query(...)):
+    """
+    下载任务源文件（仅租约持有者）
+    """
+    cluster = get_cluster(request)
+    path = held_job_errors(cluster.source_path, worker_id, job_id)
+    if not os.path.isfile(path):
+        raise HTTPException(status_code=404, detail="Source file not found")
+    return FileResponse(path, media_type="application/octet-stream")
+
+@app.put("/cluster/jobs/{job_id}/outputs/{output_path:path}")
+async def cluster_job_output(job_id: int, output_path: str, request: Request, worker_id: str = Query(...)):
+    """
+    上传任务输出文件（相对输出目录的路径），先写临时文件再原子替换
+    请求体以流式读取；租约查询（SQLite）和所有文件操作都在线程池中执行，不阻塞事件循环
+    """
+    cluster = get_cluster(request)
+
+    def open_partial():
+        path = held_job_errors(cluster.output_path, worker_id, job_id, output_path)
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        partial = f"{path}.{job_id}.part"
+        return path, partial, open(partial, "wb")
+
+    def remove_partial(partial: str):
+        if os.path.exists(partial):
+            os.remove(partial)
+
+    path, partial, f = await run_in_threadpool(open_partial)
+    size = 0
+    try:
+        try:
+            async for chunk in request.stream():
+                size += len(chunk)
+                await run_in_threadpool(f.write, chunk)
+        finally:
+            await run_in_threadpool(f.close)
+        await run_in_threadpool(os.replace, partial, path)
+    finally:
+        await run_in_threadpool(remove_partial, partial)
+    return {"success": True, "bytes": size}
+
+@app.post("/cluster/jobs/{job_id}/complete")
+def cluster_complete_job(job_id: int, body: ClusterCompleteRequest, request: Request):
+    """
+    工作节点提交处理结果，结果中的路径转换为协调器的输出目录
+    """
+    cluster = get_cluster(request)
+    held_job_errors(cluster.complete, body.worker_id, job_id, body.result, body.output_root)
+    return {"success": True}
+
+@app.post("/cluster/jobs/{job_id}/release")
+def cluster_release_job(job_id: int, body: ClusterReleaseRequest, request: Request):
+    """
+    工作节点传输失败时归还任务，未超过最大尝试次数则重新排队
+    """
+    cluster = get_cluster(request)
+    requeued = held_job_errors(cluster.release, body.worker_id, job_id, body.error)
+    return {"success": True, "requeued": requeued}
+
+@app.get("/cluster/status")
+def cluster_status(request: Request):
+    """
+    集群状态：工作节点、能力、租约和按能力统计的待处理任务
+    """
+    cluster = get_cluster(request)
+    return {"success": True, "cluster": cluster.get_status()}
+
 # 启动服务器
 if __name__ == "__main__":
     import uvicorn
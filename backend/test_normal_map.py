@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""
+测试法线贴图生成功能
+对比融合内核（fused）与参考实现（reference）的结果和耗时
+"""
+
+import os
+import sys
+import time
+import logging
+from PIL import Image
+import numpy as np
+
+# 添加项目根目录到Python路径
+sys.path.append(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from config import Config
+from modules.normal_map import NormalMapGenerator
+
+# 配置日志
+logging.basicConfig(level=logging.INFO)
+logger = logging.getLogger(__name__)
+
+
+def create_test_image(width: int = 1024, height: int = 768) -> Image.Image:
+    """
+    创建带有渐变、形状和透明通道的测试图像
+    """
+    yy, xx = np.mgrid[0:height, 0:width]
+    rgba = np.zeros((height, width, 4), dtype=np.uint8)
+    rgba[:, :, 0] = (xx * 255 // max(1, width - 1)).astype(np.uint8)
+    rgba[:, :, 1] = (yy * 255 // max(1, height - 1)).astype(np.uint8)
+    rgba[:, :, 2] = ((np.sin(xx / 17.0) * np.cos(yy / 23.0) + 1.0) * 127.5).astype(np.uint8)
+    rgba[:, :, 3] = 255
+
+    # 中间放一个圆形凸起，外圈设为透明
+    circle = (xx - width // 2) ** 2 + (yy - height // 2) ** 2 < (min(width, height) // 4) ** 2
+    rgba[circle, :3] = 230
+    rgba[:8, :, 3] = 0
+
+    return Image.fromarray(rgba, 'RGBA')
+
+
+def test_normal_map():
+    """
+    测试融合内核与参考实现的一致性
+    """
+    logger.info("Starting normal map test...")
+
+    config = Config()
+    image = create_test_image()
+
+    generator = NormalMapGenerator(config)
+
+    # 参考实现
+    start = time.perf_counter()
+    reference = np.asarray(generator._improved_sobel_normal_map(image, config.normal_strength), dtype=np.int16)
+    reference_time = time.perf_counter() - start
+
+    # 融合内核（多线程分块）
+    generator.tile_size = 128
+    start = time.perf_counter()
+    fused = np.asarray(generator._fused_normal_map(image, config.normal_strength), dtype=np.int16)
+    fused_time = time.perf_counter() - start
+
+    # 融合内核（单块），分块结果必须与整帧完全一致
+    generator.tile_size = 4096
+    single_tile = np.asarray(generator._fused_normal_map(image, config.normal_strength), dtype=np.int16)
+
+    assert fused.shape == reference.shape, f"Shape mismatch: {fused.shape} vs {reference.shape}"
+    assert np.array_equal(fused, single_tile), "Tiled result differs from single-tile result"
+    assert np.array_equal(fused[:, :, 3], reference[:, :, 3]), "Alpha channel was not preserved"
+
+    # 参考实现在模糊后量化为8位，融合内核保持float32，允许少量偏差
+    mean_diff = np.abs(fused[:, :, :3] - reference[:, :, :3]).mean()
+    logger.info(f"Mean absolute difference vs reference: {mean_diff:.3f}")
+    assert mean_diff < 8.0, f"Fused kernel deviates from reference (mean diff {mean_diff:.3f})"
+
+    logger.info(f"Reference: {reference_time * 1000:.1f} ms, fused: {fused_time * 1000:.1f} ms")
+    logger.info("\nNormal map test completed!")
+
+
+if __name__ == "__main__":
+    test_normal_map()
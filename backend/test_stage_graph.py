@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""
+测试阶段图与增量构建缓存
+变换阶段失败时，下游阶段不能写入缓存；修复后再次运行必须重新执行下游阶段
+"""
+
+import os
+import sys
+import shutil
+import logging
+import tempfile
+from PIL import Image
+
+# 添加项目根目录到Python路径
+sys.path.append(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from modules.build_cache import BuildCache
+from modules.stage_graph import StageRegistry, StageGraph, StageContext, StageExecutor, TRANSFORM, SINK
+
+# 配置日志
+logging.basicConfig(level=logging.INFO)
+logger = logging.getLogger(__name__)
+
+
+def test_failed_transform_bypasses_cache():
+    """
+    失败的变换之后接一个输出阶段：第一次运行变换失败，第二次变换成功，输出阶段应重新执行而不是从缓存恢复
+    """
+    work_dir = tempfile.mkdtemp(prefix="stage_graph_test_")
+    executor = StageExecutor(max_workers=2)
+    try:
+        state = {"fail": True, "sink_runs": 0}
+
+        def flaky(ctx, image):
+            if state["fail"]:
+                raise Exception("transform failed")
+            return image.transpose(Image.FLIP_LEFT_RIGHT)
+
+        def record(ctx, image):
+            state["sink_runs"] += 1
+            return {"outputs": []}
+
+        registry = StageRegistry()
+        registry.register("flaky", flaky, kind=TRANSFORM)
+        registry.register("record", record, kind=SINK)
+        graph = StageGraph(registry, ["flaky", "record"])
+
+        cache = BuildCache(os.path.join(work_dir, "cache"))
+        image = Image.new("RGBA", (8, 8), (200, 30, 30, 255))
+        image.putpixel((0, 0), (0, 0, 255, 255))
+        source_key = BuildCache.source_key(image.tobytes())
+        context = StageContext("test.png", os.path.join(work_dir, "test.png"), work_dir, "test")
+
+        # 第一次：变换失败，输出阶段在未变换的图像上运行，结果不应写入缓存
+        _, results = executor.run(graph, context, image, cache, source_key)
+        assert results[0]["status"] == "failed", results[0]
+        assert results[1]["status"] == "completed" and not results[1]["cached"], results[1]
+        assert state["sink_runs"] == 1
+
+        # 第二次：变换成功，输出阶段必须重新执行
+        state["fail"] = False
+        final_image, results = executor.run(graph, context, image, cache, source_key)
+        assert results[0]["status"] == "completed" and not results[0]["cached"], results[0]
+        assert results[1]["status"] == "completed" and not results[1]["cached"], results[1]
+        assert state["sink_runs"] == 2
+        assert final_image.getpixel((7, 0)) == (0, 0, 255, 255)
+
+        # 第三次：全部成功过，两个阶段都从缓存恢复
+        _, results = executor.run(graph, context, image, cache, source_key)
+        assert all(result["cached"] for result in results), results
+        assert state["sink_runs"] == 2
+
+        logger.info("Stage graph cache test passed")
+    finally:
+        executor.shutdown()
+        shutil.rmtree(work_dir, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    test_failed_transform_bypasses_cache()
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline 集群工作节点
+从协调器（cluster_role 为 coordinator 的 server.py）领取与本节点能力匹配的任务，
+下载源文件、运行完整工作流并上传输出；节点本身不保存状态，可随时增减
+
+    python backend/worker.py --coordinator http://pipeline-host:8000
+    python backend/worker.py --coordinator http://pipeline-host:8000 --capabilities cpu --slots 8
+"""
+
+import os
+import sys
+import signal
+import logging
+import argparse
+
+# 添加项目根目录到Python路径
+sys.path.append(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from config import Config
+from modules.cluster import ClusterWorker
+
+# 配置日志
+logging.basicConfig(
+    level=logging.INFO,
+    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s'
+)
+logger = logging.getLogger(__name__)
+
+
+def parse_args(argv=None):
+    parser = argparse.ArgumentParser(description="AmberPipeline cluster worker")
+    parser.add_argument("--config", default="config.json", help="配置文件路径")
+    parser.add_argument("--coordinator", default=None, help="协调器地址（默认 cluster_coordinator_url）")
+    parser.add_argument("--id", default=None, help="节点ID（默认 cluster_worker_id 或 主机名-进程ID）")
+    parser.add_argument("--capabilities", type=lambda s: [v for v in s.split(",") if v], default=None,
+                        help="逗号分隔的节点能力: cpu,gpu（默认自动检测）")
+    parser.add_argument("--slots", type=int, default=None, help="同时领取的任务数（默认 max_parallel_tasks）")
+    return parser.parse_args(argv)
+
+
+def main(argv=None) -> int:
+    args = parse_args(argv)
+    worker = ClusterWorker(Config(args.config), args.coordinator, args.id, args.capabilities, args.slots)
+    # SIGTERM 与 Ctrl+C 一样：停止领取，等待运行中的任务提交结果
+    signal.signal(signal.SIGTERM, lambda signum, frame: worker.stop())
+    try:
+        worker.run()
+    except KeyboardInterrupt:
+        worker.stop()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -24,10 +24,89 @@ class Config:
     sam_model_path: str  # SAM model path
     sam_device: str  # Running device ('cpu' or 'cuda')
     sam_confidence_threshold: float  # Segmentation confidence threshold
+    sam_batch_size: int  # Maximum images per image-encoder batch
+    sam_batch_timeout_ms: float  # How long the engine waits to fill a batch
+    sam_precision: str  # Inference precision ('fp32', 'fp16' or 'bf16')
+    sam_compile: bool  # Compile the image encoder with torch.compile
+    sam_model_config: str  # SAM2 config relative to the sam2 package ('' = chosen from the checkpoint name)
+    sam_model_cache_dir: str  # Prepared safetensors weights and compiled graphs ('' disables)
+    sam_warmup: bool  # Load the model and run a dummy prediction in the background as soon as the segmenter is created
+    sam_embedding_cache_size: int  # Image embeddings kept in memory for point prompts
+    sam_embedding_cache_dir: str  # Spill directory for evicted embeddings ('' disables)
     
     # Normal map generation configuration
     normal_strength: float  # Normal strength
     normal_blur: float  # Normal map blur amount
+    normal_backend: str  # Normal map backend ('fused' or 'reference')
+    normal_tile_size: int  # Tile size for the fused normal map kernel
+    normal_workers: int  # Worker threads for the fused kernel (0 = CPU count)
+    
+    # Inpainting configuration
+    inpaint_workers: int  # Threads for region-parallel OpenCV inpainting (0 = CPU count)
+    inpaint_use_lama: bool  # Load the LaMa backend for method 'lama'
+    inpaint_lama_model_path: str  # TorchScript big-lama model
+    inpaint_lama_device: str  # LaMa device ('cpu' or 'cuda')
+    inpaint_lama_tile_size: int  # Fixed LaMa tile size (multiple of 8)
+    inpaint_lama_batch_size: int  # Tiles per LaMa forward pass
+    
+    # Server inference configuration
+    inference_segment_workers: int  # Worker threads of the SAM inference queue
+    inference_normal_workers: int  # Worker threads of the normal map queue
+    inference_inpaint_workers: int  # Worker threads of the inpainting queue
+    inference_queue_limit: int  # Pending requests per queue before answering 429
+    server_warmup: bool  # Load and run every model once in the background at startup
+    tracing_enabled: bool  # Emit OpenTelemetry spans for requests and pipeline stages (needs opentelemetry-sdk)
+    tracing_otlp_endpoint: str  # OTLP/HTTP traces endpoint, empty = print spans to stdout
+    
+    # Pixel kernel configuration
+    pixel_kernels: bool  # Fused ImageProcessor kernels (shared alpha bounds, LUTs, offset-and-blend seamless)
+    
+    # Batch processing configuration
+    batch_backend: str  # ImageProcessor.batch_process backend ('process' = worker processes + shared memory, 'thread')
+    batch_workers: int  # Batch worker count (0 = CPU count)
+    batch_worker_memory_mb: int  # Shared memory per batch worker for returning results
+    
+    # Out-of-core tiled processing configuration
+    tiled_mode: str  # 'auto' (tile when the in-memory path would exceed the cap), 'always' or 'off'
+    tiled_memory_mb: int  # Working-set cap per stage in tiled mode, band heights follow from it
+    
+    # LOD configuration
+    lod_filter: str  # Mip downsampling filter ('box' or 'lanczos')
+    lod_container: str  # gen_lod output ('png' per level, or 'dds' full chain in one file)
+    texture_export: str  # Block-compressed export container ('' = off, 'ktx2' or 'dds'), BC7 color + BC5 normal
+    texture_export_workers: int  # Encoder threads per texture (0 = CPU count)
+    
+    # Workflow queue configuration
+    workflow_queue_path: str  # SQLite file holding the durable job queue
+    workflow_cpu_slots: int  # Concurrent CPU stages across all jobs (0 = CPU count)
+    workflow_gpu_slots: int  # Concurrent GPU stages across all jobs (0 = sam_batch_size)
+    workflow_memory_budget_mb: int  # RAM the admission scheduler may reserve for jobs (0 = 80% of free RAM at start)
+    workflow_vram_budget_mb: int  # VRAM the admission scheduler may reserve (0 = measured once models are loaded)
+    workflow_max_defer_seconds: float  # How long smaller jobs may be admitted ahead of a waiting large job
+    
+    # Cluster configuration
+    cluster_role: str  # 'standalone', 'coordinator' (owns the watch folder and job store) or 'worker'
+    cluster_coordinator_url: str  # Workers: base URL of the coordinator server
+    cluster_token: str  # Shared secret sent in X-Cluster-Token ('' = no check)
+    cluster_worker_id: str  # Workers: stable id ('' = host name and process id)
+    cluster_capabilities: list  # Workers: subset of ['cpu', 'gpu'] ([] = 'gpu' when CUDA is available, plus 'cpu')
+    cluster_shared_storage: bool  # Workers read watch_dir and write output_dir directly instead of over HTTP
+    cluster_lease_seconds: float  # Job lease length, renewed by worker heartbeats
+    cluster_max_attempts: int  # Attempts per job before a lost lease marks it failed
+    ingest_settle_ms: float  # How long a new file must stay unchanged before it is queued
+    
+    # Incremental build configuration
+    incremental_build: bool  # Skip stages whose output for the same inputs already exists
+    build_cache_dir: str  # Content-addressed stage output cache
+    build_cache_max_mb: float  # Size budget of cached stage outputs, least recently used evicted first (0 = unlimited)
+    
+    # C++ output configuration
+    compiled_output: str  # 'headers' (AssetIDs.h only) or 'archive' (packed archive + AssetArchive.h reader)
+    archive_name: str  # Archive file name inside compiled_dir
+    code_sync_debounce_ms: float  # Quiet period before headers/archive are regenerated after new assets
+    live_sync: bool  # Push changed assets to the running game's ResourceSyncServer (ResourceSyncServer.h)
+    live_sync_host: str  # Game host running ResourceSyncServer
+    live_sync_port: int  # ResourceSyncServer port
     
     def __init__(self, config_file: str = "config.json"):
         """
@@ -51,8 +130,67 @@ class Config:
             "sam_model_path": "models/sam2.1_hiera_tiny.pt",
             "sam_device": "cuda",
             "sam_confidence_threshold": 0.8,
+            "sam_batch_size": 8,
+            "sam_batch_timeout_ms": 20,
+            "sam_precision": "fp32",
+            "sam_compile": False,
+            "sam_model_config": "",
+            "sam_model_cache_dir": "model_cache",
+            "sam_warmup": False,
+            "sam_embedding_cache_size": 8,
+            "sam_embedding_cache_dir": "",
             "normal_strength": 1.0,
             "normal_blur": 0.5,
+            "normal_backend": "fused",
+            "normal_tile_size": 512,
+            "normal_workers": 0,
+            "inpaint_workers": 0,
+            "inpaint_use_lama": False,
+            "inpaint_lama_model_path": "models/big-lama.pt",
+            "inpaint_lama_device": "cuda",
+            "inpaint_lama_tile_size": 512,
+            "inpaint_lama_batch_size": 4,
+            "inference_segment_workers": 1,
+            "inference_normal_workers": 2,
+            "inference_inpaint_workers": 2,
+            "inference_queue_limit": 32,
+            "server_warmup": True,
+            "tracing_enabled": False,
+            "tracing_otlp_endpoint": "",
+            "pixel_kernels": True,
+            "batch_backend": "process",
+            "batch_workers": 0,
+            "batch_worker_memory_mb": 256,
+            "tiled_mode": "auto",
+            "tiled_memory_mb": 512,
+            "lod_filter": "box",
+            "lod_container": "png",
+            "texture_export": "",
+            "texture_export_workers": 0,
+            "workflow_queue_path": "workflow_jobs.db",
+            "workflow_cpu_slots": 0,
+            "workflow_gpu_slots": 0,
+            "workflow_memory_budget_mb": 0,
+            "workflow_vram_budget_mb": 0,
+            "workflow_max_defer_seconds": 30.0,
+            "cluster_role": "standalone",
+            "cluster_coordinator_url": "",
+            "cluster_token": "",
+            "cluster_worker_id": "",
+            "cluster_capabilities": [],
+            "cluster_shared_storage": False,
+            "cluster_lease_seconds": 60.0,
+            "cluster_max_attempts": 3,
+            "ingest_settle_ms": 500,
+            "incremental_build": True,
+            "build_cache_dir": "build_cache",
+            "build_cache_max_mb": 2048,
+            "compiled_output": "headers",
+            "archive_name": "Assets.pak",
+            "code_sync_debounce_ms": 1000,
+            "live_sync": False,
+            "live_sync_host": "localhost",
+            "live_sync_port": 8888,
             "batch_mode": False,
             "max_parallel_tasks": 4
         }
@@ -77,11 +215,72 @@ class Config:
         self.sam_model_path = os.path.abspath(default_config["sam_model_path"])
         self.sam_device = default_config["sam_device"]
         self.sam_confidence_threshold = default_config["sam_confidence_threshold"]
+        self.sam_batch_size = default_config["sam_batch_size"]
+        self.sam_batch_timeout_ms = default_config["sam_batch_timeout_ms"]
+        self.sam_precision = default_config["sam_precision"]
+        self.sam_compile = default_config["sam_compile"]
+        self.sam_model_config = default_config["sam_model_config"]
+        model_cache_dir = default_config["sam_model_cache_dir"]
+        self.sam_model_cache_dir = os.path.abspath(model_cache_dir) if model_cache_dir else ""
+        self.sam_warmup = default_config["sam_warmup"]
+        self.sam_embedding_cache_size = default_config["sam_embedding_cache_size"]
+        cache_dir = default_config["sam_embedding_cache_dir"]
+        self.sam_embedding_cache_dir = os.path.abspath(cache_dir) if cache_dir else ""
         self.normal_strength = default_config["normal_strength"]
         self.normal_blur = default_config["normal_blur"]
+        self.normal_backend = default_config["normal_backend"]
+        self.normal_tile_size = default_config["normal_tile_size"]
+        self.normal_workers = default_config["normal_workers"]
         self.cpp_header_dir = os.path.abspath(default_config["cpp_header_dir"])
         self.batch_mode = default_config["batch_mode"]
         self.max_parallel_tasks = default_config["max_parallel_tasks"]
+        self.inpaint_workers = default_config["inpaint_workers"]
+        self.inpaint_use_lama = default_config["inpaint_use_lama"]
+        self.inpaint_lama_model_path = os.path.abspath(default_config["inpaint_lama_model_path"])
+        self.inpaint_lama_device = default_config["inpaint_lama_device"]
+        self.inpaint_lama_tile_size = default_config["inpaint_lama_tile_size"]
+        self.inpaint_lama_batch_size = default_config["inpaint_lama_batch_size"]
+        self.inference_segment_workers = default_config["inference_segment_workers"]
+        self.inference_normal_workers = default_config["inference_normal_workers"]
+        self.inference_inpaint_workers = default_config["inference_inpaint_workers"]
+        self.inference_queue_limit = default_config["inference_queue_limit"]
+        self.server_warmup = default_config["server_warmup"]
+        self.tracing_enabled = default_config["tracing_enabled"]
+        self.tracing_otlp_endpoint = default_config["tracing_otlp_endpoint"]
+        self.pixel_kernels = default_config["pixel_kernels"]
+        self.batch_backend = default_config["batch_backend"]
+        self.batch_workers = default_config["batch_workers"]
+        self.batch_worker_memory_mb = default_config["batch_worker_memory_mb"]
+        self.tiled_mode = default_config["tiled_mode"]
+        self.tiled_memory_mb = default_config["tiled_memory_mb"]
+        self.lod_filter = default_config["lod_filter"]
+        self.lod_container = default_config["lod_container"]
+        self.texture_export = default_config["texture_export"]
+        self.texture_export_workers = default_config["texture_export_workers"]
+        self.workflow_queue_path = os.path.abspath(default_config["workflow_queue_path"])
+        self.workflow_cpu_slots = default_config["workflow_cpu_slots"]
+        self.workflow_gpu_slots = default_config["workflow_gpu_slots"]
+        self.workflow_memory_budget_mb = default_config["workflow_memory_budget_mb"]
+        self.workflow_vram_budget_mb = default_config["workflow_vram_budget_mb"]
+        self.workflow_max_defer_seconds = default_config["workflow_max_defer_seconds"]
+        self.cluster_role = default_config["cluster_role"]
+        self.cluster_coordinator_url = default_config["cluster_coordinator_url"]
+        self.cluster_token = default_config["cluster_token"]
+        self.cluster_worker_id = default_config["cluster_worker_id"]
+        self.cluster_capabilities = list(default_config["cluster_capabilities"])
+        self.cluster_shared_storage = default_config["cluster_shared_storage"]
+        self.cluster_lease_seconds = default_config["cluster_lease_seconds"]
+        self.cluster_max_attempts = default_config["cluster_max_attempts"]
+        self.ingest_settle_ms = default_config["ingest_settle_ms"]
+        self.incremental_build = default_config["incremental_build"]
+        self.build_cache_dir = os.path.abspath(default_config["build_cache_dir"])
+        self.build_cache_max_mb = default_config["build_cache_max_mb"]
+        self.compiled_output = default_config["compiled_output"]
+        self.archive_name = default_config["archive_name"]
+        self.code_sync_debounce_ms = default_config["code_sync_debounce_ms"]
+        self.live_sync = default_config["live_sync"]
+        self.live_sync_host = default_config["live_sync_host"]
+        self.live_sync_port = default_config["live_sync_port"]
         
         # Working directory structure
         self.raw_dir = os.path.abspath(default_config["raw_dir"])
@@ -154,6 +154,147 @@ async function uploadFile<T>(
   }
 }
 
+// 原始像素图像（二进制传输端点使用）
+export interface RawImage {
+  data: Uint8Array;
+  width: number;
+  height: number;
+  channels: number;
+  imageId?: string;
+}
+
+/**
+ * 读取图像的RGBA像素
+ * @param src 图像URL或Base64字符串
+ * @returns Promise<RawImage> 4通道像素数据
+ */
+export async function loadImagePixels(src: string): Promise<RawImage> {
+  const blob = await fetch(src).then(r => r.blob());
+  const bitmap = await createImageBitmap(blob);
+  const canvas = document.createElement('canvas');
+  canvas.width = bitmap.width;
+  canvas.height = bitmap.height;
+  const ctx = canvas.getContext('2d');
+  if (!ctx) {
+    throw createApiError(0, 'Canvas 2D context unavailable');
+  }
+  ctx.drawImage(bitmap, 0, 0);
+  bitmap.close();
+  const pixels = ctx.getImageData(0, 0, canvas.width, canvas.height);
+  return {
+    data: new Uint8Array(pixels.data.buffer),
+    width: canvas.width,
+    height: canvas.height,
+    channels: 4
+  };
+}
+
+/**
+ * 以原始像素发送请求，并将响应解析为原始像素
+ * @param endpoint API端点
+ * @param body 请求体像素数据
+ * @param params 查询参数
+ * @param controller AbortController实例，用于取消请求
+ * @returns Promise<RawImage> 响应像素及其尺寸
+ */
+async function postRaw(
+  endpoint: string,
+  body: BodyInit | null,
+  params: Record<string, any>,
+  controller?: AbortController
+): Promise<RawImage> {
+  const url = new URL(`${API_BASE_URL}${endpoint}`);
+  Object.entries(params).forEach(([key, value]) => {
+    if (value !== undefined && value !== null) {
+      url.searchParams.append(key, String(value));
+    }
+  });
+  
+  try {
+    const response = await fetch(url.toString(), {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/octet-stream' },
+      body,
+      signal: controller?.signal,
+    });
+    
+    if (!response.ok) {
+      const errorData = await response.json().catch(() => ({}));
+      throw createApiError(
+        response.status,
+        errorData.detail || `HTTP error! status: ${response.status}`,
+        errorData
+      );
+    }
+    
+    return {
+      data: new Uint8Array(await response.arrayBuffer()),
+      width: Number(response.headers.get('X-Image-Width')),
+      height: Number(response.headers.get('X-Image-Height')),
+      channels: Number(response.headers.get('X-Image-Channels')),
+      imageId: response.headers.get('X-Image-Id') || undefined
+    };
+  } catch (error) {
+    console.error(`二进制请求失败 (${endpoint}):`, error);
+    
+    if (error instanceof Error) {
+      if (error.name === 'AbortError') {
+        throw error;
+      }
+      throw createApiError(0, error.message);
+    }
+    
+    throw error;
+  }
+}
+
+// 语义涂抹会话的增量更新：脏矩形及其RLE编码像素
+export interface BrushDelta {
+  success: boolean;
+  revision: number;
+  strokeCount: number;
+  rect: { x: number; y: number; width: number; height: number } | null;
+  rle?: { values: string; lengths: string };
+}
+
+function decodeBase64(value: string): Uint8Array {
+  const binary = atob(value);
+  const bytes = new Uint8Array(binary.length);
+  for (let i = 0; i < binary.length; i++) {
+    bytes[i] = binary.charCodeAt(i);
+  }
+  return bytes;
+}
+
+/**
+ * 将增量更新写入本地遮罩
+ * @param mask 单通道遮罩像素（行优先）
+ * @param width 遮罩宽度
+ * @param delta appendBrushStrokes 返回的增量
+ */
+export function applyBrushDelta(mask: Uint8Array, width: number, delta: BrushDelta): void {
+  if (!delta.rect || !delta.rle) {
+    return;
+  }
+  const { x, y, width: rectWidth } = delta.rect;
+  const values = decodeBase64(delta.rle.values);
+  const lengthBytes = decodeBase64(delta.rle.lengths);
+  const lengths = new DataView(lengthBytes.buffer);
+  let offset = 0;
+  for (let run = 0; run < values.length; run++) {
+    let remaining = lengths.getUint32(run * 4, true);
+    while (remaining > 0) {
+      const row = Math.floor(offset / rectWidth);
+      const column = offset % rectWidth;
+      const span = Math.min(remaining, rectWidth - column);
+      const start = (y + row) * width + x + column;
+      mask.fill(values[run], start, start + span);
+      offset += span;
+      remaining -= span;
+    }
+  }
+}
+
 // 定义API响应类型
 export interface ApiResponse<T> {
   success: boolean;
@@ -172,9 +313,207 @@ export interface WorkflowStatus {
   batch_config: {
     max_parallel_tasks: number;
     current_running_tasks: number;
+    cpu_slots?: number;
+    gpu_slots?: number;
+  };
+  job_queue?: {
+    pending: number;
+    running: number;
+    completed: number;
+    failed: number;
+  };
+  // 历史总数（processed_files/failed_files 可能只包含最近几条）
+  processed_count?: number;
+  failed_count?: number;
+  file_type_counts?: Record<string, number>;
+  last_event_id?: number;
+  // 正在处理的文件的阶段进度（由 stage_progress 事件维护）
+  stage_progress?: Record<string, WorkflowStageProgress>;
+  // 准入调度器状态（由 scheduler 事件维护）
+  scheduler?: WorkflowSchedulerStats;
+  // 集群状态（仅协调器模式，由 cluster 事件维护）
+  cluster?: WorkflowClusterStatus;
+}
+
+// 集群协调器状态：工作节点、租约和按能力统计的待处理任务
+export interface WorkflowClusterStatus {
+  role: 'coordinator';
+  workers: Array<{
+    worker_id: string;
+    host: string;
+    capabilities: string[];
+    slots: number;
+    alive: boolean;
+    running: number[];
+    completed: number;
+    failed: number;
+    last_seen: number;
+  }>;
+  workers_alive: number;
+  slots: { cpu: number; gpu: number };
+  running: Array<{ id: number; filename: string; requires: string; worker_id: string; attempts: number; lease_remaining: number }>;
+  pending: { cpu: number; gpu: number };
+  lease_seconds: number;
+  max_attempts: number;
+}
+
+// 准入调度器状态：内存/显存预算、已预留量和等待中的任务
+export interface WorkflowSchedulerStats {
+  max_jobs: number;
+  ram_budget_mb: number;
+  vram_budget_mb: number | null;
+  reserved_ram_mb: number;
+  reserved_vram_mb: number;
+  admitted: number;
+  deferred: number;
+  running: Array<{ name: string; ram_mb: number; vram_mb: number; seconds: number }>;
+  waiting: Array<{ name: string; ram_mb: number; vram_mb: number; seconds: number; waited_s: number }>;
+}
+
+// 单个文件的阶段进度
+export interface WorkflowStageProgress {
+  stage: string;
+  status: string;
+  completed: number;
+  total: number;
+}
+
+// /workflow/events 推送的事件
+export interface WorkflowEvent {
+  id: number;
+  type: 'snapshot' | 'workflow_state' | 'job_queued' | 'job_started' | 'stage_progress' | 'job_finished' | 'history_cleared' | 'batch_config' | 'scheduler' | 'cluster';
+  data: any;
+}
+
+// /workflow/history 的一页记录
+export interface WorkflowHistoryPage {
+  success: boolean;
+  items: any[];
+  total: number;
+  offset: number;
+  limit: number;
+}
+
+const WORKFLOW_EVENT_TYPES: WorkflowEvent['type'][] = [
+  'snapshot', 'workflow_state', 'job_queued', 'job_started', 'stage_progress', 'job_finished', 'history_cleared', 'batch_config', 'scheduler', 'cluster'
+];
+
+/**
+ * 订阅工作流事件流（Server-Sent Events）
+ * 连接后先收到 snapshot，之后只推送变化；EventSource 断线后会带 Last-Event-ID 自动重连
+ * @param onEvent 事件回调
+ * @param historyLimit snapshot 中包含的最近记录数
+ * @returns 取消订阅函数
+ */
+export function subscribeWorkflowEvents(onEvent: (event: WorkflowEvent) => void, historyLimit: number = 5): () => void {
+  const source = new EventSource(`${API_BASE_URL}/workflow/events?history_limit=${historyLimit}`);
+  const listeners = WORKFLOW_EVENT_TYPES.map((type) => {
+    const listener = (message: MessageEvent) => {
+      onEvent({ id: Number(message.lastEventId) || 0, type, data: JSON.parse(message.data) });
+    };
+    source.addEventListener(type, listener as EventListener);
+    return [type, listener] as const;
+  });
+  return () => {
+    listeners.forEach(([type, listener]) => source.removeEventListener(type, listener as EventListener));
+    source.close();
   };
 }
 
+/**
+ * 将工作流事件应用到本地状态
+ * @param status 当前状态（收到 snapshot 之前为 undefined）
+ * @param event 推送的事件
+ * @param historyLimit 本地保留的最近记录数
+ * @returns 新状态；事件早于当前状态（重复投递）时返回原状态
+ */
+export function applyWorkflowEvent(
+  status: WorkflowStatus | undefined,
+  event: WorkflowEvent,
+  historyLimit: number = 5
+): WorkflowStatus | undefined {
+  if (event.type === 'snapshot') {
+    return { ...event.data, stage_progress: {} };
+  }
+  if (!status || (status.last_event_id !== undefined && event.id <= status.last_event_id)) {
+    return status;
+  }
+
+  const next: WorkflowStatus = { ...status, last_event_id: event.id };
+  const data = event.data;
+  switch (event.type) {
+    case 'workflow_state':
+      next.is_running = data.is_running;
+      break;
+    case 'batch_config':
+      next.batch_config = { ...status.batch_config, max_parallel_tasks: data.max_parallel_tasks };
+      break;
+    case 'scheduler':
+      next.scheduler = data;
+      break;
+    case 'cluster':
+      next.cluster = data;
+      break;
+    case 'job_queued':
+      if (!status.processing_queue.includes(data.filename)) {
+        next.processing_queue = [...status.processing_queue, data.filename];
+      }
+      break;
+    case 'job_started':
+      if (!status.processing_queue.includes(data.filename)) {
+        next.processing_queue = [...status.processing_queue, data.filename];
+      }
+      next.batch_config = { ...status.batch_config, current_running_tasks: status.batch_config.current_running_tasks + 1 };
+      break;
+    case 'stage_progress':
+      next.stage_progress = {
+        ...status.stage_progress,
+        [data.filename]: { stage: data.stage, status: data.status, completed: data.completed, total: data.total }
+      };
+      break;
+    case 'job_finished': {
+      const index = status.processing_queue.indexOf(data.filename);
+      next.processing_queue = status.processing_queue.filter((_, i) => i !== index);
+      next.batch_config = {
+        ...status.batch_config,
+        current_running_tasks: Math.max(0, status.batch_config.current_running_tasks - 1)
+      };
+      const stageProgress = { ...status.stage_progress };
+      delete stageProgress[data.filename];
+      next.stage_progress = stageProgress;
+
+      const failed = data.status === 'failed';
+      const processedCount = (status.processed_count ?? status.processed_files.length) + (failed ? 0 : 1);
+      const failedCount = (status.failed_count ?? status.failed_files.length) + (failed ? 1 : 0);
+      if (failed) {
+        next.failed_files = [...status.failed_files, data].slice(-historyLimit);
+      } else {
+        next.processed_files = [...status.processed_files, data].slice(-historyLimit);
+      }
+      const fileType = String(data.filename).split('_')[0].toLowerCase();
+      next.file_type_counts = { ...status.file_type_counts, [fileType]: (status.file_type_counts?.[fileType] || 0) + 1 };
+      next.processed_count = processedCount;
+      next.failed_count = failedCount;
+      next.total_files = processedCount + failedCount;
+      next.success_rate = next.total_files > 0 ? processedCount / next.total_files * 100 : 0;
+      break;
+    }
+    case 'history_cleared':
+      if (data.status === 'failed') {
+        next.failed_files = [];
+        next.failed_count = 0;
+      } else {
+        next.processed_files = [];
+        next.processed_count = 0;
+      }
+      next.file_type_counts = data.file_type_counts;
+      next.total_files = (next.processed_count ?? 0) + (next.failed_count ?? 0);
+      next.success_rate = next.total_files > 0 ? (next.processed_count ?? 0) / next.total_files * 100 : 0;
+      break;
+  }
+  return next;
+}
+
 // 定义批量配置类型
 export interface BatchConfig {
   max_parallel_tasks: number;
@@ -228,7 +567,28 @@ export const apiClient = {
     point_labels?: string,
     controller?: AbortController
   ) => 
-    uploadFile<{ success: boolean; image: string }>('/segment', file, { points, point_labels }, controller),
+    uploadFile<{ success: boolean; image: string; image_id?: string }>('/segment', file, { points, point_labels }, controller),
+  
+  // 创建分割会话：运行一次图像编码器并缓存嵌入
+  createSegmentSession: (
+    file: File,
+    controller?: AbortController
+  ) =>
+    uploadFile<{ success: boolean; image_id: string; width: number; height: number; cached: boolean }>('/segment/session', file, undefined, controller),
+  
+  // 使用已缓存的图像嵌入分割，只运行掩码解码器（嵌入被淘汰时返回404）
+  segmentWithImageId: (
+    imageId: string,
+    points: string,
+    point_labels: string,
+    controller?: AbortController
+  ) => {
+    const params = new URLSearchParams({ image_id: imageId, points, point_labels });
+    return fetchApi<{ success: boolean; image: string; image_id: string }>(`/segment?${params.toString()}`, {
+      method: 'POST',
+      body: new FormData(),
+    }, controller);
+  },
   
   // 生成法线贴图
   generateNormalMap: (
@@ -283,6 +643,56 @@ export const apiClient = {
     }
   },
   
+  // 分割（原始像素传输）：传入imageId时请求体为空，只运行掩码解码器
+  segmentImageBinary: (
+    image: RawImage | null,
+    points?: string,
+    point_labels?: string,
+    imageId?: string,
+    output: 'alpha' | 'rgba' = 'alpha',
+    controller?: AbortController
+  ) =>
+    postRaw('/binary/segment', image ? image.data : null, {
+      width: image?.width,
+      height: image?.height,
+      channels: image?.channels,
+      points,
+      point_labels,
+      image_id: imageId,
+      output
+    }, controller),
+  
+  // 生成法线贴图（原始像素传输）
+  generateNormalMapBinary: (
+    image: RawImage,
+    strength?: number,
+    controller?: AbortController
+  ) =>
+    postRaw('/binary/generate-normal-map', image.data, {
+      width: image.width,
+      height: image.height,
+      channels: image.channels,
+      strength
+    }, controller),
+  
+  // Inpainting 图像修复（原始像素传输）：请求体为图像像素后接单通道遮罩
+  performInpaintBinary: (
+    image: RawImage,
+    mask: Uint8Array,
+    method: string = 'telea',
+    radius: number = 3,
+    padding: number = 10,
+    controller?: AbortController
+  ) =>
+    postRaw('/binary/inpaint', new Blob([image.data, mask]), {
+      width: image.width,
+      height: image.height,
+      channels: image.channels,
+      method,
+      radius,
+      padding
+    }, controller),
+  
   // 获取可用的 Inpainting 方法
   getInpaintingMethods: (controller?: AbortController) =>
     fetchApi<{ success: boolean; methods: string[]; descriptions: Record<string, string> }>('/inpaint/methods', {}, controller),
@@ -297,6 +707,15 @@ export const apiClient = {
   getWorkflowStatus: (controller?: AbortController) => 
     fetchApi<WorkflowStatus>('/workflow/status', {}, controller),
   
+  // 分页获取处理历史（最新的在前）
+  getWorkflowHistory: (
+    status: 'completed' | 'failed' = 'completed',
+    offset: number = 0,
+    limit: number = 50,
+    controller?: AbortController
+  ) =>
+    fetchApi<WorkflowHistoryPage>(`/workflow/history?status=${status}&offset=${offset}&limit=${limit}`, {}, controller),
+  
   processFile: (
     filename: string,
     controller?: AbortController
@@ -351,6 +770,34 @@ export const apiClient = {
     }, controller);
   },
   
+  // 边缘吸附（实时）：首次上传图像建立吸附索引，之后只发送 imageId，服务端 O(1) 查表
+  snapToEdges: async (
+    source: { imageId: string } | { imagePath: string },
+    points: Array<{x: number, y: number}>,
+    mode: 'foreground' | 'background',
+    radius = 50,
+    controller?: AbortController
+  ) => {
+    const params = new URLSearchParams({
+      points: points.map(p => `${p.x},${p.y}`).join(';'),
+      labels: mode,
+      radius: String(radius),
+    });
+    const formData = new FormData();
+    if ('imageId' in source) {
+      params.set('image_id', source.imageId);
+    } else {
+      const imageFile = await fetch(source.imagePath).then(r => r.blob()).then(b => new File([b], 'image.png'));
+      formData.append('image', imageFile);
+    }
+    
+    return fetchApi<{ success: boolean; snappedPoints: Array<{x: number, y: number}>; image_id: string }>(
+      `/semantic/edge-snap?${params.toString()}`,
+      { method: 'POST', body: formData },
+      controller
+    );
+  },
+  
   performJointExpansion: async (
     imagePath: string,
     bbox: {x: number, y: number, width: number, height: number},
@@ -385,6 +832,41 @@ export const apiClient = {
     }, controller);
   },
   
+  // 增量语义涂抹：遮罩保存在服务端会话中，每次只发送新增笔触
+  createBrushSession: (width: number, height: number, blurKernel = 15) =>
+    fetchApi<{ success: boolean; session_id: string; width: number; height: number }>('/semantic/brush/session', {
+      method: 'POST',
+      body: JSON.stringify({ width, height, blur_kernel: blurKernel }),
+    }),
+  
+  appendBrushStrokes: (
+    sessionId: string,
+    strokes: Array<{x: number, y: number, mode: string, size: number}>,
+    baseRevision?: number,
+    controller?: AbortController
+  ) =>
+    fetchApi<BrushDelta>(`/semantic/brush/${sessionId}/strokes`, {
+      method: 'POST',
+      body: JSON.stringify({ strokes, base_revision: baseRevision }),
+    }, controller),
+  
+  getBrushMask: async (sessionId: string): Promise<RawImage> => {
+    const response = await fetch(`${API_BASE_URL}/semantic/brush/${sessionId}/mask`);
+    if (!response.ok) {
+      throw createApiError(response.status, `HTTP error! status: ${response.status}`);
+    }
+    return {
+      data: new Uint8Array(await response.arrayBuffer()),
+      width: Number(response.headers.get('X-Image-Width')),
+      height: Number(response.headers.get('X-Image-Height')),
+      channels: 1,
+      imageId: response.headers.get('X-Image-Id') || undefined
+    };
+  },
+  
+  closeBrushSession: (sessionId: string) =>
+    fetchApi<{ success: boolean }>(`/semantic/brush/${sessionId}`, { method: 'DELETE' }),
+  
   processSemanticBrush: async (
     imagePath: string,
     strokes: Array<{x: number, y: number, mode: string, size: number}>,
@@ -0,0 +1,84 @@
+import React, { useEffect, useRef } from 'react';
+import {
+  LayerCompositor,
+  CompositorLayer,
+  CompositorMesh,
+  OverlayPrimitive
+} from '../../utils/LayerCompositor';
+
+interface GpuLayerCanvasProps {
+  /** 共享合成器 */
+  compositor: LayerCompositor;
+  /** 底图，决定图像区域尺寸 */
+  imagePath: string;
+  /** 图像尺寸（底图加载后通过 onImageSize 得到） */
+  imageWidth: number;
+  imageHeight: number;
+  /** 变换属性：缩放比例和位移 */
+  transform: { scale: number; translateX: number; translateY: number };
+  /** 底图之上的图层，从下到上 */
+  layers: CompositorLayer[];
+  /** 覆盖层图元（笔触、骨骼等） */
+  overlay: OverlayPrimitive[];
+  /** 蒙皮网格图层（Stage D），有网格时通常不再绘制底图 */
+  meshes?: CompositorMesh[];
+  /** 是否绘制底图，默认绘制；不绘制时底图仍用于确定图像区域尺寸 */
+  drawBaseImage?: boolean;
+  onImageSize?: (size: { width: number; height: number }) => void;
+}
+
+/**
+ * GPU图层画布组件
+ * 功能：把共享的 WebGL2 画布挂到当前渲染器中，底图、图层和覆盖层在一次渲染中合成
+ * 平移缩放只更新着色器中的变换，不触发 DOM 重排
+ */
+export const GpuLayerCanvas: React.FC<GpuLayerCanvasProps> = ({
+  compositor,
+  imagePath,
+  imageWidth,
+  imageHeight,
+  transform,
+  layers,
+  overlay,
+  meshes,
+  drawBaseImage = true,
+  onImageSize
+}) => {
+  const hostRef = useRef<HTMLDivElement>(null);
+  const onImageSizeRef = useRef(onImageSize);
+  onImageSizeRef.current = onImageSize;
+
+  useEffect(() => {
+    const host = hostRef.current;
+    if (!host) return;
+    compositor.attach(host);
+    return () => compositor.detach(host);
+  }, [compositor]);
+
+  // 底图尺寸
+  useEffect(() => {
+    if (!imagePath) return;
+    let cancelled = false;
+    compositor.load(imagePath).then(size => {
+      if (!cancelled && size.width > 0) {
+        onImageSizeRef.current?.({ width: size.width, height: size.height });
+      }
+    });
+    return () => {
+      cancelled = true;
+    };
+  }, [compositor, imagePath]);
+
+  useEffect(() => {
+    compositor.setScene({
+      width: imageWidth,
+      height: imageHeight,
+      view: transform,
+      layers: imagePath && drawBaseImage ? [{ source: imagePath, opacity: 1 }, ...layers] : layers,
+      overlay,
+      meshes
+    });
+  }, [compositor, imagePath, drawBaseImage, imageWidth, imageHeight, transform, layers, overlay, meshes]);
+
+  return <div ref={hostRef} className="absolute inset-0 z-10" />;
+};
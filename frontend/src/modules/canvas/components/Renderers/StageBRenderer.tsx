@@ -1,6 +1,8 @@
-import React, { useState, useRef, useCallback } from 'react';
+import React, { useState, useRef, useCallback, useMemo } from 'react';
 import { CanvasBackground } from './CanvasBackground';
 import { CanvasTransform } from './CanvasTransform';
+import { GpuLayerCanvas } from './GpuLayerCanvas';
+import { LayerCompositor, CompositorLayer, OverlayPrimitive, BlendMode, hexColor } from '../../utils/LayerCompositor';
 import { useCanvasContext } from '../../composables/CanvasContext';
 import { apiService } from '../../../../lib/api';
 
@@ -49,6 +51,30 @@ export const StageBRenderer: React.FC<StageBRendererProps> = ({
   // 图像尺寸
   const [imageSize, setImageSize] = useState({ width: 0, height: 0 });
   
+  // 共享GPU合成器，不支持 WebGL2 时为 null，使用 DOM 渲染
+  const compositor = useMemo(() => LayerCompositor.shared(), []);
+  
+  // 部位图层（按 zIndex 从下到上），遮罩与图像相同时不再重复采样
+  const gpuLayers = useMemo<CompositorLayer[]>(() => state.layers
+    .filter(layer => layer.type === 'character' && layer.visible)
+    .sort((a, b) => a.zIndex - b.zIndex)
+    .map(layer => ({
+      source: layer.imagePath,
+      mask: layer.maskPath && layer.maskPath !== layer.imagePath ? layer.maskPath : undefined,
+      opacity: layer.opacity,
+      blend: (layer.properties?.blendMode as BlendMode | undefined) ?? 'normal'
+    })), [state.layers]);
+  
+  // 笔触覆盖层，与图层在同一渲染通道中绘制
+  const strokeOverlay = useMemo<OverlayPrimitive[]>(() => brushStrokes.map(stroke => ({
+    x0: stroke.x,
+    y0: stroke.y,
+    x1: stroke.x,
+    y1: stroke.y,
+    radius: stroke.size / 2,
+    fill: hexColor(partColors[stroke.mode], 0.7)
+  })), [brushStrokes]);
+  
   // 获取图像尺寸
   const handleImageLoad = (e: React.SyntheticEvent<HTMLImageElement>) => {
     const img = e.currentTarget;
@@ -449,64 +475,77 @@ export const StageBRenderer: React.FC<StageBRendererProps> = ({
       {/* 1. 背景层 */}
       <CanvasBackground size={20} />
       
-      {/* 2. 图像变换容器 */}
-      <CanvasTransform 
-        transform={transform}
-        imageWidth={imageSize.width}
-        imageHeight={imageSize.height}
-      >
-        {/* 3. 原始图像层 */}
-        {imagePath && (
-          <img 
-            ref={imageRef}
-            src={imagePath} 
-            alt="原图像"
-            className="max-w-full max-h-full object-contain z-10"
-            onLoad={handleImageLoad}
-          />
-        )}
-        
-        {/* 4. 部位图层 */}
-        {state.layers
-          .filter(layer => layer.type === 'character' && layer.visible)
-          .map(layer => (
-            <div 
-              key={layer.id}
-              className="relative z-20"
-              style={{ 
-                opacity: layer.opacity,
-                zIndex: layer.zIndex
-              }}
-            >
-              <img 
-                src={layer.imagePath} 
-                alt={`部位层 ${layer.name}`}
-                className="max-w-full max-h-full object-contain"
-              />
-              {/* 部位类型指示器 */}
-              <div className="absolute top-2 left-2 bg-primary text-white text-xs px-1 rounded">
-                {layer.properties?.partType || '未知'}
+      {/* 2. 图像与部位图层：优先使用GPU合成 */}
+      {compositor ? (
+        <GpuLayerCanvas
+          compositor={compositor}
+          imagePath={imagePath}
+          imageWidth={imageSize.width}
+          imageHeight={imageSize.height}
+          transform={transform}
+          layers={gpuLayers}
+          overlay={strokeOverlay}
+          onImageSize={setImageSize}
+        />
+      ) : (
+        <CanvasTransform 
+          transform={transform}
+          imageWidth={imageSize.width}
+          imageHeight={imageSize.height}
+        >
+          {/* 3. 原始图像层 */}
+          {imagePath && (
+            <img 
+              ref={imageRef}
+              src={imagePath} 
+              alt="原图像"
+              className="max-w-full max-h-full object-contain z-10"
+              onLoad={handleImageLoad}
+            />
+          )}
+          
+          {/* 4. 部位图层 */}
+          {state.layers
+            .filter(layer => layer.type === 'character' && layer.visible)
+            .map(layer => (
+              <div 
+                key={layer.id}
+                className="relative z-20"
+                style={{ 
+                  opacity: layer.opacity,
+                  zIndex: layer.zIndex
+                }}
+              >
+                <img 
+                  src={layer.imagePath} 
+                  alt={`部位层 ${layer.name}`}
+                  className="max-w-full max-h-full object-contain"
+                />
+                {/* 部位类型指示器 */}
+                <div className="absolute top-2 left-2 bg-primary text-white text-xs px-1 rounded">
+                  {layer.properties?.partType || '未知'}
+                </div>
               </div>
-            </div>
-          ))
-        }
-        
-        {/* 5. 交互覆盖层 - 显示笔触 */}
-        <div className="absolute inset-0 z-30 pointer-events-none">
-          <svg width="100%" height="100%" className="absolute inset-0">
-            {brushStrokes.map((stroke, index) => (
-              <circle
-                key={index}
-                cx={stroke.x}
-                cy={stroke.y}
-                r={stroke.size / 2}
-                fill={partColors[stroke.mode]}
-                opacity={0.7}
-              />
-            ))}
-          </svg>
-        </div>
-      </CanvasTransform>
+            ))
+          }
+          
+          {/* 5. 交互覆盖层 - 显示笔触 */}
+          <div className="absolute inset-0 z-30 pointer-events-none">
+            <svg width="100%" height="100%" className="absolute inset-0">
+              {brushStrokes.map((stroke, index) => (
+                <circle
+                  key={index}
+                  cx={stroke.x}
+                  cy={stroke.y}
+                  r={stroke.size / 2}
+                  fill={partColors[stroke.mode]}
+                  opacity={0.7}
+                />
+              ))}
+            </svg>
+          </div>
+        </CanvasTransform>
+      )}
     </div>
   );
 };
\ No newline at end of file
@@ -1,6 +1,8 @@
-import React, { useState, useRef } from 'react';
+import React, { useState, useRef, useMemo } from 'react';
 import { CanvasBackground } from './CanvasBackground';
 import { CanvasTransform } from './CanvasTransform';
+import { GpuLayerCanvas } from './GpuLayerCanvas';
+import { LayerCompositor, CompositorLayer, OverlayPrimitive, hexColor } from '../../utils/LayerCompositor';
 import { useCanvasContext } from '../../composables/CanvasContext';
 import { WeightEditPanel } from '../panels/WeightEditPanel';
 import { sx } from '../../../../themes/themeUtils';
@@ -42,6 +44,70 @@ export const StageCRenderer: React.FC<StageCRendererProps> = ({
   // 图像尺寸
   const [imageSize, setImageSize] = useState({ width: 0, height: 0 });
   
+  // 共享GPU合成器，不支持 WebGL2 时为 null，使用 DOM 渲染
+  const compositor = useMemo(() => LayerCompositor.shared(), []);
+  
+  // 骨骼、骨骼点和权重覆盖层，绘制顺序与 SVG 版本一致
+  const skeletonOverlay = useMemo<OverlayPrimitive[]>(() => {
+    const primitives: OverlayPrimitive[] = [];
+    const byId = new Map(state.skeletonPoints.map(point => [point.id, point]));
+    for (const point of state.skeletonPoints) {
+      const parent = point.parentId ? byId.get(point.parentId) : undefined;
+      if (parent) {
+        primitives.push({ x0: parent.x, y0: parent.y, x1: point.x, y1: point.y, radius: 1.5, fill: BONE_COLOR });
+      }
+    }
+    for (const point of state.skeletonPoints) {
+      const selected = state.selectedPointId === point.id;
+      const boneSelected = selectedBoneId === point.id;
+      primitives.push({
+        x0: point.x,
+        y0: point.y,
+        x1: point.x,
+        y1: point.y,
+        radius: selected ? 8 : 6,
+        fill: selected ? SELECTED_POINT_COLOR : POINT_COLOR,
+        stroke: boneSelected ? SELECTED_BONE_STROKE : POINT_STROKE,
+        strokeWidth: boneSelected ? 3 : 2
+      });
+    }
+    if (weightVisualization) {
+      for (const point of state.skeletonPoints) {
+        for (const [vertexId, weight] of Object.entries(point.weights || {})) {
+          const vertex = parseVertexId(vertexId);
+          if (vertex) {
+            primitives.push({ x0: vertex.x, y0: vertex.y, x1: vertex.x, y1: vertex.y, radius: 3, fill: [weight, 0, 1 - weight, 0.7] });
+          }
+        }
+      }
+    }
+    return primitives;
+  }, [state.skeletonPoints, state.selectedPointId, selectedBoneId, weightVisualization]);
+  
+  /**
+   * GPU模式下的骨骼点/骨骼拾取，对应 SVG 元素上的 onClick
+   */
+  const pickOverlay = (clientX: number, clientY: number) => {
+    const p = compositor?.toImageSpace(clientX, clientY);
+    if (!p) return;
+    const hitRadius = 2 / transform.scale;
+    for (let i = state.skeletonPoints.length - 1; i >= 0; i--) {
+      const point = state.skeletonPoints[i];
+      const radius = (state.selectedPointId === point.id ? 8 : 6) + 1 + hitRadius;
+      if ((point.x - p.x) ** 2 + (point.y - p.y) ** 2 <= radius * radius) {
+        dispatch({ type: 'SET_SELECTED_POINT', payload: point.id });
+        return;
+      }
+    }
+    for (const point of state.skeletonPoints) {
+      const parent = point.parentId ? state.skeletonPoints.find(q => q.id === point.parentId) : undefined;
+      if (parent && distanceToSegment(p.x, p.y, parent.x, parent.y, point.x, point.y) <= 1.5 + hitRadius) {
+        setSelectedBoneId(point.id);
+        return;
+      }
+    }
+  };
+  
   // 获取图像尺寸
   const handleImageLoad = (e: React.SyntheticEvent<HTMLImageElement>) => {
     const img = e.currentTarget;
@@ -78,6 +144,9 @@ export const StageCRenderer: React.FC<StageCRendererProps> = ({
    * 处理画布点击事件 - 添加骨骼点或连接骨骼
    */
   const handleCanvasClick = (e: React.MouseEvent) => {
+    if (compositor) {
+      pickOverlay(e.clientX, e.clientY);
+    }
     const imageCoords = convertToImageCoordinates(e.clientX, e.clientY);
     if (!imageCoords) return;
     
@@ -358,89 +427,102 @@ export const StageCRenderer: React.FC<StageCRendererProps> = ({
       {/* 1. 背景层 */}
       <CanvasBackground size={20} />
       
-      {/* 2. 图像变换容器 */}
-      <CanvasTransform 
-        transform={transform}
-        imageWidth={imageSize.width}
-        imageHeight={imageSize.height}
-      >
-        {/* 3. 原始图像层 */}
-        {imagePath && (
-          <img 
-            ref={imageRef}
-            src={imagePath} 
-            alt="原图像"
-            className="max-w-full max-h-full object-contain z-10"
-            onLoad={handleImageLoad}
-          />
-        )}
-        
-        {/* 4. 骨骼图层 */}
-        <div className="absolute inset-0 z-20">
-          <svg width="100%" height="100%" className="absolute inset-0">
-            {/* 绘制骨骼连接 */}
-            {state.skeletonPoints.map(point => {
-              if (point.parentId) {
-                const parent = state.skeletonPoints.find(p => p.id === point.parentId);
-                if (parent) {
-                  return (
-                    <line
-                      key={`bone-${point.id}`}
-                      x1={parent.x}
-                      y1={parent.y}
-                      x2={point.x}
-                      y2={point.y}
-                      stroke="#4ECDC4"
-                      strokeWidth="3"
-                      className="cursor-pointer hover:stroke-accent"
-                      onClick={() => setSelectedBoneId(point.id)}
-                    />
-                  );
-                }
-              }
-              return null;
-            })}
-            
-            {/* 绘制骨骼点 */}
-            {state.skeletonPoints.map(point => (
-              <circle
-                key={point.id}
-                cx={point.x}
-                cy={point.y}
-                r={state.selectedPointId === point.id ? "8" : "6"}
-                fill={state.selectedPointId === point.id ? "#FF6B6B" : "#45B7D1"}
-                stroke={selectedBoneId === point.id ? "#FFD93D" : "#FFFFFF"}
-                strokeWidth={selectedBoneId === point.id ? "3" : "2"}
-                className="cursor-pointer hover:fill-accent"
-                onClick={() => dispatch({ type: 'SET_SELECTED_POINT', payload: point.id })}
-              />
-            ))}
-            
-            {/* 权重可视化 */}
-            {weightVisualization && state.skeletonPoints.map(point => {
-              if (point.weights) {
-                return Object.entries(point.weights).map(([vertexId, weight]) => {
-                  const vertex = parseVertexId(vertexId);
-                  if (vertex) {
+      {/* 2. 图像与骨骼覆盖层：优先使用GPU合成 */}
+      {compositor ? (
+        <GpuLayerCanvas
+          compositor={compositor}
+          imagePath={imagePath}
+          imageWidth={imageSize.width}
+          imageHeight={imageSize.height}
+          transform={transform}
+          layers={NO_LAYERS}
+          overlay={skeletonOverlay}
+          onImageSize={setImageSize}
+        />
+      ) : (
+        <CanvasTransform 
+          transform={transform}
+          imageWidth={imageSize.width}
+          imageHeight={imageSize.height}
+        >
+          {/* 3. 原始图像层 */}
+          {imagePath && (
+            <img 
+              ref={imageRef}
+              src={imagePath} 
+              alt="原图像"
+              className="max-w-full max-h-full object-contain z-10"
+              onLoad={handleImageLoad}
+            />
+          )}
+          
+          {/* 4. 骨骼图层 */}
+          <div className="absolute inset-0 z-20">
+            <svg width="100%" height="100%" className="absolute inset-0">
+              {/* 绘制骨骼连接 */}
+              {state.skeletonPoints.map(point => {
+                if (point.parentId) {
+                  const parent = state.skeletonPoints.find(p => p.id === point.parentId);
+                  if (parent) {
                     return (
-                      <circle
-                        key={`weight-${point.id}-${vertexId}`}
-                        cx={vertex.x}
-                        cy={vertex.y}
-                        r="3"
-                        fill={getWeightColor(weight as number)}
-                        opacity="0.7"
+                      <line
+                        key={`bone-${point.id}`}
+                        x1={parent.x}
+                        y1={parent.y}
+                        x2={point.x}
+                        y2={point.y}
+                        stroke="#4ECDC4"
+                        strokeWidth="3"
+                        className="cursor-pointer hover:stroke-accent"
+                        onClick={() => setSelectedBoneId(point.id)}
                       />
                     );
                   }
-                  return null;
-                });
-              }
-              return null;
-            })}
-          </svg>
-        </div>
-      </CanvasTransform>
+                }
+                return null;
+              })}
+              
+              {/* 绘制骨骼点 */}
+              {state.skeletonPoints.map(point => (
+                <circle
+                  key={point.id}
+                  cx={point.x}
+                  cy={point.y}
+                  r={state.selectedPointId === point.id ? "8" : "6"}
+                  fill={state.selectedPointId === point.id ? "#FF6B6B" : "#45B7D1"}
+                  stroke={selectedBoneId === point.id ? "#FFD93D" : "#FFFFFF"}
+                  strokeWidth={selectedBoneId === point.id ? "3" : "2"}
+                  className="cursor-pointer hover:fill-accent"
+                  onClick={() => dispatch({ type: 'SET_SELECTED_POINT', payload: point.id })}
+                />
+              ))}
+              
+              {/* 权重可视化 */}
+              {weightVisualization && state.skeletonPoints.map(point => {
+                if (point.weights) {
+                  return Object.entries(point.weights).map(([vertexId, weight]) => {
+                    const vertex = parseVertexId(vertexId);
+                    if (vertex) {
+                      return (
+                        <circle
+                          key={`weight-${point.id}-${vertexId}`}
+                          cx={vertex.x}
+                          cy={vertex.y}
+                          r="3"
+                          fill={getWeightColor(weight as number)}
+                          opacity="0.7"
+                        />
+                      );
+                    }
+                    return null;
+                  });
+                }
+                return null;
+              })}
+            </svg>
+          </div>
+        </CanvasTransform>
+      )}
       
       {/* 6. 权重编辑面板 */}
       {skeletonMode === 'weight' && (
@@ -482,6 +564,23 @@ export const StageCRenderer: React.FC<StageCRendererProps> = ({
   );
 };
 
+const NO_LAYERS: CompositorLayer[] = [];
+const BONE_COLOR = hexColor('#4ECDC4');
+const POINT_COLOR = hexColor('#45B7D1');
+const SELECTED_POINT_COLOR = hexColor('#FF6B6B');
+const POINT_STROKE = hexColor('#FFFFFF');
+const SELECTED_BONE_STROKE = hexColor('#FFD93D');
+
+/**
+ * 点到线段的距离
+ */
+const distanceToSegment = (px: number, py: number, ax: number, ay: number, bx: number, by: number): number => {
+  const dx = bx - ax, dy = by - ay;
+  const lengthSq = dx * dx + dy * dy;
+  const t = lengthSq > 0 ? Math.max(0, Math.min(1, ((px - ax) * dx + (py - ay) * dy) / lengthSq)) : 0;
+  return Math.hypot(ax + t * dx - px, ay + t * dy - py);
+};
+
 /**
  * 解析顶点ID
  */
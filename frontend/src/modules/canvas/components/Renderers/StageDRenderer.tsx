@@ -1,8 +1,13 @@
-import React, { useState, useRef, useEffect } from 'react';
+import React, { useState, useRef, useEffect, useMemo } from 'react';
 import { CanvasBackground } from './CanvasBackground';
 import { CanvasTransform } from './CanvasTransform';
+import { GpuLayerCanvas } from './GpuLayerCanvas';
 
-import { useCanvasContext } from '../../composables/CanvasContext';
+import { useCanvasContext, SkeletonPoint } from '../../composables/CanvasContext';
+import { LayerCompositor, CompositorLayer, CompositorMesh, OverlayPrimitive, RGBA, hexColor } from '../../utils/LayerCompositor';
+import { PlaybackEngine, compileClip, evaluateClip, applyPose, poseFromPoints, POSE_CHANNELS } from '../../utils/AnimationEngine';
+import { SkinBuffers, MAX_BONES, buildSkinBuffers, computeBonePalette } from '../../utils/MeshSkinning';
+import type { MeshBuffers } from '../../utils/AutoMeshGenerator';
 
 interface StageDRendererProps {
   imagePath: string;
@@ -33,11 +38,42 @@ export const StageDRenderer: React.FC<StageDRendererProps> = ({
   
   const containerRef = useRef<HTMLDivElement>(null);
   const imageRef = useRef<HTMLImageElement>(null);
-  const animationRef = useRef<number | null>(null);
   
   // 图像尺寸
   const [imageSize, setImageSize] = useState({ width: 0, height: 0 });
   
+  // 共享GPU合成器（不支持 WebGL2 时为 null，使用 DOM 渲染）和播放引擎
+  const compositor = useMemo(() => LayerCompositor.shared(), []);
+  const engine = useMemo(() => PlaybackEngine.shared(), []);
+  
+  // DOM 渲染时播放中的骨骼点（GPU 渲染时逐帧直接写入合成器，不触发 React 渲染）
+  const [livePoints, setLivePoints] = useState<SkeletonPoint[] | null>(null);
+  
+  const activeAnimation = state.animations.find(a => a.id === state.activeAnimationId);
+  
+  // 绑定姿态：骨骼结构（点和父子关系）变化时的骨骼点，之后的移动都视为姿态
+  const structureKey = state.skeletonPoints.map(point => `${point.id}:${point.parentId ?? ''}`).join('|');
+  const bindSkeleton = useMemo(() => state.skeletonPoints, [structureKey]); // eslint-disable-line react-hooks/exhaustive-deps
+  const boneIds = useMemo(() => bindSkeleton.slice(0, MAX_BONES).map(point => point.id), [bindSkeleton]);
+  const paletteRef = useRef(new Float32Array(MAX_BONES * 8));
+  
+  // 带网格的可见图层作为蒙皮网格绘制
+  const meshes = useMemo<CompositorMesh[]>(() => {
+    return state.layers
+      .filter(layer => layer.visible && layer.imagePath && layer.properties?.meshData?.positions instanceof Float32Array)
+      .sort((a, b) => a.zIndex - b.zIndex)
+      .map(layer => ({
+        source: layer.imagePath,
+        skin: skinFor(layer.properties!.meshData as MeshBuffers, bindSkeleton),
+        opacity: layer.opacity,
+        blend: layer.properties?.blendMode
+      }));
+  }, [state.layers, bindSkeleton]);
+  
+  // 播放回调中读取的最新值
+  const latestRef = useRef({ skeletonPoints: state.skeletonPoints, selectedPointId: state.selectedPointId, currentTime: state.currentTime });
+  latestRef.current = { skeletonPoints: state.skeletonPoints, selectedPointId: state.selectedPointId, currentTime: state.currentTime };
+  
   // 获取图像尺寸
   const handleImageLoad = (e: React.SyntheticEvent<HTMLImageElement>) => {
     const img = e.currentTarget;
@@ -70,10 +106,30 @@ export const StageDRenderer: React.FC<StageDRendererProps> = ({
     return { x: imageX, y: imageY };
   };
   
+  /**
+   * GPU模式下的骨骼点拾取，对应 SVG 圆点上的 onClick
+   */
+  const pickPoint = (clientX: number, clientY: number) => {
+    const p = compositor?.toImageSpace(clientX, clientY);
+    if (!p) return;
+    const hitRadius = 2 / transform.scale;
+    for (let i = state.skeletonPoints.length - 1; i >= 0; i--) {
+      const point = state.skeletonPoints[i];
+      const radius = (state.selectedPointId === point.id ? 8 : 6) + 1 + hitRadius;
+      if ((point.x - p.x) ** 2 + (point.y - p.y) ** 2 <= radius * radius) {
+        dispatch({ type: 'SET_SELECTED_POINT', payload: point.id });
+        return;
+      }
+    }
+  };
+  
   /**
    * 处理画布点击事件 - 姿态调整或关键帧操作
    */
   const handleCanvasClick = (e: React.MouseEvent) => {
+    if (compositor) {
+      pickPoint(e.clientX, e.clientY);
+    }
     const imageCoords = convertToImageCoordinates(e.clientX, e.clientY);
     if (!imageCoords) return;
     
@@ -341,105 +397,55 @@ export const StageDRenderer: React.FC<StageDRendererProps> = ({
   };
   
   /**
-   * 播放动画
+   * 播放动画：由 isPlaying 驱动，逐帧姿态由播放引擎求值
+   * 播放期间不派发 reducer 动作，停止或结束时一次性写回当前时间和姿态
    */
-  const playAnimation = () => {
-    if (!state.activeAnimationId || state.isPlaying) return;
-    
-    dispatch({ type: 'TOGGLE_PLAYING', payload: true });
-    
-    const activeAnimation = state.animations.find(a => a.id === state.activeAnimationId);
-    if (!activeAnimation) return;
-    
-    const startTime = Date.now();
-    const duration = activeAnimation.duration * 1000; // 转换为毫秒
-    
-    const animate = () => {
-      const elapsed = Date.now() - startTime;
-      const progress = Math.min(elapsed / duration, 1);
-      
-      // 更新时间
-      const currentTime = progress * activeAnimation.duration;
-      dispatch({ type: 'SET_CURRENT_TIME', payload: currentTime });
-      
-      // 插值计算当前姿态
-      interpolatePose(currentTime);
-      
-      if (progress < 1 && state.isPlaying) {
-        animationRef.current = requestAnimationFrame(animate);
+  useEffect(() => {
+    if (!state.isPlaying || !activeAnimation) return;
+    
+    const clip = compileClip(activeAnimation);
+    const startTime = latestRef.current.currentTime < activeAnimation.duration ? latestRef.current.currentTime : 0;
+    const lastPose = new Float32Array(clip.boneIds.length * POSE_CHANNELS);
+    let lastTime = startTime;
+    let played = false;
+    
+    const unsubscribe = engine.subscribe('main', frame => {
+      const points = applyPose(latestRef.current.skeletonPoints, frame.clip, frame.pose);
+      lastPose.set(frame.pose);
+      lastTime = frame.time;
+      played = true;
+      if (compositor) {
+        compositor.setFrame({
+          overlay: buildSkeletonOverlay(points, latestRef.current.selectedPointId),
+          bonePalette: computeBonePalette(bindSkeleton, boneIds, frame.clip.boneIndex, frame.pose, paletteRef.current)
+        });
       } else {
-        // 动画结束
-        dispatch({ type: 'TOGGLE_PLAYING', payload: false });
-        if (activeAnimation.loop) {
-          // 如果循环播放，重新开始
-          setTimeout(() => playAnimation(), 0);
-        }
+        setLivePoints(points);
       }
-    };
-    
-    animationRef.current = requestAnimationFrame(animate);
-  };
-  
-  /**
-   * 停止动画
-   */
-  const stopAnimation = () => {
-    dispatch({ type: 'TOGGLE_PLAYING', payload: false });
-    if (animationRef.current) {
-      cancelAnimationFrame(animationRef.current);
-      animationRef.current = null;
-    }
-  };
-  
-  /**
-   * 插值计算姿态
-   */
-  const interpolatePose = (time: number) => {
-    if (!state.activeAnimationId) return;
-    
-    const activeAnimation = state.animations.find(a => a.id === state.activeAnimationId);
-    if (!activeAnimation || activeAnimation.keyframes.length === 0) return;
-    
-    // 找到当前时间附近的关键帧
-    let prevKeyframe = activeAnimation.keyframes[0];
-    let nextKeyframe = activeAnimation.keyframes[activeAnimation.keyframes.length - 1];
-    
-    for (let i = 0; i < activeAnimation.keyframes.length - 1; i++) {
-      if (time >= activeAnimation.keyframes[i].time && time <= activeAnimation.keyframes[i + 1].time) {
-        prevKeyframe = activeAnimation.keyframes[i];
-        nextKeyframe = activeAnimation.keyframes[i + 1];
-        break;
+      if (frame.finished) {
+        dispatch({ type: 'TOGGLE_PLAYING', payload: false });
       }
-    }
-    
-    // 计算插值因子
-    const timeDiff = nextKeyframe.time - prevKeyframe.time;
-    const factor = timeDiff === 0 ? 0 : (time - prevKeyframe.time) / timeDiff;
+    });
+    engine.play('main', activeAnimation, { startTime });
     
-    // 应用插值到骨骼点
-    prevKeyframe.properties.pose.forEach((prevBone: any) => {
-      const nextBone = nextKeyframe.properties.pose.find((b: any) => b.id === prevBone.id);
-      if (nextBone) {
-        const interpolatedX = prevBone.x + (nextBone.x - prevBone.x) * factor;
-        const interpolatedY = prevBone.y + (nextBone.y - prevBone.y) * factor;
-        const interpolatedRotation = prevBone.rotation + (nextBone.rotation - prevBone.rotation) * factor;
-        const interpolatedScale = prevBone.scale + (nextBone.scale - prevBone.scale) * factor;
-        
+    return () => {
+      unsubscribe();
+      engine.stop('main');
+      setLivePoints(null);
+      if (!played) return;
+      dispatch({ type: 'SET_CURRENT_TIME', payload: lastTime });
+      clip.boneIds.forEach((id, b) => {
+        const o = b * POSE_CHANNELS;
         dispatch({
           type: 'UPDATE_SKELETON_POINT',
           payload: {
-            id: prevBone.id,
-            updates: {
-              x: interpolatedX,
-              y: interpolatedY,
-              rotation: interpolatedRotation,
-              scale: interpolatedScale
-            }
+            id,
+            updates: { x: lastPose[o], y: lastPose[o + 1], rotation: lastPose[o + 2], scale: lastPose[o + 3] }
           }
         });
-      }
-    });
-  };
+      });
+    };
+  }, [state.isPlaying, activeAnimation, engine, compositor, bindSkeleton, boneIds, dispatch]);
   
   /**
    * 生成洋葱皮预览
@@ -450,9 +456,13 @@ export const StageDRenderer: React.FC<StageDRendererProps> = ({
     const activeAnimation = state.animations.find(a => a.id === state.activeAnimationId);
     if (!activeAnimation) return [];
     
-    const onionFrames = [];
+    const onionFrames: Array<{ time: number; opacity: number; color: string; points: SkeletonPoint[] }> = [];
+    const clip = compileClip(activeAnimation);
+    const pose = new Float32Array(clip.boneIds.length * POSE_CHANNELS);
+    const cursor = { segment: 0 };
+    const ghost = (time: number) => applyPose(state.skeletonPoints, clip, evaluateClip(clip, time, pose, cursor));
     
-    // 生成前后帧的洋葱皮
+    // 生成前后帧的洋葱皮：在对应时间求值剪辑得到骨骼姿态
     for (let i = 1; i <= onionSkinFrames; i++) {
       const prevTime = state.currentTime - (i / activeAnimation.fps);
       const nextTime = state.currentTime + (i / activeAnimation.fps);
@@ -461,7 +471,8 @@ export const StageDRenderer: React.FC<StageDRendererProps> = ({
         onionFrames.push({
           time: prevTime,
           opacity: 0.3 / i, // 距离越远，透明度越低
-          color: '#FF6B6B' // 红色表示过去帧
+          color: '#FF6B6B', // 红色表示过去帧
+          points: ghost(prevTime)
         });
       }
       
@@ -469,7 +480,8 @@ export const StageDRenderer: React.FC<StageDRendererProps> = ({
         onionFrames.push({
           time: nextTime,
           opacity: 0.3 / i, // 距离越远，透明度越低
-          color: '#4ECDC4' // 青色表示未来帧
+          color: '#4ECDC4', // 青色表示未来帧
+          points: ghost(nextTime)
         });
       }
     }
@@ -477,16 +489,25 @@ export const StageDRenderer: React.FC<StageDRendererProps> = ({
     return onionFrames;
   };
   
-  // 清理动画循环
-  useEffect(() => {
-    return () => {
-      if (animationRef.current) {
-        cancelAnimationFrame(animationRef.current);
-      }
-    };
-  }, []);
-  
   const generatedOnionSkinFrames = generateOnionSkin();
+  const displayPoints = livePoints ?? state.skeletonPoints;
+  
+  // GPU 覆盖层：洋葱皮骨骼在下，当前骨骼在上
+  const skeletonOverlay = useMemo<OverlayPrimitive[]>(() => {
+    const primitives: OverlayPrimitive[] = [];
+    for (const frame of generatedOnionSkinFrames) {
+      const color = hexColor(frame.color, frame.opacity);
+      appendBones(primitives, frame.points, color);
+    }
+    return [...primitives, ...buildSkeletonOverlay(state.skeletonPoints, state.selectedPointId)];
+  }, [state.skeletonPoints, state.selectedPointId, state.currentTime, activeAnimation, onionSkinEnabled, onionSkinFrames]); // eslint-disable-line react-hooks/exhaustive-deps
+  
+  // 非播放状态下，网格按当前骨骼点姿态变形
+  useEffect(() => {
+    if (!compositor || state.isPlaying || meshes.length === 0) return;
+    const { boneIndex, pose } = poseFromPoints(state.skeletonPoints);
+    compositor.setFrame({ bonePalette: computeBonePalette(bindSkeleton, boneIds, boneIndex, pose, paletteRef.current) });
+  }, [compositor, state.isPlaying, state.skeletonPoints, meshes, bindSkeleton, boneIds]);
   
   return (
     <div 
@@ -502,78 +523,141 @@ export const StageDRenderer: React.FC<StageDRendererProps> = ({
       {/* 1. 背景层 */}
       <CanvasBackground size={20} />
       
-      {/* 2. 图像变换容器 */}
-      <CanvasTransform 
-        transform={transform}
-        imageWidth={imageSize.width}
-        imageHeight={imageSize.height}
-      >
-        {/* 3. 洋葱皮预览层 */}
-        {onionSkinEnabled && generatedOnionSkinFrames.map((frame, index) => (
-          <div key={index} className="absolute inset-0 z-5" style={{ opacity: frame.opacity }}>
-            <div 
-              className="w-full h-full"
-              style={{
-                backgroundColor: frame.color,
-                mixBlendMode: 'screen'
-              }}
+      {/* 2. 图像、蒙皮网格与骨骼覆盖层：优先使用GPU合成 */}
+      {compositor ? (
+        <GpuLayerCanvas
+          compositor={compositor}
+          imagePath={imagePath}
+          imageWidth={imageSize.width}
+          imageHeight={imageSize.height}
+          transform={transform}
+          layers={NO_LAYERS}
+          overlay={skeletonOverlay}
+          meshes={meshes}
+          drawBaseImage={meshes.length === 0}
+          onImageSize={setImageSize}
+        />
+      ) : (
+        <CanvasTransform 
+          transform={transform}
+          imageWidth={imageSize.width}
+          imageHeight={imageSize.height}
+        >
+          {/* 3. 原始图像层 */}
+          {imagePath && (
+            <img 
+              ref={imageRef}
+              src={imagePath} 
+              alt="原图像"
+              className="max-w-full max-h-full object-contain z-10"
+              onLoad={handleImageLoad}
             />
-          </div>
-        ))}
-        
-        {/* 4. 原始图像层 */}
-        {imagePath && (
-          <img 
-            ref={imageRef}
-            src={imagePath} 
-            alt="原图像"
-            className="max-w-full max-h-full object-contain z-10"
-            onLoad={handleImageLoad}
-          />
-        )}
-        
-        {/* 5. 骨骼动画层 */}
-        <div className="absolute inset-0 z-20">
-          <svg width="100%" height="100%" className="absolute inset-0">
-            {/* 绘制骨骼连接 */}
-            {state.skeletonPoints.map(point => {
-              if (point.parentId) {
-                const parent = state.skeletonPoints.find(p => p.id === point.parentId);
-                if (parent) {
-                  return (
-                    <line
-                      key={`bone-${point.id}`}
-                      x1={parent.x}
-                      y1={parent.y}
-                      x2={point.x}
-                      y2={point.y}
-                      stroke="#4ECDC4"
-                      strokeWidth="3"
-                      className="cursor-pointer hover:stroke-accent"
-                    />
-                  );
+          )}
+          
+          {/* 4. 骨骼动画层 */}
+          <div className="absolute inset-0 z-20">
+            <svg width="100%" height="100%" className="absolute inset-0">
+              {/* 洋葱皮骨骼 */}
+              {generatedOnionSkinFrames.map((frame, index) => (
+                <g key={`onion-${index}`} opacity={frame.opacity}>
+                  {frame.points.map(point => {
+                    const parent = point.parentId ? frame.points.find(p => p.id === point.parentId) : undefined;
+                    return parent ? (
+                      <line key={point.id} x1={parent.x} y1={parent.y} x2={point.x} y2={point.y} stroke={frame.color} strokeWidth="3" />
+                    ) : null;
+                  })}
+                </g>
+              ))}
+              
+              {/* 绘制骨骼连接 */}
+              {displayPoints.map(point => {
+                if (point.parentId) {
+                  const parent = displayPoints.find(p => p.id === point.parentId);
+                  if (parent) {
+                    return (
+                      <line
+                        key={`bone-${point.id}`}
+                        x1={parent.x}
+                        y1={parent.y}
+                        x2={point.x}
+                        y2={point.y}
+                        stroke="#4ECDC4"
+                        strokeWidth="3"
+                        className="cursor-pointer hover:stroke-accent"
+                      />
+                    );
+                  }
                 }
-              }
-              return null;
-            })}
-            
-            {/* 绘制骨骼点 */}
-            {state.skeletonPoints.map(point => (
-              <circle
-                key={point.id}
-                cx={point.x}
-                cy={point.y}
-                r={state.selectedPointId === point.id ? "8" : "6"}
-                fill={state.selectedPointId === point.id ? "#FF6B6B" : "#45B7D1"}
-                stroke="#FFFFFF"
-                strokeWidth="2"
-                className="cursor-pointer hover:fill-accent"
-                onClick={() => dispatch({ type: 'SET_SELECTED_POINT', payload: point.id })}
-              />
-            ))}
-          </svg>
-        </div>
-      </CanvasTransform>
+                return null;
+              })}
+              
+              {/* 绘制骨骼点 */}
+              {displayPoints.map(point => (
+                <circle
+                  key={point.id}
+                  cx={point.x}
+                  cy={point.y}
+                  r={state.selectedPointId === point.id ? "8" : "6"}
+                  fill={state.selectedPointId === point.id ? "#FF6B6B" : "#45B7D1"}
+                  stroke="#FFFFFF"
+                  strokeWidth="2"
+                  className="cursor-pointer hover:fill-accent"
+                  onClick={() => dispatch({ type: 'SET_SELECTED_POINT', payload: point.id })}
+                />
+              ))}
+            </svg>
+          </div>
+        </CanvasTransform>
+      )}
     </div>
   );
-};
\ No newline at end of file
+};
+
+const NO_LAYERS: CompositorLayer[] = [];
+const BONE_COLOR = hexColor('#4ECDC4');
+const POINT_COLOR = hexColor('#45B7D1');
+const SELECTED_POINT_COLOR = hexColor('#FF6B6B');
+const POINT_STROKE = hexColor('#FFFFFF');
+
+// 蒙皮数据缓存：绑定姿态 -> 网格 -> 蒙皮，图层其他属性变化时不重建顶点缓冲区
+const skinCache = new WeakMap<SkeletonPoint[], WeakMap<MeshBuffers, SkinBuffers>>();
+
+function skinFor(mesh: MeshBuffers, bind: SkeletonPoint[]): SkinBuffers {
+  let byMesh = skinCache.get(bind);
+  if (!byMesh) skinCache.set(bind, (byMesh = new WeakMap()));
+  let skin = byMesh.get(mesh);
+  if (!skin) byMesh.set(mesh, (skin = buildSkinBuffers(mesh, bind)));
+  return skin;
+}
+
+function appendBones(primitives: OverlayPrimitive[], points: SkeletonPoint[], color: RGBA) {
+  const byId = new Map(points.map(point => [point.id, point]));
+  for (const point of points) {
+    const parent = point.parentId ? byId.get(point.parentId) : undefined;
+    if (parent) {
+      primitives.push({ x0: parent.x, y0: parent.y, x1: point.x, y1: point.y, radius: 1.5, fill: color });
+    }
+  }
+}
+
+/**
+ * 骨骼覆盖层图元，与 SVG 版本的绘制一致
+ */
+function buildSkeletonOverlay(points: SkeletonPoint[], selectedPointId: string | null): OverlayPrimitive[] {
+  const primitives: OverlayPrimitive[] = [];
+  appendBones(primitives, points, BONE_COLOR);
+  for (const point of points) {
+    const selected = selectedPointId === point.id;
+    primitives.push({
+      x0: point.x,
+      y0: point.y,
+      x1: point.x,
+      y1: point.y,
+      radius: selected ? 8 : 6,
+      fill: selected ? SELECTED_POINT_COLOR : POINT_COLOR,
+      stroke: POINT_STROKE,
+      strokeWidth: 2
+    });
+  }
+  return primitives;
+}
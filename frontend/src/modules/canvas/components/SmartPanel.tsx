@@ -159,8 +159,8 @@ export const SmartPanel: React.FC = () => {
               onOnionSkinEnabledChange={(enabled) => {}} 
               onionSkinFrames={3} 
               onOnionSkinFramesChange={(frames) => {}} 
-              onPlayAnimation={() => {}} 
-              onStopAnimation={() => {}} 
+              onPlayAnimation={() => dispatch({ type: 'TOGGLE_PLAYING', payload: true })} 
+              onStopAnimation={() => dispatch({ type: 'TOGGLE_PLAYING', payload: false })} 
             />
             
             <h3 className="text-sm font-medium mb-2 mt-4 text-text-secondary border-b border-border pb-1">{t('stageD.timeline')}</h3>
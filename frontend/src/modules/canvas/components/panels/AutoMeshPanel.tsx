@@ -1,7 +1,7 @@
 import React, { useState, useRef, useEffect } from 'react';
 import { useCanvasContext } from '../../composables/CanvasContext';
 import { useTranslation } from '../../../../i18n';
-import { AutoMeshGenerator, MeshData } from '../../utils/AutoMeshGenerator';
+import { AutoMeshGenerator, MeshBuffers } from '../../utils/AutoMeshGenerator';
 
 /**
  * 自动网格化组件
@@ -14,7 +14,7 @@ export const AutoMeshPanel: React.FC = () => {
   const [vertexDensity, setVertexDensity] = useState(50); // 顶点密度
   const [edgeSmoothing, setEdgeSmoothing] = useState(5); // 边缘平滑度
   const [optimizationLevel, setOptimizationLevel] = useState(1); // 优化级别
-  const [meshData, setMeshData] = useState<MeshData | null>(null);
+  const [meshData, setMeshData] = useState<MeshBuffers | null>(null);
   const [isGenerating, setIsGenerating] = useState(false);
   
   const canvasRef = useRef<HTMLCanvasElement>(null);
@@ -61,16 +61,12 @@ export const AutoMeshPanel: React.FC = () => {
         height: 200,
         vertexDensity,
         partMask: mockMask,
-        edgeSmoothing
+        edgeSmoothing,
+        optimizationLevel
       };
       
-      // 生成网格
-      let generatedMesh = AutoMeshGenerator.generateMesh(meshOptions);
-      
-      // 应用优化
-      if (optimizationLevel > 0) {
-        generatedMesh = AutoMeshGenerator.optimizeMesh(generatedMesh, optimizationLevel);
-      }
+      // 在 Web Worker 中生成网格（优化级别直接作用于内部顶点间距）
+      const generatedMesh = await AutoMeshGenerator.generateBuffersAsync(meshOptions);
       
       setMeshData(generatedMesh);
       
@@ -112,36 +108,33 @@ export const AutoMeshPanel: React.FC = () => {
     ctx.fillStyle = 'rgba(100, 200, 255, 0.3)';
     ctx.lineWidth = 1;
     
-    // 绘制三角形
-    meshData.triangles.forEach(triangle => {
-      const vertices = triangle.vertices.map(vertexId => 
-        meshData.vertices.find(v => v.id === vertexId)
-      ).filter(Boolean) as MeshData['vertices'];
-      
-      if (vertices.length === 3) {
-        ctx.beginPath();
-        ctx.moveTo(vertices[0].x, vertices[0].y);
-        ctx.lineTo(vertices[1].x, vertices[1].y);
-        ctx.lineTo(vertices[2].x, vertices[2].y);
-        ctx.closePath();
-        ctx.fill();
-        ctx.stroke();
-      }
-    });
+    // 绘制三角形（直接读取索引缓冲区）
+    const { positions, indices } = meshData;
+    ctx.beginPath();
+    for (let i = 0; i < indices.length; i += 3) {
+      const a = indices[i] * 2, b = indices[i + 1] * 2, c = indices[i + 2] * 2;
+      ctx.moveTo(positions[a], positions[a + 1]);
+      ctx.lineTo(positions[b], positions[b + 1]);
+      ctx.lineTo(positions[c], positions[c + 1]);
+      ctx.closePath();
+    }
+    ctx.fill();
+    ctx.stroke();
     
     // 绘制顶点
     ctx.fillStyle = 'rgba(255, 100, 100, 0.8)';
-    meshData.vertices.forEach(vertex => {
-      ctx.beginPath();
-      ctx.arc(vertex.x, vertex.y, 2, 0, 2 * Math.PI);
-      ctx.fill();
-    });
+    ctx.beginPath();
+    for (let i = 0; i < positions.length; i += 2) {
+      ctx.moveTo(positions[i] + 2, positions[i + 1]);
+      ctx.arc(positions[i], positions[i + 1], 2, 0, 2 * Math.PI);
+    }
+    ctx.fill();
     
     // 显示统计信息
     ctx.fillStyle = 'rgba(255, 255, 255, 0.8)';
     ctx.font = '12px Arial';
-    ctx.fillText(`顶点数: ${meshData.vertices.length}`, 10, 20);
-    ctx.fillText(`三角形数: ${meshData.triangles.length}`, 10, 35);
+    ctx.fillText(`顶点数: ${positions.length / 2}`, 10, 20);
+    ctx.fillText(`三角形数: ${indices.length / 3}`, 10, 35);
     ctx.fillText(`边界: ${meshData.bounds.minX},${meshData.bounds.minY} - ${meshData.bounds.maxX},${meshData.bounds.maxY}`, 10, 50);
   };
   
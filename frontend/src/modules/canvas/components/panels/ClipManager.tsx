@@ -2,6 +2,8 @@ import React from 'react';
 import { useTranslation } from '../../../../i18n';
 import { useCanvasContext } from '../../composables/CanvasContext';
 import { Button } from '@/components/ui/button';
+import { ClipPreview } from './ClipPreview';
+import { PlaybackEngine } from '../../utils/AnimationEngine';
 
 /**
  * 动画剪辑管理器组件
@@ -18,6 +20,39 @@ export const ClipManager: React.FC = () => {
     interpolation: 'linear' as 'linear' | 'bezier'
   });
   
+  // 正在预览的剪辑（循环播放，与主视图播放互不影响）
+  const [previewIds, setPreviewIds] = React.useState<string[]>([]);
+  
+  // 剪辑被删除或组件卸载时停止预览
+  React.useEffect(() => {
+    const engine = PlaybackEngine.shared();
+    const stale = previewIds.filter(id => !state.animations.some(a => a.id === id));
+    if (stale.length > 0) {
+      stale.forEach(id => engine.stop(`preview:${id}`));
+      setPreviewIds(ids => ids.filter(id => !stale.includes(id)));
+    }
+  }, [state.animations, previewIds]);
+  
+  React.useEffect(() => {
+    return () => {
+      const engine = PlaybackEngine.shared();
+      state.animations.forEach(a => engine.stop(`preview:${a.id}`));
+    };
+  }, []); // eslint-disable-line react-hooks/exhaustive-deps
+  
+  // 切换剪辑预览
+  const togglePreview = (animationId: string) => {
+    const engine = PlaybackEngine.shared();
+    const animation = state.animations.find(a => a.id === animationId);
+    if (previewIds.includes(animationId)) {
+      engine.stop(`preview:${animationId}`);
+      setPreviewIds(ids => ids.filter(id => id !== animationId));
+    } else if (animation) {
+      engine.play(`preview:${animationId}`, animation, { loop: true });
+      setPreviewIds(ids => [...ids, animationId]);
+    }
+  };
+  
   // 创建新动画剪辑
   const createNewAnimation = (name: string) => {
     dispatch({
@@ -90,7 +125,19 @@ export const ClipManager: React.FC = () => {
                 <div className="text-xs text-text-secondary">
                   {animation.duration}s
                 </div>
+                <button
+                  className={`ml-2 px-2 py-0.5 text-xs rounded ${previewIds.includes(animation.id) ? 'bg-primary text-white' : 'bg-surface-hover text-text-primary'}`}
+                  onClick={() => togglePreview(animation.id)}
+                  disabled={animation.keyframes.length === 0}
+                >
+                  {previewIds.includes(animation.id) ? t('stageD.stopPreview') : t('stageD.preview')}
+                </button>
               </div>
+              {previewIds.includes(animation.id) && (
+                <div className="mt-2">
+                  <ClipPreview clip={animation} skeleton={state.skeletonPoints} />
+                </div>
+              )}
             </div>
           ))
         )}
@@ -0,0 +1,69 @@
+import React, { useEffect, useRef } from 'react';
+import { AnimationClip, SkeletonPoint } from '../../composables/CanvasContext';
+import { PlaybackEngine, compileClip, POSE_CHANNELS } from '../../utils/AnimationEngine';
+
+interface ClipPreviewProps {
+  clip: AnimationClip;
+  /** 骨骼结构（父子关系），姿态来自剪辑 */
+  skeleton: SkeletonPoint[];
+  width?: number;
+  height?: number;
+}
+
+/**
+ * 剪辑预览组件
+ * 功能：订阅播放引擎的预览通道，在小画布上逐帧绘制骨骼，不触发 React 渲染
+ * 多个预览与主视图共用引擎的同一个动画循环
+ */
+export const ClipPreview: React.FC<ClipPreviewProps> = ({ clip, skeleton, width = 160, height = 100 }) => {
+  const canvasRef = useRef<HTMLCanvasElement>(null);
+
+  useEffect(() => {
+    const canvas = canvasRef.current;
+    const ctx = canvas?.getContext('2d');
+    if (!canvas || !ctx) return;
+
+    // 按剪辑中所有关键帧的范围自适应缩放
+    const compiled = compileClip(clip);
+    let minX = Infinity, minY = Infinity, maxX = -Infinity, maxY = -Infinity;
+    for (let i = 0; i < compiled.values.length; i += POSE_CHANNELS) {
+      minX = Math.min(minX, compiled.values[i]);
+      maxX = Math.max(maxX, compiled.values[i]);
+      minY = Math.min(minY, compiled.values[i + 1]);
+      maxY = Math.max(maxY, compiled.values[i + 1]);
+    }
+    const padding = 8;
+    const fit = Math.min((width - 2 * padding) / Math.max(1, maxX - minX), (height - 2 * padding) / Math.max(1, maxY - minY));
+    const offsetX = (width - (maxX - minX) * fit) / 2 - minX * fit;
+    const offsetY = (height - (maxY - minY) * fit) / 2 - minY * fit;
+
+    const parents = skeleton
+      .map(point => [compiled.boneIndex.get(point.id), point.parentId ? compiled.boneIndex.get(point.parentId) : undefined])
+      .filter((pair): pair is [number, number] => pair[0] !== undefined && pair[1] !== undefined);
+
+    return PlaybackEngine.shared().subscribe(`preview:${clip.id}`, frame => {
+      const pose = frame.pose;
+      const px = (b: number) => pose[b * POSE_CHANNELS] * fit + offsetX;
+      const py = (b: number) => pose[b * POSE_CHANNELS + 1] * fit + offsetY;
+
+      ctx.clearRect(0, 0, width, height);
+      ctx.strokeStyle = '#4ECDC4';
+      ctx.lineWidth = 2;
+      ctx.beginPath();
+      for (const [child, parent] of parents) {
+        ctx.moveTo(px(parent), py(parent));
+        ctx.lineTo(px(child), py(child));
+      }
+      ctx.stroke();
+
+      ctx.fillStyle = '#45B7D1';
+      for (let b = 0; b < frame.clip.boneIds.length; b++) {
+        ctx.beginPath();
+        ctx.arc(px(b), py(b), 2.5, 0, Math.PI * 2);
+        ctx.fill();
+      }
+    });
+  }, [clip, skeleton, width, height]);
+
+  return <canvas ref={canvasRef} width={width} height={height} className="w-full bg-surface rounded" />;
+};
@@ -194,14 +194,17 @@ export const LayerManager: React.FC = () => {
         layers: layerData,
         width: 800,
         height: 600,
-        filename: `layers_${Date.now()}.psd`
+        filename: `layers_${Date.now()}.psd`,
+        transferPixels: true
       };
 
-      // 导出PSD
-      const psdBlob = await PSDExporter.exportToPSD(exportOptions);
-      PSDExporter.downloadFile(psdBlob, exportOptions.filename);
+      // 导出PSD：图层在 Worker 中编码，直接写入文件
+      const sink = await PSDExporter.createFileSink(exportOptions.filename, 'image/vnd.adobe.photoshop');
+      await PSDExporter.writePSD(exportOptions, sink);
 
     } catch (error) {
+      // 用户取消保存对话框
+      if ((error as Error).name === 'AbortError') return;
       console.error('PSD导出失败:', error);
       alert('PSD导出失败: ' + (error as Error).message);
     }
@@ -227,14 +230,17 @@ export const LayerManager: React.FC = () => {
         layers: layerData,
         width: 800,
         height: 600,
-        filename: `layers_${Date.now()}`
+        filename: `layers_${Date.now()}.zip`,
+        transferPixels: true
       };
 
-      // 导出PNG序列
-      const pngFiles = await PSDExporter.exportToPNGSequence(exportOptions);
-      await PSDExporter.downloadMultipleFiles(pngFiles);
+      // 导出PNG序列：打包为ZIP，每个图层编码完成即写入
+      const sink = await PSDExporter.createFileSink(exportOptions.filename, 'application/zip');
+      await PSDExporter.writePNGSequenceZip(exportOptions, sink);
 
     } catch (error) {
+      // 用户取消保存对话框
+      if ((error as Error).name === 'AbortError') return;
       console.error('PNG序列导出失败:', error);
       alert('PNG序列导出失败: ' + (error as Error).message);
     }
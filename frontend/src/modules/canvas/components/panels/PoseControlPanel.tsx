@@ -16,6 +16,7 @@ export const PoseControlPanel: React.FC = () => {
   const [controlMode, setControlMode] = useState<'ik' | 'fk' | 'hybrid'>('hybrid');
   const [isRecording, setIsRecording] = useState(false);
   const [hybridChains, setHybridChains] = useState<HybridChain[]>([]);
+  const [solveMs, setSolveMs] = useState<number | null>(null); // 最近一次IK求解耗时
   
   // 初始化默认的混合链
   useEffect(() => {
@@ -70,6 +71,29 @@ export const PoseControlPanel: React.FC = () => {
     );
   };
   
+  // 一次批量求解所有链并应用
+  const applyAllChains = () => {
+    try {
+      const poseData = IKFKHybridController.calculateHybridPoses(hybridChains, state.skeletonPoints);
+      for (const [jointId, pose] of Object.entries(poseData)) {
+        dispatch({
+          type: 'UPDATE_SKELETON_POINT',
+          payload: {
+            id: jointId,
+            updates: {
+              x: pose.position.x,
+              y: pose.position.y,
+              rotation: pose.rotation
+            }
+          }
+        });
+      }
+      setSolveMs(IKFKHybridController.getSolveStats().lastMs);
+    } catch (error) {
+      console.error('姿态应用失败:', error);
+    }
+  };
+  
   // 应用姿态到骨骼
   const applyPoseToSkeleton = (chainId: string) => {
     const chain = hybridChains.find(c => c.id === chainId);
@@ -94,6 +118,7 @@ export const PoseControlPanel: React.FC = () => {
         });
       }
       
+      setSolveMs(IKFKHybridController.getSolveStats().lastMs);
       console.log(`已应用姿态到链: ${chainId}`);
       
     } catch (error) {
@@ -295,6 +320,14 @@ export const PoseControlPanel: React.FC = () => {
           {t('stageD.applyPose')}
         </button>
         
+        <button
+          onClick={applyAllChains}
+          disabled={hybridChains.length === 0}
+          className="w-full px-3 py-2 bg-blue-600 text-white rounded hover:bg-blue-700 disabled:bg-gray-600 disabled:cursor-not-allowed text-sm"
+        >
+          {t('stageD.applyAllChains')}
+        </button>
+        
         <button
           onClick={toggleRecording}
           className={`w-full px-3 py-2 text-white rounded text-sm ${
@@ -333,6 +366,9 @@ export const PoseControlPanel: React.FC = () => {
             {controlMode === 'hybrid' && (
               <div>{t('stageD.ikWeight')}: {(ikWeight * 100).toFixed(0)}%</div>
             )}
+            {solveMs !== null && (
+              <div>{t('stageD.ikSolveTime')}: {solveMs.toFixed(2)} ms</div>
+            )}
             <div>{t('stageD.joints')}: {selectedChain.ikChain.jointIds.length}</div>
           </div>
         </div>
@@ -1,4 +1,4 @@
-import React, { useState } from 'react';
+import React, { useRef, useState } from 'react';
 import { useTranslation } from '../../../../i18n';
 import { useCanvasContext } from '../../composables/CanvasContext';
 import { Button, Slider } from '@/components/ui';
@@ -27,6 +27,8 @@ export const SAMPanel: React.FC = () => {
   const [isProcessing, setIsProcessing] = useState(false);
   const [previewMask, setPreviewMask] = useState<string | null>(null);
   const [multipleTargets, setMultipleTargets] = useState(false);
+  // 当前图层的分割会话，后续点击只运行掩码解码器
+  const sessionRef = useRef<{ imagePath: string; imageId: string } | null>(null);
   
   // 添加点
   
@@ -77,12 +79,32 @@ export const SAMPanel: React.FC = () => {
         pointLabelsStr = points.map(p => `${p.label}`).join(';');
       }
       
-      // 将 base64 图像转换为 File
-      const imageBlob = await fetch(selectedLayer.imagePath).then(r => r.blob());
-      const imageFile = new File([imageBlob], 'image.png', { type: 'image/png' });
+      // 已有会话时复用缓存的图像嵌入，无需重新上传图像
+      let result: { success: boolean; image: string; image_id?: string } | null = null;
+      const session = sessionRef.current;
+      if (session && session.imagePath === selectedLayer.imagePath && pointsStr && pointLabelsStr) {
+        try {
+          result = await apiService.segmentWithImageId(session.imageId, pointsStr, pointLabelsStr);
+        } catch (error) {
+          // 嵌入已从缓存淘汰，回退到上传图像
+          if ((error as { status?: number }).status !== 404) {
+            throw error;
+          }
+          sessionRef.current = null;
+        }
+      }
       
-      // 调用 SAM API
-      const result = await apiService.segmentImage(imageFile, pointsStr, pointLabelsStr);
+      if (!result) {
+        // 将 base64 图像转换为 File
+        const imageBlob = await fetch(selectedLayer.imagePath).then(r => r.blob());
+        const imageFile = new File([imageBlob], 'image.png', { type: 'image/png' });
+        
+        // 调用 SAM API
+        result = await apiService.segmentImage(imageFile, pointsStr, pointLabelsStr);
+        if (result.image_id) {
+          sessionRef.current = { imagePath: selectedLayer.imagePath, imageId: result.image_id };
+        }
+      }
       
       if (result.success && result.image) {
         // 创建新图层
@@ -1,4 +1,5 @@
 import React, { createContext, useContext, useReducer, useState, useEffect, ReactNode } from 'react';
+import { StatePatch, applyStatePatch } from './historyPatches';
 
 
 // 定义Stage类型
@@ -133,6 +134,7 @@ type CanvasAction =
   | { type: 'SAVE_PROJECT' }
   | { type: 'EXPORT_PROJECT' }
   | { type: 'RESET_CANVAS' }
+  | { type: 'APPLY_HISTORY_PATCH'; payload: StatePatch }
   | { type: 'SET_SAM_SELECTION_MODE'; payload: 'foreground' | 'background' | 'lasso' };
 
 // 初始状态
@@ -342,6 +344,9 @@ function canvasReducer(state: CanvasState, action: CanvasAction): CanvasState {
       return state;
     case 'RESET_CANVAS':
       return { ...initialState };
+    case 'APPLY_HISTORY_PATCH':
+      // 撤销/重做：按补丁恢复，保留原有图层ID和未修改的对象
+      return applyStatePatch(state, action.payload);
     default:
       return state;
   }
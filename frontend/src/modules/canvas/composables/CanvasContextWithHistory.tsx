@@ -1,6 +1,7 @@
 import React, { createContext, useContext, ReactNode, useCallback, useEffect } from 'react';
 import { CanvasState, CanvasProvider, useCanvasContext } from './CanvasContext';
-import { useHistory } from './useHistory';
+import { useHistory, PixelEdit } from './useHistory';
+import { StatePatch } from './historyPatches';
 
 /**
  * 带历史记录的画布上下文类型
@@ -12,6 +13,7 @@ interface CanvasContextWithHistoryType {
   redo: () => void;
   clearHistory: () => void;
   saveHistory: (description?: string) => void;
+  recordPixelEdit: (edit: PixelEdit) => void;
 }
 
 // 创建历史记录上下文
@@ -45,50 +47,34 @@ export const CanvasProviderWithHistory: React.FC<CanvasProviderWithHistoryProps>
 const HistoryWrapper: React.FC<{ children: ReactNode }> = ({ children }) => {
   const { state, dispatch } = useCanvasContext();
   
-  // 创建一个设置状态的函数
-  const setState = useCallback((newState: CanvasState) => {
-    // 通过 dispatch 多个 action 来恢复状态
-    // 这是一个简化的实现，实际应该根据状态差异来优化
-    
-    // 恢复图层
-    dispatch({ type: 'RESET_CANVAS' });
-    newState.layers.forEach(layer => {
-      dispatch({ type: 'ADD_LAYER', payload: layer });
-    });
-    
-    // 恢复选中的图层
-    if (newState.selectedLayerId) {
-      dispatch({ type: 'SET_SELECTED_LAYER', payload: newState.selectedLayerId });
-    }
-    
-    // 恢复其他状态
-    dispatch({ type: 'SET_ZOOM', payload: newState.zoom });
-    dispatch({ type: 'SET_PAN_POSITION', payload: newState.panPosition });
-    dispatch({ type: 'SET_ACTIVE_TOOL', payload: newState.activeTool });
-    dispatch({ type: 'SET_STAGE', payload: newState.stage });
+  // 撤销/重做补丁直接交给 reducer，图层ID与未修改的对象保持不变
+  const applyPatch = useCallback((patch: StatePatch) => {
+    dispatch({ type: 'APPLY_HISTORY_PATCH', payload: patch });
   }, [dispatch]);
   
   // 使用历史记录 Hook
   const {
     saveHistory,
+    recordPixelEdit,
     undo,
     redo,
     clearHistory,
     canUndo,
     canRedo
-  } = useHistory(state, setState, {
+  } = useHistory(state, applyPatch, {
     maxHistorySize: 50,
     debounceMs: 300
   });
   
   // 监听状态变化，自动保存历史记录
+  // 记录只保存差异，图层、骨骼点和动画的任何修改都可以触发
   useEffect(() => {
-    // 只在图层、选中状态等关键状态变化时保存
     saveHistory();
   }, [
-    state.layers.length,
+    state.layers,
     state.selectedLayerId,
-    // 可以根据需要添加更多依赖
+    state.skeletonPoints,
+    state.animations
   ]);
   
   const value: CanvasContextWithHistoryType = {
@@ -97,7 +83,8 @@ const HistoryWrapper: React.FC<{ children: ReactNode }> = ({ children }) => {
     undo,
     redo,
     clearHistory,
-    saveHistory
+    saveHistory,
+    recordPixelEdit
   };
   
   return (
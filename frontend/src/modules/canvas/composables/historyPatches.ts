@@ -0,0 +1,215 @@
+import type { CanvasState } from './CanvasContext';
+
+/**
+ * 按ID增量比较的集合字段
+ */
+const COLLECTION_KEYS = ['layers', 'skeletonPoints', 'animations'] as const;
+type CollectionKey = typeof COLLECTION_KEYS[number];
+
+/**
+ * 不进入历史记录的瞬时字段（播放、光标、处理进度）
+ */
+const TRANSIENT_KEYS = new Set<keyof CanvasState>([
+  'cursorPosition',
+  'currentTime',
+  'isPlaying',
+  'processingStatus',
+  'isProcessing',
+  'processingMessage'
+]);
+
+/**
+ * 单个字段的变更
+ * Reducer 只做不可变更新，所以这里直接引用新旧对象而不是深拷贝，未修改的子树在各记录间共享
+ */
+export type StatePatchOp =
+  | { kind: 'set'; key: keyof CanvasState; value: unknown }
+  | {
+      kind: 'collection';
+      key: CollectionKey;
+      // [ID, 新元素]，元素为 undefined 表示删除
+      items: Array<[string, { id: string } | undefined]>;
+      // 顺序变化（增删、重排）时的完整ID顺序
+      order: string[] | null;
+    };
+
+export type StatePatch = StatePatchOp[];
+
+/**
+ * 状态历史记录：正向补丁用于重做，逆向补丁用于撤销
+ */
+export interface StateHistoryRecord {
+  forward: StatePatch;
+  inverse: StatePatch;
+}
+
+/**
+ * 像素图层的一个脏块
+ */
+export interface PixelTile {
+  x: number;
+  y: number;
+  width: number;
+  height: number;
+  before: Uint8ClampedArray;
+  after: Uint8ClampedArray;
+}
+
+export const PIXEL_TILE_SIZE = 64;
+
+// 每个补丁操作的估算开销（字节），只用于历史记录的内存预算
+const PATCH_OP_BYTES = 64;
+
+const sameOrder = (a: { id: string }[], b: { id: string }[]) =>
+  a.length === b.length && a.every((item, i) => item.id === b[i].id);
+
+function diffCollection(
+  key: CollectionKey,
+  prev: { id: string }[],
+  next: { id: string }[]
+): [StatePatchOp, StatePatchOp] | null {
+  const prevById = new Map(prev.map(item => [item.id, item]));
+  const nextById = new Map(next.map(item => [item.id, item]));
+  const forward: Array<[string, { id: string } | undefined]> = [];
+  const inverse: Array<[string, { id: string } | undefined]> = [];
+
+  for (const item of next) {
+    const old = prevById.get(item.id);
+    if (old !== item) {
+      forward.push([item.id, item]);
+      inverse.push([item.id, old]);
+    }
+  }
+  for (const item of prev) {
+    if (!nextById.has(item.id)) {
+      forward.push([item.id, undefined]);
+      inverse.push([item.id, item]);
+    }
+  }
+
+  const reordered = !sameOrder(prev, next);
+  if (forward.length === 0 && !reordered) return null;
+  return [
+    { kind: 'collection', key, items: forward, order: reordered ? next.map(item => item.id) : null },
+    { kind: 'collection', key, items: inverse, order: reordered ? prev.map(item => item.id) : null }
+  ];
+}
+
+/**
+ * 比较两个状态，生成正向与逆向补丁
+ * 只比较引用，计算量与记录大小均与变更规模成正比
+ * @returns 没有可记录的变化时返回 null
+ */
+export function diffStates(prev: CanvasState, next: CanvasState): StateHistoryRecord | null {
+  const forward: StatePatch = [];
+  const inverse: StatePatch = [];
+
+  for (const key of Object.keys(next) as (keyof CanvasState)[]) {
+    if (TRANSIENT_KEYS.has(key) || prev[key] === next[key]) continue;
+    if ((COLLECTION_KEYS as readonly string[]).includes(key)) {
+      const ops = diffCollection(key as CollectionKey, prev[key] as { id: string }[], next[key] as { id: string }[]);
+      if (ops) {
+        forward.push(ops[0]);
+        inverse.push(ops[1]);
+      }
+    } else {
+      forward.push({ kind: 'set', key, value: next[key] });
+      inverse.push({ kind: 'set', key, value: prev[key] });
+    }
+  }
+  return forward.length > 0 ? { forward, inverse } : null;
+}
+
+/**
+ * 对状态应用补丁，返回新状态（未涉及的字段和元素保持原引用）
+ */
+export function applyStatePatch(state: CanvasState, patch: StatePatch): CanvasState {
+  const result: Record<string, unknown> = { ...state };
+  for (const op of patch) {
+    if (op.kind === 'set') {
+      result[op.key] = op.value;
+      continue;
+    }
+    const current = result[op.key] as { id: string }[];
+    const byId = new Map(current.map(item => [item.id, item]));
+    for (const [id, item] of op.items) {
+      if (item === undefined) byId.delete(id);
+      else byId.set(id, item);
+    }
+    const order = op.order ?? current.map(item => item.id);
+    result[op.key] = order.map(id => byId.get(id)).filter(item => item !== undefined);
+  }
+  return result as unknown as CanvasState;
+}
+
+/**
+ * 估算状态补丁占用的内存
+ */
+export function statePatchBytes(record: StateHistoryRecord): number {
+  let ops = 0;
+  for (const op of record.forward) ops += op.kind === 'set' ? 1 : op.items.length + (op.order ? op.order.length / 8 : 0) + 1;
+  return ops * 2 * PATCH_OP_BYTES;
+}
+
+/**
+ * 比较整幅像素，按块提取变化区域
+ * @param before 修改前的RGBA像素
+ * @param after 修改后的RGBA像素
+ * @returns 有变化的块（各自保存修改前后的像素副本）
+ */
+export function diffPixelTiles(
+  before: Uint8ClampedArray,
+  after: Uint8ClampedArray,
+  width: number,
+  height: number,
+  tileSize: number = PIXEL_TILE_SIZE
+): PixelTile[] {
+  const tiles: PixelTile[] = [];
+  // 按32位比较，一次比较一个像素（要求4字节对齐，ImageData.data 满足）
+  const a = new Uint32Array(before.buffer, before.byteOffset, width * height);
+  const b = new Uint32Array(after.buffer, after.byteOffset, width * height);
+
+  for (let ty = 0; ty < height; ty += tileSize) {
+    const tileHeight = Math.min(tileSize, height - ty);
+    for (let tx = 0; tx < width; tx += tileSize) {
+      const tileWidth = Math.min(tileSize, width - tx);
+      let dirty = false;
+      for (let y = ty; y < ty + tileHeight && !dirty; y++) {
+        const row = y * width;
+        for (let x = tx; x < tx + tileWidth; x++) {
+          if (a[row + x] !== b[row + x]) {
+            dirty = true;
+            break;
+          }
+        }
+      }
+      if (dirty) {
+        tiles.push({
+          x: tx,
+          y: ty,
+          width: tileWidth,
+          height: tileHeight,
+          before: copyTile(before, width, tx, ty, tileWidth, tileHeight),
+          after: copyTile(after, width, tx, ty, tileWidth, tileHeight)
+        });
+      }
+    }
+  }
+  return tiles;
+}
+
+function copyTile(pixels: Uint8ClampedArray, width: number, x: number, y: number, tileWidth: number, tileHeight: number) {
+  const tile = new Uint8ClampedArray(tileWidth * tileHeight * 4);
+  for (let row = 0; row < tileHeight; row++) {
+    const start = ((y + row) * width + x) * 4;
+    tile.set(pixels.subarray(start, start + tileWidth * 4), row * tileWidth * 4);
+  }
+  return tile;
+}
+
+/**
+ * 像素块占用的内存
+ */
+export function pixelTilesBytes(tiles: PixelTile[]): number {
+  return tiles.reduce((total, tile) => total + tile.before.byteLength + tile.after.byteLength, 0);
+}
@@ -1,13 +1,45 @@
-import { useCallback, useRef, useEffect } from 'react';
+import { useCallback, useRef, useEffect, useState } from 'react';
 import { CanvasState } from './CanvasContext';
+import {
+  StateHistoryRecord,
+  StatePatch,
+  PixelTile,
+  diffStates,
+  applyStatePatch,
+  statePatchBytes,
+  diffPixelTiles,
+  pixelTilesBytes
+} from './historyPatches';
+
+/**
+ * 像素图层的写回函数，由持有画布的组件提供
+ */
+export type PixelTileWriter = (x: number, y: number, width: number, height: number, pixels: Uint8ClampedArray) => void;
 
 /**
  * 历史记录项
+ * 状态修改保存为正向/逆向补丁，像素修改保存为脏块，内存与变更大小成正比
  */
-interface HistoryEntry {
-  state: CanvasState;
+type HistoryEntry = {
   timestamp: number;
   description?: string;
+  bytes: number;
+} & (
+  | { kind: 'state'; record: StateHistoryRecord }
+  | { kind: 'pixels'; layerId: string; tiles: PixelTile[]; write: PixelTileWriter }
+);
+
+/**
+ * 像素修改记录参数
+ */
+export interface PixelEdit {
+  layerId: string;
+  width: number;
+  height: number;
+  before: Uint8ClampedArray; // 修改前的RGBA像素
+  after: Uint8ClampedArray; // 修改后的RGBA像素
+  write: PixelTileWriter;
+  description?: string;
 }
 
 /**
@@ -15,137 +47,201 @@ interface HistoryEntry {
  */
 interface HistoryConfig {
   maxHistorySize?: number; // 最大历史记录数量
+  maxHistoryBytes?: number; // 历史记录内存上限（字节）
   debounceMs?: number; // 防抖延迟（毫秒）
 }
 
 /**
  * 撤销重做 Hook
  * 提供完整的历史记录管理功能
+ * @param currentState 当前画布状态
+ * @param applyPatch 将补丁应用到画布状态（通常 dispatch APPLY_HISTORY_PATCH）
  */
 export function useHistory(
   currentState: CanvasState,
-  setState: (state: CanvasState) => void,
+  applyPatch: (patch: StatePatch) => void,
   config: HistoryConfig = {}
 ) {
-  const { maxHistorySize = 50, debounceMs = 300 } = config;
-  
+  const { maxHistorySize = 50, maxHistoryBytes = 256 * 1024 * 1024, debounceMs = 300 } = config;
+
   // 历史记录栈
   const historyRef = useRef<HistoryEntry[]>([]);
-  
-  // 当前历史记录索引
-  const historyIndexRef = useRef<number>(-1);
-  
+
+  // 已应用的记录数量（撤销指针）
+  const cursorRef = useRef<number>(0);
+
+  // 历史记录占用的内存
+  const bytesRef = useRef<number>(0);
+
+  // 最近一次记录时的状态，下一条记录相对它求差
+  const committedRef = useRef<CanvasState>(currentState);
+
+  // 最新状态，防抖回调中读取
+  const latestRef = useRef<CanvasState>(currentState);
+  latestRef.current = currentState;
+
   // 防抖定时器
   const debounceTimerRef = useRef<NodeJS.Timeout | null>(null);
-  
-  // 是否正在执行撤销/重做操作
-  const isUndoRedoRef = useRef<boolean>(false);
-  
+  const pendingDescriptionRef = useRef<string | undefined>(undefined);
+
+  // 历史记录变化时刷新 canUndo/canRedo
+  const [, setRevision] = useState(0);
+
+  /**
+   * 追加记录：丢弃重做分支，并按数量和内存上限裁剪最旧的记录
+   */
+  const pushEntry = useCallback((entry: HistoryEntry) => {
+    const history = historyRef.current;
+    for (const dropped of history.splice(cursorRef.current)) {
+      bytesRef.current -= dropped.bytes;
+    }
+    history.push(entry);
+    bytesRef.current += entry.bytes;
+    while (history.length > 1 && (history.length > maxHistorySize || bytesRef.current > maxHistoryBytes)) {
+      bytesRef.current -= history.shift()!.bytes;
+    }
+    cursorRef.current = history.length;
+    setRevision(revision => revision + 1);
+  }, [maxHistorySize, maxHistoryBytes]);
+
+  /**
+   * 把当前状态与上次记录的差异写入历史
+   */
+  const commit = useCallback(() => {
+    if (debounceTimerRef.current) {
+      clearTimeout(debounceTimerRef.current);
+      debounceTimerRef.current = null;
+    }
+    const record = diffStates(committedRef.current, latestRef.current);
+    committedRef.current = latestRef.current;
+    if (record) {
+      pushEntry({
+        kind: 'state',
+        record,
+        timestamp: Date.now(),
+        description: pendingDescriptionRef.current,
+        bytes: statePatchBytes(record)
+      });
+    }
+    pendingDescriptionRef.current = undefined;
+  }, [pushEntry]);
+
   /**
    * 保存当前状态到历史记录
+   * 撤销/重做后的状态与上次记录一致，求差为空，不会产生新记录
    */
   const saveHistory = useCallback((description?: string) => {
-    // 如果正在执行撤销/重做，不保存历史记录
-    if (isUndoRedoRef.current) {
-      return;
+    if (description) {
+      pendingDescriptionRef.current = description;
     }
-    
+
     // 清除防抖定时器
     if (debounceTimerRef.current) {
       clearTimeout(debounceTimerRef.current);
     }
-    
+
     // 设置防抖定时器
-    debounceTimerRef.current = setTimeout(() => {
-      const entry: HistoryEntry = {
-        state: JSON.parse(JSON.stringify(currentState)),
-        timestamp: Date.now(),
-        description
-      };
-      
-      // 如果不是在历史记录的末尾，删除后面的记录
-      if (historyIndexRef.current < historyRef.current.length - 1) {
-        historyRef.current = historyRef.current.slice(0, historyIndexRef.current + 1);
-      }
-      
-      // 添加新记录
-      historyRef.current.push(entry);
-      
-      // 限制历史记录数量
-      if (historyRef.current.length > maxHistorySize) {
-        historyRef.current.shift();
-      } else {
-        historyIndexRef.current++;
+    debounceTimerRef.current = setTimeout(commit, debounceMs);
+  }, [commit, debounceMs]);
+
+  /**
+   * 记录像素图层修改，只保存有变化的块
+   */
+  const recordPixelEdit = useCallback((edit: PixelEdit) => {
+    // 先落下尚未记录的状态修改，保证记录顺序
+    commit();
+    const tiles = diffPixelTiles(edit.before, edit.after, edit.width, edit.height);
+    if (tiles.length === 0) {
+      return;
+    }
+    pushEntry({
+      kind: 'pixels',
+      layerId: edit.layerId,
+      tiles,
+      write: edit.write,
+      timestamp: Date.now(),
+      description: edit.description,
+      bytes: pixelTilesBytes(tiles)
+    });
+  }, [commit, pushEntry]);
+
+  /**
+   * 在画布状态或像素上应用一条记录
+   */
+  const applyEntry = useCallback((entry: HistoryEntry, direction: 'undo' | 'redo') => {
+    if (entry.kind === 'pixels') {
+      for (const tile of entry.tiles) {
+        entry.write(tile.x, tile.y, tile.width, tile.height, direction === 'undo' ? tile.before : tile.after);
       }
-    }, debounceMs);
-  }, [currentState, debounceMs, maxHistorySize]);
-  
+      return;
+    }
+    const patch = direction === 'undo' ? entry.record.inverse : entry.record.forward;
+    committedRef.current = applyStatePatch(committedRef.current, patch);
+    applyPatch(patch);
+  }, [applyPatch]);
+
   /**
    * 撤销操作
    */
   const undo = useCallback(() => {
-    if (historyIndexRef.current > 0) {
-      isUndoRedoRef.current = true;
-      historyIndexRef.current--;
-      const entry = historyRef.current[historyIndexRef.current];
-      if (entry) {
-        setState(entry.state);
-      }
-      // 延迟重置标志，确保状态更新完成
-      setTimeout(() => {
-        isUndoRedoRef.current = false;
-      }, 0);
+    commit();
+    if (cursorRef.current > 0) {
+      cursorRef.current--;
+      applyEntry(historyRef.current[cursorRef.current], 'undo');
+      setRevision(revision => revision + 1);
     }
-  }, [setState]);
-  
+  }, [commit, applyEntry]);
+
   /**
    * 重做操作
    */
   const redo = useCallback(() => {
-    if (historyIndexRef.current < historyRef.current.length - 1) {
-      isUndoRedoRef.current = true;
-      historyIndexRef.current++;
-      const entry = historyRef.current[historyIndexRef.current];
-      if (entry) {
-        setState(entry.state);
-      }
-      // 延迟重置标志，确保状态更新完成
-      setTimeout(() => {
-        isUndoRedoRef.current = false;
-      }, 0);
+    commit();
+    if (cursorRef.current < historyRef.current.length) {
+      applyEntry(historyRef.current[cursorRef.current], 'redo');
+      cursorRef.current++;
+      setRevision(revision => revision + 1);
     }
-  }, [setState]);
-  
+  }, [commit, applyEntry]);
+
   /**
    * 清除历史记录
    */
   const clearHistory = useCallback(() => {
+    if (debounceTimerRef.current) {
+      clearTimeout(debounceTimerRef.current);
+      debounceTimerRef.current = null;
+    }
     historyRef.current = [];
-    historyIndexRef.current = -1;
+    cursorRef.current = 0;
+    bytesRef.current = 0;
+    committedRef.current = latestRef.current;
+    setRevision(revision => revision + 1);
   }, []);
-  
+
   /**
    * 检查是否可以撤销
    */
-  const canUndo = historyIndexRef.current > 0;
-  
+  const canUndo = cursorRef.current > 0;
+
   /**
    * 检查是否可以重做
    */
-  const canRedo = historyIndexRef.current < historyRef.current.length - 1;
-  
+  const canRedo = cursorRef.current < historyRef.current.length;
+
   /**
    * 获取历史记录信息
    */
   const getHistoryInfo = useCallback(() => {
     return {
-      currentIndex: historyIndexRef.current,
+      currentIndex: cursorRef.current - 1,
       totalEntries: historyRef.current.length,
+      memoryBytes: bytesRef.current,
       canUndo,
       canRedo
     };
   }, [canUndo, canRedo]);
-  
+
   // 清理防抖定时器
   useEffect(() => {
     return () => {
@@ -154,9 +250,10 @@ export function useHistory(
       }
     };
   }, []);
-  
+
   return {
     saveHistory,
+    recordPixelEdit,
     undo,
     redo,
     clearHistory,
@@ -7,6 +7,8 @@ import { useState, useCallback } from 'react';
 // 定义SAM模式的状态接口
 export interface PrecisionCutState {
   imagePath: string;
+  // 后端分割会话ID（图像嵌入缓存键），为空表示下次请求需要上传图像
+  imageId: string;
   historyStack: any[];
   layerVisibility: {
     original: boolean;
@@ -34,6 +36,7 @@ export const useSamWorkflow = (
   // 初始化SAM模式的状态
   const [state, setState] = useState<PrecisionCutState>({
     imagePath: initialState.imagePath || '',
+    imageId: initialState.imageId || '',
     historyStack: initialState.historyStack || [],
     layerVisibility: initialState.layerVisibility || {
       original: true,
@@ -57,7 +60,15 @@ export const useSamWorkflow = (
    * 设置图像路径
    */
   const setImagePath = useCallback((path: string) => {
-    setState(prev => ({ ...prev, imagePath: path }));
+    // 图像变化后旧的会话ID失效
+    setState(prev => ({ ...prev, imagePath: path, imageId: prev.imagePath === path ? prev.imageId : '' }));
+  }, []);
+
+  /**
+   * 设置分割会话ID
+   */
+  const setImageId = useCallback((imageId: string) => {
+    setState(prev => ({ ...prev, imageId }));
   }, []);
 
   /**
@@ -214,6 +225,7 @@ export const useSamWorkflow = (
 
     // 方法
     setImagePath,
+    setImageId,
     setProcessing,
     setProcessingProgress,
     setProcessingStatus,
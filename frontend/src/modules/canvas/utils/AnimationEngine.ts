@@ -0,0 +1,322 @@
+/**
+ * 动画播放引擎模块
+ * 功能：把动画剪辑编译为类型化数组曲线，在 React 状态之外逐帧求值姿态
+ * 播放期间不经过 reducer，只在开始/停止时同步一次画布状态
+ */
+
+import { AnimationClip, Keyframe, SkeletonPoint } from '../composables/CanvasContext';
+
+// 每个骨骼点的通道：x, y, rotation, scale
+export const POSE_CHANNELS = 4;
+
+// 缓动类型编码
+const EASE_CODES: Record<Keyframe['interpolation'], number> = {
+  linear: 0,
+  easeIn: 1,
+  easeOut: 2,
+  bezier: 3
+};
+
+/**
+ * 编译后的动画剪辑
+ */
+export interface CompiledClip {
+  clipId: string;
+  duration: number;
+  fps: number;
+  loop: boolean;
+  boneIds: string[];
+  boneIndex: Map<string, number>;
+  times: Float32Array; // 按时间排序的关键帧时间 (K)
+  ease: Uint8Array; // 关键帧 i 到 i+1 的缓动 (K)
+  values: Float32Array; // (K, B, 4)
+}
+
+/**
+ * 分段查找游标，顺序播放时每帧只需比较一次
+ */
+export interface ClipCursor {
+  segment: number;
+}
+
+const compiledClips = new WeakMap<AnimationClip, CompiledClip>();
+
+/**
+ * 编译剪辑（按剪辑对象缓存，剪辑被修改后 reducer 生成新对象，自动重新编译）
+ * 某个关键帧缺少的骨骼点沿用前一关键帧的值，开头缺失的取第一个出现的值
+ */
+export function compileClip(clip: AnimationClip): CompiledClip {
+  const cached = compiledClips.get(clip);
+  if (cached) return cached;
+
+  const keyframes = [...clip.keyframes].sort((a, b) => a.time - b.time);
+  const boneIndex = new Map<string, number>();
+  for (const keyframe of keyframes) {
+    for (const bone of keyframe.properties?.pose || []) {
+      if (!boneIndex.has(bone.id)) boneIndex.set(bone.id, boneIndex.size);
+    }
+  }
+
+  const frameCount = keyframes.length;
+  const boneCount = boneIndex.size;
+  const stride = boneCount * POSE_CHANNELS;
+  const times = new Float32Array(frameCount);
+  const ease = new Uint8Array(frameCount);
+  const values = new Float32Array(frameCount * stride);
+  const known = new Uint8Array(frameCount * boneCount);
+
+  keyframes.forEach((keyframe, k) => {
+    times[k] = keyframe.time;
+    ease[k] = EASE_CODES[keyframe.interpolation] ?? 0;
+    for (const bone of keyframe.properties?.pose || []) {
+      const b = boneIndex.get(bone.id)!;
+      const o = k * stride + b * POSE_CHANNELS;
+      values[o] = bone.x;
+      values[o + 1] = bone.y;
+      values[o + 2] = bone.rotation ?? 0;
+      values[o + 3] = bone.scale ?? 1;
+      known[k * boneCount + b] = 1;
+    }
+  });
+
+  // 补齐缺失的骨骼点：先向后沿用，再用第一个已知值向前填充
+  for (let b = 0; b < boneCount; b++) {
+    let last = -1;
+    for (let k = 0; k < frameCount; k++) {
+      if (known[k * boneCount + b]) {
+        if (last === -1) {
+          for (let j = 0; j < k; j++) copyBone(values, stride, b, k, j);
+        }
+        last = k;
+      } else if (last !== -1) {
+        copyBone(values, stride, b, last, k);
+      }
+    }
+  }
+
+  const compiled: CompiledClip = {
+    clipId: clip.id,
+    duration: clip.duration,
+    fps: clip.fps,
+    loop: clip.loop,
+    boneIds: [...boneIndex.keys()],
+    boneIndex,
+    times,
+    ease,
+    values
+  };
+  compiledClips.set(clip, compiled);
+  return compiled;
+}
+
+function copyBone(values: Float32Array, stride: number, bone: number, from: number, to: number) {
+  const src = from * stride + bone * POSE_CHANNELS;
+  values.copyWithin(to * stride + bone * POSE_CHANNELS, src, src + POSE_CHANNELS);
+}
+
+function applyEase(code: number, t: number): number {
+  switch (code) {
+    case 1:
+      return t * t;
+    case 2:
+      return 1 - (1 - t) * (1 - t);
+    case 3:
+      return t * t * (3 - 2 * t);
+    default:
+      return t;
+  }
+}
+
+/**
+ * 找到包含 time 的关键帧段，先检查游标所在段及其下一段，否则二分查找
+ */
+function findSegment(times: Float32Array, time: number, cursor: ClipCursor): number {
+  const last = times.length - 1;
+  let s = Math.min(cursor.segment, Math.max(0, last - 1));
+  if (times[s] <= time && (s + 1 > last || time < times[s + 1])) return s;
+  if (s + 2 <= last && times[s + 1] <= time && time < times[s + 2]) return (cursor.segment = s + 1);
+
+  let lo = 0, hi = last;
+  while (lo < hi) {
+    const mid = (lo + hi + 1) >> 1;
+    if (times[mid] <= time) lo = mid;
+    else hi = mid - 1;
+  }
+  cursor.segment = Math.min(lo, Math.max(0, last - 1));
+  return cursor.segment;
+}
+
+/**
+ * 求值某一时刻的姿态
+ * @param out (B, 4) 输出缓冲区，复用以避免每帧分配
+ */
+export function evaluateClip(clip: CompiledClip, time: number, out: Float32Array, cursor: ClipCursor): Float32Array {
+  const frameCount = clip.times.length;
+  const stride = clip.boneIds.length * POSE_CHANNELS;
+  if (frameCount === 0) return out;
+  if (frameCount === 1 || time <= clip.times[0]) {
+    out.set(clip.values.subarray(0, stride));
+    return out;
+  }
+  if (time >= clip.times[frameCount - 1]) {
+    out.set(clip.values.subarray((frameCount - 1) * stride, frameCount * stride));
+    return out;
+  }
+
+  const s = findSegment(clip.times, time, cursor);
+  const span = clip.times[s + 1] - clip.times[s];
+  const t = applyEase(clip.ease[s], span > 0 ? (time - clip.times[s]) / span : 0);
+  const a = s * stride, b = a + stride;
+  for (let i = 0; i < stride; i++) {
+    out[i] = clip.values[a + i] + (clip.values[b + i] - clip.values[a + i]) * t;
+  }
+  return out;
+}
+
+/**
+ * 播放帧
+ */
+export interface PlaybackFrame {
+  time: number;
+  pose: Float32Array; // (B, 4)，引擎内部缓冲区，只在回调期间有效
+  clip: CompiledClip;
+  finished: boolean;
+}
+
+export type PlaybackListener = (frame: PlaybackFrame) => void;
+
+interface ChannelState {
+  clip: CompiledClip;
+  cursor: ClipCursor;
+  pose: Float32Array;
+  startedAt: number;
+  loop: boolean;
+  listeners: Set<PlaybackListener>;
+}
+
+/**
+ * 播放引擎：所有正在播放的剪辑（主视图和剪辑预览）共用一个 requestAnimationFrame 循环
+ */
+export class PlaybackEngine {
+  private static instance: PlaybackEngine | null = null;
+
+  private channels = new Map<string, ChannelState>();
+  private listeners = new Map<string, Set<PlaybackListener>>();
+  private frame = 0;
+
+  static shared(): PlaybackEngine {
+    if (!PlaybackEngine.instance) {
+      PlaybackEngine.instance = new PlaybackEngine();
+    }
+    return PlaybackEngine.instance;
+  }
+
+  /**
+   * 开始播放
+   * @param channelId 播放通道（如 'main' 或 `preview:${clipId}`），同一通道再次播放会从头开始
+   * @param startTime 起始时间（秒）
+   */
+  play(channelId: string, clip: AnimationClip, options: { loop?: boolean; startTime?: number } = {}) {
+    const compiled = compileClip(clip);
+    this.channels.set(channelId, {
+      clip: compiled,
+      cursor: { segment: 0 },
+      pose: new Float32Array(compiled.boneIds.length * POSE_CHANNELS),
+      startedAt: performance.now() - (options.startTime ?? 0) * 1000,
+      loop: options.loop ?? compiled.loop,
+      listeners: this.listenersOf(channelId)
+    });
+    if (!this.frame) {
+      this.frame = requestAnimationFrame(this.tick);
+    }
+  }
+
+  stop(channelId: string) {
+    this.channels.delete(channelId);
+    if (this.channels.size === 0 && this.frame) {
+      cancelAnimationFrame(this.frame);
+      this.frame = 0;
+    }
+  }
+
+  isPlaying(channelId: string): boolean {
+    return this.channels.has(channelId);
+  }
+
+  /**
+   * 订阅通道的逐帧姿态
+   * @returns 取消订阅函数
+   */
+  subscribe(channelId: string, listener: PlaybackListener): () => void {
+    const listeners = this.listenersOf(channelId);
+    listeners.add(listener);
+    return () => {
+      listeners.delete(listener);
+    };
+  }
+
+  private listenersOf(channelId: string): Set<PlaybackListener> {
+    let listeners = this.listeners.get(channelId);
+    if (!listeners) {
+      listeners = new Set();
+      this.listeners.set(channelId, listeners);
+    }
+    return listeners;
+  }
+
+  private tick = (now: number) => {
+    this.frame = 0;
+    for (const [channelId, channel] of this.channels) {
+      const duration = channel.clip.duration;
+      let time = (now - channel.startedAt) / 1000;
+      let finished = false;
+      if (duration <= 0) {
+        time = 0;
+        finished = !channel.loop;
+      } else if (channel.loop) {
+        time %= duration;
+      } else if (time >= duration) {
+        time = duration;
+        finished = true;
+      }
+
+      evaluateClip(channel.clip, time, channel.pose, channel.cursor);
+      const frame: PlaybackFrame = { time, pose: channel.pose, clip: channel.clip, finished };
+      if (finished) {
+        this.channels.delete(channelId);
+      }
+      for (const listener of channel.listeners) {
+        listener(frame);
+      }
+    }
+    if (this.channels.size > 0 && !this.frame) {
+      this.frame = requestAnimationFrame(this.tick);
+    }
+  };
+}
+
+/**
+ * 把姿态应用到骨骼点（不修改原数组，缺少的骨骼点保持不变）
+ */
+export function applyPose(points: SkeletonPoint[], clip: CompiledClip, pose: Float32Array): SkeletonPoint[] {
+  return points.map(point => {
+    const b = clip.boneIndex.get(point.id);
+    if (b === undefined) return point;
+    const o = b * POSE_CHANNELS;
+    return { ...point, x: pose[o], y: pose[o + 1], rotation: pose[o + 2], scale: pose[o + 3] };
+  });
+}
+
+/**
+ * 把骨骼点编码为姿态（非播放状态下与剪辑姿态走同一条蒙皮路径）
+ */
+export function poseFromPoints(points: SkeletonPoint[]): { boneIndex: Map<string, number>; pose: Float32Array } {
+  const pose = new Float32Array(points.length * POSE_CHANNELS);
+  points.forEach((point, i) => {
+    pose[i * POSE_CHANNELS] = point.x;
+    pose[i * POSE_CHANNELS + 1] = point.y;
+    pose[i * POSE_CHANNELS + 2] = point.rotation ?? 0;
+    pose[i * POSE_CHANNELS + 3] = point.scale ?? 1;
+  });
+  return { boneIndex: new Map(points.map((point, i) => [point.id, i])), pose };
+}
@@ -1,8 +1,14 @@
 /**
  * 自动网格化工具模块
  * 功能：根据部位分割结果生成用于变形的网格
+ * 轮廓追踪 + 约束Delaunay三角剖分在 Web Worker 中执行，直接输出 GPU 缓冲区（见 meshTriangulation.ts）
  */
 
+import { buildMeshBuffers, MeshBuffers, MeshBuildParams } from './meshTriangulation';
+import type { AutoMeshWorkerRequest } from './autoMesh.worker';
+
+export type { MeshBuffers } from './meshTriangulation';
+
 export interface MeshVertex {
   id: string;
   x: number;
@@ -35,270 +41,122 @@ export interface AutoMeshOptions {
   vertexDensity: number; // 顶点密度，控制网格精细度
   partMask: ImageData; // 部位的遮罩数据
   edgeSmoothing: number; // 边缘平滑度
+  optimizationLevel?: number; // 优化级别，每级约减少10%内部顶点
+}
+
+interface PendingRequest {
+  resolve: (mesh: MeshBuffers) => void;
+  reject: (error: Error) => void;
 }
 
 /**
  * 自动网格化生成器
  */
 export class AutoMeshGenerator {
+  private static worker: Worker | null = null;
+  private static pending = new Map<number, PendingRequest>();
+  private static nextRequestId = 1;
   
   /**
-   * 生成用于部位变形的网格
-   */
-  static generateMesh(options: AutoMeshOptions): MeshData {
-    const { width, height, vertexDensity, partMask } = options;
-    
-    // 根据密度计算网格间距
-    const spacing = Math.max(5, Math.min(50, 100 / vertexDensity));
-    
-    // 生成顶点
-    const vertices = this.generateVertices(width, height, spacing, partMask);
-    
-    // 生成三角形
-    const triangles = this.generateTriangles(vertices, width, height, spacing);
-    
-    // 计算边界
-    const bounds = this.calculateBounds(vertices);
-    
-    return {
-      vertices,
-      triangles,
-      bounds,
-      vertexDensity
-    };
-  }
-  
-  /**
-   * 生成网格顶点
+   * 在 Web Worker 中生成网格缓冲区（不支持 Worker 的环境在当前线程生成）
+   * 遮罩像素以 Transferable 方式传入，调用方的 ImageData 不受影响
    */
-  private static generateVertices(
-    width: number, 
-    height: number, 
-    spacing: number, 
-    mask: ImageData
-  ): MeshVertex[] {
-    const vertices: MeshVertex[] = [];
-    let vertexId = 0;
-    
-    // 在网格点上生成顶点
-    for (let y = 0; y < height; y += spacing) {
-      for (let x = 0; x < width; x += spacing) {
-        // 检查该点是否在遮罩内
-        if (this.isPointInMask(x, y, mask)) {
-          const vertex: MeshVertex = {
-            id: `vertex-${vertexId++}`,
-            x,
-            y,
-            u: x / width,
-            v: y / height
-          };
-          vertices.push(vertex);
-        }
-      }
+  static generateBuffersAsync(options: AutoMeshOptions): Promise<MeshBuffers> {
+    if (typeof Worker === 'undefined') {
+      return Promise.resolve(this.generateBuffers(options));
     }
     
-    // 在边缘添加额外的顶点以提高变形质量
-    const edgeVertices = this.generateEdgeVertices(width, height, mask);
-    vertices.push(...edgeVertices);
-    
-    return vertices;
+    const worker = this.getWorker();
+    const id = this.nextRequestId++;
+    const pixels = options.partMask.data.slice().buffer;
+    const request: AutoMeshWorkerRequest = { id, pixels, params: this.buildParams(options) };
+    return new Promise((resolve, reject) => {
+      this.pending.set(id, { resolve, reject });
+      worker.postMessage(request, [pixels]);
+    });
   }
   
   /**
-   * 检查点是否在遮罩内
+   * 在当前线程生成网格缓冲区
    */
-  private static isPointInMask(x: number, y: number, mask: ImageData): boolean {
-    const index = (y * mask.width + x) * 4;
-    if (index < 0 || index >= mask.data.length) return false;
-    
-    // 检查alpha通道，大于128认为在遮罩内
-    return mask.data[index + 3] > 128;
-  }
-  
-  /**
-   * 生成边缘顶点
-   */
-  private static generateEdgeVertices(
-    width: number, 
-    height: number, 
-    mask: ImageData
-  ): MeshVertex[] {
-    const edgeVertices: MeshVertex[] = [];
-    let vertexId = 10000; // 边缘顶点使用不同的ID范围
-    
-    // 在遮罩边缘添加顶点
-    for (let y = 1; y < height - 1; y++) {
-      for (let x = 1; x < width - 1; x++) {
-        const currentInMask = this.isPointInMask(x, y, mask);
-        const neighbors = [
-          { x: x - 1, y }, // 左
-          { x: x + 1, y }, // 右
-          { x, y: y - 1 }, // 上
-          { x, y: y + 1 }  // 下
-        ];
-        
-        // 如果当前点在遮罩内，且至少有一个邻居在遮罩外，则是边缘
-        if (currentInMask) {
-          const isEdge = neighbors.some(neighbor => 
-            !this.isPointInMask(neighbor.x, neighbor.y, mask)
-          );
-          
-          if (isEdge) {
-            edgeVertices.push({
-              id: `edge-${vertexId++}`,
-              x,
-              y,
-              u: x / width,
-              v: y / height
-            });
-          }
-        }
-      }
-    }
-    
-    return edgeVertices;
+  static generateBuffers(options: AutoMeshOptions): MeshBuffers {
+    return buildMeshBuffers(options.partMask.data, this.buildParams(options));
   }
   
   /**
-   * 生成三角形
+   * 生成用于部位变形的网格（对象形式，兼容旧接口）
    */
-  private static generateTriangles(
-    vertices: MeshVertex[], 
-    width: number, 
-    height: number, 
-    spacing: number
-  ): MeshTriangle[] {
-    const triangles: MeshTriangle[] = [];
-    let triangleId = 0;
-    
-    // 使用Delaunay三角剖分算法（简化版）
-    // 这里使用基于网格的方法
-    for (let y = 0; y < height - spacing; y += spacing) {
-      for (let x = 0; x < width - spacing; x += spacing) {
-        // 找到当前网格的四个顶点
-        const topLeft = vertices.find(v => v.x === x && v.y === y);
-        const topRight = vertices.find(v => v.x === x + spacing && v.y === y);
-        const bottomLeft = vertices.find(v => v.x === x && v.y === y + spacing);
-        const bottomRight = vertices.find(v => v.x === x + spacing && v.y === y + spacing);
-        
-        // 创建两个三角形
-        if (topLeft && topRight && bottomLeft) {
-          triangles.push({
-            id: `triangle-${triangleId++}`,
-            vertices: [topLeft.id, topRight.id, bottomLeft.id]
-          });
-        }
-        
-        if (topRight && bottomLeft && bottomRight) {
-          triangles.push({
-            id: `triangle-${triangleId++}`,
-            vertices: [topRight.id, bottomLeft.id, bottomRight.id]
-          });
-        }
-      }
-    }
-    
-    return triangles;
+  static generateMesh(options: AutoMeshOptions): MeshData {
+    return this.toMeshData(this.generateBuffers(options));
   }
   
   /**
-   * 计算边界
+   * 将网格缓冲区展开为顶点/三角形对象
    */
-  private static calculateBounds(vertices: MeshVertex[]): {
-    minX: number;
-    minY: number;
-    maxX: number;
-    maxY: number;
-  } {
-    if (vertices.length === 0) {
-      return { minX: 0, minY: 0, maxX: 0, maxY: 0 };
+  static toMeshData(mesh: MeshBuffers): MeshData {
+    const vertexCount = mesh.positions.length / 2;
+    const vertices: MeshVertex[] = new Array(vertexCount);
+    for (let i = 0; i < vertexCount; i++) {
+      vertices[i] = {
+        id: `vertex-${i}`,
+        x: mesh.positions[2 * i],
+        y: mesh.positions[2 * i + 1],
+        u: mesh.uvs[2 * i],
+        v: mesh.uvs[2 * i + 1]
+      };
     }
     
-    let minX = vertices[0].x;
-    let minY = vertices[0].y;
-    let maxX = vertices[0].x;
-    let maxY = vertices[0].y;
-    
-    for (const vertex of vertices) {
-      minX = Math.min(minX, vertex.x);
-      minY = Math.min(minY, vertex.y);
-      maxX = Math.max(maxX, vertex.x);
-      maxY = Math.max(maxY, vertex.y);
-    }
-    
-    return { minX, minY, maxX, maxY };
-  }
-  
-  /**
-   * 优化网格，移除不必要的顶点
-   */
-  static optimizeMesh(mesh: MeshData, optimizationLevel: number = 1): MeshData {
-    // 基于优化级别移除顶点
-    const targetReduction = optimizationLevel * 0.1; // 10% * level
-    const targetVertexCount = Math.floor(mesh.vertices.length * (1 - targetReduction));
-    
-    if (mesh.vertices.length <= targetVertexCount) {
-      return mesh; // 无需优化
+    const triangleCount = mesh.indices.length / 3;
+    const triangles: MeshTriangle[] = new Array(triangleCount);
+    for (let i = 0; i < triangleCount; i++) {
+      triangles[i] = {
+        id: `triangle-${i}`,
+        vertices: [vertices[mesh.indices[3 * i]].id, vertices[mesh.indices[3 * i + 1]].id, vertices[mesh.indices[3 * i + 2]].id]
+      };
     }
     
-    // 简化的优化算法：基于顶点的重要性进行移除
-    const optimizedVertices = this.selectImportantVertices(mesh.vertices, targetVertexCount);
-    
-    // 重新生成三角形
-    const optimizedTriangles = this.regenerateTriangles(optimizedVertices);
-    
     return {
-      vertices: optimizedVertices,
-      triangles: optimizedTriangles,
+      vertices,
+      triangles,
       bounds: mesh.bounds,
       vertexDensity: mesh.vertexDensity
     };
   }
   
-  /**
-   * 选择重要的顶点
-   */
-  private static selectImportantVertices(vertices: MeshVertex[], targetCount: number): MeshVertex[] {
-    // 简化的重要性计算：基于位置分布
-    // 实际应用中可以使用更复杂的算法，如基于曲率、边缘强度等
-    
-    if (vertices.length <= targetCount) {
-      return vertices;
-    }
-    
-    // 均匀采样
-    const step = vertices.length / targetCount;
-    const selected: MeshVertex[] = [];
-    
-    for (let i = 0; i < vertices.length; i += step) {
-      const index = Math.floor(i);
-      if (index < vertices.length) {
-        selected.push(vertices[index]);
-      }
-    }
-    
-    return selected;
+  private static buildParams(options: AutoMeshOptions): MeshBuildParams {
+    return {
+      width: options.width,
+      height: options.height,
+      vertexDensity: options.vertexDensity,
+      edgeSmoothing: options.edgeSmoothing,
+      optimizationLevel: options.optimizationLevel ?? 0
+    };
   }
   
-  /**
-   * 重新生成三角形
-   */
-  private static regenerateTriangles(vertices: MeshVertex[]): MeshTriangle[] {
-    // 简化的三角剖分
-    // 实际应用中应该使用Delaunay三角剖分算法
-    
-    const triangles: MeshTriangle[] = [];
-    let triangleId = 0;
-    
-    // 这里只是一个占位符实现
-    // 实际应用中需要基于顶点位置进行正确的三角剖分
-    for (let i = 0; i < vertices.length - 2; i += 3) {
-      triangles.push({
-        id: `triangle-${triangleId++}`,
-        vertices: [vertices[i].id, vertices[i + 1].id, vertices[i + 2].id]
-      });
-    }
-    
-    return triangles;
+  private static getWorker(): Worker {
+    if (this.worker) return this.worker;
+    
+    const worker = new Worker(new URL('./autoMesh.worker.ts', import.meta.url), { type: 'module' });
+    worker.onmessage = (event: MessageEvent<{ id: number; mesh?: MeshBuffers; error?: string }>) => {
+      const { id, mesh, error } = event.data;
+      const request = this.pending.get(id);
+      if (!request) return;
+      this.pending.delete(id);
+      if (mesh) {
+        request.resolve(mesh);
+      } else {
+        request.reject(new Error(error || '网格生成失败'));
+      }
+    };
+    worker.onerror = (event: ErrorEvent) => {
+      // Worker 崩溃时拒绝所有未完成请求，下次调用重新创建
+      const error = new Error(event.message || '网格生成 Worker 出错');
+      this.pending.forEach(request => request.reject(error));
+      this.pending.clear();
+      worker.terminate();
+      this.worker = null;
+    };
+    this.worker = worker;
+    return worker;
   }
-}
\ No newline at end of file
+}
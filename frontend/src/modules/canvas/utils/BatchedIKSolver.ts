@@ -0,0 +1,230 @@
+/**
+ * 批量IK求解模块
+ * 功能：骨骼以 Float32Array 结构数组存储，所有IK链在一次调用中用 FABRIK 求解，达到容差提前结束
+ * 求解过程不分配对象，拖拽时每次指针移动只需同步坐标并求解
+ */
+
+import { SkeletonPoint } from '../composables/CanvasContext';
+
+/**
+ * 结构数组形式的骨骼
+ */
+export interface IKSkeleton {
+  ids: string[];
+  index: Map<string, number>;
+  x: Float32Array;
+  y: Float32Array;
+  rotation: Float32Array; // 弧度
+  scale: Float32Array;
+  version: number; // 结构变化时递增，已编译的链随之失效
+}
+
+/**
+ * 编译后的一批IK链
+ */
+export interface IKChainBatch {
+  skeletonVersion: number;
+  chainIds: string[];
+  offsets: Uint32Array; // 链 c 的关节为 joints[offsets[c] .. offsets[c+1])
+  joints: Uint32Array; // 骨骼索引，从根到末端
+  targets: Float32Array; // 每条链的目标 x,y
+  lengths: Float32Array; // 关节 i 到 i+1 的长度（求解时按当前坐标计算）
+  angles: Float32Array; // 求解前关节 i-1 到 i 的方向
+}
+
+export interface IKChainInput {
+  id: string;
+  jointIds: string[];
+  targetPosition: { x: number; y: number };
+  isActive?: boolean;
+}
+
+/**
+ * 求解计时
+ */
+export interface IKSolveStats {
+  solves: number; // 累计求解次数
+  totalMs: number; // 累计耗时
+  lastMs: number; // 最近一次求解耗时
+  lastIterations: number; // 最近一次所有链的迭代次数之和
+  lastConverged: number; // 最近一次达到容差的链数
+}
+
+const stats: IKSolveStats = { solves: 0, totalMs: 0, lastMs: 0, lastIterations: 0, lastConverged: 0 };
+
+/**
+ * 创建结构数组骨骼
+ */
+export function createIKSkeleton(points: SkeletonPoint[]): IKSkeleton {
+  const count = points.length;
+  const skeleton: IKSkeleton = {
+    ids: points.map(point => point.id),
+    index: new Map(points.map((point, i) => [point.id, i])),
+    x: new Float32Array(count),
+    y: new Float32Array(count),
+    rotation: new Float32Array(count),
+    scale: new Float32Array(count),
+    version: 0
+  };
+  loadIKSkeleton(skeleton, points);
+  return skeleton;
+}
+
+/**
+ * 把骨骼点的当前值写入已有骨骼
+ * @returns 骨骼点结构（数量和顺序）与骨骼一致时为 true，否则需要重新创建
+ */
+export function loadIKSkeleton(skeleton: IKSkeleton, points: SkeletonPoint[]): boolean {
+  if (points.length !== skeleton.ids.length) return false;
+  for (let i = 0; i < points.length; i++) {
+    const point = points[i];
+    if (point.id !== skeleton.ids[i]) return false;
+    skeleton.x[i] = point.x;
+    skeleton.y[i] = point.y;
+    skeleton.rotation[i] = point.rotation ?? 0;
+    skeleton.scale[i] = point.scale ?? 1;
+  }
+  return true;
+}
+
+/**
+ * 编译IK链，缺失的关节被跳过，少于2个关节或未激活的链不参与求解
+ */
+export function compileIKChains(skeleton: IKSkeleton, chains: IKChainInput[]): IKChainBatch {
+  const active = chains.filter(chain => chain.isActive !== false);
+  const offsets = new Uint32Array(active.length + 1);
+  const joints: number[] = [];
+  active.forEach((chain, c) => {
+    const start = joints.length;
+    for (const id of chain.jointIds) {
+      const i = skeleton.index.get(id);
+      if (i !== undefined) joints.push(i);
+    }
+    if (joints.length - start < 2) joints.length = start;
+    offsets[c + 1] = joints.length;
+  });
+  const targets = new Float32Array(active.length * 2);
+  active.forEach((chain, c) => {
+    targets[2 * c] = chain.targetPosition.x;
+    targets[2 * c + 1] = chain.targetPosition.y;
+  });
+  return {
+    skeletonVersion: skeleton.version,
+    chainIds: active.map(chain => chain.id),
+    offsets,
+    joints: Uint32Array.from(joints),
+    targets,
+    lengths: new Float32Array(joints.length),
+    angles: new Float32Array(joints.length)
+  };
+}
+
+/**
+ * 批量求解所有链（FABRIK，根关节固定）
+ * 共享关节的链按顺序求解，后面的链使用前面链的结果
+ * 关节旋转按其父段方向的变化累加，与原 CCD 实现的语义一致
+ */
+export function solveIKBatch(
+  skeleton: IKSkeleton,
+  batch: IKChainBatch,
+  maxIterations: number = 100,
+  tolerance: number = 1.0
+): IKSolveStats {
+  const start = performance.now();
+  const { x, y, rotation } = skeleton;
+  const { offsets, joints, targets, lengths, angles } = batch;
+  const toleranceSq = tolerance * tolerance;
+  let iterations = 0;
+  let converged = 0;
+
+  for (let c = 0; c + 1 < offsets.length; c++) {
+    const first = offsets[c], last = offsets[c + 1] - 1;
+    if (last <= first) continue;
+    const tx = targets[2 * c], ty = targets[2 * c + 1];
+    const root = joints[first], end = joints[last];
+    const rootX = x[root], rootY = y[root];
+
+    let reach = 0;
+    for (let k = first; k < last; k++) {
+      const a = joints[k], b = joints[k + 1];
+      const dx = x[b] - x[a], dy = y[b] - y[a];
+      lengths[k] = Math.sqrt(dx * dx + dy * dy);
+      angles[k + 1] = Math.atan2(dy, dx);
+      reach += lengths[k];
+    }
+
+    const rtx = tx - rootX, rty = ty - rootY;
+    if (rtx * rtx + rty * rty >= reach * reach) {
+      // 目标不可达：沿目标方向伸直
+      const d = Math.sqrt(rtx * rtx + rty * rty) || 1;
+      const ux = rtx / d, uy = rty / d;
+      let along = 0;
+      for (let k = first; k < last; k++) {
+        along += lengths[k];
+        x[joints[k + 1]] = rootX + ux * along;
+        y[joints[k + 1]] = rootY + uy * along;
+      }
+      iterations++;
+    } else {
+      for (let iteration = 0; iteration < maxIterations; iteration++) {
+        const ex = x[end] - tx, ey = y[end] - ty;
+        if (ex * ex + ey * ey < toleranceSq) break;
+        iterations++;
+
+        // 反向：末端放到目标，逐段拉回
+        x[end] = tx;
+        y[end] = ty;
+        for (let k = last - 1; k >= first; k--) {
+          const a = joints[k], b = joints[k + 1];
+          const dx = x[a] - x[b], dy = y[a] - y[b];
+          const s = lengths[k] / (Math.sqrt(dx * dx + dy * dy) || 1);
+          x[a] = x[b] + dx * s;
+          y[a] = y[b] + dy * s;
+        }
+        // 正向：根放回原处，逐段推出
+        x[root] = rootX;
+        y[root] = rootY;
+        for (let k = first; k < last; k++) {
+          const a = joints[k], b = joints[k + 1];
+          const dx = x[b] - x[a], dy = y[b] - y[a];
+          const s = lengths[k] / (Math.sqrt(dx * dx + dy * dy) || 1);
+          x[b] = x[a] + dx * s;
+          y[b] = y[a] + dy * s;
+        }
+      }
+    }
+
+    const ex = x[end] - tx, ey = y[end] - ty;
+    if (ex * ex + ey * ey < toleranceSq) converged++;
+
+    // 段方向变化归一化到 [-π, π]，跨越 ±π 时不会多转一圈
+    for (let k = first + 1; k <= last; k++) {
+      const a = joints[k - 1], b = joints[k];
+      const delta = Math.atan2(y[b] - y[a], x[b] - x[a]) - angles[k];
+      rotation[b] += delta - 2 * Math.PI * Math.round(delta / (2 * Math.PI));
+    }
+  }
+
+  const elapsed = performance.now() - start;
+  stats.solves++;
+  stats.totalMs += elapsed;
+  stats.lastMs = elapsed;
+  stats.lastIterations = iterations;
+  stats.lastConverged = converged;
+  return stats;
+}
+
+/**
+ * 读取求解计时（只读快照）
+ */
+export function getIKSolveStats(): IKSolveStats {
+  return { ...stats };
+}
+
+export function resetIKSolveStats() {
+  stats.solves = 0;
+  stats.totalMs = 0;
+  stats.lastMs = 0;
+  stats.lastIterations = 0;
+  stats.lastConverged = 0;
+}
@@ -4,6 +4,16 @@
  */
 
 import { SkeletonPoint } from '../composables/CanvasContext';
+import {
+  IKSkeleton,
+  IKChainBatch,
+  IKSolveStats,
+  createIKSkeleton,
+  loadIKSkeleton,
+  compileIKChains,
+  solveIKBatch,
+  getIKSolveStats
+} from './BatchedIKSolver';
 
 export interface IKChain {
   id: string;
@@ -42,8 +52,15 @@ export interface PoseData {
  */
 export class IKFKHybridController {
   
+  // 复用的结构数组骨骼和已编译链（拖拽时骨骼结构和链通常不变）
+  private static skeleton: IKSkeleton | null = null;
+  private static compiled = new WeakMap<IKChain[], IKChainBatch>();
+  // 第一条参与IK的链 -> 参与IK的链数组，使 compiled 在逐帧调用间能命中
+  private static ikChainLists = new WeakMap<IKChain, IKChain[]>();
+  
   /**
    * 计算IK解
+   * 不修改传入的骨骼点
    */
   static solveIK(
     chain: IKChain,
@@ -51,112 +68,60 @@ export class IKFKHybridController {
     maxIterations: number = 100,
     tolerance: number = 1.0
   ): { [jointId: string]: PoseData } | null {
-    const joints = chain.jointIds.map(id => 
-      skeletonPoints.find(p => p.id === id)
-    ).filter(Boolean) as SkeletonPoint[];
-    
+    const joints = chain.jointIds.filter(id => skeletonPoints.some(p => p.id === id));
     if (joints.length < 2) return null;
-    
-    const result: { [jointId: string]: PoseData } = {};
-    
-    // 简化的CCD（Cyclic Coordinate Descent）算法
-    for (let iteration = 0; iteration < maxIterations; iteration++) {
-      const endEffector = joints[joints.length - 1];
-      const distance = this.calculateDistance(
-        { x: endEffector.x, y: endEffector.y },
-        chain.targetPosition
-      );
-      
-      if (distance < tolerance) {
-        // 找到解，记录最终姿态
-        for (const joint of joints) {
-          result[joint.id] = {
-            position: { x: joint.x, y: joint.y },
-            rotation: joint.rotation || 0,
-            scale: { x: joint.scale || 1, y: joint.scale || 1 }
-          };
-        }
-        return result;
-      }
-      
-      // 从末端向根节点迭代
-      for (let i = joints.length - 2; i >= 0; i--) {
-        const currentJoint = joints[i];
-        const endEffectorPos = { x: endEffector.x, y: endEffector.y };
-        const targetPos = chain.targetPosition;
-        const jointPos = { x: currentJoint.x, y: currentJoint.y };
-        
-        // 计算旋转角度
-        const angle = this.calculateRotationAngle(
-          jointPos,
-          endEffectorPos,
-          targetPos
-        );
-        
-        // 应用旋转
-        this.rotateJoint(currentJoint, joints.slice(i + 1), angle);
-      }
-    }
-    
-    // 达到最大迭代次数，返回最佳解
-    for (const joint of joints) {
-      result[joint.id] = {
-        position: { x: joint.x, y: joint.y },
-        rotation: joint.rotation || 0,
-        scale: { x: joint.scale || 1, y: joint.scale || 1 }
-      };
-    }
-    
-    return result;
-  }
-  
-  /**
-   * 计算两点间距离
-   */
-  private static calculateDistance(p1: { x: number; y: number }, p2: { x: number; y: number }): number {
-    const dx = p2.x - p1.x;
-    const dy = p2.y - p1.y;
-    return Math.sqrt(dx * dx + dy * dy);
+    return this.solveIKChains([{ ...chain, isActive: true }], skeletonPoints, maxIterations, tolerance);
   }
   
   /**
-   * 计算旋转角度
+   * 在一次批量求解中计算所有IK链（如四足骨骼的四条腿及其镜像链）
+   * @param chains 同一个数组在多次调用间复用时，链的编译结果会被缓存，目标位置每次重新读取
+   * @returns 所有参与求解的关节的姿态
    */
-  private static calculateRotationAngle(
-    joint: { x: number; y: number },
-    endEffector: { x: number; y: number },
-    target: { x: number; y: number }
-  ): number {
-    const v1 = { x: endEffector.x - joint.x, y: endEffector.y - joint.y };
-    const v2 = { x: target.x - joint.x, y: target.y - joint.y };
+  static solveIKChains(
+    chains: IKChain[],
+    skeletonPoints: SkeletonPoint[],
+    maxIterations: number = 100,
+    tolerance: number = 1.0
+  ): { [jointId: string]: PoseData } {
+    let skeleton = this.skeleton;
+    if (!skeleton || !loadIKSkeleton(skeleton, skeletonPoints)) {
+      const version = skeleton ? skeleton.version + 1 : 0;
+      skeleton = this.skeleton = createIKSkeleton(skeletonPoints);
+      skeleton.version = version;
+    }
+    
+    let batch = this.compiled.get(chains);
+    if (!batch || batch.skeletonVersion !== skeleton.version) {
+      batch = compileIKChains(skeleton, chains);
+      this.compiled.set(chains, batch);
+    } else {
+      const byId = new Map(chains.map(chain => [chain.id, chain]));
+      batch.chainIds.forEach((id, c) => {
+        const target = byId.get(id)!.targetPosition;
+        batch!.targets[2 * c] = target.x;
+        batch!.targets[2 * c + 1] = target.y;
+      });
+    }
     
-    const angle1 = Math.atan2(v1.y, v1.x);
-    const angle2 = Math.atan2(v2.y, v2.x);
+    solveIKBatch(skeleton, batch, maxIterations, tolerance);
     
-    return angle2 - angle1;
+    const result: { [jointId: string]: PoseData } = {};
+    for (const i of batch.joints) {
+      result[skeleton.ids[i]] = {
+        position: { x: skeleton.x[i], y: skeleton.y[i] },
+        rotation: skeleton.rotation[i],
+        scale: { x: skeleton.scale[i], y: skeleton.scale[i] }
+      };
+    }
+    return result;
   }
   
   /**
-   * 旋转关节
+   * 获取IK求解计时
    */
-  private static rotateJoint(
-    joint: SkeletonPoint,
-    children: SkeletonPoint[],
-    angle: number
-  ): void {
-    const cos = Math.cos(angle);
-    const sin = Math.sin(angle);
-    
-    for (const child of children) {
-      const dx = child.x - joint.x;
-      const dy = child.y - joint.y;
-      
-      child.x = joint.x + dx * cos - dy * sin;
-      child.y = joint.y + dx * sin + dy * cos;
-      
-      // 更新旋转角度
-      child.rotation = (child.rotation || 0) + angle;
-    }
+  static getSolveStats(): IKSolveStats {
+    return getIKSolveStats();
   }
   
   /**
@@ -287,6 +252,56 @@ export class IKFKHybridController {
     }
   }
   
+  /**
+   * 计算多条混合链的姿态，所有用到IK的链在一次批量求解中完成
+   */
+  static calculateHybridPoses(
+    hybridChains: HybridChain[],
+    skeletonPoints: SkeletonPoint[]
+  ): { [jointId: string]: PoseData } {
+    const ikChains = this.ikChainsOf(hybridChains);
+    const ikResult = ikChains.length > 0 ? this.solveIKChains(ikChains, skeletonPoints) : {};
+    const result: { [jointId: string]: PoseData } = {};
+    for (const chain of hybridChains) {
+      const chainIK: { [jointId: string]: PoseData } = {};
+      for (const id of chain.ikChain.jointIds) {
+        if (ikResult[id]) chainIK[id] = ikResult[id];
+      }
+      const pose = chain.mode === 'ik'
+        ? chainIK
+        : chain.mode === 'fk'
+          ? this.applyFKPose(chain.fkChain, skeletonPoints)
+          : this.blendIKFK(chainIK, this.applyFKPose(chain.fkChain, skeletonPoints), chain.blendWeight);
+      Object.assign(result, pose);
+    }
+    return result;
+  }
+  
+  /**
+   * 取出用到IK的链；各链的模式和IK链对象不变时返回同一个数组
+   * 混合链数组本身可能每次重建（如修改混合权重），因此以IK链对象而非外层数组为键
+   */
+  private static ikChainsOf(hybridChains: HybridChain[]): IKChain[] {
+    const head = hybridChains.find(chain => chain.mode !== 'fk');
+    if (!head) return [];
+    const cached = this.ikChainLists.get(head.ikChain);
+    if (cached) {
+      let k = 0;
+      let same = true;
+      for (const chain of hybridChains) {
+        if (chain.mode === 'fk') continue;
+        if (cached[k++] !== chain.ikChain) {
+          same = false;
+          break;
+        }
+      }
+      if (same && k === cached.length) return cached;
+    }
+    const ikChains = hybridChains.filter(chain => chain.mode !== 'fk').map(chain => chain.ikChain);
+    this.ikChainLists.set(head.ikChain, ikChains);
+    return ikChains;
+  }
+  
   /**
    * 创建默认的混合链配置
    */
@@ -0,0 +1,684 @@
+/**
+ * GPU图层合成器
+ * 功能：在一个共享的 WebGL2 上下文中把图层作为纹理合成，并在同一渲染通道中绘制交互覆盖层
+ * 所有页签共用同一个画布和纹理缓存，切换页签时画布被移动到当前渲染器中，已解码的纹理直接复用
+ */
+
+import { SkinBuffers, MAX_BONES, identityPalette } from './MeshSkinning';
+
+export type BlendMode = 'normal' | 'multiply' | 'screen' | 'add';
+
+export type RGBA = [number, number, number, number];
+
+/**
+ * 合成图层，按数组顺序从下到上绘制，按 object-contain 方式放入图像区域
+ */
+export interface CompositorLayer {
+  source: string; // 纹理来源（URL，或通过 setPixels 注册的键）
+  mask?: string; // 遮罩纹理来源，按亮度×透明度调制
+  opacity: number;
+  blend?: BlendMode;
+}
+
+/**
+ * 覆盖层图元：胶囊体（x0,y0 与 x1,y1 相同时为圆），坐标为图像像素
+ */
+export interface OverlayPrimitive {
+  x0: number;
+  y0: number;
+  x1: number;
+  y1: number;
+  radius: number;
+  fill: RGBA; // 0-1，非预乘
+  stroke?: RGBA;
+  strokeWidth?: number;
+}
+
+/**
+ * 蒙皮网格图层：顶点在着色器中按骨骼调色板变形，绘制在普通图层之上、覆盖层之下
+ */
+export interface CompositorMesh {
+  source: string; // 网格所属图层的纹理来源
+  skin: SkinBuffers;
+  opacity: number;
+  blend?: BlendMode;
+}
+
+export interface CompositorView {
+  scale: number;
+  translateX: number;
+  translateY: number;
+}
+
+export interface CompositorScene {
+  width: number; // 图像区域尺寸
+  height: number;
+  view: CompositorView;
+  layers: CompositorLayer[];
+  overlay: OverlayPrimitive[];
+  meshes?: CompositorMesh[];
+}
+
+interface MeshEntry {
+  vao: WebGLVertexArrayObject;
+  buffers: WebGLBuffer[];
+  count: number;
+  lastUsed: number;
+}
+
+interface TextureEntry {
+  texture: WebGLTexture | null;
+  width: number;
+  height: number;
+  bytes: number;
+  lastUsed: number;
+  pending: Promise<TextureEntry> | null;
+}
+
+// 纹理缓存上限，超出后淘汰当前场景未使用、最久未用的纹理
+const TEXTURE_BUDGET_BYTES = 768 * 1024 * 1024;
+
+// 每个覆盖层实例的浮点数：线段(4) + 半径/描边宽度(2) + 填充色(4) + 描边色(4)
+const OVERLAY_STRIDE = 14;
+
+const LAYER_VS = `#version 300 es
+uniform vec4 u_rect;
+uniform vec4 u_view;
+out vec2 v_uv;
+void main() {
+  vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+  vec2 screen = u_view.zw + (u_rect.xy + corner * u_rect.zw) * u_view.x;
+  v_uv = corner;
+  gl_Position = vec4(screen / vec2(u_view.y, -1.0), 0.0, 1.0);
+}`;
+
+const LAYER_FS = `#version 300 es
+precision mediump float;
+uniform sampler2D u_image;
+uniform sampler2D u_mask;
+uniform bool u_hasMask;
+uniform float u_opacity;
+in vec2 v_uv;
+out vec4 outColor;
+void main() {
+  float coverage = u_opacity;
+  if (u_hasMask) {
+    vec4 mask = texture(u_mask, v_uv);
+    coverage *= dot(mask.rgb, vec3(0.299, 0.587, 0.114)) * mask.a;
+  }
+  outColor = texture(u_image, v_uv) * coverage;
+}`;
+
+const MESH_VS = `#version 300 es
+layout(location = 0) in vec2 a_position;
+layout(location = 1) in vec2 a_uv;
+layout(location = 2) in vec4 a_boneIndex;
+layout(location = 3) in vec4 a_boneWeight;
+uniform vec4 u_rect;
+uniform vec4 u_view;
+uniform vec4 u_bones[${MAX_BONES * 2}];
+out vec2 v_uv;
+vec2 skin(vec2 p, float bone) {
+  int b = int(bone) * 2;
+  vec4 m = u_bones[b];
+  return vec2(m.x * p.x + m.z * p.y, m.y * p.x + m.w * p.y) + u_bones[b + 1].xy;
+}
+void main() {
+  vec2 p = u_rect.xy + a_position * u_rect.z;
+  vec2 skinned = skin(p, a_boneIndex.x) * a_boneWeight.x + skin(p, a_boneIndex.y) * a_boneWeight.y
+    + skin(p, a_boneIndex.z) * a_boneWeight.z + skin(p, a_boneIndex.w) * a_boneWeight.w;
+  if (dot(a_boneWeight, vec4(1.0)) < 1e-4) skinned = p;
+  v_uv = a_uv;
+  vec2 screen = u_view.zw + skinned * u_view.x;
+  gl_Position = vec4(screen / vec2(u_view.y, -1.0), 0.0, 1.0);
+}`;
+
+const MESH_FS = `#version 300 es
+precision mediump float;
+uniform sampler2D u_image;
+uniform float u_opacity;
+in vec2 v_uv;
+out vec4 outColor;
+void main() {
+  outColor = texture(u_image, v_uv) * u_opacity;
+}`;
+
+const OVERLAY_VS = `#version 300 es
+layout(location = 0) in vec4 a_segment;
+layout(location = 1) in vec2 a_params;
+layout(location = 2) in vec4 a_fill;
+layout(location = 3) in vec4 a_stroke;
+uniform vec4 u_view;
+uniform float u_pixel;
+out vec2 v_position;
+flat out vec4 v_segment;
+flat out vec2 v_params;
+flat out vec4 v_fill;
+flat out vec4 v_stroke;
+void main() {
+  float extent = a_params.x + a_params.y * 0.5 + u_pixel;
+  vec2 lo = min(a_segment.xy, a_segment.zw) - extent;
+  vec2 hi = max(a_segment.xy, a_segment.zw) + extent;
+  vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+  v_position = mix(lo, hi, corner);
+  v_segment = a_segment;
+  v_params = a_params;
+  v_fill = a_fill;
+  v_stroke = a_stroke;
+  vec2 screen = u_view.zw + v_position * u_view.x;
+  gl_Position = vec4(screen / vec2(u_view.y, -1.0), 0.0, 1.0);
+}`;
+
+const OVERLAY_FS = `#version 300 es
+precision highp float;
+uniform float u_pixel;
+in vec2 v_position;
+flat in vec4 v_segment;
+flat in vec2 v_params;
+flat in vec4 v_fill;
+flat in vec4 v_stroke;
+out vec4 outColor;
+void main() {
+  vec2 pa = v_position - v_segment.xy;
+  vec2 ba = v_segment.zw - v_segment.xy;
+  float h = clamp(dot(pa, ba) / max(dot(ba, ba), 1e-6), 0.0, 1.0);
+  float d = length(pa - ba * h) - v_params.x;
+  float aa = 0.5 * u_pixel;
+  float halfStroke = v_params.y * 0.5;
+  float outer = 1.0 - smoothstep(-aa, aa, d - halfStroke);
+  float inner = 1.0 - smoothstep(-aa, aa, d + halfStroke);
+  vec4 fill = vec4(v_fill.rgb * v_fill.a, v_fill.a);
+  vec4 stroke = vec4(v_stroke.rgb * v_stroke.a, v_stroke.a);
+  outColor = fill * inner + stroke * (outer - inner);
+}`;
+
+/**
+ * 解析 #RRGGBB 颜色
+ */
+export function hexColor(hex: string, alpha: number = 1): RGBA {
+  const value = parseInt(hex.slice(1), 16);
+  return [((value >> 16) & 255) / 255, ((value >> 8) & 255) / 255, (value & 255) / 255, alpha];
+}
+
+export class LayerCompositor {
+  private static instance: LayerCompositor | null | undefined;
+
+  readonly canvas: HTMLCanvasElement;
+  private gl: WebGL2RenderingContext;
+  private layerProgram!: WebGLProgram;
+  private overlayProgram!: WebGLProgram;
+  private overlayVao!: WebGLVertexArrayObject;
+  private overlayBuffer!: WebGLBuffer;
+  private overlayData = new Float32Array(OVERLAY_STRIDE * 256);
+  private emptyMask!: WebGLTexture;
+  private meshProgram!: WebGLProgram;
+  private meshes = new Map<SkinBuffers, MeshEntry>();
+  private bonePalette = identityPalette();
+  private uniforms: Record<string, WebGLUniformLocation | null> = {};
+
+  private textures = new Map<string, TextureEntry>();
+  private textureBytes = 0;
+  private scene: CompositorScene | null = null;
+  private host: HTMLElement | null = null;
+  private resizeObserver: ResizeObserver | null = null;
+  private frame = 0;
+  private frameId = 0;
+  private lost = false;
+
+  /**
+   * 获取共享合成器，不支持 WebGL2 时返回 null（调用方回退到 DOM 渲染）
+   */
+  static shared(): LayerCompositor | null {
+    if (LayerCompositor.instance === undefined) {
+      const canvas = typeof document !== 'undefined' ? document.createElement('canvas') : null;
+      const gl = canvas?.getContext('webgl2', { premultipliedAlpha: true, alpha: true, antialias: false });
+      LayerCompositor.instance = canvas && gl ? new LayerCompositor(canvas, gl) : null;
+    }
+    return LayerCompositor.instance;
+  }
+
+  private constructor(canvas: HTMLCanvasElement, gl: WebGL2RenderingContext) {
+    this.canvas = canvas;
+    this.gl = gl;
+    canvas.style.position = 'absolute';
+    canvas.style.inset = '0';
+    canvas.style.width = '100%';
+    canvas.style.height = '100%';
+    canvas.addEventListener('webglcontextlost', (e) => {
+      e.preventDefault();
+      this.lost = true;
+    });
+    canvas.addEventListener('webglcontextrestored', () => {
+      // 上下文恢复后重建着色器，纹理在下一帧按来源重新加载
+      this.lost = false;
+      this.textures.clear();
+      this.textureBytes = 0;
+      this.meshes.clear();
+      this.initResources();
+      this.requestRender();
+    });
+    this.initResources();
+  }
+
+  private initResources() {
+    const gl = this.gl;
+    this.layerProgram = this.createProgram(LAYER_VS, LAYER_FS);
+    this.overlayProgram = this.createProgram(OVERLAY_VS, OVERLAY_FS);
+    for (const name of ['u_rect', 'u_view', 'u_image', 'u_mask', 'u_hasMask', 'u_opacity']) {
+      this.uniforms[`layer.${name}`] = gl.getUniformLocation(this.layerProgram, name);
+    }
+    for (const name of ['u_view', 'u_pixel']) {
+      this.uniforms[`overlay.${name}`] = gl.getUniformLocation(this.overlayProgram, name);
+    }
+    this.meshProgram = this.createProgram(MESH_VS, MESH_FS);
+    for (const name of ['u_rect', 'u_view', 'u_bones', 'u_image', 'u_opacity']) {
+      this.uniforms[`mesh.${name}`] = gl.getUniformLocation(this.meshProgram, name);
+    }
+
+    this.overlayVao = gl.createVertexArray()!;
+    this.overlayBuffer = gl.createBuffer()!;
+    gl.bindVertexArray(this.overlayVao);
+    gl.bindBuffer(gl.ARRAY_BUFFER, this.overlayBuffer);
+    const layout: Array<[number, number, number]> = [[0, 4, 0], [1, 2, 4], [2, 4, 6], [3, 4, 10]];
+    for (const [location, size, offset] of layout) {
+      gl.enableVertexAttribArray(location);
+      gl.vertexAttribPointer(location, size, gl.FLOAT, false, OVERLAY_STRIDE * 4, offset * 4);
+      gl.vertexAttribDivisor(location, 1);
+    }
+    gl.bindVertexArray(null);
+
+    this.emptyMask = this.createTexture();
+    gl.texImage2D(gl.TEXTURE_2D, 0, gl.RGBA, 1, 1, 0, gl.RGBA, gl.UNSIGNED_BYTE, new Uint8Array([255, 255, 255, 255]));
+  }
+
+  private createProgram(vertex: string, fragment: string): WebGLProgram {
+    const gl = this.gl;
+    const program = gl.createProgram()!;
+    for (const [type, source] of [[gl.VERTEX_SHADER, vertex], [gl.FRAGMENT_SHADER, fragment]] as const) {
+      const shader = gl.createShader(type)!;
+      gl.shaderSource(shader, source);
+      gl.compileShader(shader);
+      if (!gl.getShaderParameter(shader, gl.COMPILE_STATUS)) {
+        throw new Error(`着色器编译失败: ${gl.getShaderInfoLog(shader)}`);
+      }
+      gl.attachShader(program, shader);
+    }
+    gl.linkProgram(program);
+    if (!gl.getProgramParameter(program, gl.LINK_STATUS)) {
+      throw new Error(`着色器链接失败: ${gl.getProgramInfoLog(program)}`);
+    }
+    return program;
+  }
+
+  private createTexture(): WebGLTexture {
+    const gl = this.gl;
+    const texture = gl.createTexture()!;
+    gl.bindTexture(gl.TEXTURE_2D, texture);
+    gl.texParameteri(gl.TEXTURE_2D, gl.TEXTURE_MIN_FILTER, gl.LINEAR);
+    gl.texParameteri(gl.TEXTURE_2D, gl.TEXTURE_MAG_FILTER, gl.LINEAR);
+    gl.texParameteri(gl.TEXTURE_2D, gl.TEXTURE_WRAP_S, gl.CLAMP_TO_EDGE);
+    gl.texParameteri(gl.TEXTURE_2D, gl.TEXTURE_WRAP_T, gl.CLAMP_TO_EDGE);
+    return texture;
+  }
+
+  private storeTexture(source: string, width: number, height: number, upload: (gl: WebGL2RenderingContext) => void): TextureEntry {
+    const previous = this.textures.get(source);
+    if (previous?.texture) {
+      this.gl.deleteTexture(previous.texture);
+      this.textureBytes -= previous.bytes;
+    }
+    const texture = this.createTexture();
+    upload(this.gl);
+    const entry: TextureEntry = {
+      texture,
+      width,
+      height,
+      bytes: width * height * 4,
+      lastUsed: this.frameId,
+      pending: null
+    };
+    this.textures.set(source, entry);
+    this.textureBytes += entry.bytes;
+    return entry;
+  }
+
+  /**
+   * 加载纹理（已缓存时直接返回），解码在浏览器后台线程完成，上传后立即释放解码结果
+   * @returns 纹理尺寸
+   */
+  load(source: string): Promise<{ width: number; height: number }> {
+    // 加载失败的来源不再重试，直到被 setPixels 替换
+    const cached = this.textures.get(source);
+    if (cached) {
+      return cached.pending ?? Promise.resolve(cached);
+    }
+    const placeholder: TextureEntry = {
+      texture: null, width: 0, height: 0, bytes: 0, lastUsed: this.frameId, pending: null
+    };
+    placeholder.pending = (async () => {
+      try {
+        const blob = await (await fetch(source)).blob();
+        const bitmap = await createImageBitmap(blob, { premultiplyAlpha: 'premultiply', colorSpaceConversion: 'none' });
+        // 加载期间被淘汰或替换时不再上传
+        if (this.textures.get(source) !== placeholder) {
+          bitmap.close();
+          return placeholder;
+        }
+        const entry = this.storeTexture(source, bitmap.width, bitmap.height, (gl) => {
+          gl.texImage2D(gl.TEXTURE_2D, 0, gl.RGBA, gl.RGBA, gl.UNSIGNED_BYTE, bitmap);
+        });
+        bitmap.close();
+        this.requestRender();
+        return entry;
+      } catch (error) {
+        console.error('纹理加载失败:', source, error);
+        placeholder.pending = null;
+        return placeholder;
+      }
+    })();
+    this.textures.set(source, placeholder);
+    return placeholder.pending;
+  }
+
+  /**
+   * 用原始RGBA像素注册或替换一个纹理（无需经过 data URL）
+   */
+  setPixels(source: string, width: number, height: number, pixels: Uint8ClampedArray) {
+    const premultiplied = premultiply(pixels);
+    this.storeTexture(source, width, height, (gl) => {
+      gl.texImage2D(gl.TEXTURE_2D, 0, gl.RGBA, width, height, 0, gl.RGBA, gl.UNSIGNED_BYTE, premultiplied);
+    });
+    this.requestRender();
+  }
+
+  /**
+   * 只上传修改过的矩形区域
+   * @param pixels 该区域的RGBA像素（非预乘），行宽为 width
+   * @returns 纹理尚未就绪时返回 false
+   */
+  updateRegion(source: string, x: number, y: number, width: number, height: number, pixels: Uint8ClampedArray): boolean {
+    const entry = this.textures.get(source);
+    if (!entry?.texture || this.lost) {
+      return false;
+    }
+    const gl = this.gl;
+    gl.bindTexture(gl.TEXTURE_2D, entry.texture);
+    gl.texSubImage2D(gl.TEXTURE_2D, 0, x, y, width, height, gl.RGBA, gl.UNSIGNED_BYTE, premultiply(pixels));
+    this.requestRender();
+    return true;
+  }
+
+  /**
+   * 把共享画布挂到渲染器的容器中
+   */
+  attach(host: HTMLElement) {
+    if (this.host === host) return;
+    this.resizeObserver?.disconnect();
+    this.host = host;
+    host.appendChild(this.canvas);
+    this.resizeObserver = new ResizeObserver(() => this.requestRender());
+    this.resizeObserver.observe(host);
+    this.requestRender();
+  }
+
+  detach(host: HTMLElement) {
+    if (this.host !== host) return;
+    this.resizeObserver?.disconnect();
+    this.resizeObserver = null;
+    this.host = null;
+    this.scene = null;
+    this.canvas.remove();
+  }
+
+  setScene(scene: CompositorScene) {
+    this.scene = scene;
+    for (const layer of scene.layers) {
+      this.load(layer.source);
+      if (layer.mask) this.load(layer.mask);
+    }
+    for (const mesh of scene.meshes || []) {
+      this.load(mesh.source);
+    }
+    this.requestRender();
+  }
+
+  /**
+   * 逐帧更新（动画播放），不经过 React：替换覆盖层和/或骨骼调色板
+   * @param bonePalette MAX_BONES * 8 个浮点数，见 computeBonePalette
+   */
+  setFrame(frame: { overlay?: OverlayPrimitive[]; bonePalette?: Float32Array }) {
+    if (frame.bonePalette) this.bonePalette.set(frame.bonePalette.subarray(0, this.bonePalette.length));
+    if (frame.overlay && this.scene) this.scene = { ...this.scene, overlay: frame.overlay };
+    this.requestRender();
+  }
+
+  private meshEntry(skin: SkinBuffers): MeshEntry {
+    let entry = this.meshes.get(skin);
+    if (entry) return entry;
+    const gl = this.gl;
+    const vao = gl.createVertexArray()!;
+    gl.bindVertexArray(vao);
+    const attributes: Array<[ArrayBufferView, number, number, boolean]> = [
+      [skin.mesh.positions, 2, gl.FLOAT, false],
+      [skin.mesh.uvs, 2, gl.FLOAT, false],
+      [skin.indices, 4, gl.UNSIGNED_BYTE, false],
+      [skin.weights, 4, gl.FLOAT, false]
+    ];
+    const buffers = attributes.map(([data, size, type, normalized], location) => {
+      const buffer = gl.createBuffer()!;
+      gl.bindBuffer(gl.ARRAY_BUFFER, buffer);
+      gl.bufferData(gl.ARRAY_BUFFER, data, gl.STATIC_DRAW);
+      gl.enableVertexAttribArray(location);
+      gl.vertexAttribPointer(location, size, type, normalized, 0, 0);
+      return buffer;
+    });
+    const indexBuffer = gl.createBuffer()!;
+    gl.bindBuffer(gl.ELEMENT_ARRAY_BUFFER, indexBuffer);
+    gl.bufferData(gl.ELEMENT_ARRAY_BUFFER, skin.mesh.indices, gl.STATIC_DRAW);
+    gl.bindVertexArray(null);
+    entry = { vao, buffers: [...buffers, indexBuffer], count: skin.mesh.indices.length, lastUsed: this.frameId };
+    this.meshes.set(skin, entry);
+    return entry;
+  }
+
+  /**
+   * 屏幕坐标转图像像素坐标（与绘制使用同一变换）
+   */
+  toImageSpace(clientX: number, clientY: number): { x: number; y: number } | null {
+    if (!this.scene) return null;
+    const rect = this.canvas.getBoundingClientRect();
+    const [scale, originX, originY] = this.viewOrigin(rect.width, rect.height, this.scene);
+    return { x: (clientX - rect.left - originX) / scale, y: (clientY - rect.top - originY) / scale };
+  }
+
+  /**
+   * 与 CanvasTransform 相同的变换：图像中心对齐容器中心，先平移再缩放
+   */
+  private viewOrigin(width: number, height: number, scene: CompositorScene): [number, number, number] {
+    const { scale, translateX, translateY } = scene.view;
+    return [
+      scale,
+      width / 2 + scale * (translateX - scene.width / 2),
+      height / 2 + scale * (translateY - scene.height / 2)
+    ];
+  }
+
+  private requestRender() {
+    if (this.frame || typeof requestAnimationFrame === 'undefined') return;
+    this.frame = requestAnimationFrame(() => {
+      this.frame = 0;
+      this.render();
+    });
+  }
+
+  private render() {
+    const gl = this.gl;
+    if (this.lost || !this.host) return;
+    const dpr = window.devicePixelRatio || 1;
+    const cssWidth = this.host.clientWidth;
+    const cssHeight = this.host.clientHeight;
+    const width = Math.max(1, Math.round(cssWidth * dpr));
+    const height = Math.max(1, Math.round(cssHeight * dpr));
+    if (this.canvas.width !== width || this.canvas.height !== height) {
+      this.canvas.width = width;
+      this.canvas.height = height;
+    }
+    gl.viewport(0, 0, width, height);
+    gl.clearColor(0, 0, 0, 0);
+    gl.clear(gl.COLOR_BUFFER_BIT);
+
+    const scene = this.scene;
+    if (!scene || scene.width <= 0 || scene.height <= 0) return;
+    this.frameId++;
+
+    // u_view: 缩放、宽高比、图像原点（相对视口中心），均以半个视口高度为单位
+    const [scale, originX, originY] = this.viewOrigin(cssWidth, cssHeight, scene);
+    const halfWidth = cssWidth / 2, halfHeight = Math.max(1, cssHeight / 2);
+    const aspect = halfWidth / halfHeight;
+    const viewScale = scale / halfHeight;
+    const view: [number, number, number, number] = [
+      viewScale,
+      aspect,
+      (originX - halfWidth) / halfHeight,
+      (originY - halfHeight) / halfHeight
+    ];
+
+    gl.enable(gl.BLEND);
+    gl.useProgram(this.layerProgram);
+    gl.uniform4fv(this.uniforms['layer.u_view'], view);
+    gl.uniform1i(this.uniforms['layer.u_image'], 0);
+    gl.uniform1i(this.uniforms['layer.u_mask'], 1);
+
+    for (const layer of scene.layers) {
+      const entry = this.textures.get(layer.source);
+      if (!entry?.texture || layer.opacity <= 0) continue;
+      entry.lastUsed = this.frameId;
+      const mask = layer.mask ? this.textures.get(layer.mask) : undefined;
+      // 遮罩尚未加载完成时先不绘制，避免闪出未遮罩的图层
+      if (layer.mask && !mask?.texture) continue;
+      if (mask) mask.lastUsed = this.frameId;
+
+      // object-contain 放入图像区域
+      const fit = Math.min(scene.width / entry.width, scene.height / entry.height);
+      const drawWidth = entry.width * fit, drawHeight = entry.height * fit;
+      gl.uniform4f(this.uniforms['layer.u_rect'], (scene.width - drawWidth) / 2, (scene.height - drawHeight) / 2, drawWidth, drawHeight);
+      gl.uniform1f(this.uniforms['layer.u_opacity'], layer.opacity);
+      gl.uniform1i(this.uniforms['layer.u_hasMask'], mask ? 1 : 0);
+      gl.activeTexture(gl.TEXTURE1);
+      gl.bindTexture(gl.TEXTURE_2D, mask?.texture ?? this.emptyMask);
+      gl.activeTexture(gl.TEXTURE0);
+      gl.bindTexture(gl.TEXTURE_2D, entry.texture);
+      this.setBlend(layer.blend ?? 'normal');
+      gl.drawArrays(gl.TRIANGLE_STRIP, 0, 4);
+    }
+
+    // 蒙皮网格：顶点缓冲区上传一次，每帧只更新骨骼调色板
+    if (scene.meshes && scene.meshes.length > 0) {
+      gl.useProgram(this.meshProgram);
+      gl.uniform4fv(this.uniforms['mesh.u_view'], view);
+      gl.uniform4fv(this.uniforms['mesh.u_bones'], this.bonePalette);
+      gl.uniform1i(this.uniforms['mesh.u_image'], 0);
+      gl.activeTexture(gl.TEXTURE0);
+      for (const mesh of scene.meshes) {
+        const texture = this.textures.get(mesh.source);
+        if (!texture?.texture || mesh.opacity <= 0 || mesh.skin.mesh.indices.length === 0) continue;
+        texture.lastUsed = this.frameId;
+        const entry = this.meshEntry(mesh.skin);
+        entry.lastUsed = this.frameId;
+        // 网格坐标是图层像素，按与普通图层相同的 object-contain 方式放入图像区域
+        const fit = Math.min(scene.width / texture.width, scene.height / texture.height);
+        gl.uniform4f(this.uniforms['mesh.u_rect'], (scene.width - texture.width * fit) / 2, (scene.height - texture.height * fit) / 2, fit, 0);
+        gl.uniform1f(this.uniforms['mesh.u_opacity'], mesh.opacity);
+        gl.bindTexture(gl.TEXTURE_2D, texture.texture);
+        this.setBlend(mesh.blend ?? 'normal');
+        gl.bindVertexArray(entry.vao);
+        gl.drawElements(gl.TRIANGLES, entry.count, gl.UNSIGNED_INT, 0);
+      }
+      gl.bindVertexArray(null);
+    }
+
+    // 覆盖层：单次实例化绘制
+    if (scene.overlay.length > 0) {
+      const count = scene.overlay.length;
+      if (this.overlayData.length < count * OVERLAY_STRIDE) {
+        this.overlayData = new Float32Array(count * OVERLAY_STRIDE * 2);
+      }
+      const data = this.overlayData;
+      for (let i = 0; i < count; i++) {
+        const p = scene.overlay[i];
+        const o = i * OVERLAY_STRIDE;
+        data[o] = p.x0; data[o + 1] = p.y0; data[o + 2] = p.x1; data[o + 3] = p.y1;
+        data[o + 4] = p.radius; data[o + 5] = p.stroke ? p.strokeWidth ?? 1 : 0;
+        data.set(p.fill, o + 6);
+        data.set(p.stroke ?? p.fill, o + 10);
+      }
+      gl.useProgram(this.overlayProgram);
+      gl.uniform4fv(this.uniforms['overlay.u_view'], view);
+      // 一个屏幕像素对应的图像像素，用于抗锯齿宽度
+      gl.uniform1f(this.uniforms['overlay.u_pixel'], 1 / scale);
+      gl.bindBuffer(gl.ARRAY_BUFFER, this.overlayBuffer);
+      gl.bufferData(gl.ARRAY_BUFFER, data.subarray(0, count * OVERLAY_STRIDE), gl.DYNAMIC_DRAW);
+      gl.bindVertexArray(this.overlayVao);
+      this.setBlend('normal');
+      gl.drawArraysInstanced(gl.TRIANGLE_STRIP, 0, 4, count);
+      gl.bindVertexArray(null);
+    }
+
+    this.evict();
+  }
+
+  /**
+   * 预乘颜色下的固定管线混合
+   */
+  private setBlend(mode: BlendMode) {
+    const gl = this.gl;
+    switch (mode) {
+      case 'add':
+        gl.blendFuncSeparate(gl.ONE, gl.ONE, gl.ONE, gl.ONE_MINUS_SRC_ALPHA);
+        break;
+      case 'multiply':
+        gl.blendFuncSeparate(gl.DST_COLOR, gl.ONE_MINUS_SRC_ALPHA, gl.ONE, gl.ONE_MINUS_SRC_ALPHA);
+        break;
+      case 'screen':
+        gl.blendFuncSeparate(gl.ONE, gl.ONE_MINUS_SRC_COLOR, gl.ONE, gl.ONE_MINUS_SRC_ALPHA);
+        break;
+      default:
+        gl.blendFuncSeparate(gl.ONE, gl.ONE_MINUS_SRC_ALPHA, gl.ONE, gl.ONE_MINUS_SRC_ALPHA);
+    }
+  }
+
+  /**
+   * 超出预算时淘汰最久未用的纹理，当前帧用到的不淘汰；网格缓冲区连续60帧未使用后释放
+   */
+  private evict() {
+    for (const [skin, entry] of this.meshes) {
+      if (entry.lastUsed < this.frameId - 60) {
+        this.gl.deleteVertexArray(entry.vao);
+        entry.buffers.forEach(buffer => this.gl.deleteBuffer(buffer));
+        this.meshes.delete(skin);
+      }
+    }
+    if (this.textureBytes <= TEXTURE_BUDGET_BYTES) return;
+    const candidates = [...this.textures.entries()]
+      .filter(([, entry]) => entry.texture && entry.lastUsed < this.frameId)
+      .sort((a, b) => a[1].lastUsed - b[1].lastUsed);
+    for (const [source, entry] of candidates) {
+      if (this.textureBytes <= TEXTURE_BUDGET_BYTES) break;
+      this.gl.deleteTexture(entry.texture);
+      this.textureBytes -= entry.bytes;
+      this.textures.delete(source);
+    }
+  }
+}
+
+function premultiply(pixels: Uint8ClampedArray): Uint8Array {
+  const out = new Uint8Array(pixels.length);
+  for (let i = 0; i < pixels.length; i += 4) {
+    const a = pixels[i + 3];
+    out[i] = (pixels[i] * a + 127) / 255;
+    out[i + 1] = (pixels[i + 1] * a + 127) / 255;
+    out[i + 2] = (pixels[i + 2] * a + 127) / 255;
+    out[i + 3] = a;
+  }
+  return out;
+}
@@ -0,0 +1,165 @@
+/**
+ * 网格蒙皮模块
+ * 功能：为 AutoMeshGenerator 生成的网格构建每顶点骨骼影响（最多4根），并把骨骼姿态编码为着色器使用的矩阵调色板
+ * 骨骼 j 指从父骨骼点到骨骼点 j 的线段；根骨骼点使用自身的平移/旋转/缩放
+ */
+
+import { SkeletonPoint } from '../composables/CanvasContext';
+import type { MeshBuffers, MeshData } from './AutoMeshGenerator';
+import { POSE_CHANNELS } from './AnimationEngine';
+
+// 着色器中的骨骼数上限（每根骨骼占两个 vec4）
+export const MAX_BONES = 64;
+export const INFLUENCES = 4;
+
+/**
+ * 网格的蒙皮数据，与网格顶点一一对应
+ */
+export interface SkinBuffers {
+  mesh: MeshBuffers;
+  boneIds: string[]; // 调色板中的骨骼顺序
+  indices: Uint8Array; // (V, 4)
+  weights: Float32Array; // (V, 4)，每行和为1
+}
+
+/**
+ * 构建蒙皮数据
+ * 顶点权重来源依次为：网格顶点的 boneWeights、骨骼点上绘制的权重（按 "x-y" 像素键），
+ * 都没有时按到骨骼线段距离的反平方自动分配
+ * @param mesh 网格缓冲区
+ * @param skeleton 绑定姿态的骨骼点
+ * @param meshData 可选的对象形式网格（带 boneWeights）
+ */
+export function buildSkinBuffers(mesh: MeshBuffers, skeleton: SkeletonPoint[], meshData?: MeshData): SkinBuffers {
+  const bones = skeleton.slice(0, MAX_BONES);
+  const boneIds = bones.map(point => point.id);
+  const boneIndex = new Map(boneIds.map((id, i) => [id, i]));
+  const byId = new Map(skeleton.map(point => [point.id, point]));
+  const vertexCount = mesh.positions.length / 2;
+  const indices = new Uint8Array(vertexCount * INFLUENCES);
+  const weights = new Float32Array(vertexCount * INFLUENCES);
+
+  // 骨骼点上绘制的权重：像素键 -> [骨骼, 权重]
+  const painted = new Map<string, Array<[number, number]>>();
+  bones.forEach((point, b) => {
+    for (const [key, weight] of Object.entries(point.weights || {})) {
+      let list = painted.get(key);
+      if (!list) painted.set(key, (list = []));
+      list.push([b, weight]);
+    }
+  });
+
+  const candidates: Array<[number, number]> = [];
+  for (let v = 0; v < vertexCount; v++) {
+    const x = mesh.positions[2 * v], y = mesh.positions[2 * v + 1];
+    candidates.length = 0;
+
+    const explicit = meshData?.vertices[v]?.boneWeights;
+    if (explicit) {
+      for (const [id, weight] of Object.entries(explicit)) {
+        const b = boneIndex.get(id);
+        if (b !== undefined && weight > 0) candidates.push([b, weight]);
+      }
+    }
+    if (candidates.length === 0) {
+      for (const entry of painted.get(`${Math.round(x)}-${Math.round(y)}`) || []) {
+        if (entry[1] > 0) candidates.push(entry);
+      }
+    }
+    if (candidates.length === 0) {
+      bones.forEach((point, b) => {
+        const parent = point.parentId ? byId.get(point.parentId) : undefined;
+        const d = parent ? distanceToSegment(x, y, parent.x, parent.y, point.x, point.y) : Math.hypot(x - point.x, y - point.y);
+        candidates.push([b, 1 / (d * d + 1)]);
+      });
+    }
+
+    candidates.sort((a, b) => b[1] - a[1]);
+    const count = Math.min(INFLUENCES, candidates.length);
+    let total = 0;
+    for (let i = 0; i < count; i++) total += candidates[i][1];
+    for (let i = 0; i < count && total > 0; i++) {
+      indices[v * INFLUENCES + i] = candidates[i][0];
+      weights[v * INFLUENCES + i] = candidates[i][1] / total;
+    }
+  }
+
+  return { mesh, boneIds, indices, weights };
+}
+
+/**
+ * 计算骨骼矩阵调色板
+ * 每根骨骼两个 vec4：(a, b, c, d), (tx, ty, 0, 0)，x' = a·x + c·y + tx，y' = b·x + d·y + ty
+ * @param bind 绑定姿态的骨骼点
+ * @param boneIds 调色板骨骼顺序（SkinBuffers.boneIds）
+ * @param boneIndex 姿态中骨骼点的位置（CompiledClip.boneIndex 或 poseFromPoints 的结果）
+ * @param pose 当前姿态 (B, 4)
+ * @param out 输出 (MAX_BONES * 8)
+ */
+export function computeBonePalette(
+  bind: SkeletonPoint[],
+  boneIds: string[],
+  boneIndex: Map<string, number>,
+  pose: Float32Array,
+  out: Float32Array
+): Float32Array {
+  const byId = new Map(bind.map(point => [point.id, point]));
+  const posed = (id: string, channel: number, fallback: number) => {
+    const b = boneIndex.get(id);
+    return b === undefined ? fallback : pose[b * POSE_CHANNELS + channel];
+  };
+
+  out.fill(0);
+  boneIds.forEach((id, i) => {
+    const rest = byId.get(id);
+    if (!rest) return;
+    const parent = rest.parentId ? byId.get(rest.parentId) : undefined;
+    let pivotX: number, pivotY: number, targetX: number, targetY: number, angle: number, scale: number;
+
+    if (parent) {
+      // 骨骼线段：绕父骨骼点旋转并沿骨骼方向缩放
+      const restDx = rest.x - parent.x, restDy = rest.y - parent.y;
+      const px = posed(parent.id, 0, parent.x), py = posed(parent.id, 1, parent.y);
+      const dx = posed(id, 0, rest.x) - px, dy = posed(id, 1, rest.y) - py;
+      const restLength = Math.hypot(restDx, restDy);
+      angle = Math.atan2(dy, dx) - Math.atan2(restDy, restDx);
+      scale = restLength > 0 ? Math.hypot(dx, dy) / restLength : 1;
+      pivotX = parent.x; pivotY = parent.y;
+      targetX = px; targetY = py;
+    } else {
+      angle = ((posed(id, 2, rest.rotation ?? 0) - (rest.rotation ?? 0)) * Math.PI) / 180;
+      scale = posed(id, 3, rest.scale ?? 1) / (rest.scale || 1);
+      pivotX = rest.x; pivotY = rest.y;
+      targetX = posed(id, 0, rest.x); targetY = posed(id, 1, rest.y);
+    }
+
+    const cos = Math.cos(angle) * scale, sin = Math.sin(angle) * scale;
+    const o = i * 8;
+    out[o] = cos;
+    out[o + 1] = sin;
+    out[o + 2] = -sin;
+    out[o + 3] = cos;
+    out[o + 4] = targetX - (cos * pivotX - sin * pivotY);
+    out[o + 5] = targetY - (sin * pivotX + cos * pivotY);
+  });
+  return out;
+}
+
+/**
+ * 单位调色板（绑定姿态）
+ */
+export function identityPalette(out: Float32Array = new Float32Array(MAX_BONES * 8)): Float32Array {
+  out.fill(0);
+  for (let i = 0; i < MAX_BONES; i++) {
+    out[i * 8] = 1;
+    out[i * 8 + 3] = 1;
+  }
+  return out;
+}
+
+function distanceToSegment(px: number, py: number, ax: number, ay: number, bx: number, by: number): number {
+  const dx = bx - ax, dy = by - ay;
+  const lengthSq = dx * dx + dy * dy;
+  const t = lengthSq > 0 ? Math.max(0, Math.min(1, ((px - ax) * dx + (py - ay) * dy) / lengthSq)) : 0;
+  return Math.hypot(ax + t * dx - px, ay + t * dy - py);
+}
@@ -1,8 +1,14 @@
 /**
  * PSD导出工具模块
- * 功能：将图层数据导出为PSD格式
+ * 功能：将图层数据导出为分层PSD或PNG序列（ZIP）
+ * 图层在 Web Worker 池中并行裁剪和编码，结果按顺序增量写入文件流
  */
 
+import { ExportSink, PSDLayerRecord, ZipStreamWriter, flattenLayers, writePSD } from './layerExportFormat';
+import type { LayerExportJob, LayerExportResult } from './layerExportJob';
+
+export type { ExportSink } from './layerExportFormat';
+
 export interface LayerData {
   id: string;
   name: string;
@@ -16,141 +22,266 @@ export interface LayerData {
 }
 
 export interface PSDExportOptions {
-  layers: LayerData[];
+  layers: LayerData[]; // 从上到下
   width: number;
   height: number;
   filename: string;
+  /** 直接转交图层像素缓冲区给 Worker（调用方的 ImageData 随后不可用），默认拷贝 */
+  transferPixels?: boolean;
+  /** 进度回调：已完成图层数 / 总数 */
+  onProgress?: (done: number, total: number) => void;
+}
+
+interface PendingJob {
+  id: number;
+  job: Omit<LayerExportJob, 'pixels'>;
+  pixels: () => ArrayBuffer;
+  resolve: (result: LayerExportResult) => void;
+  reject: (error: Error) => void;
 }
 
 /**
- * 模拟PSD导出功能
- * 在实际应用中，这里需要集成专业的PSD库，如 psd.js 或 ag-psd
+ * PSD导出器
  */
 export class PSDExporter {
+  private static workers: Worker[] = [];
+  private static idle: Worker[] = [];
+  private static queue: PendingJob[] = [];
+  private static running = new Map<Worker, PendingJob>();
+  private static nextJobId = 1;
+
   /**
-   * 导出图层为PSD格式
+   * 导出图层为PSD格式（在内存中生成）
    */
   static async exportToPSD(options: PSDExportOptions): Promise<Blob> {
+    const sink = this.createMemorySink();
+    await this.writePSD(options, sink);
+    return sink.blob('image/vnd.adobe.photoshop');
+  }
+
+  /**
+   * 导出分层PSD到输出端
+   * 每个图层只编码非透明包围盒，隐藏图层保留为隐藏；合成图像为可见图层的拼合结果
+   */
+  static async writePSD(options: PSDExportOptions, sink: ExportSink): Promise<void> {
     try {
-      // 这里模拟PSD导出过程
-      // 实际实现中，需要：
-      // 1. 创建PSD文件头
-      // 2. 写入图层信息
-      // 3. 写入图像数据
-      // 4. 生成二进制数据
-      
-      console.log('开始导出PSD:', options.filename);
-      console.log('图层数量:', options.layers.length);
-      console.log('画布尺寸:', `${options.width}x${options.height}`);
-      
-      // 模拟处理延迟
-      await new Promise(resolve => setTimeout(resolve, 1000));
-      
-      // 创建模拟的PSD文件Blob
-      // 实际应用中，这里应该生成真正的PSD格式数据
-      const mockPSDData = this.createMockPSDData(options);
-      const blob = new Blob([mockPSDData], { type: 'image/vnd.adobe.photoshop' });
-      
-      return blob;
+      // 像素可能转交给 Worker，需在编码前合成
+      const composite = flattenLayers(options.width, options.height, options.layers.map(layer => ({
+        pixels: layer.imageData.data,
+        width: layer.imageData.width,
+        height: layer.imageData.height,
+        x: layer.x,
+        y: layer.y,
+        opacity: layer.opacity,
+        visible: layer.visible
+      })).reverse());
+      const results = await this.encodeLayers(options, 'psd');
+      // PSD 图层记录从下到上
+      const records: PSDLayerRecord[] = options.layers.map((layer, i) => {
+        const result = results[i] as Extract<LayerExportResult, { kind: 'psd' }>;
+        const empty = result.bounds.right === result.bounds.left;
+        return {
+          name: layer.name,
+          bounds: empty
+            ? result.bounds
+            : {
+                left: layer.x + result.bounds.left,
+                top: layer.y + result.bounds.top,
+                right: layer.x + result.bounds.right,
+                bottom: layer.y + result.bounds.bottom
+              },
+          opacity: layer.opacity,
+          visible: layer.visible,
+          channels: result.channels
+        };
+      }).reverse();
+      await writePSD(sink, options.width, options.height, records, composite);
+      await sink.close();
     } catch (error) {
       console.error('PSD导出失败:', error);
       throw new Error('PSD导出失败: ' + (error as Error).message);
     }
   }
-  
+
+  /**
+   * 导出图层为PNG序列，打包为ZIP写入输出端
+   * 每个PNG只包含图层的非透明区域，layers.json 记录各图层在文档中的位置
+   */
+  static async writePNGSequenceZip(options: PSDExportOptions, sink: ExportSink): Promise<void> {
+    const zip = new ZipStreamWriter(sink);
+    const manifest: Array<Record<string, unknown>> = [];
+    const usedNames = new Set<string>();
+    let writing = Promise.resolve();
+
+    // 编码完成一个就写一个，ZIP 写入按完成顺序串行
+    await this.encodeLayers(options, 'png', (layer, result) => {
+      if (result.kind !== 'png') return;
+      const filename = uniqueName(`${sanitizeFilename(layer.name)}.png`, usedNames);
+      manifest.push({
+        id: layer.id,
+        name: layer.name,
+        file: filename,
+        x: layer.x + result.bounds.left,
+        y: layer.y + result.bounds.top,
+        width: result.bounds.right - result.bounds.left,
+        height: result.bounds.bottom - result.bounds.top,
+        opacity: layer.opacity,
+        visible: layer.visible
+      });
+      writing = writing.then(() => zip.addFile(filename, result.png, result.crc));
+    });
+    await writing;
+
+    const order = new Map(options.layers.map((layer, i) => [layer.id, i]));
+    manifest.sort((a, b) => order.get(a.id as string)! - order.get(b.id as string)!);
+    const json = JSON.stringify({ width: options.width, height: options.height, layers: manifest }, null, 2);
+    await zip.addFile('layers.json', new TextEncoder().encode(json));
+    await zip.close();
+  }
+
   /**
-   * 导出图层为独立的PNG序列
+   * 导出图层为独立的PNG序列（裁剪到非透明区域）
    */
   static async exportToPNGSequence(options: PSDExportOptions): Promise<{ filename: string; blob: Blob }[]> {
     const results: { filename: string; blob: Blob }[] = [];
-    
-    for (const layer of options.layers) {
-      try {
-        // 为每个图层创建Canvas
-        const canvas = document.createElement('canvas');
-        canvas.width = options.width;
-        canvas.height = options.height;
-        
-        const ctx = canvas.getContext('2d');
-        if (!ctx) {
-          throw new Error('无法获取Canvas上下文');
-        }
-        
-        // 设置透明度
-        ctx.globalAlpha = layer.opacity;
-        
-        // 创建ImageData并绘制
-        const imageData = new ImageData(
-          new Uint8ClampedArray(layer.imageData.data),
-          layer.imageData.width,
-          layer.imageData.height
-        );
-        
-        // 创建临时Canvas来绘制ImageData
-        const tempCanvas = document.createElement('canvas');
-        tempCanvas.width = layer.imageData.width;
-        tempCanvas.height = layer.imageData.height;
-        const tempCtx = tempCanvas.getContext('2d');
-        
-        if (tempCtx) {
-          tempCtx.putImageData(imageData, 0, 0);
-          
-          // 将图层绘制到主Canvas
-          ctx.drawImage(
-            tempCanvas,
-            layer.x,
-            layer.y,
-            layer.imageData.width,
-            layer.imageData.height
-          );
-        }
-        
-        // 转换为PNG
-        const blob = await new Promise<Blob>((resolve, reject) => {
-          canvas.toBlob((blob) => {
-            if (blob) {
-              resolve(blob);
-            } else {
-              reject(new Error('无法创建PNG blob'));
-            }
-          }, 'image/png');
-        });
-        
-        results.push({
-          filename: `${layer.name}.png`,
-          blob
-        });
-        
-      } catch (error) {
-        console.error(`导出图层 ${layer.name} 失败:`, error);
+    const encoded = await this.encodeLayers(options, 'png');
+    encoded.forEach((result, i) => {
+      if (result.kind === 'png') {
+        results.push({ filename: `${options.layers[i].name}.png`, blob: new Blob([result.png], { type: 'image/png' }) });
       }
-    }
-    
+    });
     return results;
   }
-  
+
   /**
-   * 创建模拟的PSD数据（实际应用中会使用专业库）
+   * 创建文件输出端
+   * 支持 File System Access API 时直接写入用户选择的文件，否则在内存中收集片段并在关闭时下载
+   * 需在用户手势的同步调用链中调用（保存对话框要求）
    */
-  private static createMockPSDData(options: PSDExportOptions): ArrayBuffer {
-    // 这里创建模拟的二进制数据
-    // 实际应用中需要使用专业的PSD库
-    const headerSize = 26; // 简化的PSD头部大小
-    const layerInfoSize = options.layers.length * 100; // 每个图层约100字节信息
-    const imageDataSize = options.width * options.height * 4 * options.layers.length; // RGBA数据
-    
-    const totalSize = headerSize + layerInfoSize + imageDataSize;
-    const buffer = new ArrayBuffer(totalSize);
-    const view = new DataView(buffer);
-    
-    // 写入模拟的PSD头部
-    view.setUint16(0, 1, false); // 版本
-    view.setUint16(2, options.width, false);
-    view.setUint16(4, options.height, false);
-    
-    return buffer;
+  static async createFileSink(filename: string, mimeType: string): Promise<ExportSink> {
+    const picker = (window as unknown as {
+      showSaveFilePicker?: (options: { suggestedName: string }) => Promise<{
+        createWritable(): Promise<{ write(data: Uint8Array): Promise<void>; close(): Promise<void> }>;
+      }>;
+    }).showSaveFilePicker;
+    if (picker) {
+      const handle = await picker({ suggestedName: filename });
+      const writable = await handle.createWritable();
+      return {
+        write: chunk => writable.write(chunk),
+        close: () => writable.close()
+      };
+    }
+    const memory = this.createMemorySink();
+    return {
+      write: memory.write,
+      close: async () => {
+        await memory.close();
+        this.downloadFile(memory.blob(mimeType), filename);
+      }
+    };
   }
-  
+
+  /**
+   * 在 Worker 池中并行编码所有图层
+   * @param onResult 每个图层完成时回调（完成顺序）
+   * @returns 与 options.layers 顺序一致的结果
+   */
+  private static encodeLayers(
+    options: PSDExportOptions,
+    kind: LayerExportJob['kind'],
+    onResult?: (layer: LayerData, result: LayerExportResult) => void
+  ): Promise<LayerExportResult[]> {
+    const total = options.layers.length;
+    let done = 0;
+    return Promise.all(options.layers.map(async layer => {
+      // 像素在任务被分配时才拷贝，同时在途的拷贝数不超过 Worker 数
+      const pixels = () => options.transferPixels
+        ? (layer.imageData.data.buffer as ArrayBuffer)
+        : layer.imageData.data.slice().buffer;
+      const result = await this.runJob({
+        kind,
+        width: layer.imageData.width,
+        height: layer.imageData.height,
+        opacity: layer.opacity
+      }, pixels);
+      onResult?.(layer, result);
+      options.onProgress?.(++done, total);
+      return result;
+    }));
+  }
+
+  /**
+   * 提交单个任务；每个 Worker 同时只处理一个任务，未分配的任务在队列中等待
+   */
+  private static async runJob(job: Omit<LayerExportJob, 'pixels'>, pixels: () => ArrayBuffer): Promise<LayerExportResult> {
+    if (typeof Worker === 'undefined' || typeof OffscreenCanvas === 'undefined') {
+      const { encodeLayerJob } = await import('./layerExportJob');
+      return encodeLayerJob({ ...job, pixels: pixels() });
+    }
+    return new Promise((resolve, reject) => {
+      this.queue.push({ id: this.nextJobId++, job, pixels, resolve, reject });
+      this.drain();
+    });
+  }
+
+  private static drain() {
+    while (this.queue.length > 0) {
+      const worker = this.idle.pop() ?? this.spawnWorker();
+      if (!worker) return;
+      const pending = this.queue.shift()!;
+      this.running.set(worker, pending);
+      const pixels = pending.pixels();
+      worker.postMessage({ ...pending.job, id: pending.id, pixels }, [pixels]);
+    }
+  }
+
+  /**
+   * 按需创建 Worker，数量不超过 CPU 核心数-1（至少1个，最多4个）
+   */
+  private static spawnWorker(): Worker | null {
+    const limit = Math.max(1, Math.min(4, (navigator.hardwareConcurrency || 2) - 1));
+    if (this.workers.length >= limit) return null;
+
+    const worker = new Worker(new URL('./layerExport.worker.ts', import.meta.url), { type: 'module' });
+    worker.onmessage = (event: MessageEvent<{ id: number; result?: LayerExportResult; error?: string }>) => {
+      const pending = this.running.get(worker);
+      this.running.delete(worker);
+      this.idle.push(worker);
+      if (pending && pending.id === event.data.id) {
+        if (event.data.result) {
+          pending.resolve(event.data.result);
+        } else {
+          pending.reject(new Error(event.data.error || '图层编码失败'));
+        }
+      }
+      this.drain();
+    };
+    worker.onerror = (event: ErrorEvent) => {
+      // Worker 崩溃时拒绝其当前任务并移出池，后续任务由其他或新建的 Worker 处理
+      const pending = this.running.get(worker);
+      this.running.delete(worker);
+      this.workers = this.workers.filter(w => w !== worker);
+      this.idle = this.idle.filter(w => w !== worker);
+      worker.terminate();
+      pending?.reject(new Error(event.message || '图层导出 Worker 出错'));
+      this.drain();
+    };
+    this.workers.push(worker);
+    return worker;
+  }
+
+  private static createMemorySink() {
+    const parts: Uint8Array[] = [];
+    return {
+      write: async (chunk: Uint8Array) => {
+        parts.push(chunk);
+      },
+      close: async () => {},
+      blob: (type: string) => new Blob(parts, { type })
+    };
+  }
+
   /**
    * 下载文件
    */
@@ -164,18 +295,28 @@ export class PSDExporter {
     document.body.removeChild(link);
     URL.revokeObjectURL(url);
   }
-  
+
   /**
-   * 下载多个文件（压缩包）
-   * 实际应用中需要集成JSZip等库
+   * 逐个下载多个文件
    */
   static async downloadMultipleFiles(files: { filename: string; blob: Blob }[]): Promise<void> {
-    // 实际应用中，这里应该创建ZIP文件
-    // 为简化，我们逐个下载
     for (const file of files) {
       this.downloadFile(file.blob, file.filename);
       // 添加延迟避免浏览器阻止多个下载
       await new Promise(resolve => setTimeout(resolve, 500));
     }
   }
-}
\ No newline at end of file
+}
+
+function sanitizeFilename(name: string): string {
+  return name.replace(/[\\/:*?"<>|]/g, '_').trim() || 'layer';
+}
+
+function uniqueName(filename: string, used: Set<string>): string {
+  let candidate = filename;
+  for (let i = 2; used.has(candidate); i++) {
+    candidate = filename.replace(/\.png$/, `_${i}.png`);
+  }
+  used.add(candidate);
+  return candidate;
+}
@@ -0,0 +1,24 @@
+/**
+ * 自动网格化 Web Worker
+ * 功能：在后台线程中执行 buildMeshBuffers，结果缓冲区以 Transferable 方式零拷贝返回
+ */
+
+import { buildMeshBuffers, MeshBuildParams } from './meshTriangulation';
+
+export interface AutoMeshWorkerRequest {
+  id: number;
+  pixels: ArrayBuffer; // RGBA像素
+  params: MeshBuildParams;
+}
+
+self.onmessage = (event: MessageEvent<AutoMeshWorkerRequest>) => {
+  const { id, pixels, params } = event.data;
+  try {
+    const mesh = buildMeshBuffers(new Uint8ClampedArray(pixels), params);
+    self.postMessage({ id, mesh }, {
+      transfer: [mesh.positions.buffer, mesh.uvs.buffer, mesh.indices.buffer, mesh.boundary.buffer]
+    });
+  } catch (error) {
+    self.postMessage({ id, error: (error as Error).message });
+  }
+};
@@ -0,0 +1,17 @@
+/**
+ * 图层导出 Web Worker
+ * 功能：在后台线程中裁剪图层并编码为 PSD 通道或 PNG，结果以 Transferable 方式零拷贝返回
+ */
+
+import { encodeLayerJob, LayerExportJob } from './layerExportJob';
+
+self.onmessage = async (event: MessageEvent<LayerExportJob & { id: number }>) => {
+  const { id, ...job } = event.data;
+  try {
+    const result = await encodeLayerJob(job);
+    const transfer = result.kind === 'psd' ? result.channels.map(channel => channel.buffer) : [result.png.buffer];
+    self.postMessage({ id, result }, { transfer });
+  } catch (error) {
+    self.postMessage({ id, error: (error as Error).message });
+  }
+};
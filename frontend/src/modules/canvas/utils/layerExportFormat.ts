@@ -0,0 +1,426 @@
+/**
+ * 图层导出格式模块
+ * 功能：图层裁剪与合成、PSD 通道 RLE 编码与文件结构写入、无压缩 ZIP 封装
+ * 不依赖DOM，可直接在Web Worker中运行
+ */
+
+export interface LayerBounds {
+  left: number;
+  top: number;
+  right: number; // 不含
+  bottom: number; // 不含
+}
+
+/**
+ * 字节输出端，按顺序接收文件片段
+ */
+export interface ExportSink {
+  write(chunk: Uint8Array): Promise<void>;
+  close(): Promise<void>;
+}
+
+// PSD 单边尺寸上限，超过需要 PSB 格式
+export const PSD_MAX_SIZE = 30000;
+
+/**
+ * 计算非透明像素的包围盒，全透明时返回空包围盒
+ */
+export function findOpaqueBounds(data: Uint8ClampedArray, width: number, height: number): LayerBounds {
+  let left = width, top = height, right = 0, bottom = 0;
+  for (let y = 0; y < height; y++) {
+    const row = y * width * 4;
+    let first = -1, last = -1;
+    for (let x = 0; x < width; x++) {
+      if (data[row + x * 4 + 3] !== 0) {
+        if (first === -1) first = x;
+        last = x;
+      }
+    }
+    if (first === -1) continue;
+    if (y < top) top = y;
+    bottom = y + 1;
+    if (first < left) left = first;
+    if (last + 1 > right) right = last + 1;
+  }
+  return right > left ? { left, top, right, bottom } : { left: 0, top: 0, right: 0, bottom: 0 };
+}
+
+/**
+ * 拷贝包围盒内的像素
+ */
+export function cropPixels(data: Uint8ClampedArray, width: number, bounds: LayerBounds): Uint8ClampedArray {
+  const cropWidth = bounds.right - bounds.left;
+  const cropHeight = bounds.bottom - bounds.top;
+  const out = new Uint8ClampedArray(cropWidth * cropHeight * 4);
+  for (let y = 0; y < cropHeight; y++) {
+    const src = ((bounds.top + y) * width + bounds.left) * 4;
+    out.set(data.subarray(src, src + cropWidth * 4), y * cropWidth * 4);
+  }
+  return out;
+}
+
+/**
+ * PackBits 编码一行（按 stride 读取单个通道）
+ * @returns 写入 out 的字节数
+ */
+function packBitsRow(src: Uint8ClampedArray, start: number, stride: number, length: number, out: Uint8Array, outPos: number): number {
+  let o = outPos;
+  let i = 0;
+  while (i < length) {
+    // 重复段
+    let run = 1;
+    const value = src[start + i * stride];
+    while (i + run < length && run < 128 && src[start + (i + run) * stride] === value) run++;
+    if (run >= 2) {
+      out[o++] = 257 - run;
+      out[o++] = value;
+      i += run;
+      continue;
+    }
+    // 字面段：直到出现至少两个相同字节
+    let literal = 1;
+    while (
+      i + literal < length &&
+      literal < 128 &&
+      !(i + literal + 1 < length && src[start + (i + literal) * stride] === src[start + (i + literal + 1) * stride])
+    ) {
+      literal++;
+    }
+    out[o++] = literal - 1;
+    for (let k = 0; k < literal; k++) out[o++] = src[start + (i + k) * stride];
+    i += literal;
+  }
+  return o - outPos;
+}
+
+/**
+ * 把 RGBA 像素编码为 PSD 图层通道数据（每个通道独立的 RLE 压缩块）
+ * @returns 通道顺序为 A(-1), R(0), G(1), B(2)
+ */
+export function encodePSDChannels(pixels: Uint8ClampedArray, width: number, height: number): Uint8Array[] {
+  return [3, 0, 1, 2].map(offset => {
+    if (width === 0 || height === 0) {
+      return new Uint8Array(2); // 压缩方式 0，无像素
+    }
+    // 最坏情况每128字节多1字节
+    const scratch = new Uint8Array(2 + height * 2 + height * (width + Math.ceil(width / 128)));
+    const view = new DataView(scratch.buffer);
+    view.setUint16(0, 1);
+    let pos = 2 + height * 2;
+    for (let y = 0; y < height; y++) {
+      const written = packBitsRow(pixels, y * width * 4 + offset, 4, width, scratch, pos);
+      view.setUint16(2 + y * 2, written);
+      pos += written;
+    }
+    return scratch.slice(0, pos);
+  });
+}
+
+/**
+ * PSD 图层记录所需信息，像素已按包围盒裁剪并编码
+ */
+export interface PSDLayerRecord {
+  name: string;
+  bounds: LayerBounds; // 文档坐标
+  opacity: number; // 0-1
+  visible: boolean;
+  channels: Uint8Array[]; // encodePSDChannels 的结果
+}
+
+/**
+ * 合成用的图层像素，位置为文档坐标
+ */
+export interface CompositeLayer {
+  pixels: Uint8ClampedArray; // RGBA，非预乘
+  width: number;
+  height: number;
+  x: number;
+  y: number;
+  opacity: number; // 0-1
+  visible: boolean;
+}
+
+/**
+ * 按 normal 混合（source-over）把可见图层合成为文档大小的 RGBA 图像
+ * @param layers 从下到上
+ * @returns 非预乘 RGBA，与 PSD 合成图像通道一致
+ */
+export function flattenLayers(width: number, height: number, layers: CompositeLayer[]): Uint8ClampedArray {
+  const out = new Uint8ClampedArray(width * height * 4);
+  for (const layer of layers) {
+    const opacity = Math.max(0, Math.min(1, layer.opacity));
+    if (!layer.visible || opacity === 0) continue;
+    const x0 = Math.max(0, layer.x), x1 = Math.min(width, layer.x + layer.width);
+    const y0 = Math.max(0, layer.y), y1 = Math.min(height, layer.y + layer.height);
+    const scale = opacity / 255;
+    for (let y = y0; y < y1; y++) {
+      let s = ((y - layer.y) * layer.width + (x0 - layer.x)) * 4;
+      let d = (y * width + x0) * 4;
+      for (let x = x0; x < x1; x++, s += 4, d += 4) {
+        const sa = layer.pixels[s + 3] * scale;
+        if (sa === 0) continue;
+        const da = out[d + 3] / 255 * (1 - sa);
+        const a = sa + da;
+        out[d] = (layer.pixels[s] * sa + out[d] * da) / a;
+        out[d + 1] = (layer.pixels[s + 1] * sa + out[d + 1] * da) / a;
+        out[d + 2] = (layer.pixels[s + 2] * sa + out[d + 2] * da) / a;
+        out[d + 3] = a * 255;
+      }
+    }
+  }
+  return out;
+}
+
+class ByteWriter {
+  private bytes: Uint8Array;
+  private view: DataView;
+  length = 0;
+
+  constructor(capacity: number = 256) {
+    this.bytes = new Uint8Array(capacity);
+    this.view = new DataView(this.bytes.buffer);
+  }
+
+  private reserve(size: number) {
+    if (this.length + size <= this.bytes.length) return;
+    const next = new Uint8Array(Math.max(this.bytes.length * 2, this.length + size));
+    next.set(this.bytes.subarray(0, this.length));
+    this.bytes = next;
+    this.view = new DataView(next.buffer);
+  }
+
+  u8(value: number) { this.reserve(1); this.view.setUint8(this.length, value); this.length += 1; return this; }
+  u16(value: number) { this.reserve(2); this.view.setUint16(this.length, value); this.length += 2; return this; }
+  i16(value: number) { this.reserve(2); this.view.setInt16(this.length, value); this.length += 2; return this; }
+  u32(value: number) { this.reserve(4); this.view.setUint32(this.length, value); this.length += 4; return this; }
+  i32(value: number) { this.reserve(4); this.view.setInt32(this.length, value); this.length += 4; return this; }
+  u16le(value: number) { this.reserve(2); this.view.setUint16(this.length, value, true); this.length += 2; return this; }
+  u32le(value: number) { this.reserve(4); this.view.setUint32(this.length, value >>> 0, true); this.length += 4; return this; }
+  ascii(text: string) { for (let i = 0; i < text.length; i++) this.u8(text.charCodeAt(i)); return this; }
+  bytesOf(data: Uint8Array) { this.reserve(data.length); this.bytes.set(data, this.length); this.length += data.length; return this; }
+  pad(multiple: number) { while (this.length % multiple !== 0) this.u8(0); return this; }
+
+  finish(): Uint8Array {
+    return this.bytes.slice(0, this.length);
+  }
+}
+
+function layerRecordExtra(name: string): Uint8Array {
+  const extra = new ByteWriter();
+  extra.u32(0); // 图层蒙版
+  extra.u32(0); // 混合范围
+  // Pascal 名称（仅 ASCII），长度含长度字节按4对齐
+  const ascii = name.replace(/[^\x20-\x7e]/g, '?').slice(0, 255);
+  extra.u8(ascii.length).ascii(ascii).pad(4);
+  // Unicode 名称
+  const unicode = new ByteWriter();
+  unicode.u32(name.length);
+  for (let i = 0; i < name.length; i++) unicode.u16(name.charCodeAt(i));
+  unicode.pad(4);
+  extra.ascii('8BIMluni').u32(unicode.length).bytesOf(unicode.finish());
+  return extra.finish();
+}
+
+/**
+ * 按顺序把分层 PSD 写入输出端
+ * 图层记录需要各通道长度，因此所有图层先编码完成；通道数据随后逐块写出，不拼接成一个大缓冲区
+ * 合成图像为 flattenLayers 的结果，只读取合成图像的查看器和导入器据此显示；未提供时写为透明
+ * @param layers 从下到上
+ * @param composite 文档大小的 RGBA 合成图像
+ */
+export async function writePSD(
+  sink: ExportSink,
+  width: number,
+  height: number,
+  layers: PSDLayerRecord[],
+  composite?: Uint8ClampedArray
+): Promise<void> {
+  if (width > PSD_MAX_SIZE || height > PSD_MAX_SIZE) {
+    throw new Error(`PSD尺寸不能超过 ${PSD_MAX_SIZE} 像素`);
+  }
+
+  // 图层记录
+  const records = new ByteWriter(layers.length * 128);
+  records.i16(-layers.length); // 负数：合成图像第一个 alpha 通道为透明度
+  let channelBytes = 0;
+  for (const layer of layers) {
+    const { left, top, right, bottom } = layer.bounds;
+    records.i32(top).i32(left).i32(bottom).i32(right);
+    records.u16(4);
+    [-1, 0, 1, 2].forEach((id, c) => {
+      records.i16(id).u32(layer.channels[c].length);
+      channelBytes += layer.channels[c].length;
+    });
+    records.ascii('8BIMnorm');
+    records.u8(Math.round(Math.max(0, Math.min(1, layer.opacity)) * 255));
+    records.u8(0); // 剪贴
+    records.u8(layer.visible ? 0 : 2); // 标志位 bit1：隐藏
+    records.u8(0);
+    const extra = layerRecordExtra(layer.name);
+    records.u32(extra.length).bytesOf(extra);
+  }
+
+  const layerInfoLength = records.length + channelBytes;
+  const layerInfoPadded = layerInfoLength + (layerInfoLength % 2);
+
+  const head = new ByteWriter(64);
+  head.ascii('8BPS').u16(1).u32(0).u16(0); // 签名、版本、保留6字节
+  head.u16(4).u32(height).u32(width).u16(8).u16(3); // RGBA, 8位, RGB
+  head.u32(0); // 颜色模式数据
+  head.u32(0); // 图像资源
+  head.u32(4 + layerInfoPadded + 4); // 图层与蒙版信息
+  head.u32(layerInfoPadded);
+  await sink.write(head.finish());
+  await sink.write(records.finish());
+
+  for (const layer of layers) {
+    for (const channel of layer.channels) {
+      await sink.write(channel);
+    }
+  }
+
+  const tail = new ByteWriter(16);
+  if (layerInfoLength % 2) tail.u8(0);
+  tail.u32(0); // 全局图层蒙版
+  await sink.write(tail.finish());
+
+  if (composite) {
+    await writeComposite(sink, composite, width, height);
+  } else {
+    await writeBlankComposite(sink, width, height);
+  }
+}
+
+/**
+ * 合成图像：RLE 压缩，通道顺序 R, G, B, A
+ * 行长度表位于全部行数据之前，因此先逐行压缩一遍只统计长度，再压缩第二遍分块写出，避免同时持有整幅压缩结果
+ */
+async function writeComposite(sink: ExportSink, composite: Uint8ClampedArray, width: number, height: number) {
+  const maxRow = width + Math.ceil(width / 128);
+  const scratch = new Uint8Array(maxRow);
+  const counts = new ByteWriter(2 + height * 8);
+  counts.u16(1);
+  for (let c = 0; c < 4; c++) {
+    for (let y = 0; y < height; y++) {
+      counts.u16(packBitsRow(composite, y * width * 4 + c, 4, width, scratch, 0));
+    }
+  }
+  await sink.write(counts.finish());
+
+  const rowsPerChunk = Math.max(1, Math.floor((1 << 20) / Math.max(1, maxRow)));
+  const chunk = new Uint8Array(rowsPerChunk * maxRow);
+  for (let c = 0; c < 4; c++) {
+    let pos = 0;
+    let rows = 0;
+    for (let y = 0; y < height; y++) {
+      pos += packBitsRow(composite, y * width * 4 + c, 4, width, chunk, pos);
+      if (++rows === rowsPerChunk) {
+        await sink.write(chunk.slice(0, pos));
+        pos = 0;
+        rows = 0;
+      }
+    }
+    if (pos > 0) await sink.write(chunk.slice(0, pos));
+  }
+}
+
+/**
+ * 透明合成图像：所有行内容相同，只编码一次
+ */
+async function writeBlankComposite(sink: ExportSink, width: number, height: number) {
+  const zeros = new Uint8ClampedArray(width);
+  const packed = new Uint8Array(width + Math.ceil(width / 128) + 1);
+  const rowLength = packBitsRow(zeros, 0, 1, width, packed, 0);
+  const row = packed.slice(0, rowLength);
+
+  const counts = new ByteWriter(2 + height * 8);
+  counts.u16(1);
+  for (let i = 0; i < height * 4; i++) counts.u16(rowLength);
+  await sink.write(counts.finish());
+
+  // 每次写出若干行，避免大图时过多的小片段
+  const rowsPerChunk = Math.max(1, Math.floor((1 << 20) / Math.max(1, rowLength)));
+  const chunk = new Uint8Array(rowsPerChunk * rowLength);
+  for (let r = 0; r < rowsPerChunk; r++) chunk.set(row, r * rowLength);
+  let remaining = height * 4;
+  while (remaining > 0) {
+    const rows = Math.min(rowsPerChunk, remaining);
+    await sink.write(rows === rowsPerChunk ? chunk : chunk.subarray(0, rows * rowLength));
+    remaining -= rows;
+  }
+}
+
+// CRC32 查找表
+const CRC_TABLE = (() => {
+  const table = new Uint32Array(256);
+  for (let n = 0; n < 256; n++) {
+    let c = n;
+    for (let k = 0; k < 8; k++) c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+    table[n] = c >>> 0;
+  }
+  return table;
+})();
+
+export function crc32(data: Uint8Array): number {
+  let crc = 0xffffffff;
+  for (let i = 0; i < data.length; i++) {
+    crc = CRC_TABLE[(crc ^ data[i]) & 255] ^ (crc >>> 8);
+  }
+  return (crc ^ 0xffffffff) >>> 0;
+}
+
+/**
+ * 增量写出的 ZIP（存储模式，PNG 本身已压缩）
+ * 每个文件写完即输出，最后写中央目录
+ */
+export class ZipStreamWriter {
+  private entries: Array<{ name: Uint8Array; crc: number; size: number; offset: number }> = [];
+  private offset = 0;
+  private readonly sink: ExportSink;
+  private readonly time: number;
+  private readonly date: number;
+
+  constructor(sink: ExportSink, now: Date = new Date()) {
+    this.sink = sink;
+    this.time = (now.getHours() << 11) | (now.getMinutes() << 5) | (now.getSeconds() >> 1);
+    this.date = ((now.getFullYear() - 1980) << 9) | ((now.getMonth() + 1) << 5) | now.getDate();
+  }
+
+  /**
+   * 添加文件
+   * @param crc 可选的预先计算的 CRC32（如在 Worker 中计算）
+   */
+  async addFile(filename: string, data: Uint8Array, crc: number = crc32(data)): Promise<void> {
+    const name = new TextEncoder().encode(filename);
+    const header = new ByteWriter(30 + name.length);
+    header.u32le(0x04034b50).u16le(20).u16le(0x0800).u16le(0);
+    header.u16le(this.time).u16le(this.date);
+    header.u32le(crc).u32le(data.length).u32le(data.length);
+    header.u16le(name.length).u16le(0).bytesOf(name);
+    const bytes = header.finish();
+    await this.sink.write(bytes);
+    await this.sink.write(data);
+    this.entries.push({ name, crc, size: data.length, offset: this.offset });
+    this.offset += bytes.length + data.length;
+    if (this.offset > 0xffffffff) {
+      throw new Error('ZIP文件超过4GB');
+    }
+  }
+
+  async close(): Promise<void> {
+    const directory = new ByteWriter(this.entries.length * 64 + 22);
+    for (const entry of this.entries) {
+      directory.u32le(0x02014b50).u16le(20).u16le(20).u16le(0x0800).u16le(0);
+      directory.u16le(this.time).u16le(this.date);
+      directory.u32le(entry.crc).u32le(entry.size).u32le(entry.size);
+      directory.u16le(entry.name.length).u16le(0).u16le(0).u16le(0).u16le(0).u32le(0);
+      directory.u32le(entry.offset).bytesOf(entry.name);
+    }
+    const directorySize = directory.length;
+    directory.u32le(0x06054b50).u16le(0).u16le(0);
+    directory.u16le(this.entries.length).u16le(this.entries.length);
+    directory.u32le(directorySize).u32le(this.offset).u16le(0);
+    await this.sink.write(directory.finish());
+    await this.sink.close();
+  }
+}
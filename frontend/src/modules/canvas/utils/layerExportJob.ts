@@ -0,0 +1,60 @@
+/**
+ * 单个图层的导出任务
+ * 功能：裁剪到非透明区域后编码，Worker 与主线程回退路径共用
+ */
+
+import { LayerBounds, findOpaqueBounds, cropPixels, encodePSDChannels, crc32 } from './layerExportFormat';
+
+export interface LayerExportJob {
+  kind: 'psd' | 'png';
+  pixels: ArrayBuffer; // 图层 RGBA 像素，所有权转交给任务
+  width: number;
+  height: number;
+  opacity: number; // 仅 PNG：透明度烘焙到 alpha
+}
+
+export type LayerExportResult =
+  | { kind: 'psd'; bounds: LayerBounds; channels: Uint8Array[] }
+  | { kind: 'png'; bounds: LayerBounds; png: Uint8Array; crc: number };
+
+export async function encodeLayerJob(job: LayerExportJob): Promise<LayerExportResult> {
+  const data = new Uint8ClampedArray(job.pixels);
+  const bounds = findOpaqueBounds(data, job.width, job.height);
+  const cropWidth = bounds.right - bounds.left;
+  const cropHeight = bounds.bottom - bounds.top;
+  const cropped = cropPixels(data, job.width, bounds);
+
+  if (job.kind === 'psd') {
+    return { kind: 'psd', bounds, channels: encodePSDChannels(cropped, cropWidth, cropHeight) };
+  }
+
+  if (job.opacity < 1) {
+    for (let i = 3; i < cropped.length; i += 4) cropped[i] = Math.round(cropped[i] * job.opacity);
+  }
+  // 全透明图层输出 1×1 透明 PNG
+  const png = await encodePNG(cropWidth > 0 ? cropped : new Uint8ClampedArray(4), Math.max(1, cropWidth), Math.max(1, cropHeight));
+  return { kind: 'png', bounds, png, crc: crc32(png) };
+}
+
+async function encodePNG(pixels: Uint8ClampedArray, width: number, height: number): Promise<Uint8Array> {
+  const image = new ImageData(pixels, width, height);
+  let blob: Blob | null;
+  if (typeof OffscreenCanvas !== 'undefined') {
+    const canvas = new OffscreenCanvas(width, height);
+    const ctx = canvas.getContext('2d');
+    if (!ctx) throw new Error('无法获取Canvas上下文');
+    ctx.putImageData(image, 0, 0);
+    blob = await canvas.convertToBlob({ type: 'image/png' });
+  } else {
+    // 不支持 OffscreenCanvas 的主线程回退
+    const canvas = document.createElement('canvas');
+    canvas.width = width;
+    canvas.height = height;
+    const ctx = canvas.getContext('2d');
+    if (!ctx) throw new Error('无法获取Canvas上下文');
+    ctx.putImageData(image, 0, 0);
+    blob = await new Promise<Blob | null>(resolve => canvas.toBlob(resolve, 'image/png'));
+  }
+  if (!blob) throw new Error('无法创建PNG blob');
+  return new Uint8Array(await blob.arrayBuffer());
+}
@@ -0,0 +1,702 @@
+/**
+ * 网格三角剖分核心模块
+ * 功能：遮罩 → 轮廓追踪 → 轮廓简化 → 内部采样 → 约束Delaunay三角剖分 → GPU缓冲区
+ * 不依赖DOM，可直接在Web Worker中运行
+ */
+
+export interface MeshBuffers {
+  positions: Float32Array; // 顶点坐标 x,y 交错
+  uvs: Float32Array; // 纹理坐标 u,v 交错
+  indices: Uint32Array; // 三角形索引，每3个一个三角形
+  boundary: Uint32Array; // 轮廓边，每2个一条边
+  bounds: {
+    minX: number;
+    minY: number;
+    maxX: number;
+    maxY: number;
+  };
+  vertexDensity: number;
+}
+
+export interface MeshBuildParams {
+  width: number;
+  height: number;
+  vertexDensity: number; // 顶点密度
+  edgeSmoothing: number; // 边缘平滑度，决定轮廓简化容差
+  optimizationLevel?: number; // 优化级别，每级约减少10%内部顶点
+  alphaThreshold?: number; // alpha大于该值视为在遮罩内，默认128
+}
+
+/**
+ * 网格间距，与原AutoMeshGenerator一致；优化级别按顶点数比例放大间距
+ */
+export function meshSpacing(vertexDensity: number, optimizationLevel: number = 0): number {
+  const spacing = Math.max(5, Math.min(50, 100 / vertexDensity));
+  const keep = Math.max(0.1, 1 - optimizationLevel * 0.1);
+  return spacing / Math.sqrt(keep);
+}
+
+/**
+ * 沿像素边界追踪遮罩轮廓（4连通，外轮廓与孔洞方向相反）
+ * @returns 每个轮廓为格点坐标 [x0, y0, x1, y1, ...]，只保留方向变化处的拐点
+ */
+export function traceContours(mask: Uint8Array, width: number, height: number): number[][] {
+  const cornerWidth = width + 1;
+  const inside = (x: number, y: number) => x >= 0 && y >= 0 && x < width && y < height && mask[y * width + x] !== 0;
+
+  let edgeCount = 0;
+  for (let y = 0; y < height; y++) {
+    for (let x = 0; x < width; x++) {
+      if (!mask[y * width + x]) continue;
+      edgeCount += (inside(x, y - 1) ? 0 : 1) + (inside(x, y + 1) ? 0 : 1) +
+        (inside(x - 1, y) ? 0 : 1) + (inside(x + 1, y) ? 0 : 1);
+    }
+  }
+
+  // 每个格点的出边链表；遮罩内部始终在前进方向左侧
+  const head = new Int32Array(cornerWidth * (height + 1)).fill(-1);
+  const nextOut = new Int32Array(edgeCount);
+  const from = new Int32Array(edgeCount);
+  const to = new Int32Array(edgeCount);
+  let count = 0;
+  const addEdge = (a: number, b: number) => {
+    from[count] = a;
+    to[count] = b;
+    nextOut[count] = head[a];
+    head[a] = count++;
+  };
+  for (let y = 0; y < height; y++) {
+    for (let x = 0; x < width; x++) {
+      if (!mask[y * width + x]) continue;
+      const topLeft = y * cornerWidth + x;
+      const topRight = topLeft + 1;
+      const bottomLeft = topLeft + cornerWidth;
+      const bottomRight = bottomLeft + 1;
+      if (!inside(x, y - 1)) addEdge(topRight, topLeft);
+      if (!inside(x - 1, y)) addEdge(topLeft, bottomLeft);
+      if (!inside(x, y + 1)) addEdge(bottomLeft, bottomRight);
+      if (!inside(x + 1, y)) addEdge(bottomRight, topRight);
+    }
+  }
+
+  // 左转顺序：左 → 下 → 右 → 上
+  const leftTurn = (direction: number) =>
+    direction === -1 ? cornerWidth : direction === cornerWidth ? 1 : direction === 1 ? -cornerWidth : -1;
+
+  const visited = new Uint8Array(edgeCount);
+  const loops: number[][] = [];
+  for (let start = 0; start < edgeCount; start++) {
+    if (visited[start]) continue;
+    const loop: number[] = [];
+    let edge = start;
+    while (!visited[edge]) {
+      visited[edge] = 1;
+      const corner = to[edge];
+      const direction = to[edge] - from[edge];
+
+      // 鞍点处有两条出边，取左转的一条，使对角相接的像素分属不同轮廓
+      let next = -1;
+      for (let candidate = head[corner]; candidate !== -1; candidate = nextOut[candidate]) {
+        if (visited[candidate] && candidate !== start) continue;
+        next = candidate;
+        if (to[candidate] - from[candidate] === leftTurn(direction)) break;
+      }
+      if (next === -1) break;
+      if (to[next] - from[next] !== direction) {
+        loop.push(corner % cornerWidth, Math.floor(corner / cornerWidth));
+      }
+      edge = next;
+    }
+    if (loop.length >= 6) loops.push(loop);
+  }
+  return loops;
+}
+
+/**
+ * 闭合多边形的Douglas-Peucker简化
+ */
+export function simplifyClosed(points: number[], epsilon: number): number[] {
+  const n = points.length / 2;
+  if (n <= 3) return points;
+
+  // 以第0点和离它最远的点为锚点，分成两条折线
+  let far = 0;
+  let farDistance = -1;
+  for (let i = 1; i < n; i++) {
+    const d = (points[2 * i] - points[0]) ** 2 + (points[2 * i + 1] - points[1]) ** 2;
+    if (d > farDistance) {
+      farDistance = d;
+      far = i;
+    }
+  }
+
+  const keep = new Uint8Array(n);
+  keep[0] = 1;
+  keep[far] = 1;
+  const stack = [0, far, far, n];
+  const epsilonSq = epsilon * epsilon;
+  while (stack.length) {
+    const j = stack.pop()!;
+    const i = stack.pop()!;
+    const ax = points[2 * i], ay = points[2 * i + 1];
+    const bx = points[2 * (j % n)], by = points[2 * (j % n) + 1];
+    const dx = bx - ax, dy = by - ay;
+    const lengthSq = dx * dx + dy * dy;
+    let best = -1;
+    let bestDistance = epsilonSq;
+    for (let k = i + 1; k < j; k++) {
+      const px = points[2 * k] - ax, py = points[2 * k + 1] - ay;
+      const cross = dx * py - dy * px;
+      const d = lengthSq > 0 ? (cross * cross) / lengthSq : px * px + py * py;
+      if (d > bestDistance) {
+        bestDistance = d;
+        best = k;
+      }
+    }
+    if (best !== -1) {
+      keep[best] = 1;
+      stack.push(i, best, best, j);
+    }
+  }
+
+  const result: number[] = [];
+  for (let i = 0; i < n; i++) {
+    if (keep[i]) result.push(points[2 * i], points[2 * i + 1]);
+  }
+  return result;
+}
+
+function polygonArea(points: number[]): number {
+  let area = 0;
+  const n = points.length / 2;
+  for (let i = 0, j = n - 1; i < n; j = i++) {
+    area += points[2 * j] * points[2 * i + 1] - points[2 * i] * points[2 * j + 1];
+  }
+  return area / 2;
+}
+
+const nextEdge = (e: number) => (e % 3 === 2 ? e - 2 : e + 1);
+const prevEdge = (e: number) => (e % 3 === 0 ? e + 2 : e - 1);
+
+/**
+ * 约束Delaunay三角剖分（半边结构，逐点插入 + Lawson翻转，约束边用Sloan翻转法恢复）
+ * 三角形 t 的半边为 3t、3t+1、3t+2，triangles[e] 为半边 e 的起点，halfedges[e] 为对边
+ */
+export class ConstrainedDelaunay {
+  readonly coords: Float64Array;
+  readonly triangles: Int32Array;
+  readonly halfedges: Int32Array;
+  readonly constrained: Uint8Array;
+  readonly vertexEdge: Int32Array;
+  readonly superStart: number;
+  triangleCount = 0;
+  private lastTriangle = 0;
+  private readonly legalizeStack: number[] = [];
+
+  /**
+   * @param points 顶点坐标 x,y 交错
+   * @param count 顶点数
+   */
+  constructor(points: ArrayLike<number>, count: number) {
+    this.superStart = count;
+    this.coords = new Float64Array((count + 3) * 2);
+    let minX = Infinity, minY = Infinity, maxX = -Infinity, maxY = -Infinity;
+    for (let i = 0; i < count; i++) {
+      // 确定性微小扰动，避免格点带来的共线/共圆退化；只用于判定，不影响输出坐标
+      const hash = Math.imul(i + 1, 2654435761) >>> 0;
+      const x = points[2 * i] + ((hash & 0xffff) / 0xffff - 0.5) * 1e-3;
+      const y = points[2 * i + 1] + ((hash >>> 16) / 0xffff - 0.5) * 1e-3;
+      this.coords[2 * i] = x;
+      this.coords[2 * i + 1] = y;
+      minX = Math.min(minX, x); minY = Math.min(minY, y);
+      maxX = Math.max(maxX, x); maxY = Math.max(maxY, y);
+    }
+    if (count === 0) {
+      minX = minY = 0;
+      maxX = maxY = 1;
+    }
+
+    // 覆盖所有点的超级三角形
+    const size = Math.max(maxX - minX, maxY - minY, 1);
+    const cx = (minX + maxX) / 2, cy = (minY + maxY) / 2;
+    const s = this.superStart;
+    this.coords.set([cx - 20 * size, cy - size, cx + 20 * size, cy - size, cx, cy + 20 * size], 2 * s);
+
+    const capacity = 2 * (count + 3) + 1;
+    this.triangles = new Int32Array(capacity * 3);
+    this.halfedges = new Int32Array(capacity * 3).fill(-1);
+    this.constrained = new Uint8Array(capacity * 3);
+    this.vertexEdge = new Int32Array(count + 3).fill(-1);
+    if (this.orient(s, s + 1, s + 2) > 0) {
+      this.addTriangle(s, s + 1, s + 2);
+    } else {
+      this.addTriangle(s, s + 2, s + 1);
+    }
+  }
+
+  private orient(a: number, b: number, c: number): number {
+    const p = this.coords;
+    return (p[2 * b] - p[2 * a]) * (p[2 * c + 1] - p[2 * a + 1]) - (p[2 * b + 1] - p[2 * a + 1]) * (p[2 * c] - p[2 * a]);
+  }
+
+  /**
+   * d 是否在逆时针三角形 (a, b, c) 的外接圆内（> 0）
+   */
+  private inCircle(a: number, b: number, c: number, d: number): number {
+    const p = this.coords;
+    const dx = p[2 * d], dy = p[2 * d + 1];
+    const adx = p[2 * a] - dx, ady = p[2 * a + 1] - dy;
+    const bdx = p[2 * b] - dx, bdy = p[2 * b + 1] - dy;
+    const cdx = p[2 * c] - dx, cdy = p[2 * c + 1] - dy;
+    return (adx * adx + ady * ady) * (bdx * cdy - cdx * bdy) -
+      (bdx * bdx + bdy * bdy) * (adx * cdy - cdx * ady) +
+      (cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady);
+  }
+
+  private addTriangle(a: number, b: number, c: number): number {
+    const t = this.triangleCount++;
+    this.triangles[3 * t] = a;
+    this.triangles[3 * t + 1] = b;
+    this.triangles[3 * t + 2] = c;
+    this.vertexEdge[a] = 3 * t;
+    this.vertexEdge[b] = 3 * t + 1;
+    this.vertexEdge[c] = 3 * t + 2;
+    return t;
+  }
+
+  private link(a: number, b: number) {
+    this.halfedges[a] = b;
+    if (b !== -1) this.halfedges[b] = a;
+  }
+
+  /**
+   * 定位包含点 p 的三角形（从上次插入位置直线行走）
+   */
+  private locate(p: number): number {
+    let t = this.lastTriangle;
+    const limit = this.triangleCount * 4 + 16;
+    for (let steps = 0; steps < limit; steps++) {
+      let moved = false;
+      for (let k = 0; k < 3; k++) {
+        const e = 3 * t + (k + steps) % 3;
+        if (this.orient(this.triangles[e], this.triangles[nextEdge(e)], p) < 0) {
+          const h = this.halfedges[e];
+          if (h === -1) break;
+          t = Math.floor(h / 3);
+          moved = true;
+          break;
+        }
+      }
+      if (!moved) return t;
+    }
+    // 行走失败时退化为全扫描
+    for (t = 0; t < this.triangleCount; t++) {
+      const e = 3 * t;
+      if (this.orient(this.triangles[e], this.triangles[e + 1], p) >= 0 &&
+          this.orient(this.triangles[e + 1], this.triangles[e + 2], p) >= 0 &&
+          this.orient(this.triangles[e + 2], this.triangles[e], p) >= 0) {
+        return t;
+      }
+    }
+    return -1;
+  }
+
+  /**
+   * 插入顶点 p，所在三角形一分为三后恢复Delaunay性质
+   */
+  insert(p: number): boolean {
+    const t = this.locate(p);
+    if (t === -1) return false;
+    const tri = this.triangles, adj = this.halfedges, cons = this.constrained;
+    const e0 = 3 * t;
+    const a = tri[e0], b = tri[e0 + 1], c = tri[e0 + 2];
+    const h0 = adj[e0], h1 = adj[e0 + 1], h2 = adj[e0 + 2];
+    const c0 = cons[e0], c1 = cons[e0 + 1], c2 = cons[e0 + 2];
+
+    // t 变为 (a, b, p)，新增 (b, c, p) 和 (c, a, p)
+    tri[e0 + 2] = p;
+    const t1 = this.addTriangle(b, c, p);
+    const t2 = this.addTriangle(c, a, p);
+    const e1 = 3 * t1, e2 = 3 * t2;
+    this.link(e0, h0); cons[e0] = c0;
+    this.link(e1, h1); cons[e1] = c1;
+    this.link(e2, h2); cons[e2] = c2;
+    this.link(e0 + 1, e1 + 2); cons[e0 + 1] = 0;
+    this.link(e1 + 1, e2 + 2);
+    this.link(e2 + 1, e0 + 2); cons[e0 + 2] = 0;
+    this.vertexEdge[a] = e0;
+    this.vertexEdge[b] = e1;
+    this.vertexEdge[c] = e2;
+    this.vertexEdge[p] = e0 + 2;
+    this.lastTriangle = t;
+
+    this.legalizeStack.push(e0, e1, e2);
+    this.legalize();
+    return true;
+  }
+
+  private legalize() {
+    const stack = this.legalizeStack;
+    const tri = this.triangles, adj = this.halfedges;
+    while (stack.length) {
+      const a = stack.pop()!;
+      const b = adj[a];
+      if (b === -1 || this.constrained[a]) continue;
+      const a0 = a - a % 3;
+      const ar = a0 + (a + 2) % 3;
+      const al = a0 + (a + 1) % 3;
+      const b0 = b - b % 3;
+      const bl = b0 + (b + 2) % 3;
+      const br = b0 + (b + 1) % 3;
+      if (this.inCircle(tri[a], tri[al], tri[ar], tri[bl]) > 0) {
+        this.flip(a);
+        stack.push(a, br);
+      }
+    }
+  }
+
+  /**
+   * 翻转半边 a 所在的对角线
+   * 三角形 (pr, pl, p0) 与 (pl, pr, p1) 变为 (p1, pl, p0) 与 (p0, pr, p1)
+   */
+  private flip(a: number) {
+    const tri = this.triangles, adj = this.halfedges, cons = this.constrained;
+    const b = adj[a];
+    const a0 = a - a % 3;
+    const ar = a0 + (a + 2) % 3;
+    const al = a0 + (a + 1) % 3;
+    const b0 = b - b % 3;
+    const bl = b0 + (b + 2) % 3;
+    const br = b0 + (b + 1) % 3;
+    const p0 = tri[ar], pr = tri[a], pl = tri[al], p1 = tri[bl];
+    const hbl = adj[bl], har = adj[ar];
+    const cbl = cons[bl], car = cons[ar];
+
+    tri[a] = p1;
+    tri[b] = p0;
+    this.link(a, hbl); cons[a] = cbl;
+    this.link(b, har); cons[b] = car;
+    this.link(ar, bl); cons[ar] = 0; cons[bl] = 0;
+    this.vertexEdge[p1] = a;
+    this.vertexEdge[p0] = b;
+    this.vertexEdge[pl] = al;
+    this.vertexEdge[pr] = br;
+  }
+
+  /**
+   * 查找从 u 到 v 的半边，不存在返回 -1
+   */
+  findEdge(u: number, v: number): number {
+    const start = this.vertexEdge[u];
+    if (start === -1) return -1;
+    let e = start;
+    do {
+      if (this.triangles[nextEdge(e)] === v) return e;
+      e = this.halfedges[prevEdge(e)];
+    } while (e !== -1 && e !== start);
+    return -1;
+  }
+
+  private markConstrained(e: number) {
+    this.constrained[e] = 1;
+    if (this.halfedges[e] !== -1) this.constrained[this.halfedges[e]] = 1;
+  }
+
+  private crosses(a: number, b: number, w: number, z: number): boolean {
+    if (w === a || w === b || z === a || z === b) return false;
+    return this.orient(a, b, w) * this.orient(a, b, z) < 0 && this.orient(w, z, a) * this.orient(w, z, b) < 0;
+  }
+
+  /**
+   * 插入约束边 (a, b)
+   * @returns 边已存在或恢复成功返回 true；与其它约束边相交等无法恢复时返回 false
+   */
+  insertConstraint(a: number, b: number): boolean {
+    if (a === b) return false;
+    const tri = this.triangles, adj = this.halfedges;
+    const existing = this.findEdge(a, b);
+    if (existing !== -1) {
+      this.markConstrained(existing);
+      return true;
+    }
+
+    // 找到 a 周围被线段 ab 穿过的三角形
+    let crossing = -1;
+    const start = this.vertexEdge[a];
+    let e = start;
+    do {
+      const x = tri[nextEdge(e)], y = tri[prevEdge(e)];
+      if (this.orient(a, x, b) > 0 && this.orient(a, y, b) < 0) {
+        crossing = nextEdge(e);
+        break;
+      }
+      e = adj[prevEdge(e)];
+    } while (e !== -1 && e !== start);
+    if (crossing === -1) return false;
+
+    // 沿线段收集所有相交边
+    const queue: number[] = [];
+    for (let h = crossing; ;) {
+      if (this.constrained[h]) return false;
+      const u = tri[h], v = tri[nextEdge(h)];
+      queue.push(u, v);
+      const g = adj[h];
+      if (g === -1) return false;
+      const z = tri[prevEdge(g)];
+      if (z === b) break;
+      const side = this.orient(a, b, z);
+      if (side === 0) return false;
+      h = side * this.orient(a, b, u) > 0 ? prevEdge(g) : nextEdge(g);
+    }
+
+    // Sloan：翻转凸四边形的对角线，直到没有边与 ab 相交
+    const fresh: number[] = [];
+    const limit = queue.length * queue.length + 1024;
+    let head = 0;
+    for (let guard = 0; head < queue.length; guard++) {
+      if (guard > limit) return false;
+      const u = queue[head++], v = queue[head++];
+      const edge = this.findEdge(u, v);
+      if (edge === -1 || adj[edge] === -1) continue;
+      const w = tri[prevEdge(edge)], z = tri[prevEdge(adj[edge])];
+      if (this.orient(w, z, u) * this.orient(w, z, v) < 0) {
+        this.flip(edge);
+        if (this.crosses(a, b, w, z)) {
+          queue.push(w, z);
+        } else {
+          fresh.push(w, z);
+        }
+      } else {
+        queue.push(u, v);
+      }
+    }
+
+    const constraint = this.findEdge(a, b);
+    if (constraint === -1) return false;
+    this.markConstrained(constraint);
+
+    // 对新生成的边恢复Delaunay性质（约束边不翻转）
+    for (let swapped = true, passes = 0; swapped && passes < 64; passes++) {
+      swapped = false;
+      for (let k = 0; k < fresh.length; k += 2) {
+        const edge = this.findEdge(fresh[k], fresh[k + 1]);
+        if (edge === -1 || adj[edge] === -1 || this.constrained[edge]) continue;
+        const u = tri[edge], v = tri[nextEdge(edge)];
+        const w = tri[prevEdge(edge)], z = tri[prevEdge(adj[edge])];
+        if (this.inCircle(u, v, w, z) > 0 && this.orient(w, z, u) * this.orient(w, z, v) < 0) {
+          this.flip(edge);
+          fresh[k] = w;
+          fresh[k + 1] = z;
+          swapped = true;
+        }
+      }
+    }
+    return true;
+  }
+
+  /**
+   * 按跨越约束边的奇偶性区分内外：从超级三角形出发泛洪，跨过奇数条约束边的三角形在内部
+   * @param classify 有约束边未能恢复时奇偶性不可靠，改用该函数按重心判断
+   * @returns 内部三角形的顶点索引
+   */
+  interiorTriangles(classify?: (x: number, y: number) => boolean): Uint32Array {
+    const count = this.triangleCount;
+    const depth = new Int32Array(count).fill(-1);
+    const seed = Math.floor(this.vertexEdge[this.superStart] / 3);
+    const queue = new Int32Array(count);
+    let head = 0, tail = 0;
+    depth[seed] = 0;
+    queue[tail++] = seed;
+    while (head < tail) {
+      const t = queue[head++];
+      for (let k = 0; k < 3; k++) {
+        const e = 3 * t + k;
+        const h = this.halfedges[e];
+        if (h === -1) continue;
+        const n = Math.floor(h / 3);
+        if (depth[n] === -1) {
+          depth[n] = depth[t] + this.constrained[e];
+          queue[tail++] = n;
+        }
+      }
+    }
+
+    // 先标记并计数内部三角形，再写入预分配的输出
+    const interior = new Uint8Array(count);
+    let inside = 0;
+    for (let t = 0; t < count; t++) {
+      if (depth[t] === -1) continue;
+      const a = this.triangles[3 * t], b = this.triangles[3 * t + 1], c = this.triangles[3 * t + 2];
+      if (a >= this.superStart || b >= this.superStart || c >= this.superStart) continue;
+      const isInside = classify
+        ? classify((this.coords[2 * a] + this.coords[2 * b] + this.coords[2 * c]) / 3,
+                   (this.coords[2 * a + 1] + this.coords[2 * b + 1] + this.coords[2 * c + 1]) / 3)
+        : (depth[t] & 1) === 1;
+      if (isInside) {
+        interior[t] = 1;
+        inside++;
+      }
+    }
+
+    const result = new Uint32Array(inside * 3);
+    let offset = 0;
+    for (let t = 0; t < count; t++) {
+      if (!interior[t]) continue;
+      result[offset++] = this.triangles[3 * t];
+      result[offset++] = this.triangles[3 * t + 1];
+      result[offset++] = this.triangles[3 * t + 2];
+    }
+    return result;
+  }
+}
+
+/**
+ * 由RGBA像素生成网格缓冲区
+ * @param pixels RGBA像素（ImageData.data）
+ */
+export function buildMeshBuffers(pixels: ArrayLike<number>, params: MeshBuildParams): MeshBuffers {
+  const { width, height, vertexDensity, edgeSmoothing } = params;
+  const threshold = params.alphaThreshold ?? 128;
+  const spacing = meshSpacing(vertexDensity, params.optimizationLevel ?? 0);
+
+  const mask = new Uint8Array(width * height);
+  for (let i = 0; i < mask.length; i++) {
+    mask[i] = pixels[i * 4 + 3] > threshold ? 1 : 0;
+  }
+
+  // 轮廓：追踪 → 简化 → 按网格间距加密边
+  const epsilon = 0.5 + edgeSmoothing * 0.25;
+  const minArea = spacing * spacing * 0.25;
+  const points: number[] = [];
+  const cornerIndex = new Map<number, number>();
+  const constraints: number[] = [];
+  const segments: number[] = [];
+  const addPoint = (x: number, y: number): number => {
+    const integral = Number.isInteger(x) && Number.isInteger(y);
+    const key = y * (width + 1) + x;
+    if (integral) {
+      const known = cornerIndex.get(key);
+      if (known !== undefined) return known;
+    }
+    const index = points.length / 2;
+    points.push(x, y);
+    if (integral) cornerIndex.set(key, index);
+    return index;
+  };
+
+  for (const loop of traceContours(mask, width, height)) {
+    const simplified = simplifyClosed(loop, epsilon);
+    if (simplified.length < 6 || Math.abs(polygonArea(simplified)) < minArea) continue;
+    const n = simplified.length / 2;
+    const loopIndices: number[] = [];
+    for (let i = 0; i < n; i++) {
+      const ax = simplified[2 * i], ay = simplified[2 * i + 1];
+      const bx = simplified[2 * ((i + 1) % n)], by = simplified[2 * ((i + 1) % n) + 1];
+      const pieces = Math.max(1, Math.ceil(Math.hypot(bx - ax, by - ay) / spacing));
+      for (let k = 0; k < pieces; k++) {
+        const x = ax + (bx - ax) * (k / pieces), y = ay + (by - ay) * (k / pieces);
+        loopIndices.push(addPoint(x, y));
+        const x2 = ax + (bx - ax) * ((k + 1) / pieces), y2 = ay + (by - ay) * ((k + 1) / pieces);
+        segments.push(x, y, x2, y2);
+      }
+    }
+    for (let i = 0; i < loopIndices.length; i++) {
+      constraints.push(loopIndices[i], loopIndices[(i + 1) % loopIndices.length]);
+    }
+  }
+
+  // 轮廓线段网格哈希（按中点分桶，线段长度不超过一个格子）
+  const cellsX = Math.ceil(width / spacing) + 1;
+  const cellsY = Math.ceil(height / spacing) + 1;
+  const segmentCount = segments.length / 4;
+  const cellStart = new Int32Array(cellsX * cellsY + 1);
+  const segmentCell = new Int32Array(segmentCount);
+  for (let s = 0; s < segmentCount; s++) {
+    const cx = Math.min(cellsX - 1, Math.floor((segments[4 * s] + segments[4 * s + 2]) / 2 / spacing));
+    const cy = Math.min(cellsY - 1, Math.floor((segments[4 * s + 1] + segments[4 * s + 3]) / 2 / spacing));
+    segmentCell[s] = cy * cellsX + cx;
+    cellStart[segmentCell[s] + 1]++;
+  }
+  for (let c = 0; c < cellsX * cellsY; c++) cellStart[c + 1] += cellStart[c];
+  const cellItems = new Int32Array(segmentCount);
+  const fill = cellStart.slice(0, cellsX * cellsY);
+  for (let s = 0; s < segmentCount; s++) cellItems[fill[segmentCell[s]]++] = s;
+
+  const nearContour = (x: number, y: number, radius: number): boolean => {
+    const cx = Math.floor(x / spacing), cy = Math.floor(y / spacing);
+    const radiusSq = radius * radius;
+    for (let j = Math.max(0, cy - 1); j <= Math.min(cellsY - 1, cy + 1); j++) {
+      for (let i = Math.max(0, cx - 1); i <= Math.min(cellsX - 1, cx + 1); i++) {
+        const cell = j * cellsX + i;
+        for (let k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+          const s = 4 * cellItems[k];
+          const ax = segments[s], ay = segments[s + 1];
+          const dx = segments[s + 2] - ax, dy = segments[s + 3] - ay;
+          const lengthSq = dx * dx + dy * dy;
+          const t = lengthSq > 0 ? Math.max(0, Math.min(1, ((x - ax) * dx + (y - ay) * dy) / lengthSq)) : 0;
+          if ((ax + t * dx - x) ** 2 + (ay + t * dy - y) ** 2 < radiusSq) return true;
+        }
+      }
+    }
+    return false;
+  };
+
+  // 内部顶点：遮罩内、且离轮廓至少半个间距的格点
+  for (let y = spacing / 2; y < height; y += spacing) {
+    for (let x = spacing / 2; x < width; x += spacing) {
+      if (mask[Math.floor(y) * width + Math.floor(x)] && !nearContour(x, y, spacing * 0.5)) {
+        points.push(x, y);
+      }
+    }
+  }
+
+  const count = points.length / 2;
+  const cdt = new ConstrainedDelaunay(points, count);
+  for (let i = 0; i < count; i++) cdt.insert(i);
+  let failed = 0;
+  for (let i = 0; i < constraints.length; i += 2) {
+    if (!cdt.insertConstraint(constraints[i], constraints[i + 1])) failed++;
+  }
+  // 大容差简化后的轮廓可能互相交叉，此时按重心采样遮罩判断内外
+  const triangles = cdt.interiorTriangles(failed > 0
+    ? (x, y) => mask[Math.min(height - 1, Math.floor(y)) * width + Math.min(width - 1, Math.floor(x))] === 1
+    : undefined);
+
+  // 压缩为只含被引用顶点的GPU缓冲区
+  const remap = new Int32Array(count).fill(-1);
+  let used = 0;
+  for (let i = 0; i < triangles.length; i++) {
+    if (remap[triangles[i]] === -1) remap[triangles[i]] = used++;
+  }
+  const positions = new Float32Array(used * 2);
+  const uvs = new Float32Array(used * 2);
+  let minX = Infinity, minY = Infinity, maxX = -Infinity, maxY = -Infinity;
+  for (let i = 0; i < count; i++) {
+    const j = remap[i];
+    if (j === -1) continue;
+    const x = points[2 * i], y = points[2 * i + 1];
+    positions[2 * j] = x;
+    positions[2 * j + 1] = y;
+    uvs[2 * j] = x / width;
+    uvs[2 * j + 1] = y / height;
+    minX = Math.min(minX, x); minY = Math.min(minY, y);
+    maxX = Math.max(maxX, x); maxY = Math.max(maxY, y);
+  }
+  const indices = new Uint32Array(triangles.length);
+  for (let i = 0; i < triangles.length; i++) indices[i] = remap[triangles[i]];
+
+  const boundaryEdges: number[] = [];
+  for (let i = 0; i < constraints.length; i += 2) {
+    const a = remap[constraints[i]], b = remap[constraints[i + 1]];
+    if (a !== -1 && b !== -1 && a !== b) boundaryEdges.push(a, b);
+  }
+
+  return {
+    positions,
+    uvs,
+    indices,
+    boundary: Uint32Array.from(boundaryEdges),
+    bounds: used > 0 ? { minX, minY, maxX, maxY } : { minX: 0, minY: 0, maxX: 0, maxY: 0 },
+    vertexDensity
+  };
+}
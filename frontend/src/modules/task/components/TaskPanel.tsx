@@ -1,10 +1,11 @@
-import React, { useState, useEffect, useCallback } from 'react';
+import React, { useState, useEffect, useCallback, useMemo } from 'react';
 import { 
   Play, StopCircle, RefreshCcw, 
   ChevronDown, ChevronUp 
 } from 'lucide-react';
 import { cn } from '@/lib/utils';
 import type { Task, WorkflowStatus, FileTypeStats } from '../utils/utils';
+import { summarizeWorkflowTimings, formatDuration } from '../utils/utils';
 import { useTranslation } from '../../../i18n';
 import { Button, Card } from '../../../components/ui';
 import { sx } from '../../../themes/themeUtils';
@@ -347,15 +348,89 @@ export interface WorkflowStatusDisplayProps {
 
 export const WorkflowStatusDisplay: React.FC<WorkflowStatusDisplayProps> = ({ workflowStatus }) => {
   const { t } = useTranslation();
+  const timings = useMemo(
+    () => summarizeWorkflowTimings([...(workflowStatus.processed_files || []), ...(workflowStatus.failed_files || [])]),
+    [workflowStatus.processed_files, workflowStatus.failed_files]
+  );
   return (
     <div className={sx(['mb-4'])}>
       <h5 className={sx(['text-sm', 'font-medium', 'text.text-primary', 'mb-2'])}>{t('workflow-status.title')}</h5>
       <div className={sx(['flex', 'items-center', 'gap-4', 'text-xs', 'text.text-secondary'])}>
         <div>{t('workflow-status.total-files')}: {workflowStatus.total_files || 0}</div>
-        <div>{t('workflow-status.processed')}: {(workflowStatus.processed_files || []).length}</div>
-        <div>{t('workflow-status.failed')}: {(workflowStatus.failed_files || []).length}</div>
+        <div>{t('workflow-status.processed')}: {workflowStatus.processed_count ?? (workflowStatus.processed_files || []).length}</div>
+        <div>{t('workflow-status.failed')}: {workflowStatus.failed_count ?? (workflowStatus.failed_files || []).length}</div>
         <div>{t('workflow-status.success-rate')}: {(workflowStatus.success_rate || 0 * 100).toFixed(1)}%</div>
       </div>
+      {workflowStatus.scheduler && (
+        <div className={sx(['flex', 'items-center', 'gap-4', 'mt-1', 'text-xs', 'text.text-secondary'])}>
+          <div>
+            {t('workflow-status.memory')}: {Math.round(workflowStatus.scheduler.reserved_ram_mb)} / {Math.round(workflowStatus.scheduler.ram_budget_mb)} MB
+          </div>
+          {workflowStatus.scheduler.vram_budget_mb !== null && (
+            <div>
+              {t('workflow-status.vram')}: {Math.round(workflowStatus.scheduler.reserved_vram_mb)} / {Math.round(workflowStatus.scheduler.vram_budget_mb)} MB
+            </div>
+          )}
+          <div>{t('workflow-status.deferred')}: {workflowStatus.scheduler.waiting.length}</div>
+        </div>
+      )}
+      {workflowStatus.cluster && (
+        <div className={sx(['mt-2', 'text-xs', 'text.text-secondary'])}>
+          <div className={sx(['flex', 'items-center', 'gap-4'])}>
+            <div>{t('workflow-status.workers')}: {workflowStatus.cluster.workers_alive} / {workflowStatus.cluster.workers.length}</div>
+            <div>{t('workflow-status.pending-gpu')}: {workflowStatus.cluster.pending.gpu}</div>
+            <div>{t('workflow-status.pending-cpu')}: {workflowStatus.cluster.pending.cpu}</div>
+          </div>
+          {workflowStatus.cluster.workers.map(worker => (
+            <div key={worker.worker_id} className={sx(['flex', 'items-center', 'gap-4'], { 'opacity-50': !worker.alive })}>
+              <div className={sx(['text.text-primary'])}>{worker.worker_id}</div>
+              <div>{worker.capabilities.join('/')}</div>
+              <div>{t('workflow-status.worker-running')}: {worker.running.length} / {worker.slots}</div>
+              <div>{t('workflow-status.processed')}: {worker.completed}</div>
+              <div>{t('workflow-status.failed')}: {worker.failed}</div>
+              {!worker.alive && <div>{t('workflow-status.worker-offline')}</div>}
+            </div>
+          ))}
+        </div>
+      )}
+      {timings.jobs > 0 && (
+        <div className={sx(['mt-3', 'text-xs', 'text.text-secondary'])}>
+          <div className={sx(['font-medium', 'text.text-primary', 'mb-1'])}>{t('workflow-status.timings')}</div>
+          <div className={sx(['flex', 'items-center', 'gap-4', 'mb-2'])}>
+            <div>{t('workflow-status.queue')}: {formatDuration(timings.phases.queue_ms)}</div>
+            <div>{t('workflow-status.load')}: {formatDuration(timings.phases.load_ms)}</div>
+            <div>{t('workflow-status.stages')}: {formatDuration(timings.phases.stages_ms)}</div>
+            <div>{t('workflow-status.save')}: {formatDuration(timings.phases.save_ms)}</div>
+            <div>{t('workflow-status.total')}: {formatDuration(timings.phases.total_ms)}</div>
+          </div>
+          {timings.stages.length > 0 && (
+            <table className={sx(['w-full', 'text-left'])}>
+              <thead>
+                <tr className={sx(['text.text-primary'])}>
+                  <th className={sx(['font-normal'])}>{t('workflow-status.stage')}</th>
+                  <th className={sx(['font-normal', 'text-right'])}>{t('workflow-status.run')}</th>
+                  <th className={sx(['font-normal', 'text-right'])}>{t('workflow-status.wait')}</th>
+                  <th className={sx(['font-normal', 'text-right'])}>{t('workflow-status.runs')}</th>
+                </tr>
+              </thead>
+              <tbody>
+                {timings.stages.map(stage => (
+                  <tr key={stage.name}>
+                    <td>{stage.name}</td>
+                    <td className={sx(['text-right'])} title={`max ${formatDuration(stage.maxMs)}`}>
+                      {stage.runs ? formatDuration(stage.avgMs) : '-'}
+                    </td>
+                    <td className={sx(['text-right'])}>{stage.runs ? formatDuration(stage.avgWaitMs) : '-'}</td>
+                    <td className={sx(['text-right'])}>
+                      {stage.runs}{stage.cached > 0 ? ` (+${stage.cached} ${t('workflow-status.cached')})` : ''}
+                    </td>
+                  </tr>
+                ))}
+              </tbody>
+            </table>
+          )}
+        </div>
+      )}
     </div>
   );
 };
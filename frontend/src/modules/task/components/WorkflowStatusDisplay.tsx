@@ -19,11 +19,11 @@ const WorkflowStatusDisplay: React.FC<WorkflowStatusDisplayProps> = ({ workflowS
       </div>
       <div className="flex justify-between">
         <span className="text-gray-400">已处理任务:</span>
-        <span className="text-white">{workflowStatus.processed_files.length}</span>
+        <span className="text-white">{workflowStatus.processed_count ?? workflowStatus.processed_files.length}</span>
       </div>
       <div className="flex justify-between">
         <span className="text-gray-400">失败任务:</span>
-        <span className="text-white">{workflowStatus.failed_files.length}</span>
+        <span className="text-white">{workflowStatus.failed_count ?? workflowStatus.failed_files.length}</span>
       </div>
       <div className="flex justify-between">
         <span className="text-gray-400">当前队列:</span>
@@ -1,12 +1,13 @@
 import { useState, useCallback, useEffect } from 'react';
 import { Task, WorkflowStatus, FileTypeStats, updateFileTypeStats } from '../utils/utils';
-import { apiService } from '../../../lib/api';
+import { apiService, applyWorkflowEvent, subscribeWorkflowEvents } from '../../../lib/api';
 
 interface TaskWorkflowOptions {
   onTaskCancel?: (taskId: string) => void;
   onTaskRetry?: (taskId: string) => void;
   autoUpdate?: boolean;
-  updateInterval?: number;
+  // 本地保留的最近处理记录数
+  historyLimit?: number;
 }
 
 /**
@@ -21,7 +22,7 @@ export const useTaskWorkflow = (
     onTaskCancel, 
     onTaskRetry, 
     autoUpdate = true, 
-    updateInterval = 1000 
+    historyLimit = 5 
   } = options;
 
   // 任务列表 - 只在初始渲染时使用initialTasks，避免无限循环
@@ -180,16 +181,20 @@ export const useTaskWorkflow = (
     fetchWorkflowStatus();
   }, [fetchWorkflowStatus]);
 
-  // 自动更新工作流状态
+  // 自动更新工作流状态：订阅服务器推送的事件，只传输变化而不是每秒拉取完整历史
   useEffect(() => {
     if (!autoUpdate) return;
 
-    const intervalId = setInterval(() => {
-      fetchWorkflowStatus();
-    }, updateInterval);
-
-    return () => clearInterval(intervalId);
-  }, [autoUpdate, updateInterval, fetchWorkflowStatus]);
+    return subscribeWorkflowEvents((event) => {
+      setWorkflowStatus(prevStatus => {
+        const nextStatus = applyWorkflowEvent(prevStatus, event, historyLimit) as WorkflowStatus;
+        if (nextStatus !== prevStatus) {
+          setFileTypeStats(updateFileTypeStats(nextStatus));
+        }
+        return nextStatus;
+      });
+    }, historyLimit);
+  }, [autoUpdate, historyLimit]);
 
   // 当初始任务变化时更新本地任务列表 - 注释掉这个useEffect以避免无限循环
   // useEffect(() => {
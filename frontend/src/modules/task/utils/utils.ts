@@ -1,3 +1,5 @@
+import type { WorkflowClusterStatus, WorkflowSchedulerStats } from '../../../lib/api';
+
 // 任务接口定义
 export interface Task {
   id: string;
@@ -8,40 +10,63 @@ export interface Task {
   timestamp: number; // 添加时间戳字段，用于显示消息时间
 }
 
+// 单个处理阶段的结果
+export interface WorkflowProcessResult {
+  name: string;
+  status: string;
+  error: string | null;
+  duration_ms?: number; // 运行时间，不含等待槽位
+  wait_ms?: number; // 等待CPU/GPU槽位的时间
+  cached?: boolean;
+}
+
+// 单个文件的处理结果
+export interface WorkflowJobResult {
+  filename: string;
+  status: string;
+  start_time: number;
+  end_time: number | null;
+  processes: WorkflowProcessResult[];
+  error: string | null;
+  // 各阶段耗时（毫秒），旧的历史记录没有此字段
+  timings?: {
+    queue_ms?: number;
+    load_ms?: number;
+    stages_ms?: number;
+    save_ms?: number;
+    total_ms?: number;
+  };
+  bytes_in?: number;
+  bytes_out?: number;
+}
+
 // 工作流状态接口定义
 export interface WorkflowStatus {
   is_running: boolean;
   processing_queue: string[];
-  processed_files: Array<{
-    filename: string;
-    status: string;
-    start_time: number;
-    end_time: number | null;
-    processes: Array<{
-      name: string;
-      status: string;
-      error: string | null;
-    }>;
-    error: string | null;
-  }>;
-  failed_files: Array<{
-    filename: string;
-    status: string;
-    start_time: number;
-    end_time: number | null;
-    processes: Array<{
-      name: string;
-      status: string;
-      error: string | null;
-    }>;
-    error: string | null;
-  }>;
+  processed_files: WorkflowJobResult[];
+  failed_files: WorkflowJobResult[];
   total_files: number;
   success_rate: number;
   batch_config: {
     max_parallel_tasks: number;
     current_running_tasks: number;
   };
+  // 历史总数；事件驱动时 processed_files/failed_files 只包含最近几条
+  processed_count?: number;
+  failed_count?: number;
+  file_type_counts?: Record<string, number>;
+  last_event_id?: number;
+  // 准入调度器：按估算的内存/显存放行任务
+  scheduler?: WorkflowSchedulerStats;
+  // 集群模式：各工作节点和按能力统计的待处理任务
+  cluster?: WorkflowClusterStatus;
+  stage_progress?: Record<string, {
+    stage: string;
+    status: string;
+    completed: number;
+    total: number;
+  }>;
 }
 
 // 文件类型统计接口定义
@@ -124,6 +149,12 @@ export const updateFileTypeStats = (workflowStatus: WorkflowStatus): FileTypeSta
     prp: 0
   };
   
+  // 服务器维护的完整历史统计
+  if (workflowStatus.file_type_counts) {
+    const counts = workflowStatus.file_type_counts;
+    return { chr: counts.chr || 0, ui: counts.ui || 0, env: counts.env || 0, prp: counts.prp || 0 };
+  }
+  
   // 统计已处理文件
   if (workflowStatus.processed_files) {
     workflowStatus.processed_files.forEach(file => {
@@ -155,4 +186,73 @@ export const updateFileTypeStats = (workflowStatus: WorkflowStatus): FileTypeSta
   }
   
   return stats;
-};
\ No newline at end of file
+};
+// 阶段耗时汇总
+export interface StageTimingSummary {
+  name: string;
+  runs: number; // 实际运行次数（不含缓存命中）
+  cached: number;
+  avgMs: number;
+  avgWaitMs: number;
+  maxMs: number;
+}
+
+export interface WorkflowTimingSummary {
+  jobs: number; // 带耗时记录的任务数
+  phases: Record<'queue_ms' | 'load_ms' | 'stages_ms' | 'save_ms' | 'total_ms', number>; // 各阶段平均耗时
+  stages: StageTimingSummary[]; // 按平均耗时从高到低
+}
+
+const TIMING_PHASES = ['queue_ms', 'load_ms', 'stages_ms', 'save_ms', 'total_ms'] as const;
+
+/**
+ * 汇总最近任务的阶段耗时
+ * @param jobs 已处理和失败的任务结果
+ * @returns 各阶段平均耗时和每个处理阶段的统计
+ */
+export const summarizeWorkflowTimings = (jobs: WorkflowJobResult[]): WorkflowTimingSummary => {
+  const phases = { queue_ms: 0, load_ms: 0, stages_ms: 0, save_ms: 0, total_ms: 0 };
+  const stages = new Map<string, { runs: number; cached: number; total: number; wait: number; max: number }>();
+  let timed = 0;
+
+  for (const job of jobs) {
+    if (!job.timings) continue;
+    timed++;
+    TIMING_PHASES.forEach(phase => { phases[phase] += job.timings![phase] ?? 0; });
+    for (const process of job.processes || []) {
+      if (process.duration_ms === undefined) continue;
+      const entry = stages.get(process.name) ?? { runs: 0, cached: 0, total: 0, wait: 0, max: 0 };
+      if (process.cached) {
+        entry.cached++;
+      } else {
+        entry.runs++;
+        entry.total += process.duration_ms;
+        entry.wait += process.wait_ms ?? 0;
+        entry.max = Math.max(entry.max, process.duration_ms);
+      }
+      stages.set(process.name, entry);
+    }
+  }
+
+  if (timed > 0) TIMING_PHASES.forEach(phase => { phases[phase] /= timed; });
+  return {
+    jobs: timed,
+    phases,
+    stages: [...stages.entries()]
+      .map(([name, s]) => ({
+        name,
+        runs: s.runs,
+        cached: s.cached,
+        avgMs: s.runs ? s.total / s.runs : 0,
+        avgWaitMs: s.runs ? s.wait / s.runs : 0,
+        maxMs: s.max
+      }))
+      .sort((a, b) => b.avgMs - a.avgMs)
+  };
+};
+
+/**
+ * 格式化毫秒耗时
+ */
+export const formatDuration = (ms: number): string =>
+  ms >= 1000 ? `${(ms / 1000).toFixed(2)} s` : `${ms.toFixed(ms < 10 ? 1 : 0)} ms`;
@@ -2,26 +2,55 @@
  * 工作流数据访问层
  * 功能：封装工作流相关的API调用与React Query结合，提供统一的数据访问接口
  */
+import { useEffect } from 'react';
 import { useMutation, useQuery, useQueryClient } from '@tanstack/react-query';
-import { apiClient } from '../lib/api';
+import { apiClient, applyWorkflowEvent, subscribeWorkflowEvents } from '../lib/api';
 import { QUERY_KEYS } from '../lib/queryClient';
 import { handleApiError } from '../lib/errorHandler';
 import type { WorkflowStatus, BatchConfig } from '../lib/api';
 
+// 事件驱动状态中保留的最近处理记录数，完整历史通过 /workflow/history 分页获取
+const WORKFLOW_HISTORY_LIMIT = 5;
+
 /**
  * 获取工作流状态查询
+ * 状态由 /workflow/events 推送的事件增量更新，不再定时轮询；断线重连后服务器会补发事件或重新发送快照
  * @returns 工作流状态查询钩子
  */
 export const useWorkflowStatusQuery = () => {
+  const queryClient = useQueryClient();
+
+  useEffect(() => {
+    return subscribeWorkflowEvents((event) => {
+      queryClient.setQueryData<WorkflowStatus | undefined>(
+        [QUERY_KEYS.WORKFLOW_STATUS],
+        (status) => applyWorkflowEvent(status, event, WORKFLOW_HISTORY_LIMIT)
+      );
+    }, WORKFLOW_HISTORY_LIMIT);
+  }, [queryClient]);
+
   return useQuery({
     queryKey: [QUERY_KEYS.WORKFLOW_STATUS],
     queryFn: async (): Promise<WorkflowStatus> => {
       const response = await apiClient.getWorkflowStatus();
       return response;
     },
-    staleTime: 500, // 工作流状态变化较快，缓存时间较短
-    refetchInterval: 1000, // 每秒刷新一次
-    refetchIntervalInBackground: true,
+    staleTime: Infinity, // 由事件流保持最新
+  });
+};
+
+/**
+ * 分页获取工作流历史查询
+ * @param status completed 或 failed
+ * @param page 页码（从0开始）
+ * @param pageSize 每页记录数
+ * @returns 历史查询钩子
+ */
+export const useWorkflowHistoryQuery = (status: 'completed' | 'failed', page: number = 0, pageSize: number = 50) => {
+  return useQuery({
+    queryKey: [QUERY_KEYS.WORKFLOW_STATUS, 'history', status, page, pageSize],
+    queryFn: () => apiClient.getWorkflowHistory(status, page * pageSize, pageSize),
+    staleTime: 5000,
   });
 };
 
@@ -195,7 +224,6 @@ export const useTaskQueueQuery = () => {
       // 模拟任务队列查询，实际应该调用后端API
       return [];
     },
-    staleTime: 1000, // 1秒缓存
-    refetchInterval: 2000, // 每2秒刷新一次
+    staleTime: 1000, // 1秒缓存，由工作流变更使其失效，不再定时轮询
   });
 };
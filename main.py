@@ -8,14 +8,17 @@ Features: Directory monitoring -> Automatic image matting -> Normal map generati
 import os
 import time
 import logging
-from watchdog.observers import Observer
-from watchdog.events import FileSystemEventHandler
+import threading
+from io import BytesIO
 from config import Config
-from modules.segmentation import SAMSegmenter  # SAM2 segmentation module
+from modules.segmentation_engine import get_segmentation_engine  # Shared SAM2 segmentation engine
 from modules.normal_map import NormalMapGenerator
 from modules.image_processing import ImageProcessor
 from modules.naming_resolver import NamingResolver
 from modules.code_sync import CodeSync
+from modules.file_ingest import FileIngestWatcher
+from modules.stage_graph import StageContext, StageGraph, StageExecutor, create_default_registry
+from modules.build_cache import BuildCache
 
 # Configure logging
 logging.basicConfig(
@@ -28,9 +31,9 @@ logging.basicConfig(
 )
 logger = logging.getLogger(__name__)
 
-class ImageProcessingHandler(FileSystemEventHandler):
+class ImageProcessingHandler:
     """
-    Directory monitoring event handler, triggers processing flow when new images are added
+    Directory monitoring handler, triggers processing flow when new images are completely written
     """
     def __init__(self, config):
         self.config = config
@@ -38,10 +41,23 @@ class ImageProcessingHandler(FileSystemEventHandler):
         self.segmenter = None  # SAM2 segmentation module - 延迟加载
         self.normal_generator = None  # Normal map generator - 延迟加载
         self.image_processor = None  # Image processor - 延迟加载
+        self.stage_registry = None  # Stage graph registry - 延迟加载
+        self.stage_executor = StageExecutor(max_workers=os.cpu_count() or 1)
+        # 启用 sam_warmup 时立即创建分割器，模型在后台加载，首个文件无需等待
+        if config.sam_warmup:
+            self.segmenter = get_segmentation_engine(config)
+        self.build_cache = None
+        if config.incremental_build:
+            self.build_cache = BuildCache(config.build_cache_dir, int(config.build_cache_max_mb * 1024 * 1024))
         self.naming_resolver = NamingResolver()
-        self.code_sync = CodeSync(config.output_dir, config.cpp_header_dir, config.compiled_dir)
+        self.code_sync = CodeSync(config.output_dir, config.cpp_header_dir, config.compiled_dir,
+                                  config.live_sync_host, config.live_sync_port, live_sync=config.live_sync)
         # Asset list for generating C++ header files
         self.asset_list = []
+        # Headers/archive are regenerated once per burst of new assets, not per asset
+        self._code_sync_timer = None
+        self._code_sync_lock = threading.Lock()
+        self._synced_assets = 0
         
     def _init_processors(self):
         """
@@ -49,23 +65,32 @@ class ImageProcessingHandler(FileSystemEventHandler):
         """
         if self.segmenter is None:
             print("初始化SAM2分割器...")
-            self.segmenter = SAMSegmenter(self.config)
+            self.segmenter = get_segmentation_engine(self.config)
         if self.normal_generator is None:
             print("初始化法线贴图生成器...")
             self.normal_generator = NormalMapGenerator(self.config)
         if self.image_processor is None:
             print("初始化图像处理处理器...")
             self.image_processor = ImageProcessor(self.config)
+        if self.stage_registry is None:
+            self.stage_registry = create_default_registry(
+                self.image_processor,
+                self.normal_generator,
+                self.segmenter.segment,
+                square_size=self.config.target_size[0]
+            )
+            # Default processing resizes to the configured target size
+            self.stage_registry.register(
+                "default_process",
+                lambda ctx, image: self.image_processor.resize(image, self.config.target_size),
+                params={"size": list(self.config.target_size)}
+            )
     
-    def on_created(self, event):
-        """Called when a new file is created"""
-        if not event.is_directory:
-            file_path = event.src_path
-            if self._is_supported_image(file_path):
-                logger.info(f"New image file detected: {file_path}")
-                # Add delay to wait for file to be completely written to disk
-                time.sleep(0.5)
-                self._process_image(file_path)
+    def on_file_ready(self, file_path):
+        """Called by the ingest watcher once a new file has finished being written"""
+        if self._is_supported_image(file_path):
+            logger.info(f"New image file detected: {file_path}")
+            self._process_image(file_path)
     
     def _is_supported_image(self, file_path):
         """Check if file is a supported image format"""
@@ -87,73 +112,33 @@ class ImageProcessingHandler(FileSystemEventHandler):
             resource_info = self.naming_resolver.resolve(base_name)
             logger.info(f"Resolved resource info from filename: {base_name} -> Type: {resource_info['resource_type']}, Processes: {resource_info['processes']}")
             
-            # 3. Load original image
-            original_image = self.image_processor.load_image(file_path)
+            # 3. Load original image (hashed for the incremental build cache)
+            with open(file_path, 'rb') as f:
+                source_data = f.read()
+            source_key = BuildCache.source_key(source_data)
+            original_image = self.image_processor.load_image(BytesIO(source_data))
             if original_image is None:
                 logger.error(f"Failed to load image: {file_path}")
                 return
             
-            # 4. Perform segmentation using SAM2
-            logger.info(f"Performing segmentation using SAM2: {file_path}")
-            processed_image = self.segmenter.segment(file_path)
-            if processed_image is None:
+            # 4. Build the stage graph; segmentation always runs first and only once
+            processes = ["segment"] + [p for p in resource_info['processes'] if p != "segment"]
+            if self.config.texture_export:
+                processes.append("export_textures")
+            graph = StageGraph(self.stage_registry, processes)
+            
+            # 5. Execute processing workflow, images stay in memory between stages
+            context = StageContext(base_name, file_path, self.config.output_dir, name_without_ext,
+                                   naming={"normal": "_normal"})
+            processed_image, step_results = self.stage_executor.run(
+                graph, context, original_image, self.build_cache, source_key
+            )
+            if step_results[0]["status"] != "completed":
                 logger.error(f"Segmentation failed: {file_path}")
                 return
-            
-            # 5. Execute processing workflow
-            executed_steps = []
-            
-            for step in resource_info['processes']:
-                try:
-                    logger.info(f"Executing step: {step}")
-                    executed_steps.append(step)
-                    
-                    if step == "segment":
-                        # Segmentation processing using SAM2
-                        logger.info(f"Performing segmentation using SAM2")
-                        processed_image = self.segmenter.segment(file_path)
-                    elif step == "align_bottom":
-                        # Align to bottom
-                        processed_image = self.image_processor.align_bottom(processed_image)
-                    elif step == "generate_shadow":
-                        # Generate shadow
-                        processed_image = self.image_processor.generate_shadow(processed_image)
-                    elif step == "resize_square":
-                        # Square resize
-                        target_size = self.config.target_size[0]  # Assuming square
-                        processed_image = self.image_processor.resize_square(processed_image, target_size)
-                    elif step == "sharpen":
-                        # Sharpen edges
-                        processed_image = self.image_processor.sharpen(processed_image)
-                    elif step == "make_seamless":
-                        # Make seamless
-                        processed_image = self.image_processor.make_seamless(processed_image)
-                    elif step == "gen_pbr":
-                        # Generate PBR maps (only normal map for now)
-                        logger.info(f"Generating normal map")
-                        normal_map = self.normal_generator.generate(file_path)
-                        if normal_map is not None:
-                            normal_path = os.path.join(self.config.output_dir, f"{name_without_ext}_normal.png")
-                            self.image_processor.save_image(normal_map, normal_path)
-                            logger.info(f"Normal map generated, saved to: {normal_path}")
-                    elif step == "gen_lod":
-                        # Generate LODs
-                        logger.info(f"Generating LODs")
-                        lods = self.image_processor.gen_lod(processed_image)
-                        for i, lod_image in enumerate(lods):
-                            lod_path = os.path.join(self.config.output_dir, f"{name_without_ext}_lod{i}.png")
-                            self.image_processor.save_image(lod_image, lod_path)
-                            logger.info(f"LOD {i} generated, saved to: {lod_path}")
-                    elif step == "box_collision":
-                        # Generate collision box
-                        collision_box = self.image_processor.box_collision(processed_image)
-                        logger.info(f"Collision box generated: {collision_box}")
-                    elif step == "default_process":
-                        # Default processing
-                        logger.info(f"Executing default process")
-                        processed_image = self.image_processor.resize(processed_image, self.config.target_size)
-                except Exception as step_error:
-                    logger.error(f"Failed to execute step {step}: {str(step_error)}")
+            executed_steps = [step["name"] for step in step_results]
+            for step in step_results:
+                logger.info(f"Step {step['name']}: {step['status']} ({step['duration_ms']:.1f} ms)")
             
             # 6. Save original image copy
             original_copy_path = os.path.join(self.config.output_dir, f"{name_without_ext}_original.png")
@@ -177,23 +162,64 @@ class ImageProcessingHandler(FileSystemEventHandler):
                 asset_name=name_without_ext,
                 original_path=file_path,
                 prompt="",
-                process_steps=executed_steps
+                process_steps=executed_steps,
+                fingerprint=BuildCache.combine(self.stage_executor.stage_keys(graph, context, source_key))
             )
             logger.info(f"Asset metadata generated: {metadata_path}")
             
             # 11. Add to asset list for C++ header generation
             if name_without_ext not in self.asset_list:
                 self.asset_list.append(name_without_ext)
-                # Update C++ header files
-                header_paths = self.code_sync.generate_cpp_header(self.asset_list)
-                for path in header_paths:
-                    logger.info(f"C++ header file updated: {path}")
+            # Archive mode repacks on any rebuilt output, header mode only on new names
+            if self.config.compiled_output == "archive" or len(self.asset_list) != self._synced_assets:
+                self.schedule_code_sync()
+            
+            # 12. Push the new outputs to the running game right away, the header stays debounced
+            if self.config.live_sync:
+                sent = self.code_sync.sync_live([name_without_ext])
+                if sent.get("full") or sent.get("delta"):
+                    logger.info(f"Live sync: {sent['full']} full, {sent['delta']} delta, {sent['bytes']} bytes sent")
             
             logger.info(f"Image processing workflow completed: {file_path}")
             
         except Exception as e:
             logger.error(f"Error processing image: {file_path}, Error: {str(e)}")
 
+    def schedule_code_sync(self):
+        """
+        Regenerate C++ outputs after a quiet period
+        """
+        with self._code_sync_lock:
+            if self._code_sync_timer is not None:
+                self._code_sync_timer.cancel()
+            self._code_sync_timer = threading.Timer(self.config.code_sync_debounce_ms / 1000.0, self.flush_code_sync)
+            self._code_sync_timer.daemon = True
+            self._code_sync_timer.start()
+    
+    def flush_code_sync(self):
+        """
+        Write AssetIDs.h, or in archive mode the packed archive plus its reader header
+        """
+        with self._code_sync_lock:
+            if self._code_sync_timer is not None:
+                self._code_sync_timer.cancel()
+                self._code_sync_timer = None
+            asset_list = list(self.asset_list)
+        if not asset_list:
+            return
+        try:
+            if self.config.compiled_output == "archive":
+                result = self.code_sync.build_archive(asset_list, self.config.archive_name)
+                logger.info(f"Asset archive updated: {result['archive_path']} ({len(result['entries'])} entries)")
+                header_paths = result["headers"]
+            else:
+                header_paths = self.code_sync.generate_cpp_header(asset_list)
+            self._synced_assets = len(asset_list)
+            for path in header_paths:
+                logger.info(f"C++ header file updated: {path}")
+        except Exception as e:
+            logger.error(f"Failed to update C++ outputs: {str(e)}")
+
 def main():
     """Main function, starts the pipeline"""
     # Load configuration
@@ -211,21 +237,25 @@ def main():
     # Create event handler
     event_handler = ImageProcessingHandler(config)
     
-    # Create observer
-    observer = Observer()
-    observer.schedule(event_handler, config.watch_dir, recursive=False)
+    # Create watcher, files are reported once their size stops changing
+    watcher = FileIngestWatcher(
+        config.watch_dir,
+        event_handler.on_file_ready,
+        settle_seconds=config.ingest_settle_ms / 1000.0,
+        scan_existing=False
+    )
     
-    # Start observer
-    observer.start()
+    # Start watcher
+    watcher.start()
     
     try:
         while True:
             time.sleep(1)
     except KeyboardInterrupt:
-        observer.stop()
         logger.info("AmberPipeline AI stopped")
     
-    observer.join()
+    watcher.stop()
+    event_handler.flush_code_sync()
 
 def start_gui():
     """
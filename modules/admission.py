@@ -0,0 +1,365 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Admission Scheduler
+Estimates the RAM / VRAM / time cost of a workflow job from its image size and process list,
+and admits jobs against live device budgets: small jobs are packed together, large jobs wait
+for room instead of running out of memory
+"""
+
+import sys
+import time
+import threading
+import contextlib
+import logging
+from typing import Dict, Any, List, Optional
+from PIL import Image
+
+from modules import metrics
+
+logger = logging.getLogger(__name__)
+
+MB = 1024 * 1024
+
+# Per-process cost: working-set bytes per pixel in RAM and on the GPU, and CPU/GPU seconds per megapixel
+# Working sets are the temporaries a stage allocates on top of its input image. These are rough
+# upper estimates, recalibrate against peak_rss_mb / peak_vram_mb from backend/benchmark.py
+PROCESS_COSTS = {
+    "segment":         {"ram": 16, "vram": 8,  "seconds_per_mp": 0.02, "seconds": 0.15},
+    "align_bottom":    {"ram": 8,  "vram": 0,  "seconds_per_mp": 0.01},
+    "generate_shadow": {"ram": 24, "vram": 0,  "seconds_per_mp": 0.08},
+    "resize_square":   {"ram": 8,  "vram": 0,  "seconds_per_mp": 0.02},
+    "sharpen":         {"ram": 16, "vram": 0,  "seconds_per_mp": 0.04},
+    "make_seamless":   {"ram": 24, "vram": 0,  "seconds_per_mp": 0.06},
+    "gen_pbr":         {"ram": 40, "vram": 0,  "seconds_per_mp": 0.15},
+    "gen_lod":         {"ram": 6,  "vram": 0,  "seconds_per_mp": 0.03},
+    "export_textures": {"ram": 12, "vram": 0,  "seconds_per_mp": 0.60},
+    "box_collision":   {"ram": 4,  "vram": 0,  "seconds_per_mp": 0.01},
+    "default_process": {"ram": 4,  "vram": 0,  "seconds_per_mp": 0.01},
+    # Inpainting is not a naming-convention process, used by InpaintingProcessor.estimate_cost
+    "inpaint_telea":   {"ram": 12, "vram": 0,  "seconds_per_mp": 1.0},
+    "inpaint_ns":      {"ram": 12, "vram": 0,  "seconds_per_mp": 2.0},
+    "inpaint_lama":    {"ram": 16, "vram": 48, "seconds_per_mp": 10.0, "vram_fixed_mb": 600}
+}
+UNKNOWN_PROCESS_COST = {"ram": 16, "vram": 0, "seconds_per_mp": 0.05}
+
+# SAM2 image encoder activations at its fixed 1024x1024 input, per image in flight
+SAM_ACTIVATION_MB = {"fp32": 1200, "fp16": 600, "bf16": 600}
+
+# Decoded source, PNG encode buffer and the image handed between stages
+BASE_BYTES_PER_PIXEL = 12
+# Processes that replace the working image with a fixed-size square
+RESIZING_PROCESSES = ("resize_square",)
+
+SCHEDULER_RUNNING = metrics.gauge("amber_scheduler_running_jobs", "Jobs admitted by the scheduler")
+SCHEDULER_WAITING = metrics.gauge("amber_scheduler_waiting_jobs", "Jobs waiting for admission")
+SCHEDULER_RESERVED = metrics.gauge("amber_scheduler_reserved_bytes", "Estimated bytes reserved by admitted jobs",
+                                   ["device"])
+SCHEDULER_WAIT_SECONDS = metrics.histogram("amber_scheduler_admission_wait_seconds", "Time a job waited for admission")
+
+
+class JobCost:
+    """Estimated peak resource use of one job"""
+
+    __slots__ = ("ram_bytes", "vram_bytes", "seconds", "width", "height", "tiled")
+
+    def __init__(self, ram_bytes: int = 0, vram_bytes: int = 0, seconds: float = 0.0,
+                 width: int = 0, height: int = 0, tiled: bool = False):
+        self.ram_bytes = int(ram_bytes)
+        self.vram_bytes = int(vram_bytes)
+        self.seconds = float(seconds)
+        self.width = width
+        self.height = height
+        self.tiled = tiled
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {
+            "ram_mb": round(self.ram_bytes / MB, 1),
+            "vram_mb": round(self.vram_bytes / MB, 1),
+            "seconds": round(self.seconds, 3),
+            "width": self.width,
+            "height": self.height,
+            "tiled": self.tiled
+        }
+
+
+class CostModel:
+    """
+    Estimates job cost from image dimensions and the resolved process list
+    """
+
+    def __init__(self, config, stage_kinds: Dict[str, str] = None, use_gpu: bool = None):
+        """
+        Args:
+            config: Configuration object
+            stage_kinds: Optional stage name -> "transform" / "sink"; transform outputs stay
+                         in memory until the job ends, so they add to the peak
+            use_gpu: Whether GPU stages run on CUDA (default: from sam_device)
+        """
+        self.config = config
+        self.stage_kinds = stage_kinds or {}
+        self.square_size = 512
+        self.tiled_budget_bytes = max(16, int(getattr(config, "tiled_memory_mb", 512))) * MB
+        precision = getattr(config, "sam_precision", "fp32")
+        self.sam_activation_bytes = SAM_ACTIVATION_MB.get(precision, SAM_ACTIVATION_MB["fp32"]) * MB
+        if use_gpu is None:
+            use_gpu = str(getattr(config, "sam_device", "cpu")).startswith("cuda")
+        self.use_gpu = use_gpu
+
+    def estimate(self, width: int, height: int, processes: List[str], tiled: bool = False) -> JobCost:
+        """
+        Estimate the peak cost of a job
+
+        Args:
+            width: Source width
+            height: Source height
+            processes: Resolved process list
+            tiled: Job runs out of core (RAM is bounded by tiled_memory_mb)
+
+        Returns:
+            JobCost
+        """
+        pixels = width * height
+        ram = BASE_BYTES_PER_PIXEL * pixels
+        peak_stage_ram = 0
+        vram = 0
+        seconds = 0.0
+        for name in processes:
+            cost = PROCESS_COSTS.get(name, UNKNOWN_PROCESS_COST)
+            peak_stage_ram = max(peak_stage_ram, cost["ram"] * pixels)
+            vram = max(vram, cost["vram"] * pixels + cost.get("vram_fixed_mb", 0) * MB)
+            if name == "segment":
+                vram = max(vram, cost["vram"] * pixels + self.sam_activation_bytes)
+            seconds += cost.get("seconds", 0.0) + cost["seconds_per_mp"] * pixels / 1e6
+            if self.stage_kinds.get(name, "transform") == "transform":
+                # Each transform output is kept for dependent stages
+                ram += 4 * pixels
+            if name in RESIZING_PROCESSES:
+                pixels = self.square_size * self.square_size
+        ram += peak_stage_ram
+
+        if tiled:
+            # Source and output stream through disk, stages work in bands of the tiled budget
+            ram = min(ram, 2 * self.tiled_budget_bytes)
+        if not self.use_gpu:
+            # CPU inference: the encoder activations live in RAM instead
+            ram += vram
+            vram = 0
+        return JobCost(ram, vram, seconds, width, height, tiled)
+
+    def estimate_file(self, path: str, processes: List[str], tiled: bool = False) -> JobCost:
+        """
+        Estimate from an image file, only the header is read
+        """
+        try:
+            with Image.open(path) as image:
+                width, height = image.size
+        except Exception:
+            width = height = 0
+        return self.estimate(width, height, processes, tiled)
+
+
+def available_ram_bytes() -> Optional[int]:
+    """
+    Memory the OS can hand out without swapping (MemAvailable), None if unknown
+    """
+    try:
+        with open("/proc/meminfo") as f:
+            for line in f:
+                if line.startswith("MemAvailable:"):
+                    return int(line.split()[1]) * 1024
+    except OSError:
+        pass
+    try:
+        import psutil
+        return psutil.virtual_memory().available
+    except ImportError:
+        return None
+
+
+def cuda_memory_bytes() -> Optional[tuple]:
+    """
+    (free, total) bytes of the current CUDA device, None without a loaded torch or GPU
+    Never imports torch itself, so CPU-only setups stay lightweight
+    """
+    torch = sys.modules.get("torch")
+    if torch is None:
+        return None
+    try:
+        if not torch.cuda.is_available():
+            return None
+        return torch.cuda.mem_get_info()
+    except Exception:
+        return None
+
+
+class _Ticket:
+    __slots__ = ("name", "cost", "queued", "bypassed")
+
+    def __init__(self, name: str, cost: JobCost):
+        self.name = name
+        self.cost = cost
+        self.queued = time.monotonic()
+        self.bypassed = 0
+
+
+class AdmissionScheduler:
+    """
+    Admits jobs while their summed estimates fit the RAM and VRAM budgets
+
+    Waiting jobs are considered in arrival order, but a later job that fits may be admitted
+    ahead of an earlier one that does not (packing). A job bypassed for longer than
+    max_defer_seconds stops further packing until it has run, so large jobs are not starved.
+    A job that is larger than the whole budget runs on its own instead of failing.
+    """
+
+    def __init__(self, config, max_jobs: int = 4):
+        """
+        Args:
+            config: Configuration object (workflow_memory_budget_mb, workflow_vram_budget_mb,
+                    workflow_max_defer_seconds)
+            max_jobs: Upper bound on concurrently admitted jobs
+        """
+        self.max_jobs = max(1, int(max_jobs))
+        self.max_defer_seconds = float(getattr(config, "workflow_max_defer_seconds", 30.0))
+        self.poll_interval = 0.5  # Live device readings are refreshed this often while jobs wait
+
+        configured_ram = int(getattr(config, "workflow_memory_budget_mb", 0)) * MB
+        if configured_ram <= 0:
+            # Auto: most of what is free now, the rest is left to the server and the OS
+            available = available_ram_bytes()
+            configured_ram = int(available * 0.8) if available else 8 * 1024 * MB
+        self.ram_budget = configured_ram
+        self._configured_vram = int(getattr(config, "workflow_vram_budget_mb", 0)) * MB
+        self._vram_budget = None
+
+        self._condition = threading.Condition()
+        self._waiting: List[_Ticket] = []
+        self._running: Dict[int, _Ticket] = {}
+        self.reserved_ram = 0
+        self.reserved_vram = 0
+        self.admitted = 0
+        self.deferred = 0  # Admissions that had to wait for budget
+
+    @property
+    def vram_budget(self) -> Optional[int]:
+        """
+        VRAM budget in bytes, None while no GPU is visible (VRAM is then not limited)
+        Auto mode measures once the models are on the device, so resident weights are excluded
+        """
+        if self._configured_vram > 0:
+            return self._configured_vram
+        if self._vram_budget is None:
+            memory = cuda_memory_bytes()
+            if memory is None:
+                return None
+            free, total = memory
+            self._vram_budget = int(min(free, total * 0.9))
+        return self._vram_budget
+
+    def set_max_jobs(self, max_jobs: int):
+        with self._condition:
+            self.max_jobs = max(1, int(max_jobs))
+            self._condition.notify_all()
+
+    @contextlib.contextmanager
+    def admit(self, name: str, cost: JobCost):
+        """
+        Block until the job fits, hold its reservation for the duration of the block
+
+        Args:
+            name: Job name (for logs and stats)
+            cost: Estimated cost
+        """
+        ticket = _Ticket(name, cost)
+        with self._condition:
+            self._waiting.append(ticket)
+            SCHEDULER_WAITING.set(len(self._waiting))
+            waited = False
+            while not self._can_admit(ticket):
+                if not waited:
+                    waited = True
+                    self.deferred += 1
+                    logger.info(f"Deferring {name}: needs {cost.ram_bytes // MB} MB RAM / "
+                                f"{cost.vram_bytes // MB} MB VRAM, reserved {self.reserved_ram // MB} / "
+                                f"{self.reserved_vram // MB} MB")
+                self._condition.wait(timeout=self.poll_interval)
+            self._waiting.remove(ticket)
+            # Jobs ahead of this one were bypassed
+            for other in self._waiting:
+                if other.queued < ticket.queued:
+                    other.bypassed += 1
+            self._running[id(ticket)] = ticket
+            self.reserved_ram += cost.ram_bytes
+            self.reserved_vram += cost.vram_bytes
+            self.admitted += 1
+            self._update_gauges()
+        SCHEDULER_WAIT_SECONDS.observe(time.monotonic() - ticket.queued)
+        try:
+            yield ticket
+        finally:
+            with self._condition:
+                self._running.pop(id(ticket), None)
+                self.reserved_ram -= cost.ram_bytes
+                self.reserved_vram -= cost.vram_bytes
+                self._update_gauges()
+                self._condition.notify_all()
+
+    def _can_admit(self, ticket: _Ticket) -> bool:
+        """
+        Admission rule, called with the condition held
+        """
+        if len(self._running) >= self.max_jobs:
+            return False
+        # A starving earlier job blocks packing until it has been admitted
+        now = time.monotonic()
+        for other in self._waiting:
+            if other is ticket:
+                break
+            if now - other.queued > self.max_defer_seconds and other.bypassed > 0:
+                return False
+        if not self._running:
+            # Nothing else running: even an over-budget job goes, alone
+            return True
+        cost = ticket.cost
+        if self.reserved_ram + cost.ram_bytes > self.ram_budget:
+            return False
+        live_ram = available_ram_bytes()
+        if live_ram is not None and cost.ram_bytes > live_ram:
+            return False
+        if cost.vram_bytes:
+            vram_budget = self.vram_budget
+            if vram_budget is not None:
+                if self.reserved_vram + cost.vram_bytes > vram_budget:
+                    return False
+                memory = cuda_memory_bytes()
+                if memory is not None and cost.vram_bytes > memory[0]:
+                    return False
+        return True
+
+    def _update_gauges(self):
+        SCHEDULER_RUNNING.set(len(self._running))
+        SCHEDULER_WAITING.set(len(self._waiting))
+        SCHEDULER_RESERVED.set(self.reserved_ram, device="ram")
+        SCHEDULER_RESERVED.set(self.reserved_vram, device="vram")
+
+    def get_stats(self) -> Dict[str, Any]:
+        """
+        Get scheduler state
+
+        Returns:
+            Budgets, reservations, and the running and waiting jobs with their estimates
+        """
+        vram_budget = self.vram_budget
+        with self._condition:
+            return {
+                "max_jobs": self.max_jobs,
+                "ram_budget_mb": round(self.ram_budget / MB, 1),
+                "vram_budget_mb": round(vram_budget / MB, 1) if vram_budget is not None else None,
+                "reserved_ram_mb": round(self.reserved_ram / MB, 1),
+                "reserved_vram_mb": round(self.reserved_vram / MB, 1),
+                "admitted": self.admitted,
+                "deferred": self.deferred,
+                "running": [dict(name=t.name, **t.cost.to_dict()) for t in self._running.values()],
+                "waiting": [dict(name=t.name, waited_s=round(time.monotonic() - t.queued, 1), **t.cost.to_dict())
+                            for t in self._waiting]
+            }
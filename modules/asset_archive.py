@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Packed Asset Archive
+Packs processed assets into one memory-mappable file: a fixed header, an ID-sorted
+entry table and page-aligned blobs, read by the generated C++ Assets::Archive
+"""
+
+import os
+import mmap
+import bisect
+import shutil
+import struct
+from typing import Dict, Iterable, List, Optional, Tuple
+
+ARCHIVE_MAGIC = b"AMBP"
+ARCHIVE_VERSION = 1
+ARCHIVE_ALIGNMENT = 4096
+
+# magic, version, entry count, blob alignment, table offset, file size
+HEADER_FORMAT = "<4s3I2Q"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+# id, format, offset, size, name offset, name length
+ENTRY_FORMAT = "<2I2Q2I"
+ENTRY_SIZE = struct.calcsize(ENTRY_FORMAT)
+
+# Asset formats, mirrored by Assets::Format in the generated reader
+ASSET_FORMATS = {
+    ".bin": 0,
+    ".png": 1,
+    ".dds": 2,
+    ".ktx2": 3,
+    ".json": 4
+}
+
+# Preferred file when several share a name: GPU-ready containers first
+_FORMAT_PRIORITY = {".ktx2": 0, ".dds": 1, ".png": 2, ".json": 3}
+
+_FNV_OFFSET = 0x811c9dc5
+_FNV_PRIME = 0x01000193
+
+
+def asset_id(name: str) -> int:
+    """
+    Stable 32-bit asset ID: FNV-1a of the upper-cased name
+    Matches Assets::Id() in the generated headers, so IDs never depend on processing order
+
+    Args:
+        name: Asset name without extension, e.g. UI_Amber_01_BC
+
+    Returns:
+        32-bit ID
+    """
+    value = _FNV_OFFSET
+    for byte in name.upper().encode("utf-8"):
+        value = ((value ^ byte) * _FNV_PRIME) & 0xffffffff
+    return value
+
+
+def collect_asset_files(output_dir: str, asset_names: Iterable[str],
+                        exclude_suffixes: Tuple[str, ...] = ("_original", "_metadata")) -> Dict[str, str]:
+    """
+    Find the output files belonging to each asset
+
+    Args:
+        output_dir: Directory holding processed outputs
+        asset_names: Asset names (file stems of the sources)
+        exclude_suffixes: Stem suffixes that are never packed
+
+    Returns:
+        Dictionary of entry name (file stem) -> file path
+    """
+    names = sorted(set(asset_names), key=len, reverse=True)
+    files: Dict[str, str] = {}
+    for filename in sorted(os.listdir(output_dir)):
+        stem, extension = os.path.splitext(filename)
+        extension = extension.lower()
+        if extension not in ASSET_FORMATS or stem.endswith(exclude_suffixes):
+            continue
+        if not any(stem == name or stem.startswith(name + "_") for name in names):
+            continue
+
+        current = files.get(stem)
+        if current is not None:
+            current_extension = os.path.splitext(current)[1].lower()
+            if _FORMAT_PRIORITY.get(current_extension, 9) <= _FORMAT_PRIORITY.get(extension, 9):
+                continue
+        files[stem] = os.path.join(output_dir, filename)
+    return files
+
+
+def write_archive(path: str, files: Dict[str, str], alignment: int = ARCHIVE_ALIGNMENT) -> List[Dict]:
+    """
+    Write a packed archive
+
+    Args:
+        path: Output archive path
+        files: Dictionary of entry name -> source file path
+        alignment: Alignment of each blob (page size, so blobs can be mapped directly)
+
+    Returns:
+        List of entries (name, id, format, offset, size) sorted by ID
+
+    Raises:
+        ValueError: Two names hash to the same ID
+    """
+    entries = []
+    by_id: Dict[int, str] = {}
+    for name, file_path in files.items():
+        entry_id = asset_id(name)
+        if entry_id in by_id:
+            raise ValueError(f"Asset ID collision: {name} and {by_id[entry_id]} both hash to {entry_id:#010x}")
+        by_id[entry_id] = name
+        entries.append({
+            "name": name,
+            "id": entry_id,
+            "format": ASSET_FORMATS.get(os.path.splitext(file_path)[1].lower(), 0),
+            "path": file_path,
+            "size": os.path.getsize(file_path)
+        })
+    entries.sort(key=lambda entry: entry["id"])
+
+    # Layout: header, table, names, then page-aligned blobs
+    names_offset = HEADER_SIZE + ENTRY_SIZE * len(entries)
+    name_bytes = b""
+    for entry in entries:
+        encoded = entry["name"].encode("utf-8")
+        entry["name_offset"] = names_offset + len(name_bytes)
+        entry["name_length"] = len(encoded)
+        name_bytes += encoded + b"\0"
+
+    cursor = names_offset + len(name_bytes)
+    for entry in entries:
+        cursor = _align(cursor, alignment)
+        entry["offset"] = cursor
+        cursor += entry["size"]
+    file_size = _align(cursor, alignment)
+
+    os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+    temp_path = f"{path}.tmp"
+    with open(temp_path, "wb") as f:
+        f.write(struct.pack(HEADER_FORMAT, ARCHIVE_MAGIC, ARCHIVE_VERSION, len(entries), alignment,
+                            HEADER_SIZE, file_size))
+        for entry in entries:
+            f.write(struct.pack(ENTRY_FORMAT, entry["id"], entry["format"], entry["offset"], entry["size"],
+                                entry["name_offset"], entry["name_length"]))
+        f.write(name_bytes)
+        for entry in entries:
+            f.write(b"\0" * (entry["offset"] - f.tell()))
+            with open(entry["path"], "rb") as source:
+                shutil.copyfileobj(source, f, 1024 * 1024)
+        f.write(b"\0" * (file_size - f.tell()))
+    os.replace(temp_path, path)
+
+    return [{key: entry[key] for key in ("name", "id", "format", "offset", "size")} for entry in entries]
+
+
+class AssetArchiveReader:
+    """
+    Memory-mapped archive reader, the Python counterpart of Assets::Archive
+    """
+
+    def __init__(self, path: str):
+        """
+        Map an archive
+
+        Args:
+            path: Archive path
+
+        Raises:
+            ValueError: Not a valid archive
+        """
+        self._file = open(path, "rb")
+        self._map = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version, count, _, table_offset, file_size = struct.unpack_from(HEADER_FORMAT, self._map, 0)
+        if magic != ARCHIVE_MAGIC or version != ARCHIVE_VERSION or file_size > len(self._map):
+            self.close()
+            raise ValueError(f"Not a valid asset archive: {path}")
+        self._ids = []
+        self._entries = []
+        for i in range(count):
+            entry = struct.unpack_from(ENTRY_FORMAT, self._map, table_offset + i * ENTRY_SIZE)
+            self._ids.append(entry[0])
+            self._entries.append(entry)
+
+    def __len__(self) -> int:
+        return len(self._entries)
+
+    def names(self) -> List[str]:
+        return [bytes(self._map[e[4]:e[4] + e[5]]).decode("utf-8") for e in self._entries]
+
+    def get(self, key) -> Optional[memoryview]:
+        """
+        Zero-copy view of an asset
+
+        Args:
+            key: Asset ID or name
+
+        Returns:
+            memoryview over the mapped blob, or None if absent
+        """
+        entry_id = asset_id(key) if isinstance(key, str) else key
+        index = bisect.bisect_left(self._ids, entry_id)
+        if index == len(self._ids) or self._ids[index] != entry_id:
+            return None
+        _, _, offset, size, _, _ = self._entries[index]
+        return memoryview(self._map)[offset:offset + size]
+
+    def close(self):
+        if self._map is not None:
+            self._map.close()
+            self._map = None
+        if self._file is not None:
+            self._file.close()
+            self._file = None
+
+
+def _align(value: int, alignment: int) -> int:
+    return (value + alignment - 1) // alignment * alignment
@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Multi-Process Batch Engine
+Runs ImageProcessor operations in worker processes so numpy/PIL code that holds the GIL
+scales with cores. Workers decode their own inputs from disk and write results into
+per-worker shared memory slots, so pixels are never pickled between processes.
+"""
+
+import os
+import time
+import pickle
+import types
+import logging
+import multiprocessing
+import concurrent.futures
+from multiprocessing import shared_memory
+from typing import Any, Callable, Dict, List, Tuple
+import numpy as np
+from PIL import Image
+
+logger = logging.getLogger(__name__)
+
+# Result modes copied through shared memory; anything else comes back pickled
+_SHARED_MODES = {"RGBA": 4, "RGB": 3, "L": 1}
+
+# Per-process state of a worker
+_worker_processor = None
+_worker_slots: Dict[str, shared_memory.SharedMemory] = {}
+
+
+def _attach_slot(name: str) -> shared_memory.SharedMemory:
+    """
+    Attach to a parent-owned slot, kept open for the worker's lifetime
+    Workers share the parent's resource tracker, so the parent's unlink covers every attachment
+    """
+    slot = _worker_slots.get(name)
+    if slot is None:
+        slot = shared_memory.SharedMemory(name=name)
+        _worker_slots[name] = slot
+    return slot
+
+
+def _worker_init(config_values: Dict[str, Any]):
+    global _worker_processor
+    from modules.image_processing import ImageProcessor
+    _worker_processor = ImageProcessor(types.SimpleNamespace(**config_values))
+    # Each worker is one core; nested thread pools would oversubscribe
+    _worker_processor.batch_backend = "thread"
+
+
+def _worker_run(path: str, operation, kwargs: Dict[str, Any], slot_name: str) -> Tuple:
+    """
+    Load, process and publish one image
+
+    Returns:
+        (kind, payload, timings): kind "shared" with (mode, width, height) when the result
+        is in the slot, "object" with the result itself otherwise, or "none" on failure
+    """
+    started = time.perf_counter()
+    image = _worker_processor.load_image(path)
+    if image is None:
+        return "none", None, {}
+    loaded = time.perf_counter()
+
+    func = getattr(_worker_processor, operation) if isinstance(operation, str) else operation
+    try:
+        result = func(image, **kwargs)
+    except Exception as e:
+        print(f"Error processing image {path}: {str(e)}")
+        return "none", None, {}
+    processed = time.perf_counter()
+
+    timings = {
+        "decode_ms": (loaded - started) * 1000.0,
+        "process_ms": (processed - loaded) * 1000.0,
+        "width": image.width,
+        "height": image.height
+    }
+    if isinstance(result, Image.Image) and result.mode in _SHARED_MODES:
+        channels = _SHARED_MODES[result.mode]
+        slot = _attach_slot(slot_name)
+        size = result.width * result.height * channels
+        if size <= slot.size:
+            shape = (result.height, result.width, channels) if channels > 1 else (result.height, result.width)
+            np.ndarray(shape, dtype=np.uint8, buffer=slot.buf)[...] = np.asarray(result)
+            timings["copy_ms"] = (time.perf_counter() - processed) * 1000.0
+            return "shared", (result.mode, result.width, result.height), timings
+        timings["oversize"] = True
+    return "object", result, timings
+
+
+class BatchEngine:
+    """
+    Process pool with two shared memory result slots per worker
+    """
+
+    def __init__(self, config, workers: int = 0, worker_memory_mb: int = 256):
+        """
+        Start the pool
+
+        Args:
+            config: Configuration object, its plain attributes are forwarded to the workers
+            workers: Worker processes (0 = CPU count)
+            worker_memory_mb: Shared memory per worker, split into two result slots so a worker
+                never waits for the parent to copy out; larger results fall back to pickling
+        """
+        self.workers = workers or os.cpu_count() or 1
+        self.slot_size = max(1, int(worker_memory_mb)) * 1024 * 1024 // 2
+        config_values = {
+            key: value for key, value in vars(config).items()
+            if isinstance(value, (str, int, float, bool, type(None), list, tuple, dict))
+        }
+
+        # Workers only run numpy/PIL code; forkserver/spawn avoid forking the caller's threads
+        methods = multiprocessing.get_all_start_methods()
+        context = multiprocessing.get_context("forkserver" if "forkserver" in methods else "spawn")
+        self._pool = concurrent.futures.ProcessPoolExecutor(
+            max_workers=self.workers, mp_context=context,
+            initializer=_worker_init, initargs=(config_values,)
+        )
+        self._slots = [shared_memory.SharedMemory(create=True, size=self.slot_size) for _ in range(self.workers * 2)]
+        logger.info(f"Batch engine started: {self.workers} worker(s), {worker_memory_mb} MB shared memory per worker")
+
+    @staticmethod
+    def resolve(process_func: Callable):
+        """
+        Translate a processing function into something a worker can run
+
+        Args:
+            process_func: Bound ImageProcessor method, or a picklable module-level function
+
+        Returns:
+            Method name, the function itself, or None if it cannot be sent to a process
+        """
+        owner = getattr(process_func, "__self__", None)
+        if owner is not None and type(owner).__name__ == "ImageProcessor":
+            return process_func.__name__
+        try:
+            pickle.dumps(process_func)
+            return process_func
+        except Exception:
+            return None
+
+    def run(self, image_paths: List[str], operation, kwargs: Dict[str, Any]) -> Tuple[Dict[str, Any], Dict[str, Any]]:
+        """
+        Process images
+
+        Args:
+            image_paths: Image file paths
+            operation: Value returned by resolve
+            kwargs: Additional arguments for the operation
+
+        Returns:
+            (results by path, throughput report)
+        """
+        started = time.perf_counter()
+        results: Dict[str, Any] = {}
+        per_image: Dict[str, Dict[str, Any]] = {}
+        free_slots = list(range(len(self._slots)))
+        pending = list(reversed(image_paths))
+        running = {}
+        failed = 0
+        oversize = 0
+        pixels = 0
+
+        while pending or running:
+            # Only as many images in flight as there are result slots
+            while pending and free_slots:
+                path = pending.pop()
+                slot = free_slots.pop()
+                future = self._pool.submit(_worker_run, path, operation, kwargs, self._slots[slot].name)
+                running[future] = (path, slot, time.perf_counter())
+
+            done, _ = concurrent.futures.wait(running, return_when=concurrent.futures.FIRST_COMPLETED)
+            for future in done:
+                path, slot, submitted = running.pop(future)
+                try:
+                    kind, payload, timings = future.result()
+                except Exception as e:
+                    print(f"Failed to process image {path}: {str(e)}")
+                    kind, payload, timings = "none", None, {}
+
+                if kind == "shared":
+                    mode, width, height = payload
+                    channels = _SHARED_MODES[mode]
+                    shape = (height, width, channels) if channels > 1 else (height, width)
+                    view = np.ndarray(shape, dtype=np.uint8, buffer=self._slots[slot].buf)
+                    results[path] = Image.fromarray(view.copy(), mode)
+                elif kind == "object":
+                    results[path] = payload
+                    oversize += int(timings.get("oversize", False))
+                else:
+                    failed += 1
+                free_slots.append(slot)
+
+                if timings:
+                    timings["total_ms"] = (time.perf_counter() - submitted) * 1000.0
+                    per_image[path] = timings
+                    pixels += timings["width"] * timings["height"]
+
+        seconds = time.perf_counter() - started
+        report = {
+            "images": len(results),
+            "failed": failed,
+            "oversize": oversize,
+            "workers": self.workers,
+            "seconds": seconds,
+            "images_per_second": len(results) / seconds if seconds > 0 else 0.0,
+            "megapixels_per_second": pixels / 1e6 / seconds if seconds > 0 else 0.0,
+            "per_image": per_image
+        }
+        logger.info(f"Batch processed {len(results)} image(s) in {seconds:.2f}s "
+                    f"({report['images_per_second']:.1f} images/s, {report['megapixels_per_second']:.1f} MP/s, "
+                    f"{failed} failed)")
+        if oversize:
+            logger.warning(f"{oversize} result(s) exceeded the {self.slot_size // (1024 * 1024)} MB result slot and were pickled")
+        return results, report
+
+    def shutdown(self):
+        self._pool.shutdown(wait=True)
+        for slot in self._slots:
+            slot.close()
+            slot.unlink()
+        self._slots = []
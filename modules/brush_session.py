@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Semantic Brush Session
+Keeps a brush mask in memory between requests: new strokes are rasterized on top of it,
+only the dirty rectangle is re-blurred, and callers get a run-length encoded delta
+"""
+
+import time
+import uuid
+import base64
+import threading
+from collections import OrderedDict
+from typing import Any, Dict, List, Optional
+import numpy as np
+import cv2
+
+
+def encode_rle(region: np.ndarray) -> Dict[str, str]:
+    """
+    Run-length encode a uint8 region in row-major order
+
+    Args:
+        region: uint8 array (H, W)
+
+    Returns:
+        Dictionary with base64 "values" (uint8 per run) and "lengths" (little-endian uint32 per run)
+    """
+    flat = np.ascontiguousarray(region).ravel()
+    if flat.size == 0:
+        return {"values": "", "lengths": ""}
+    starts = np.concatenate(([0], np.flatnonzero(flat[1:] != flat[:-1]) + 1))
+    lengths = np.diff(np.concatenate((starts, [flat.size]))).astype('<u4')
+    return {
+        "values": base64.b64encode(flat[starts].tobytes()).decode('ascii'),
+        "lengths": base64.b64encode(lengths.tobytes()).decode('ascii')
+    }
+
+
+def decode_rle(values: str, lengths: str, shape: tuple) -> np.ndarray:
+    """
+    Inverse of encode_rle
+
+    Args:
+        values: base64 run values
+        lengths: base64 run lengths
+        shape: (H, W) of the region
+
+    Returns:
+        uint8 array of the given shape
+    """
+    run_values = np.frombuffer(base64.b64decode(values), dtype=np.uint8)
+    run_lengths = np.frombuffer(base64.b64decode(lengths), dtype='<u4')
+    return np.repeat(run_values, run_lengths).reshape(shape)
+
+
+class BrushSession:
+    """
+    Incremental brush mask
+    Raw strokes and their Gaussian-smoothed version are both kept, so each update costs
+    proportional to the area it touches rather than the number of strokes so far
+    """
+
+    def __init__(self, width: int, height: int, blur_kernel: int = 15):
+        """
+        Args:
+            width: Mask width
+            height: Mask height
+            blur_kernel: Gaussian kernel size (odd)
+        """
+        self.width = int(width)
+        self.height = int(height)
+        self.blur_kernel = blur_kernel | 1
+        self.strokes = np.zeros((self.height, self.width), dtype=np.uint8)
+        self.mask = np.zeros((self.height, self.width), dtype=np.uint8)
+        self.revision = 0
+        self.stroke_count = 0
+        self.last_used = time.monotonic()
+        self.lock = threading.Lock()
+
+    def apply(self, strokes: List[Dict[str, Any]]) -> Optional[tuple]:
+        """
+        Rasterize new strokes and update the smoothed mask around them
+
+        Args:
+            strokes: Strokes with x, y, size and mode ('eraser' clears)
+
+        Returns:
+            Dirty rectangle (x0, y0, x1, y1) of the smoothed mask, None if nothing changed
+        """
+        x0, y0, x1, y1 = self.width, self.height, 0, 0
+        for stroke in strokes:
+            x, y = int(stroke['x']), int(stroke['y'])
+            radius = int(stroke['size']) // 2
+            color = 0 if stroke.get('mode') == 'eraser' else 255
+            cv2.circle(self.strokes, (x, y), radius, color, -1)
+            x0, y0 = min(x0, x - radius), min(y0, y - radius)
+            x1, y1 = max(x1, x + radius + 1), max(y1, y + radius + 1)
+        self.stroke_count += len(strokes)
+        self.last_used = time.monotonic()
+
+        # Blur output changes up to half a kernel outside the strokes
+        half = self.blur_kernel // 2
+        x0, y0 = max(0, x0 - half), max(0, y0 - half)
+        x1, y1 = min(self.width, x1 + half), min(self.height, y1 + half)
+        if x0 >= x1 or y0 >= y1:
+            return None
+
+        # Blur with another half kernel of context; clipped sides coincide with the image
+        # border, so the result matches a full-frame blur exactly
+        sx0, sy0 = max(0, x0 - half), max(0, y0 - half)
+        sx1, sy1 = min(self.width, x1 + half), min(self.height, y1 + half)
+        blurred = cv2.GaussianBlur(self.strokes[sy0:sy1, sx0:sx1], (self.blur_kernel, self.blur_kernel), 0)
+        self.mask[y0:y1, x0:x1] = blurred[y0 - sy0:y1 - sy0, x0 - sx0:x1 - sx0]
+        self.revision += 1
+        return x0, y0, x1, y1
+
+    def delta(self, rect: Optional[tuple]) -> Dict[str, Any]:
+        """
+        Describe an update for the client
+
+        Args:
+            rect: Dirty rectangle returned by apply
+
+        Returns:
+            Dictionary with revision and, when something changed, the rect and its RLE pixels
+        """
+        result = {"revision": self.revision, "strokeCount": self.stroke_count}
+        if rect is None:
+            result["rect"] = None
+            return result
+        x0, y0, x1, y1 = rect
+        result["rect"] = {"x": x0, "y": y0, "width": x1 - x0, "height": y1 - y0}
+        result["rle"] = encode_rle(self.mask[y0:y1, x0:x1])
+        return result
+
+    def reset(self):
+        self.strokes.fill(0)
+        self.mask.fill(0)
+        self.stroke_count = 0
+        self.revision += 1
+
+
+class BrushSessionManager:
+    """
+    Bounded set of brush sessions, least recently used ones are dropped first
+    """
+
+    def __init__(self, max_sessions: int = 16, idle_timeout: float = 1800.0):
+        """
+        Args:
+            max_sessions: Maximum live sessions
+            idle_timeout: Seconds after which an unused session is dropped
+        """
+        self.max_sessions = max(1, max_sessions)
+        self.idle_timeout = idle_timeout
+        self._sessions: "OrderedDict[str, BrushSession]" = OrderedDict()
+        self._lock = threading.Lock()
+
+    def create(self, width: int, height: int, blur_kernel: int = 15) -> str:
+        """
+        Start a session
+
+        Returns:
+            Session ID
+        """
+        session_id = uuid.uuid4().hex
+        with self._lock:
+            self._expire()
+            self._sessions[session_id] = BrushSession(width, height, blur_kernel)
+            while len(self._sessions) > self.max_sessions:
+                self._sessions.popitem(last=False)
+        return session_id
+
+    def get(self, session_id: str) -> Optional[BrushSession]:
+        with self._lock:
+            session = self._sessions.get(session_id)
+            if session is not None:
+                self._sessions.move_to_end(session_id)
+            return session
+
+    def close(self, session_id: str) -> bool:
+        with self._lock:
+            return self._sessions.pop(session_id, None) is not None
+
+    def _expire(self):
+        now = time.monotonic()
+        for session_id in [k for k, s in self._sessions.items() if now - s.last_used > self.idle_timeout]:
+            del self._sessions[session_id]
@@ -0,0 +1,270 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Incremental Build Cache
+Content-addressed cache of stage outputs, keyed like a build system: a stage's key
+is derived from its input's key, its name and its parameters, so a stage only reruns
+when something upstream of it changed
+"""
+
+import os
+import json
+import hashlib
+import logging
+import threading
+from typing import Dict, Any, List, Optional
+from PIL import Image
+
+logger = logging.getLogger(__name__)
+
+# Bump when stage implementations change in a way that invalidates cached outputs
+CACHE_VERSION = 1
+
+# Eviction frees space down to this share of the budget, so it does not run on every store
+EVICTION_LOW_WATERMARK = 0.9
+
+
+def _digest(*parts) -> str:
+    digest = hashlib.blake2b(digest_size=20)
+    for part in parts:
+        if isinstance(part, (bytes, bytearray, memoryview)):
+            digest.update(part)
+        else:
+            digest.update(json.dumps(part, sort_keys=True, default=str).encode('utf-8'))
+        digest.update(b'\0')
+    return digest.hexdigest()
+
+
+class BuildCache:
+    """
+    Stage output cache
+    Transform outputs are stored as PNG objects; sink outputs are recorded as manifests
+    listing the files they wrote, which count as a hit only while those files exist.
+    Objects are kept within a byte budget, least recently used first out (a hit refreshes
+    the object's mtime)
+    """
+
+    def __init__(self, cache_dir: str, max_bytes: int = 0):
+        """
+        Initialize the cache
+
+        Args:
+            cache_dir: Root directory for cached objects and manifests
+            max_bytes: Budget for stored objects, 0 for unlimited
+        """
+        self.cache_dir = cache_dir
+        self.objects_dir = os.path.join(cache_dir, "objects")
+        self.manifests_dir = os.path.join(cache_dir, "manifests")
+        os.makedirs(self.objects_dir, exist_ok=True)
+        os.makedirs(self.manifests_dir, exist_ok=True)
+
+        self.max_bytes = max_bytes
+        self._lock = threading.Lock()
+        self._bytes = self._scan_objects()[0]
+
+        # Statistics
+        self.hits = 0
+        self.misses = 0
+        self.evictions = 0
+
+    @staticmethod
+    def source_key(data: bytes) -> str:
+        """
+        Compute the key of a source file from its bytes
+
+        Args:
+            data: Source file contents
+
+        Returns:
+            Hex digest
+        """
+        return _digest(CACHE_VERSION, data)
+
+    @staticmethod
+    def stage_key(input_key: str, name: str, kind: str, params: Dict[str, Any], outputs: Any = None) -> str:
+        """
+        Compute the key of a stage
+
+        Args:
+            input_key: Key of the stage's input image
+            name: Stage name
+            kind: Stage kind
+            params: Parameters affecting the stage output
+            outputs: Output location for stages that write files
+
+        Returns:
+            Hex digest
+        """
+        return _digest(input_key, name, kind, params or {}, outputs)
+
+    @staticmethod
+    def combine(keys: List[str]) -> str:
+        """
+        Combine stage keys into the key of a whole build
+        """
+        return _digest(keys)
+
+    def load_image(self, key: str) -> Optional[Image.Image]:
+        """
+        Load a cached transform output
+
+        Args:
+            key: Stage key
+
+        Returns:
+            RGBA Image, or None on miss
+        """
+        path = os.path.join(self.objects_dir, key[:2], f"{key}.png")
+        if not os.path.exists(path):
+            self.misses += 1
+            return None
+        try:
+            image = Image.open(path)
+            image.load()
+            self.hits += 1
+            self._touch(path)
+            return image
+        except Exception as e:
+            logger.warning(f"Failed to load cached stage output {key}: {str(e)}")
+            self.misses += 1
+            return None
+
+    def store_image(self, key: str, image: Image.Image):
+        """
+        Store a transform output
+
+        Args:
+            key: Stage key
+            image: Output image
+        """
+        directory = os.path.join(self.objects_dir, key[:2])
+        path = os.path.join(directory, f"{key}.png")
+        try:
+            os.makedirs(directory, exist_ok=True)
+            temp_path = f"{path}.tmp"
+            # Fast compression: the cache favours build speed over size
+            image.save(temp_path, format='PNG', compress_level=1)
+            previous = os.path.getsize(path) if os.path.exists(path) else 0
+            os.replace(temp_path, path)
+            with self._lock:
+                self._bytes += os.path.getsize(path) - previous
+                over_budget = self.max_bytes and self._bytes > self.max_bytes
+            if over_budget:
+                self.evict()
+        except Exception as e:
+            logger.warning(f"Failed to cache stage output {key}: {str(e)}")
+
+    @staticmethod
+    def _touch(path: str):
+        try:
+            os.utime(path)
+        except OSError:
+            pass
+
+    def _scan_objects(self):
+        """
+        Total size and (mtime, size, path) of every stored object
+        """
+        objects = []
+        total = 0
+        for root, _, files in os.walk(self.objects_dir):
+            for filename in files:
+                if not filename.endswith(".png"):
+                    continue
+                path = os.path.join(root, filename)
+                try:
+                    stat = os.stat(path)
+                except OSError:
+                    continue
+                objects.append((stat.st_mtime, stat.st_size, path))
+                total += stat.st_size
+        return total, objects
+
+    def evict(self) -> int:
+        """
+        Delete least recently used objects until the cache is back under its budget
+        The directory is rescanned, so objects stored by other processes are counted too
+
+        Returns:
+            Number of objects deleted
+        """
+        if not self.max_bytes:
+            return 0
+        with self._lock:
+            total, objects = self._scan_objects()
+            target = self.max_bytes * EVICTION_LOW_WATERMARK
+            removed = 0
+            for _, size, path in sorted(objects):
+                if total <= target:
+                    break
+                try:
+                    os.remove(path)
+                except OSError:
+                    continue
+                total -= size
+                removed += 1
+            self._bytes = total
+            self.evictions += removed
+        if removed:
+            logger.info(f"Build cache evicted {removed} object(s), {total / (1024 * 1024):.1f} MB kept")
+        return removed
+
+    def load_manifest(self, key: str) -> Optional[Dict[str, Any]]:
+        """
+        Load a manifest whose recorded output files all still exist
+
+        Args:
+            key: Stage or build key
+
+        Returns:
+            Manifest dictionary, or None on miss
+        """
+        path = os.path.join(self.manifests_dir, key[:2], f"{key}.json")
+        try:
+            with open(path, 'r', encoding='utf-8') as f:
+                manifest = json.load(f)
+        except (OSError, ValueError):
+            self.misses += 1
+            return None
+
+        if not all(os.path.exists(output) for output in manifest.get("outputs", [])):
+            self.misses += 1
+            return None
+        self.hits += 1
+        return manifest
+
+    def store_manifest(self, key: str, manifest: Dict[str, Any]):
+        """
+        Store a manifest
+
+        Args:
+            key: Stage or build key
+            manifest: Dictionary with "outputs" (file paths) and any stage details
+        """
+        directory = os.path.join(self.manifests_dir, key[:2])
+        path = os.path.join(directory, f"{key}.json")
+        try:
+            os.makedirs(directory, exist_ok=True)
+            temp_path = f"{path}.tmp"
+            with open(temp_path, 'w', encoding='utf-8') as f:
+                json.dump(manifest, f, ensure_ascii=False, default=str)
+            os.replace(temp_path, path)
+        except Exception as e:
+            logger.warning(f"Failed to write build manifest {key}: {str(e)}")
+
+    def get_stats(self) -> Dict[str, Any]:
+        """
+        Get cache statistics
+
+        Returns:
+            Dictionary with hit and miss counts and the stored object size
+        """
+        lookups = self.hits + self.misses
+        return {
+            "cache_dir": self.cache_dir,
+            "hits": self.hits,
+            "misses": self.misses,
+            "hit_rate": (self.hits / lookups) if lookups else 0.0,
+            "bytes": self._bytes,
+            "max_bytes": self.max_bytes,
+            "evictions": self.evictions
+        }
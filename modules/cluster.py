@@ -0,0 +1,625 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Cluster Coordinator and Worker
+Lets several GPU/CPU nodes share one watch folder: the coordinator owns the watch directory and the
+durable job store and hands out leased jobs; stateless workers pull jobs matching their capabilities,
+fetch the source, run the normal workflow pipeline and push the outputs back
+"""
+
+import os
+import copy
+import json
+import time
+import socket
+import shutil
+import threading
+import logging
+import urllib.error
+import urllib.parse
+import urllib.request
+from typing import Dict, List, Any, Optional
+
+from modules import metrics
+
+logger = logging.getLogger(__name__)
+
+LEASES_EXPIRED = metrics.counter("amber_cluster_leases_expired_total", "Job leases that ran out, by outcome",
+                                 ["outcome"])
+REMOTE_JOBS = metrics.counter("amber_cluster_jobs_total", "Jobs finished by cluster workers", ["worker", "status"])
+TRANSFER_SECONDS = metrics.histogram("amber_cluster_transfer_seconds", "Worker source download and output upload time",
+                                     ["direction"])
+
+
+class LeaseLostError(Exception):
+    """
+    The job is no longer held by the calling worker (lease expired and re-queued, or already finished)
+    """
+    pass
+
+
+def detect_capabilities(config) -> List[str]:
+    """
+    Capabilities of this node: always "cpu", plus "gpu" when CUDA is usable for SAM
+    """
+    capabilities = ["cpu"]
+    if str(getattr(config, "sam_device", "cuda")).startswith("cuda"):
+        try:
+            import torch
+            if torch.cuda.is_available():
+                capabilities.append("gpu")
+        except ImportError:
+            pass
+    return capabilities
+
+
+def _rebase_paths(value: Any, old_root: str, new_root: str) -> Any:
+    """
+    Rewrite every path string under old_root to the same relative path under new_root
+    """
+    if isinstance(value, str):
+        if value == old_root or value.startswith(old_root + os.sep) or value.startswith(old_root + "/"):
+            return os.path.join(new_root, os.path.relpath(value, old_root))
+        return value
+    if isinstance(value, list):
+        return [_rebase_paths(item, old_root, new_root) for item in value]
+    if isinstance(value, dict):
+        return {key: _rebase_paths(item, old_root, new_root) for key, item in value.items()}
+    return value
+
+
+class ClusterCoordinator:
+    """
+    Coordinator side of cluster mode
+    Jobs live in the WorkflowManager's JobQueue; this class adds the worker registry, lease handling
+    and the bookkeeping of results reported by remote workers
+    """
+
+    def __init__(self, manager, config):
+        """
+        Args:
+            manager: WorkflowManager owning the watch directory and job store
+            config: Configuration object
+        """
+        self.manager = manager
+        self.config = config
+        self.job_queue = manager.job_queue
+        self.lease_seconds = float(getattr(config, "cluster_lease_seconds", 60.0))
+        self.max_attempts = max(1, int(getattr(config, "cluster_max_attempts", 3)))
+        self.workers: Dict[str, Dict[str, Any]] = {}
+        self._lock = threading.Lock()
+        self._stop = threading.Event()
+        self._reaper = None
+        metrics.REGISTRY.register_collector("cluster", self._collect_metrics)
+
+    def start(self):
+        """
+        Start expiring lost leases in the background
+        """
+        if self._reaper is not None and self._reaper.is_alive():
+            return
+        self._stop.clear()
+        self._reaper = threading.Thread(target=self._reap_loop, name="ClusterLeaseReaper", daemon=True)
+        self._reaper.start()
+
+    def stop(self):
+        """
+        Stop the lease reaper; leases held by workers stay valid until they expire
+        """
+        self._stop.set()
+        if self._reaper is not None:
+            self._reaper.join(timeout=5)
+            self._reaper = None
+
+    def _reap_loop(self):
+        interval = max(1.0, self.lease_seconds / 4.0)
+        while not self._stop.wait(interval):
+            try:
+                self.reap()
+            except Exception as e:
+                logger.error(f"Lease reaper failed: {str(e)}")
+
+    def _touch(self, worker_id: str, info: Optional[Dict[str, Any]] = None) -> Dict[str, Any]:
+        """
+        Create or refresh a worker registry entry (workers re-register implicitly after a coordinator restart)
+        """
+        now = time.time()
+        with self._lock:
+            worker = self.workers.get(worker_id)
+            if worker is None:
+                worker = self.workers[worker_id] = {
+                    "worker_id": worker_id,
+                    "host": "",
+                    "capabilities": ["cpu"],
+                    "slots": 1,
+                    "registered_at": now,
+                    "running": [],
+                    "completed": 0,
+                    "failed": 0,
+                    "stats": {}
+                }
+                logger.info(f"Cluster worker joined: {worker_id}")
+                joined = True
+            else:
+                joined = False
+            worker["last_seen"] = now
+            for key in ("host", "capabilities", "slots", "stats"):
+                if info and info.get(key) is not None:
+                    worker[key] = info[key]
+        if joined:
+            self._publish()
+        return worker
+
+    def _publish(self):
+        # Pushed on membership and lease changes, not on every heartbeat
+        self.manager.events.publish("cluster", self.get_status())
+
+    def heartbeat(self, worker_id: str, job_ids: List[int], info: Optional[Dict[str, Any]] = None) -> List[int]:
+        """
+        Register/refresh a worker and renew the leases of its running jobs
+
+        Args:
+            worker_id: Worker id
+            job_ids: Jobs the worker is running
+            info: Optional host, capabilities, slots and stats
+
+        Returns:
+            Ids still held; the worker should drop the others
+        """
+        held = self.job_queue.heartbeat(worker_id, job_ids, self.lease_seconds) if job_ids else []
+        worker = self._touch(worker_id, info)
+        with self._lock:
+            worker["running"] = held
+        return held
+
+    def claim(self, worker_id: str, capabilities: List[str],
+              info: Optional[Dict[str, Any]] = None) -> Optional[Dict[str, Any]]:
+        """
+        Lease the next job a worker can run
+
+        Args:
+            worker_id: Claiming worker
+            capabilities: Capabilities of the worker ("cpu", "gpu")
+
+        Returns:
+            Job dictionary with "id", "filename", "attempts", "requires", "enqueued_at" and "lease_seconds",
+            or None when the workflow is stopped or nothing matching is pending
+        """
+        worker = self._touch(worker_id, dict(info or {}, capabilities=capabilities))
+        if not self.manager.running:
+            return None
+        # Expired leases become claimable right away instead of waiting for the reaper
+        self.reap()
+        job = self.job_queue.claim(worker_id, capabilities, self.lease_seconds)
+        if job is None:
+            return None
+        with self._lock:
+            worker["running"] = worker["running"] + [job["id"]]
+        job["lease_seconds"] = self.lease_seconds
+        self.manager.events.publish("job_started", {
+            "filename": job["filename"],
+            "start_time": time.time(),
+            "worker_id": worker_id
+        })
+        logger.info(f"Leased job {job['id']} ({job['filename']}) to {worker_id}, attempt {job['attempts']}")
+        self._publish()
+        return job
+
+    def held_job(self, worker_id: str, job_id: int) -> Dict[str, Any]:
+        """
+        Get a job the worker is running
+
+        Raises:
+            KeyError: Unknown job id
+            LeaseLostError: The worker no longer holds the job
+        """
+        job = self.job_queue.get(job_id)
+        if job is None:
+            raise KeyError(job_id)
+        if job["status"] != "running" or job["worker_id"] != worker_id:
+            raise LeaseLostError(f"Job {job_id} is not held by {worker_id}")
+        return job
+
+    def source_path(self, worker_id: str, job_id: int) -> str:
+        """
+        Path of the source file of a held job in the watch directory
+        """
+        job = self.held_job(worker_id, job_id)
+        return os.path.join(self.config.watch_dir, job["filename"])
+
+    def output_path(self, worker_id: str, job_id: int, relative_path: str) -> str:
+        """
+        Destination of an uploaded output file under the output directory
+
+        Raises:
+            ValueError: The path is absolute or escapes the output directory
+        """
+        self.held_job(worker_id, job_id)
+        normalized = os.path.normpath(relative_path.replace("\\", "/"))
+        if os.path.isabs(normalized) or normalized == ".." or normalized.startswith(".." + os.sep):
+            raise ValueError(f"Invalid output path: {relative_path}")
+        return os.path.join(self.config.output_dir, normalized)
+
+    def complete(self, worker_id: str, job_id: int, result: Dict[str, Any], output_root: Optional[str] = None):
+        """
+        Record the result a worker reports for a held job
+
+        Args:
+            worker_id: Reporting worker
+            job_id: Job id
+            result: WorkflowManager.process_file result
+            output_root: Worker-side output directory the result paths refer to (None = shared storage)
+
+        Raises:
+            LeaseLostError: The lease expired first, the result is discarded
+        """
+        self.held_job(worker_id, job_id)
+        if output_root:
+            result = _rebase_paths(result, output_root, self.config.output_dir)
+        result["worker_id"] = worker_id
+        if not self.job_queue.complete(job_id, result, worker_id):
+            raise LeaseLostError(f"Job {job_id} is not held by {worker_id}")
+        self._finish(worker_id, job_id, result)
+
+    def release(self, worker_id: str, job_id: int, error: str) -> bool:
+        """
+        Give a held job back after a transfer failure so another attempt can run it
+
+        Returns:
+            True if the job was re-queued, False if it used up its attempts and was marked failed
+        """
+        job = self.held_job(worker_id, job_id)
+        if self.job_queue.retry(job_id, self.max_attempts, worker_id):
+            logger.warning(f"Worker {worker_id} released job {job_id} ({job['filename']}): {error}")
+            self._drop_running(worker_id, job_id)
+            self._requeued(job["filename"])
+            return True
+        result = self._failed_result(job, f"Attempt {job['attempts']} on {worker_id} failed: {error}")
+        if self.job_queue.complete(job_id, result, worker_id):
+            self._finish(worker_id, job_id, result)
+        return False
+
+    def reap(self) -> int:
+        """
+        Re-queue jobs whose lease ran out; jobs out of attempts are marked failed
+
+        Returns:
+            Number of expired leases handled
+        """
+        expired = self.job_queue.expired()
+        for job in expired:
+            worker_id = job["worker_id"]
+            if self.job_queue.retry(job["id"], self.max_attempts, worker_id):
+                LEASES_EXPIRED.inc(outcome="requeued")
+                logger.warning(f"Lease of job {job['id']} ({job['filename']}) on {worker_id} expired, re-queued")
+                self._drop_running(worker_id, job["id"])
+                self._requeued(job["filename"])
+                continue
+            result = self._failed_result(job, f"Lease expired on {worker_id} after {job['attempts']} attempt(s)")
+            if self.job_queue.complete(job["id"], result, worker_id):
+                LEASES_EXPIRED.inc(outcome="failed")
+                self._finish(worker_id, job["id"], result)
+        return len(expired)
+
+    def _requeued(self, filename: str):
+        self.manager.events.publish("job_queued", {"filename": filename})
+        self._publish()
+
+    def _drop_running(self, worker_id: str, job_id: int):
+        with self._lock:
+            worker = self.workers.get(worker_id)
+            if worker is not None:
+                worker["running"] = [i for i in worker["running"] if i != job_id]
+
+    def _finish(self, worker_id: str, job_id: int, result: Dict[str, Any]):
+        self._drop_running(worker_id, job_id)
+        with self._lock:
+            worker = self.workers.get(worker_id)
+            if worker is not None:
+                worker["failed" if result["status"] == "failed" else "completed"] += 1
+        REMOTE_JOBS.inc(worker=worker_id, status=result["status"])
+        self.manager.record_remote_result(result)
+        self._publish()
+        logger.info(f"Worker {worker_id} finished job {job_id} ({result['filename']}): {result['status']}")
+
+    @staticmethod
+    def _failed_result(job: Dict[str, Any], error: str) -> Dict[str, Any]:
+        return {
+            "filename": job["filename"],
+            "status": "failed",
+            "start_time": job.get("started_at") or time.time(),
+            "end_time": time.time(),
+            "processes": [],
+            "error": error,
+            "timings": {},
+            "bytes_in": 0,
+            "bytes_out": 0,
+            "worker_id": job.get("worker_id")
+        }
+
+    def _alive(self, worker: Dict[str, Any], now: float) -> bool:
+        return now - worker["last_seen"] <= self.lease_seconds
+
+    def get_status(self) -> Dict[str, Any]:
+        """
+        Cluster view merged into the workflow status
+
+        Returns:
+            Dictionary with workers (capabilities, liveness, running jobs, counts), running leases
+            and pending jobs per required capability
+        """
+        now = time.time()
+        with self._lock:
+            workers = [dict(worker, alive=self._alive(worker, now)) for worker in self.workers.values()]
+        running = self.job_queue.running()
+        for job in running:
+            job["lease_remaining"] = max(0.0, (job["lease_expires"] or now) - now)
+        pending = dict({"cpu": 0, "gpu": 0}, **self.job_queue.get_pending_requirements())
+        alive = [worker for worker in workers if worker["alive"]]
+        return {
+            "role": "coordinator",
+            "workers": sorted(workers, key=lambda worker: worker["worker_id"]),
+            "workers_alive": len(alive),
+            "slots": {
+                capability: sum(worker["slots"] for worker in alive if capability in worker["capabilities"])
+                for capability in ("cpu", "gpu")
+            },
+            "running": running,
+            "pending": pending,
+            "lease_seconds": self.lease_seconds,
+            "max_attempts": self.max_attempts
+        }
+
+    def _collect_metrics(self):
+        now = time.time()
+        with self._lock:
+            workers = list(self.workers.values())
+        alive = {"cpu": 0, "gpu": 0}
+        for worker in workers:
+            if self._alive(worker, now):
+                for capability in worker["capabilities"]:
+                    alive[capability] = alive.get(capability, 0) + 1
+        return [
+            ("amber_cluster_workers_alive", "gauge", "Workers seen within one lease, per capability",
+             [({"capability": capability}, count) for capability, count in alive.items()])
+        ]
+
+
+class ClusterWorker:
+    """
+    Stateless worker node
+    Runs a private WorkflowManager on scratch directories (or on the shared ones with shared storage);
+    the coordinator keeps the job store and history, so a worker can be stopped or replaced at any time
+    and its leased jobs are retried elsewhere
+    """
+
+    def __init__(self, config, coordinator_url: Optional[str] = None, worker_id: Optional[str] = None,
+                 capabilities: Optional[List[str]] = None, slots: Optional[int] = None):
+        """
+        Args:
+            config: Configuration object
+            coordinator_url: Coordinator base URL (default cluster_coordinator_url)
+            worker_id: Worker id (default cluster_worker_id, else host name and process id)
+            capabilities: Capabilities to advertise (default cluster_capabilities, else detected)
+            slots: Jobs leased at once (default max_parallel_tasks)
+        """
+        self.url = (coordinator_url or getattr(config, "cluster_coordinator_url", "")).rstrip("/")
+        if not self.url:
+            raise ValueError("cluster_coordinator_url is not configured")
+        self.worker_id = (worker_id or getattr(config, "cluster_worker_id", "")
+                          or f"{socket.gethostname()}-{os.getpid()}")
+        self.capabilities = list(capabilities or getattr(config, "cluster_capabilities", []) or detect_capabilities(config))
+        self.slots = max(1, int(slots or getattr(config, "max_parallel_tasks", 1)))
+        self.token = getattr(config, "cluster_token", "")
+        self.shared_storage = bool(getattr(config, "cluster_shared_storage", False))
+        self.lease_seconds = float(getattr(config, "cluster_lease_seconds", 60.0))
+        safe_id = "".join(c if c.isalnum() or c in "-_." else "_" for c in self.worker_id)
+        self.scratch_dir = os.path.join(config.temp_dir, "cluster", safe_id)
+        self.config = self._local_config(config)
+        self.manager = None
+        self.active: Dict[int, Dict[str, Any]] = {}
+        self.lost = set()
+        self._lock = threading.Lock()
+        self._stop = threading.Event()
+
+    def _local_config(self, config):
+        local = copy.copy(config)
+        local.cluster_role = "standalone"
+        # The local queue is never fed, history and de-duplication live on the coordinator
+        local.workflow_queue_path = os.path.join(self.scratch_dir, "jobs.db")
+        local.max_parallel_tasks = self.slots
+        if not self.shared_storage:
+            local.watch_dir = os.path.join(self.scratch_dir, "source")
+            local.output_dir = os.path.join(self.scratch_dir, "output")
+            # Scratch outputs are removed after upload, so cached builds would have nothing to restore
+            local.incremental_build = False
+        return local
+
+    def run(self):
+        """
+        Pull and process jobs until stop() is called
+        """
+        from modules.workflow_manager import WorkflowManager
+
+        for directory in (self.config.watch_dir, self.config.output_dir):
+            os.makedirs(directory, exist_ok=True)
+        self.manager = WorkflowManager(self.config)
+        if "gpu" in self.capabilities and getattr(self.config, "sam_warmup", False):
+            # Creating the shared engine starts the background model load while the first job is fetched
+            from modules.segmentation_engine import get_segmentation_engine
+            get_segmentation_engine(self.config)
+        logger.info(f"Cluster worker {self.worker_id} ({', '.join(self.capabilities)}, {self.slots} slot(s)) "
+                    f"-> {self.url}")
+
+        threads = [threading.Thread(target=self._heartbeat_loop, name="ClusterHeartbeat", daemon=True)]
+        threads += [threading.Thread(target=self._slot_loop, name=f"ClusterSlot-{i}", daemon=True)
+                    for i in range(self.slots)]
+        for thread in threads:
+            thread.start()
+        try:
+            while not self._stop.wait(1.0):
+                pass
+        finally:
+            self._stop.set()
+            for thread in threads:
+                thread.join(timeout=10)
+
+    def stop(self):
+        """
+        Stop claiming; running jobs finish and report before run() returns (within the join timeout)
+        """
+        self._stop.set()
+
+    def _info(self) -> Dict[str, Any]:
+        stats = {}
+        if self.manager is not None:
+            stats = {"scheduler": self.manager.scheduler.get_stats(),
+                     "running_tasks": self.manager.current_running_tasks}
+        return {"host": socket.gethostname(), "capabilities": self.capabilities, "slots": self.slots, "stats": stats}
+
+    def _request(self, method: str, path: str, body: Any = None, data: Any = None,
+                 headers: Optional[Dict[str, str]] = None, timeout: float = 60.0):
+        request_headers = dict(headers or {})
+        if self.token:
+            request_headers["X-Cluster-Token"] = self.token
+        if body is not None:
+            data = json.dumps(body, ensure_ascii=False, default=str).encode("utf-8")
+            request_headers["Content-Type"] = "application/json"
+        request = urllib.request.Request(self.url + path, data=data, method=method, headers=request_headers)
+        return urllib.request.urlopen(request, timeout=timeout)
+
+    def _call(self, method: str, path: str, body: Any = None) -> Any:
+        with self._request(method, path, body) as response:
+            return json.loads(response.read() or b"null")
+
+    def _heartbeat_loop(self):
+        interval = max(1.0, self.lease_seconds / 3.0)
+        while True:
+            with self._lock:
+                job_ids = list(self.active)
+            try:
+                reply = self._call("POST", "/cluster/heartbeat",
+                                   dict(self._info(), worker_id=self.worker_id, job_ids=job_ids))
+                self.lease_seconds = float(reply.get("lease_seconds", self.lease_seconds))
+                lost = set(job_ids) - set(reply.get("held", []))
+                if lost:
+                    logger.warning(f"Lost lease on job(s) {sorted(lost)}, results will be discarded")
+                    with self._lock:
+                        self.lost.update(lost)
+            except (urllib.error.URLError, OSError, ValueError) as e:
+                logger.warning(f"Heartbeat to {self.url} failed: {str(e)}")
+            # After stop(), keep renewing until the running jobs have reported
+            if self._stop.is_set():
+                with self._lock:
+                    if not self.active:
+                        return
+                time.sleep(1.0)
+            else:
+                self._stop.wait(interval)
+
+    def _slot_loop(self):
+        while not self._stop.is_set():
+            try:
+                reply = self._call("POST", "/cluster/jobs/claim",
+                                   dict(self._info(), worker_id=self.worker_id))
+            except (urllib.error.URLError, OSError, ValueError) as e:
+                logger.warning(f"Claim from {self.url} failed: {str(e)}")
+                self._stop.wait(5.0)
+                continue
+            job = reply.get("job")
+            if job is None:
+                self._stop.wait(2.0)
+                continue
+            self._run_job(job)
+
+    def _run_job(self, job: Dict[str, Any]):
+        job_id, filename = job["id"], job["filename"]
+        with self._lock:
+            self.active[job_id] = job
+        source_path = os.path.join(self.config.watch_dir, filename)
+        result = None
+        try:
+            if not self.shared_storage:
+                try:
+                    self._download(job_id, source_path)
+                except (urllib.error.URLError, OSError) as e:
+                    self._release(job_id, f"source download failed: {str(e)}")
+                    return
+
+            result = self.manager.process_file(filename, queued_at=job.get("enqueued_at"))
+
+            if job_id in self.lost:
+                logger.warning(f"Discarding result of job {job_id} ({filename}), lease was lost")
+                return
+            output_root = None
+            if not self.shared_storage:
+                output_root = self.config.output_dir
+                try:
+                    self._upload_outputs(job_id, result)
+                except (urllib.error.URLError, OSError) as e:
+                    self._release(job_id, f"output upload failed: {str(e)}")
+                    return
+            try:
+                self._call("POST", f"/cluster/jobs/{job_id}/complete",
+                           {"worker_id": self.worker_id, "result": result, "output_root": output_root})
+            except (urllib.error.URLError, OSError) as e:
+                # The lease expires and the job is retried elsewhere
+                logger.error(f"Reporting job {job_id} ({filename}) failed: {str(e)}")
+        finally:
+            with self._lock:
+                self.active.pop(job_id, None)
+                self.lost.discard(job_id)
+            if result is not None:
+                self._forget(result)
+            if not self.shared_storage:
+                self._cleanup(source_path, result)
+
+    def _release(self, job_id: int, error: str):
+        logger.error(f"Job {job_id}: {error}")
+        try:
+            self._call("POST", f"/cluster/jobs/{job_id}/release", {"worker_id": self.worker_id, "error": error})
+        except (urllib.error.URLError, OSError) as e:
+            logger.warning(f"Releasing job {job_id} failed, it is retried once the lease expires: {str(e)}")
+
+    def _download(self, job_id: int, path: str):
+        query = urllib.parse.urlencode({"worker_id": self.worker_id})
+        with metrics.timed("cluster.download", TRANSFER_SECONDS, direction="download"):
+            with self._request("GET", f"/cluster/jobs/{job_id}/source?{query}", timeout=300.0) as response:
+                partial = path + ".part"
+                with open(partial, "wb") as f:
+                    shutil.copyfileobj(response, f, 1024 * 1024)
+                os.replace(partial, path)
+
+    def _upload_outputs(self, job_id: int, result: Dict[str, Any]):
+        query = urllib.parse.urlencode({"worker_id": self.worker_id})
+        with metrics.timed("cluster.upload", TRANSFER_SECONDS, direction="upload"):
+            for path in self.manager.job_outputs(result["filename"], result["processes"]):
+                relative = os.path.relpath(path, self.config.output_dir)
+                if relative.startswith(".."):
+                    logger.warning(f"Not uploading {path}, it is outside the output directory")
+                    continue
+                if not os.path.isfile(path):
+                    continue
+                remote = urllib.parse.quote(relative.replace(os.sep, "/"))
+                headers = {"Content-Type": "application/octet-stream", "Content-Length": str(os.path.getsize(path))}
+                with open(path, "rb") as f:
+                    with self._request("PUT", f"/cluster/jobs/{job_id}/outputs/{remote}?{query}", data=f,
+                                       headers=headers, timeout=300.0):
+                        pass
+
+    def _forget(self, result: Dict[str, Any]):
+        # The coordinator keeps the history, the private manager must not grow without bound
+        for history in (self.manager.processed_files, self.manager.failed_files):
+            try:
+                history.remove(result)
+            except ValueError:
+                pass
+
+    def _cleanup(self, source_path: str, result: Optional[Dict[str, Any]]):
+        paths = [source_path]
+        if result is not None:
+            paths += self.manager.job_outputs(result["filename"], result["processes"])
+        for path in paths:
+            try:
+                os.remove(path)
+            except (OSError, TypeError):
+                pass
@@ -8,7 +8,671 @@ Generates C++ header files and resource metadata
 import os
 import json
 from datetime import datetime
-# from .resource_sync_client import get_resource_sync_client
+from modules.asset_archive import asset_id, collect_asset_files, write_archive, ARCHIVE_VERSION
+from modules.resource_sync_client import get_resource_sync_client, SYNC_VERSION
+
+# Header-only reader for the packed archive written by asset_archive.write_archive
+ARCHIVE_READER_HEADER = """// AmberPipeline Auto-Generated Header
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <utility>
+#if __has_include(<span>) && __cplusplus >= 202002L
+#include <span>
+#endif
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Assets {
+#if defined(__cpp_lib_span)
+    using Bytes = std::span<const std::byte>;
+#else
+    // Minimal read-only span for pre-C++20 builds
+    class Bytes {
+    public:
+        constexpr Bytes() = default;
+        constexpr Bytes(const std::byte* data, std::size_t size) : data_(data), size_(size) {}
+        constexpr const std::byte* data() const { return data_; }
+        constexpr std::size_t size() const { return size_; }
+        constexpr bool empty() const { return size_ == 0; }
+        constexpr const std::byte* begin() const { return data_; }
+        constexpr const std::byte* end() const { return data_ + size_; }
+    private:
+        const std::byte* data_ = nullptr;
+        std::size_t size_ = 0;
+    };
+#endif
+
+    // Mirrors asset_archive.ASSET_FORMATS
+    enum class Format : uint32_t { Binary = 0, PNG = 1, DDS = 2, KTX2 = 3, JSON = 4 };
+
+    struct ArchiveHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t alignment;
+        uint64_t tableOffset;
+        uint64_t fileSize;
+    };
+
+    struct ArchiveEntry {
+        uint32_t id;
+        Format format;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+    };
+
+    static_assert(sizeof(ArchiveHeader) == 32, "ArchiveHeader layout");
+    static_assert(sizeof(ArchiveEntry) == 32, "ArchiveEntry layout");
+
+    constexpr uint32_t ArchiveVersion = @ARCHIVE_VERSION@;
+
+    // Memory-mapped view of Assets.pak; lookups are a binary search over the ID-sorted table
+    // and return spans into the mapping, no per-asset open, read or copy
+    class Archive {
+    public:
+        Archive() = default;
+        explicit Archive(const char* path) { Open(path); }
+        ~Archive() { Close(); }
+
+        Archive(const Archive&) = delete;
+        Archive& operator=(const Archive&) = delete;
+        Archive(Archive&& other) noexcept { *this = std::move(other); }
+        Archive& operator=(Archive&& other) noexcept {
+            if (this != &other) {
+                Close();
+                std::swap(data_, other.data_);
+                std::swap(size_, other.size_);
+#if defined(_WIN32)
+                std::swap(file_, other.file_);
+                std::swap(mapping_, other.mapping_);
+#endif
+            }
+            return *this;
+        }
+
+        bool Open(const char* path) {
+            Close();
+#if defined(_WIN32)
+            file_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file_ == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file_, &size)) { Close(); return false; }
+            size_ = static_cast<std::size_t>(size.QuadPart);
+            mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping_) { Close(); return false; }
+            data_ = static_cast<const std::byte*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0) return false;
+            struct stat st;
+            if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+            size_ = static_cast<std::size_t>(st.st_size);
+            void* mapped = size_ ? ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+            ::close(fd);
+            data_ = mapped == MAP_FAILED ? nullptr : static_cast<const std::byte*>(mapped);
+#endif
+            if (!data_ || !Valid()) { Close(); return false; }
+            return true;
+        }
+
+        void Close() {
+#if defined(_WIN32)
+            if (data_) UnmapViewOfFile(data_);
+            if (mapping_) CloseHandle(mapping_);
+            if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+            mapping_ = nullptr;
+            file_ = INVALID_HANDLE_VALUE;
+#else
+            if (data_) ::munmap(const_cast<std::byte*>(data_), size_);
+#endif
+            data_ = nullptr;
+            size_ = 0;
+        }
+
+        bool IsOpen() const { return data_ != nullptr; }
+        uint32_t Count() const { return IsOpen() ? Header().entryCount : 0; }
+
+        const ArchiveEntry* Find(uint32_t id) const {
+            if (!IsOpen()) return nullptr;
+            const ArchiveEntry* first = Entries();
+            const ArchiveEntry* last = first + Count();
+            const ArchiveEntry* it = std::lower_bound(first, last, id,
+                [](const ArchiveEntry& entry, uint32_t value) { return entry.id < value; });
+            return (it != last && it->id == id) ? it : nullptr;
+        }
+
+        // Zero-copy view of an asset, empty when absent or out of bounds
+        Bytes Get(uint32_t id) const {
+            const ArchiveEntry* entry = Find(id);
+            return entry && InBounds(*entry) ? Bytes(data_ + entry->offset, static_cast<std::size_t>(entry->size))
+                                             : Bytes();
+        }
+
+        bool Contains(uint32_t id) const { return Find(id) != nullptr; }
+
+        Format FormatOf(uint32_t id) const {
+            const ArchiveEntry* entry = Find(id);
+            return entry ? entry->format : Format::Binary;
+        }
+
+        std::string NameOf(uint32_t id) const {
+            const ArchiveEntry* entry = Find(id);
+            return entry && InBounds(*entry)
+                ? std::string(reinterpret_cast<const char*>(data_ + entry->nameOffset), entry->nameLength)
+                : std::string();
+        }
+
+    private:
+        const ArchiveHeader& Header() const { return *reinterpret_cast<const ArchiveHeader*>(data_); }
+        const ArchiveEntry* Entries() const {
+            return reinterpret_cast<const ArchiveEntry*>(data_ + Header().tableOffset);
+        }
+
+        // [offset, offset + length) lies inside the mapping, without overflowing
+        bool Fits(uint64_t offset, uint64_t length) const {
+            return offset <= uint64_t(size_) && length <= uint64_t(size_) - offset;
+        }
+
+        bool InBounds(const ArchiveEntry& entry) const {
+            return Fits(entry.offset, entry.size) && Fits(entry.nameOffset, entry.nameLength);
+        }
+
+        // Checks the header, the table and every entry, so a truncated or corrupt archive is rejected at Open()
+        bool Valid() const {
+            if (size_ < sizeof(ArchiveHeader)) return false;
+            const ArchiveHeader& header = Header();
+            if (std::memcmp(header.magic, "AMBP", 4) != 0 || header.version != ArchiveVersion) return false;
+            if (header.fileSize > size_) return false;
+            if (header.tableOffset % alignof(ArchiveEntry) != 0) return false;
+            if (header.tableOffset > size_ ||
+                uint64_t(header.entryCount) > (uint64_t(size_) - header.tableOffset) / sizeof(ArchiveEntry)) {
+                return false;
+            }
+            const ArchiveEntry* entries = Entries();
+            for (uint32_t i = 0; i < header.entryCount; ++i) {
+                if (!InBounds(entries[i])) return false;
+                // Find() is a binary search over IDs
+                if (i > 0 && entries[i - 1].id >= entries[i].id) return false;
+            }
+            return true;
+        }
+
+        const std::byte* data_ = nullptr;
+        std::size_t size_ = 0;
+#if defined(_WIN32)
+        HANDLE file_ = INVALID_HANDLE_VALUE;
+        HANDLE mapping_ = nullptr;
+#endif
+    };
+}
+"""
+
+# Header-only live sync endpoint for the game, the peer of resource_sync_client.ResourceSyncClient
+SYNC_SERVER_HEADER = """// AmberPipeline Auto-Generated Header
+#pragma once
+#include "AssetArchive.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#if defined(_MSC_VER)
+#pragma comment(lib, "Ws2_32.lib")
+#endif
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#endif
+
+namespace Assets {
+    namespace Sync {
+        constexpr uint16_t ProtocolVersion = @SYNC_VERSION@;
+        constexpr uint16_t DefaultPort = @SYNC_PORT@;
+        constexpr uint32_t MaxFrameSize = 1u << 30;
+
+        // Mirrors resource_sync_client.MSG_* and ACK_*
+        enum class Message : uint16_t { Hello = 1, IdTable = 2, Asset = 3, Delta = 4, Remove = 5, Ack = 6 };
+        enum class AckStatus : uint8_t { Applied = 0, NeedFull = 1, Error = 2 };
+
+        struct FrameHeader {
+            char magic[4];
+            uint16_t version;
+            uint16_t type;
+            uint32_t length;
+        };
+        static_assert(sizeof(FrameHeader) == 12, "FrameHeader layout");
+
+#if defined(_WIN32)
+        using Socket = SOCKET;
+        constexpr Socket InvalidSocket = INVALID_SOCKET;
+        inline void CloseSocket(Socket socket) { ::closesocket(socket); }
+        inline void ShutdownSocket(Socket socket) { ::shutdown(socket, SD_BOTH); }
+#else
+        using Socket = int;
+        constexpr Socket InvalidSocket = -1;
+        inline void CloseSocket(Socket socket) { ::close(socket); }
+        inline void ShutdownSocket(Socket socket) { ::shutdown(socket, SHUT_RDWR); }
+#endif
+
+        // Bounds-checked little-endian reads over a message payload
+        class Reader {
+        public:
+            Reader(const std::byte* data, std::size_t size) : data_(data), size_(size) {}
+
+            template <typename T>
+            bool Read(T& value) {
+                if (size_ - offset_ < sizeof(T)) return false;
+                std::memcpy(&value, data_ + offset_, sizeof(T));
+                offset_ += sizeof(T);
+                return true;
+            }
+
+            const std::byte* Take(uint64_t count) {
+                if (size_ - offset_ < count) return nullptr;
+                const std::byte* data = data_ + offset_;
+                offset_ += static_cast<std::size_t>(count);
+                return data;
+            }
+
+        private:
+            const std::byte* data_;
+            std::size_t size_;
+            std::size_t offset_ = 0;
+        };
+
+        template <typename T>
+        void Append(std::vector<std::byte>& out, const T& value) {
+            const std::byte* data = reinterpret_cast<const std::byte*>(&value);
+            out.insert(out.end(), data, data + sizeof(T));
+        }
+    }
+
+    // Asset bytes pushed by the pipeline, immutable once published
+    struct LiveAsset {
+        Format format = Format::Binary;
+        uint64_t version = 0;
+        std::shared_ptr<const std::vector<std::byte>> data;
+
+        Bytes View() const { return data ? Bytes(data->data(), data->size()) : Bytes(); }
+    };
+
+    // Live sync endpoint embedded in the running game. The pipeline connects to it, sends ID table
+    // updates and changed assets (full or as block deltas against the held version), and Poll() on
+    // the game thread hands each change to OnAsset, so textures are re-uploaded in place without a rebuild
+    //
+    //     Assets::ResourceSyncServer sync;
+    //     sync.OnAsset([&](uint32_t id, Assets::Format format, Assets::Bytes data) { textures.Reload(id, format, data); });
+    //     sync.Start();
+    //     // once per frame
+    //     sync.Poll();
+    //
+    // IDs announced live are Assets::Id("NAME"), the same values AssetIDs.h holds after the next rebuild
+    class ResourceSyncServer {
+    public:
+        using AssetCallback = std::function<void(uint32_t id, Format format, Bytes data)>;
+        using RemoveCallback = std::function<void(uint32_t id)>;
+
+        explicit ResourceSyncServer(uint16_t port = Sync::DefaultPort, bool loopbackOnly = true)
+            : port_(port), loopbackOnly_(loopbackOnly) {}
+        ~ResourceSyncServer() { Stop(); }
+
+        ResourceSyncServer(const ResourceSyncServer&) = delete;
+        ResourceSyncServer& operator=(const ResourceSyncServer&) = delete;
+
+        // Listen for the pipeline on a background thread
+        bool Start() {
+            if (running_) return true;
+#if defined(_WIN32)
+            WSADATA wsa;
+            if (::WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+            wsaStarted_ = true;
+#endif
+            listener_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (listener_ == Sync::InvalidSocket) return false;
+#if !defined(_WIN32)
+            int reuse = 1;
+            ::setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port_);
+            address.sin_addr.s_addr = htonl(loopbackOnly_ ? INADDR_LOOPBACK : INADDR_ANY);
+            if (::bind(listener_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+                ::listen(listener_, 1) != 0) {
+                Sync::CloseSocket(listener_);
+                listener_ = Sync::InvalidSocket;
+                return false;
+            }
+            running_ = true;
+            thread_ = std::thread([this] { Run(); });
+            return true;
+        }
+
+        void Stop() {
+            if (!running_.exchange(false)) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (client_ != Sync::InvalidSocket) Sync::ShutdownSocket(client_);
+            }
+            if (thread_.joinable()) thread_.join();
+            Sync::CloseSocket(listener_);
+            listener_ = Sync::InvalidSocket;
+#if defined(_WIN32)
+            if (wsaStarted_) ::WSACleanup();
+            wsaStarted_ = false;
+#endif
+        }
+
+        bool IsRunning() const { return running_; }
+        bool IsConnected() const { return connected_; }
+
+        void OnAsset(AssetCallback callback) { onAsset_ = std::move(callback); }
+        void OnRemove(RemoveCallback callback) { onRemove_ = std::move(callback); }
+
+        // Game thread: apply the changes received since the last call (latest version of each asset)
+        // and invoke the callbacks; returns the number of changes
+        std::size_t Poll() {
+            std::unordered_map<uint32_t, Change> changes;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                changes.swap(pending_);
+            }
+            for (auto& [id, change] : changes) {
+                if (change.removed) {
+                    live_.erase(id);
+                    if (onRemove_) onRemove_(id);
+                } else {
+                    const LiveAsset& asset = live_[id] = std::move(change.asset);
+                    if (onAsset_) onAsset_(id, asset.format, asset.View());
+                }
+            }
+            return changes.size();
+        }
+
+        // Game thread: live bytes of an asset as of the last Poll(), empty when none were pushed
+        Bytes Get(uint32_t id) const {
+            auto it = live_.find(id);
+            return it != live_.end() ? it->second.View() : Bytes();
+        }
+
+        // Live bytes when pushed, otherwise the archive's
+        Bytes Get(uint32_t id, const Archive& archive) const {
+            auto it = live_.find(id);
+            return it != live_.end() ? it->second.View() : archive.Get(id);
+        }
+
+        Format FormatOf(uint32_t id, const Archive& archive) const {
+            auto it = live_.find(id);
+            return it != live_.end() ? it->second.format : archive.FormatOf(id);
+        }
+
+        bool IsLive(uint32_t id) const { return live_.count(id) != 0; }
+
+        // Name announced by the pipeline, empty when unknown (safe from any thread)
+        std::string NameOf(uint32_t id) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = names_.find(id);
+            return it != names_.end() ? it->second : std::string();
+        }
+
+    private:
+        struct Change {
+            bool removed = false;
+            LiveAsset asset;
+        };
+
+        void Run() {
+            while (running_) {
+                Sync::Socket client = Accept();
+                if (client == Sync::InvalidSocket) continue;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    client_ = client;
+                }
+                connected_ = true;
+                Serve(client);
+                connected_ = false;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    client_ = Sync::InvalidSocket;
+                }
+                Sync::CloseSocket(client);
+            }
+        }
+
+        // Waits at most 200 ms for one of the sockets to become readable, so Stop() is noticed
+        // without closing a socket under a blocking call; returns the readable one
+        Sync::Socket WaitReadable(Sync::Socket client) {
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(listener_, &readable);
+            if (client != Sync::InvalidSocket) FD_SET(client, &readable);
+            Sync::Socket highest = client != Sync::InvalidSocket && client > listener_ ? client : listener_;
+            timeval timeout{0, 200000};
+            if (::select(static_cast<int>(highest) + 1, &readable, nullptr, nullptr, &timeout) <= 0) {
+                return Sync::InvalidSocket;
+            }
+            // A new connection wins: a restarted pipeline replaces a stale one
+            return FD_ISSET(listener_, &readable) ? listener_ : client;
+        }
+
+        Sync::Socket Accept() {
+            if (WaitReadable(Sync::InvalidSocket) != listener_) return Sync::InvalidSocket;
+            Sync::Socket client = ::accept(listener_, nullptr, nullptr);
+            if (client != Sync::InvalidSocket) {
+                int noDelay = 1;
+                ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay),
+                             sizeof(noDelay));
+            }
+            return client;
+        }
+
+        void Serve(Sync::Socket client) {
+            std::vector<std::byte> payload;
+            while (running_) {
+                Sync::Socket readable = WaitReadable(client);
+                if (readable == listener_) return;
+                if (readable != client) continue;
+                Sync::FrameHeader header;
+                if (!ReadExact(client, &header, sizeof(header))) return;
+                if (std::memcmp(header.magic, "AMBS", 4) != 0 || header.version != Sync::ProtocolVersion ||
+                    header.length > Sync::MaxFrameSize) {
+                    return;
+                }
+                payload.resize(header.length);
+                if (!ReadExact(client, payload.data(), payload.size())) return;
+                if (!Handle(client, static_cast<Sync::Message>(header.type), payload)) return;
+            }
+        }
+
+        // False drops the connection (malformed message or send failure)
+        bool Handle(Sync::Socket client, Sync::Message type, const std::vector<std::byte>& payload) {
+            Sync::Reader reader(payload.data(), payload.size());
+            switch (type) {
+            case Sync::Message::Hello: {
+                // Report held versions, so a reconnecting pipeline only resends what differs
+                std::vector<std::byte> reply;
+                Sync::Append(reply, static_cast<uint32_t>(held_.size()));
+                for (const auto& [id, asset] : held_) {
+                    Sync::Append(reply, id);
+                    Sync::Append(reply, asset.version);
+                }
+                return Send(client, Sync::Message::Hello, reply);
+            }
+            case Sync::Message::IdTable: {
+                uint32_t count = 0;
+                if (!reader.Read(count)) return false;
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (uint32_t i = 0; i < count; ++i) {
+                    uint32_t id = 0;
+                    uint16_t length = 0;
+                    if (!reader.Read(id) || !reader.Read(length)) return false;
+                    const std::byte* name = reader.Take(length);
+                    if (!name) return false;
+                    names_[id].assign(reinterpret_cast<const char*>(name), length);
+                }
+                return true;
+            }
+            case Sync::Message::Asset: {
+                uint32_t id = 0, format = 0;
+                uint64_t version = 0, size = 0;
+                if (!reader.Read(id) || !reader.Read(format) || !reader.Read(version) || !reader.Read(size)) {
+                    return false;
+                }
+                const std::byte* data = reader.Take(size);
+                if (!data) return false;
+                Publish(id, static_cast<Format>(format), version,
+                        std::make_shared<const std::vector<std::byte>>(data, data + size));
+                return Ack(client, id, version, Sync::AckStatus::Applied);
+            }
+            case Sync::Message::Delta: {
+                uint32_t id = 0, format = 0, blockSize = 0, blockCount = 0;
+                uint64_t baseVersion = 0, version = 0, size = 0;
+                if (!reader.Read(id) || !reader.Read(format) || !reader.Read(baseVersion) || !reader.Read(version) ||
+                    !reader.Read(size) || !reader.Read(blockSize) || !reader.Read(blockCount) ||
+                    size > Sync::MaxFrameSize) {
+                    return false;
+                }
+                auto held = held_.find(id);
+                if (held == held_.end() || held->second.version != baseVersion || !held->second.data) {
+                    return Ack(client, id, version, Sync::AckStatus::NeedFull);
+                }
+                // Copy-on-write: the game thread may still be reading the previous version
+                auto next = std::make_shared<std::vector<std::byte>>(*held->second.data);
+                next->resize(static_cast<std::size_t>(size));
+                for (uint32_t i = 0; i < blockCount; ++i) {
+                    uint32_t index = 0, length = 0;
+                    if (!reader.Read(index) || !reader.Read(length)) return false;
+                    const std::byte* block = reader.Take(length);
+                    uint64_t offset = uint64_t(index) * blockSize;
+                    if (!block || length > blockSize || offset + length > size) {
+                        return Ack(client, id, version, Sync::AckStatus::Error);
+                    }
+                    std::memcpy(next->data() + offset, block, length);
+                }
+                Publish(id, static_cast<Format>(format), version, std::move(next));
+                return Ack(client, id, version, Sync::AckStatus::Applied);
+            }
+            case Sync::Message::Remove: {
+                uint32_t id = 0;
+                if (!reader.Read(id)) return false;
+                held_.erase(id);
+                std::lock_guard<std::mutex> lock(mutex_);
+                Change& change = pending_[id];
+                change.removed = true;
+                change.asset = LiveAsset();
+                return true;
+            }
+            default:
+                // Unknown messages from newer pipelines are skipped
+                return true;
+            }
+        }
+
+        void Publish(uint32_t id, Format format, uint64_t version, std::shared_ptr<const std::vector<std::byte>> data) {
+            LiveAsset asset;
+            asset.format = format;
+            asset.version = version;
+            asset.data = std::move(data);
+            held_[id] = asset;
+            std::lock_guard<std::mutex> lock(mutex_);
+            Change& change = pending_[id];
+            change.removed = false;
+            change.asset = std::move(asset);
+        }
+
+        bool Ack(Sync::Socket client, uint32_t id, uint64_t version, Sync::AckStatus status) {
+            std::vector<std::byte> reply;
+            Sync::Append(reply, id);
+            Sync::Append(reply, version);
+            Sync::Append(reply, static_cast<uint8_t>(status));
+            return Send(client, Sync::Message::Ack, reply);
+        }
+
+        bool Send(Sync::Socket client, Sync::Message type, const std::vector<std::byte>& payload) {
+            Sync::FrameHeader header{{'A', 'M', 'B', 'S'}, Sync::ProtocolVersion, static_cast<uint16_t>(type),
+                                     static_cast<uint32_t>(payload.size())};
+            return WriteAll(client, &header, sizeof(header)) && WriteAll(client, payload.data(), payload.size());
+        }
+
+        static bool ReadExact(Sync::Socket client, void* buffer, std::size_t size) {
+            char* out = static_cast<char*>(buffer);
+            while (size > 0) {
+                int chunk = static_cast<int>(size < (1u << 20) ? size : (1u << 20));
+                int received = static_cast<int>(::recv(client, out, chunk, 0));
+                if (received <= 0) return false;
+                out += received;
+                size -= static_cast<std::size_t>(received);
+            }
+            return true;
+        }
+
+        static bool WriteAll(Sync::Socket client, const void* buffer, std::size_t size) {
+            const char* data = static_cast<const char*>(buffer);
+#if defined(MSG_NOSIGNAL)
+            const int flags = MSG_NOSIGNAL;
+#else
+            const int flags = 0;
+#endif
+            while (size > 0) {
+                int sent = static_cast<int>(::send(client, data, static_cast<int>(size), flags));
+                if (sent <= 0) return false;
+                data += sent;
+                size -= static_cast<std::size_t>(sent);
+            }
+            return true;
+        }
+
+        uint16_t port_;
+        bool loopbackOnly_;
+        std::atomic<bool> running_{false};
+        std::atomic<bool> connected_{false};
+        std::thread thread_;
+        Sync::Socket listener_ = Sync::InvalidSocket;
+#if defined(_WIN32)
+        bool wsaStarted_ = false;
+#endif
+
+        // Network thread only: versions the pipeline sent, the bases of its deltas
+        std::unordered_map<uint32_t, LiveAsset> held_;
+        // Guarded by mutex_
+        mutable std::mutex mutex_;
+        Sync::Socket client_ = Sync::InvalidSocket;
+        std::unordered_map<uint32_t, Change> pending_;
+        std::unordered_map<uint32_t, std::string> names_;
+        // Game thread only: what Get() serves
+        std::unordered_map<uint32_t, LiveAsset> live_;
+        AssetCallback onAsset_;
+        RemoveCallback onRemove_;
+    };
+}
+"""
 
 class CodeSync:
     """
@@ -16,7 +680,8 @@ class CodeSync:
     Used to generate C++ header files and resource metadata
     """
     
-    def __init__(self, output_dir, cpp_header_dir, compiled_dir, server_host="localhost", server_port=8888):
+    def __init__(self, output_dir, cpp_header_dir, compiled_dir, server_host="localhost", server_port=8888,
+                 live_sync=False):
         """
         Initialize the code synchronizer
         
@@ -26,23 +691,27 @@ class CodeSync:
             compiled_dir: Final compiled output directory
             server_host: ResourceSyncServer host address
             server_port: ResourceSyncServer port number
+            live_sync: Push changed assets to the running game's ResourceSyncServer
         """
         self.output_dir = output_dir
         self.cpp_header_dir = cpp_header_dir
         self.compiled_dir = compiled_dir
+        self.server_port = server_port
         
-        # Initialize resource sync client (temporarily commented out)
-        # self.sync_client = get_resource_sync_client(server_host, server_port)
-        # 
-        # # Try to connect to the server
-        # if not self.sync_client.connect():
-        #     print(f"Warning: Failed to connect to ResourceSyncServer at {server_host}:{server_port}")
-        #     print("Some features (real-time resource synchronization) may not work properly")
+        # Live sync client, connected lazily so the pipeline also runs without the game
         self.sync_client = None
+        if live_sync:
+            self.sync_client = get_resource_sync_client(server_host, server_port)
+            self.generate_sync_server()
+            if not self.sync_client.connect():
+                print(f"Warning: Failed to connect to ResourceSyncServer at {server_host}:{server_port}")
+                print("Assets are pushed once the game is running, headers are still generated")
     
     def generate_cpp_header(self, asset_list):
         """
         Generate C++ header file containing resource ID enums
+        IDs are FNV-1a hashes of the names (see asset_archive.asset_id), so they are
+        stable across runs; an unchanged header is not rewritten
         
         Args:
             asset_list: List of resources, each element is a resource name (without extension)
@@ -60,6 +729,16 @@ class CodeSync:
 #include <cstdint>
 
 namespace Assets {
+    // Stable asset ID: FNV-1a of the upper-cased name
+    constexpr uint32_t Id(const char* name) {
+        uint32_t value = 0x811c9dc5u;
+        for (; *name; ++name) {
+            char c = (*name >= 'a' && *name <= 'z') ? static_cast<char>(*name - 32) : *name;
+            value = (value ^ static_cast<uint8_t>(c)) * 0x01000193u;
+        }
+        return value;
+    }
+
     // Texture suffix definitions
     namespace TextureSuffix {
         constexpr const char* BaseColor = "_BC";
@@ -73,29 +752,106 @@ namespace Assets {
 """
         
         # Convert filename to uppercase enum name, e.g., UI_Amber_01_BC -> ID_UI_AMBER_01_BC
-        for i, asset_name in enumerate(asset_list):
+        for asset_name in sorted(set(asset_list)):
             enum_name = f"ID_{asset_name.upper()}"
-            header_content += f"    static constexpr uint32_t {enum_name} = {hex(i + 1000)};\n"
+            header_content += f"    static constexpr uint32_t {enum_name} = {asset_id(asset_name):#010x};\n"
         
         header_content += "}\n"
         
-        # Write header file to cpp/include directory
+        # Write header file to cpp/include directory, copy it to compiled_dir
         header_path = os.path.join(self.cpp_header_dir, "AssetIDs.h")
-        with open(header_path, "w") as f:
-            f.write(header_content)
-        
-        # Copy header file to compiled_dir directory
-        import shutil
         compiled_header_path = os.path.join(self.compiled_dir, "AssetIDs.h")
-        shutil.copy2(header_path, compiled_header_path)
-        
-        # Send header content to C++ ResourceSyncServer (temporarily commented out)
-        # if self.sync_client:
-        #     self.sync_client.send_asset_ids_header(header_content)
+        self._write_if_changed(header_path, header_content)
+        self._write_if_changed(compiled_header_path, header_content)
         
         return [header_path, compiled_header_path]
     
-    def generate_metadata(self, asset_name, original_path, prompt="", process_steps=None):
+    def build_archive(self, asset_list, archive_name="Assets.pak"):
+        """
+        Compiled output mode: pack every output of the listed assets into one archive,
+        and generate AssetIDs.h plus the header-only AssetArchive.h reader
+        
+        Args:
+            asset_list: List of resources (names without extension)
+            archive_name: Archive file name inside compiled_dir
+            
+        Returns:
+            Dictionary with archive path, entry list and generated header paths
+        """
+        os.makedirs(self.compiled_dir, exist_ok=True)
+        files = collect_asset_files(self.output_dir, asset_list)
+        archive_path = os.path.join(self.compiled_dir, archive_name)
+        entries = write_archive(archive_path, files)
+        
+        # Packed entries (e.g. X_processed, X_BC) get IDs next to the asset names
+        headers = self.generate_cpp_header(list(asset_list) + [entry["name"] for entry in entries])
+        headers += self.generate_archive_reader()
+        return {"archive_path": archive_path, "entries": entries, "headers": headers}
+    
+    def generate_archive_reader(self):
+        """
+        Generate AssetArchive.h, a header-only reader for the packed archive
+        
+        Returns:
+            List of generated header file paths
+        """
+        reader_content = ARCHIVE_READER_HEADER.replace("@ARCHIVE_VERSION@", str(ARCHIVE_VERSION))
+        paths = [os.path.join(self.cpp_header_dir, "AssetArchive.h"),
+                 os.path.join(self.compiled_dir, "AssetArchive.h")]
+        for path in paths:
+            self._write_if_changed(path, reader_content)
+        return paths
+    
+    def generate_sync_server(self):
+        """
+        Generate ResourceSyncServer.h, the header-only live sync endpoint embedded in the game
+        (needs AssetArchive.h, which is generated alongside)
+        
+        Returns:
+            List of generated header file paths
+        """
+        server_content = (SYNC_SERVER_HEADER.replace("@SYNC_VERSION@", str(SYNC_VERSION))
+                          .replace("@SYNC_PORT@", str(self.server_port)))
+        paths = [os.path.join(self.cpp_header_dir, "ResourceSyncServer.h"),
+                 os.path.join(self.compiled_dir, "ResourceSyncServer.h")]
+        for path in paths:
+            self._write_if_changed(path, server_content)
+        return paths + self.generate_archive_reader()
+    
+    def sync_live(self, asset_list):
+        """
+        Push the outputs of the listed assets to the running game; only content the game
+        does not hold is sent (block deltas where possible), new names update its ID table
+        
+        Args:
+            asset_list: List of resources (names without extension)
+            
+        Returns:
+            Counts of full, delta and unchanged assets and bytes sent, empty when live sync
+            is off or the game is not reachable
+        """
+        if self.sync_client is None:
+            return {}
+        return self.sync_client.sync(collect_asset_files(self.output_dir, asset_list))
+    
+    @staticmethod
+    def _write_if_changed(path, content):
+        """
+        Write a generated file only when its content changed, so the game build
+        does not recompile on every new asset
+        """
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        try:
+            with open(path, "r") as f:
+                if f.read() == content:
+                    return False
+        except OSError:
+            pass
+        with open(path, "w") as f:
+            f.write(content)
+        return True
+    
+    def generate_metadata(self, asset_name, original_path, prompt="", process_steps=None, fingerprint=None):
         """
         Generate resource metadata JSON file
         
@@ -104,10 +860,23 @@ namespace Assets {
             original_path: Original file path
             prompt: Prompt used to generate the resource (if any)
             process_steps: List of processing steps
+            fingerprint: Build fingerprint of the asset; an existing file with the same
+                fingerprint is left untouched
             
         Returns:
             Path to the generated metadata file
         """
+        metadata_path = os.path.join(self.output_dir, f"{asset_name}_metadata.json")
+        
+        # Skip rewriting metadata for an unchanged build
+        if fingerprint and os.path.exists(metadata_path):
+            try:
+                with open(metadata_path, "r", encoding="utf-8") as f:
+                    if json.load(f).get("fingerprint") == fingerprint:
+                        return metadata_path
+            except (OSError, ValueError):
+                pass
+        
         # Build metadata
         metadata = {
             "asset_name": asset_name,
@@ -117,9 +886,10 @@ namespace Assets {
             "process_steps": process_steps or [],
             "version": "1.0"
         }
+        if fingerprint:
+            metadata["fingerprint"] = fingerprint
         
         # Write metadata file
-        metadata_path = os.path.join(self.output_dir, f"{asset_name}_metadata.json")
         with open(metadata_path, "w", encoding="utf-8") as f:
             json.dump(metadata, f, ensure_ascii=False, indent=2)
         
@@ -140,14 +910,7 @@ namespace Assets {
         """
         generated_files = []
         
-        # 生成C++头文件
-        header_path = self.generate_cpp_header(asset_list)
-        generated_files.append(header_path)
-        
-        # 复制头文件到compiled_dir目录
-        import shutil
-        compiled_header_path = os.path.join(self.compiled_dir, "AssetIDs.h")
-        shutil.copy2(header_path, compiled_header_path)
-        generated_files.append(compiled_header_path)
+        # 生成C++头文件（同时复制到compiled_dir目录）
+        generated_files.extend(self.generate_cpp_header(asset_list))
         
         return generated_files
\ No newline at end of file
@@ -0,0 +1,265 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Image Embedding Cache
+Bounded LRU cache of SAM2 image-encoder outputs keyed by image content hash,
+with optional spill to disk, so follow-up point prompts only run the mask decoder
+"""
+
+import os
+import hashlib
+import threading
+import logging
+from collections import OrderedDict
+from typing import Dict, Any, Optional
+import numpy as np
+
+logger = logging.getLogger(__name__)
+
+
+class EmbeddingCache:
+    """
+    LRU cache of image embeddings
+    Each entry holds the predictor features, the original image size and the RGB pixels.
+    Per-image derived data (e.g. the edge snap index) can be attached as extras under the
+    same key; extras live in memory only and share the LRU bound
+    """
+
+    def __init__(self, max_entries: int = 8, spill_dir: str = None, max_spill_entries: int = 256):
+        """
+        Initialize the embedding cache
+
+        Args:
+            max_entries: Maximum number of entries kept in memory
+            spill_dir: Directory for entries evicted from memory, None disables disk spill
+            max_spill_entries: Maximum number of entries kept on disk
+        """
+        self.max_entries = max(1, int(max_entries))
+        self.spill_dir = spill_dir or None
+        self.max_spill_entries = max(1, int(max_spill_entries))
+        self._entries = OrderedDict()
+        self._extras = OrderedDict()
+        self._lock = threading.Lock()
+
+        # Statistics
+        self.hits = 0
+        self.disk_hits = 0
+        self.misses = 0
+        self.evictions = 0
+
+        if self.spill_dir:
+            os.makedirs(self.spill_dir, exist_ok=True)
+
+    @staticmethod
+    def hash_image(image_np: np.ndarray) -> str:
+        """
+        Compute the content key of an image
+
+        Args:
+            image_np: Image pixels as numpy array
+
+        Returns:
+            Hex digest identifying the pixels and their shape
+        """
+        digest = hashlib.blake2b(digest_size=16)
+        digest.update(str(image_np.shape).encode('ascii'))
+        digest.update(np.ascontiguousarray(image_np).data)
+        return digest.hexdigest()
+
+    def get(self, key: str) -> Optional[Dict[str, Any]]:
+        """
+        Look up an entry, checking memory first and then the spill directory
+
+        Args:
+            key: Image content key
+
+        Returns:
+            Cached entry, or None if not cached
+        """
+        with self._lock:
+            entry = self._entries.get(key)
+            if entry is not None:
+                self._entries.move_to_end(key)
+                self.hits += 1
+                return entry
+
+        entry = self._load_spilled(key)
+        if entry is None:
+            with self._lock:
+                self.misses += 1
+            return None
+
+        with self._lock:
+            self.disk_hits += 1
+        self.put(key, entry)
+        return entry
+
+    def put(self, key: str, entry: Dict[str, Any]):
+        """
+        Store an entry, evicting (and spilling) the least recently used ones
+
+        Args:
+            key: Image content key
+            entry: Dictionary with "features", "orig_hw" and "image"
+        """
+        evicted = []
+        with self._lock:
+            self._entries[key] = entry
+            self._entries.move_to_end(key)
+            while len(self._entries) > self.max_entries:
+                evicted.append(self._entries.popitem(last=False))
+                self._extras.pop(evicted[-1][0], None)
+                self.evictions += 1
+
+        for evicted_key, evicted_entry in evicted:
+            self._spill(evicted_key, evicted_entry)
+
+    def get_extra(self, key: str, name: str) -> Optional[Any]:
+        """
+        Look up data attached to an image
+
+        Args:
+            key: Image content key
+            name: Extra name
+
+        Returns:
+            Attached value, or None
+        """
+        with self._lock:
+            extras = self._extras.get(key)
+            if extras is None or name not in extras:
+                return None
+            self._extras.move_to_end(key)
+            if key in self._entries:
+                self._entries.move_to_end(key)
+            return extras[name]
+
+    def put_extra(self, key: str, name: str, value: Any):
+        """
+        Attach data to an image, with or without a cached embedding
+
+        Args:
+            key: Image content key
+            name: Extra name
+            value: Value to attach
+        """
+        with self._lock:
+            self._extras.setdefault(key, {})[name] = value
+            self._extras.move_to_end(key)
+            while len(self._extras) > self.max_entries:
+                self._extras.popitem(last=False)
+
+    def contains(self, key: str) -> bool:
+        """
+        Check whether an entry exists in memory or on disk
+
+        Args:
+            key: Image content key
+
+        Returns:
+            True if the entry can be served without running the encoder
+        """
+        with self._lock:
+            if key in self._entries:
+                return True
+        return self.spill_dir is not None and os.path.exists(self._spill_path(key))
+
+    def clear(self):
+        """
+        Drop all in-memory entries (spilled entries are kept)
+        """
+        with self._lock:
+            self._entries.clear()
+            self._extras.clear()
+
+    def get_stats(self) -> Dict[str, Any]:
+        """
+        Get cache statistics
+
+        Returns:
+            Dictionary with entry counts and hit rates
+        """
+        with self._lock:
+            lookups = self.hits + self.disk_hits + self.misses
+            return {
+                "entries": len(self._entries),
+                "extras": len(self._extras),
+                "max_entries": self.max_entries,
+                "spill_enabled": self.spill_dir is not None,
+                "hits": self.hits,
+                "disk_hits": self.disk_hits,
+                "misses": self.misses,
+                "evictions": self.evictions,
+                "hit_rate": ((self.hits + self.disk_hits) / lookups) if lookups else 0.0
+            }
+
+    def _spill_path(self, key: str) -> str:
+        return os.path.join(self.spill_dir, f"{key}.pt")
+
+    def _spill(self, key: str, entry: Dict[str, Any]):
+        """
+        Write an evicted entry to the spill directory
+        """
+        if not self.spill_dir:
+            return
+        try:
+            import torch
+
+            path = self._spill_path(key)
+            if not os.path.exists(path):
+                cpu_entry = {
+                    "features": _map_tensors(entry["features"], lambda t: t.detach().cpu()),
+                    "orig_hw": entry["orig_hw"],
+                    "image": entry["image"]
+                }
+                temp_path = f"{path}.tmp"
+                torch.save(cpu_entry, temp_path)
+                os.replace(temp_path, path)
+            self._trim_spill_dir()
+        except Exception as e:
+            logger.warning(f"Failed to spill embedding {key} to disk: {str(e)}")
+
+    def _load_spilled(self, key: str) -> Optional[Dict[str, Any]]:
+        """
+        Load an entry from the spill directory
+        """
+        if not self.spill_dir:
+            return None
+        path = self._spill_path(key)
+        if not os.path.exists(path):
+            return None
+        try:
+            import torch
+
+            entry = torch.load(path, map_location="cpu", weights_only=False)
+            os.utime(path, None)
+            return entry
+        except Exception as e:
+            logger.warning(f"Failed to load spilled embedding {key}: {str(e)}")
+            return None
+
+    def _trim_spill_dir(self):
+        """
+        Remove the oldest spilled entries beyond max_spill_entries
+        """
+        files = [os.path.join(self.spill_dir, f) for f in os.listdir(self.spill_dir) if f.endswith('.pt')]
+        if len(files) <= self.max_spill_entries:
+            return
+        files.sort(key=os.path.getmtime)
+        for path in files[:len(files) - self.max_spill_entries]:
+            try:
+                os.remove(path)
+            except OSError:
+                pass
+
+
+def _map_tensors(value, fn):
+    """
+    Apply fn to every tensor in a nested dict/list structure
+    """
+    if isinstance(value, dict):
+        return {k: _map_tensors(v, fn) for k, v in value.items()}
+    if isinstance(value, (list, tuple)):
+        return type(value)(_map_tensors(v, fn) for v in value)
+    if hasattr(value, "detach"):
+        return fn(value)
+    return value
@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - File Ingest Watcher
+Event-driven directory watcher that only reports a file once it has finished being written
+"""
+
+import os
+import time
+import threading
+import logging
+from typing import Callable, Dict, Iterable
+
+logger = logging.getLogger(__name__)
+
+try:
+    from watchdog.observers import Observer
+    from watchdog.events import FileSystemEventHandler
+    WATCHDOG_AVAILABLE = True
+except ImportError:
+    Observer = None
+    FileSystemEventHandler = object
+    WATCHDOG_AVAILABLE = False
+
+# Partial downloads and editor swap files are never ingested
+IGNORED_SUFFIXES = ('.tmp', '.part', '.crdownload', '.swp', '.partial')
+
+
+class _IngestEventHandler(FileSystemEventHandler):
+    """Forwards watchdog events to the ingest watcher"""
+
+    def __init__(self, watcher):
+        self.watcher = watcher
+
+    def on_created(self, event):
+        if not event.is_directory:
+            self.watcher.notify(event.src_path)
+
+    def on_modified(self, event):
+        if not event.is_directory:
+            self.watcher.notify(event.src_path)
+
+    def on_moved(self, event):
+        if not event.is_directory:
+            self.watcher.notify(event.dest_path)
+
+
+class FileIngestWatcher:
+    """
+    Watches a directory and calls on_ready(path) for each completely written file
+    A file is complete once its size and mtime stay unchanged for settle_seconds
+    and it can be opened for reading
+    """
+
+    def __init__(self, watch_dir: str, on_ready: Callable[[str], None], settle_seconds: float = 0.5,
+                 extensions: Iterable[str] = None, scan_existing: bool = True):
+        """
+        Initialize the watcher
+
+        Args:
+            watch_dir: Directory to watch (not recursive)
+            on_ready: Callback receiving the full path of each ready file
+            settle_seconds: How long a file must stay unchanged before it is reported
+            extensions: Optional lowercase extensions to accept, e.g. ['.png']; all files if None
+            scan_existing: Also report files already present when the watcher starts
+        """
+        self.watch_dir = watch_dir
+        self.on_ready = on_ready
+        self.settle_seconds = max(0.05, float(settle_seconds))
+        self.extensions = {e.lower() for e in extensions} if extensions else None
+        self.scan_existing = scan_existing
+
+        self._candidates: Dict[str, tuple] = {}
+        self._reported: Dict[str, tuple] = {}
+        self._condition = threading.Condition()
+        self._running = False
+        self._observer = None
+        self._settle_thread = None
+
+    def start(self):
+        """
+        Start watching the directory
+        """
+        if self._running:
+            return
+        self._running = True
+
+        if self.scan_existing:
+            self._scan_directory()
+
+        if WATCHDOG_AVAILABLE:
+            self._observer = Observer()
+            self._observer.schedule(_IngestEventHandler(self), self.watch_dir, recursive=False)
+            self._observer.start()
+        else:
+            logger.warning("watchdog is not installed, falling back to directory polling")
+
+        self._settle_thread = threading.Thread(target=self._settle_loop, name="FileIngest", daemon=True)
+        self._settle_thread.start()
+        logger.info(f"File ingest watching: {self.watch_dir}")
+
+    def stop(self, timeout: float = 5.0):
+        """
+        Stop watching the directory
+
+        Args:
+            timeout: Seconds to wait for the background threads
+        """
+        if not self._running:
+            return
+        self._running = False
+        if self._observer:
+            self._observer.stop()
+            self._observer.join(timeout=timeout)
+            self._observer = None
+        with self._condition:
+            self._condition.notify_all()
+        if self._settle_thread:
+            self._settle_thread.join(timeout=timeout)
+            self._settle_thread = None
+
+    def notify(self, path: str):
+        """
+        Register a created or modified file as a candidate
+
+        Args:
+            path: Full file path
+        """
+        if not self._accepts(path):
+            return
+        with self._condition:
+            if path not in self._candidates:
+                self._candidates[path] = (None, time.monotonic())
+            self._condition.notify()
+
+    def _accepts(self, path: str) -> bool:
+        name = os.path.basename(path)
+        if name.startswith('.') or name.lower().endswith(IGNORED_SUFFIXES):
+            return False
+        if self.extensions is not None and os.path.splitext(name)[1].lower() not in self.extensions:
+            return False
+        return True
+
+    def _scan_directory(self):
+        """
+        Register every file currently in the watch directory
+        """
+        try:
+            for name in os.listdir(self.watch_dir):
+                path = os.path.join(self.watch_dir, name)
+                if os.path.isfile(path):
+                    self.notify(path)
+        except OSError as e:
+            logger.error(f"Failed to scan watch directory: {str(e)}")
+
+    def _settle_loop(self):
+        """
+        Check candidates until each one has stopped changing, then report it
+        """
+        interval = self.settle_seconds / 2.0
+        while self._running:
+            with self._condition:
+                if not self._candidates and WATCHDOG_AVAILABLE:
+                    # Nothing pending: sleep until an event arrives
+                    self._condition.wait()
+                    continue
+            if not WATCHDOG_AVAILABLE:
+                self._scan_directory()
+
+            ready = self._collect_ready()
+            for path in ready:
+                try:
+                    self.on_ready(path)
+                except Exception as e:
+                    logger.error(f"Ingest callback failed for {path}: {str(e)}")
+
+            with self._condition:
+                if self._running:
+                    self._condition.wait(timeout=interval)
+
+    def _collect_ready(self) -> list:
+        """
+        Return candidates whose size and mtime have been stable for the settle period
+        """
+        now = time.monotonic()
+        ready = []
+        with self._condition:
+            candidates = list(self._candidates.items())
+
+        for path, (signature, stable_since) in candidates:
+            try:
+                stat = os.stat(path)
+            except OSError:
+                # File was removed or renamed before it settled
+                with self._condition:
+                    self._candidates.pop(path, None)
+                continue
+
+            current = (stat.st_size, stat.st_mtime_ns)
+            if self._reported.get(path) == current:
+                # Already reported this version (duplicate event or polling rescan)
+                with self._condition:
+                    self._candidates.pop(path, None)
+                continue
+            if current != signature:
+                with self._condition:
+                    if path in self._candidates:
+                        self._candidates[path] = (current, now)
+                continue
+
+            if stat.st_size == 0 or now - stable_since < self.settle_seconds or not self._is_readable(path):
+                continue
+
+            with self._condition:
+                self._candidates.pop(path, None)
+            self._reported[path] = current
+            ready.append(path)
+        return ready
+
+    @staticmethod
+    def _is_readable(path: str) -> bool:
+        """
+        Check that the writer has released the file (exclusive locks fail on Windows)
+        """
+        try:
+            with open(path, 'rb'):
+                return True
+        except OSError:
+            return False
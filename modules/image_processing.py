@@ -5,10 +5,16 @@ Provides basic image processing functions, including image loading, saving, scal
 """
 
 import os
+import time
+import atexit
+import threading
 import concurrent.futures
 from PIL import Image, ImageOps, ImageDraw, ImageFilter
 import numpy as np
 
+from modules.mip_chain import build_mip_chain
+from modules import pixel_kernels
+
 class ImageProcessor:
     """Image Processing Class"""
     
@@ -20,6 +26,17 @@ class ImageProcessor:
             config: Configuration object
         """
         self.config = config
+        self.lod_filter = getattr(config, "lod_filter", "box")
+        # Fused kernels for RGBA inputs (shared alpha bounds, LUTs, ROI-only compositing)
+        self.pixel_kernels = getattr(config, "pixel_kernels", True)
+        
+        # batch_process backend: worker processes with shared memory, or threads
+        self.batch_backend = getattr(config, "batch_backend", "thread")
+        self.batch_workers = getattr(config, "batch_workers", 0) or os.cpu_count()
+        self.batch_worker_memory_mb = getattr(config, "batch_worker_memory_mb", 256)
+        self.last_batch_report = None
+        self._batch_engine = None
+        self._batch_engine_lock = threading.Lock()
     
     def load_image(self, file_path: str) -> Image.Image:
         """
@@ -198,6 +215,9 @@ class ImageProcessor:
             Aligned Image object
         """
         try:
+            if self.pixel_kernels and image.mode == 'RGBA':
+                return pixel_kernels.align_bottom(image, padding)
+            
             # Get alpha channel
             alpha = image.split()[3]
             
@@ -234,6 +254,9 @@ class ImageProcessor:
             Image object with shadow
         """
         try:
+            if self.pixel_kernels and image.mode == 'RGBA':
+                return pixel_kernels.generate_shadow(image, shadow_color, shadow_size)
+            
             # Get alpha channel
             alpha = image.split()[3]
             
@@ -318,6 +341,9 @@ class ImageProcessor:
         """
         Make image seamless
         
+        With pixel_kernels the image is offset by half its size and blended with the original
+        (true tiling); otherwise the edges are mirrored and blurred
+        
         Args:
             image: Original Image object
             
@@ -325,6 +351,9 @@ class ImageProcessor:
             Seamless processed Image object
         """
         try:
+            if self.pixel_kernels:
+                return pixel_kernels.make_seamless(image)
+            
             # Simple edge blending method: mirror flip edge pixels
             width, height = image.size
             
@@ -359,36 +388,41 @@ class ImageProcessor:
             print(f"Failed to make seamless, error message: {str(e)}")
             return image
     
-    def gen_lod(self, image: Image.Image, levels: int = 3) -> list[Image.Image]:
+    def gen_lod(self, image: Image.Image, levels: int = 3, min_size: int = 32) -> list[Image.Image]:
         """
         Generate LOD levels
         
+        Each level is filtered from the previous one (premultiplied alpha) instead of
+        from the full-resolution source
+        
         Args:
             image: Original Image object
-            levels: Number of LOD levels to generate
+            levels: Number of LOD levels to generate, 0 for a full chain
+            min_size: Minimum edge length of the smallest level
             
         Returns:
             List of LOD levels from high to low
         """
         try:
-            lods = [image]
-            current_width, current_height = image.size
-            
-            for i in range(1, levels):
-                # Reduce by half each time
-                new_width = max(32, current_width // 2)
-                new_height = max(32, current_height // 2)
-                
-                lod_image = image.resize((new_width, new_height), Image.LANCZOS)
-                lods.append(lod_image)
-                
-                current_width, current_height = new_width, new_height
-            
-            return lods
+            chain = build_mip_chain(image, levels=levels, min_size=min_size, filter=self.lod_filter)
+            return [image] + [Image.fromarray(level, 'RGBA') for level in chain[1:]]
         except Exception as e:
             print(f"Failed to generate LOD, error message: {str(e)}")
             return [image]
     
+    def gen_mip_chain(self, image: Image.Image, min_size: int = 1) -> list:
+        """
+        Generate a full mip chain as arrays
+        
+        Args:
+            image: Original Image object
+            min_size: Minimum edge length, 1 for a chain down to 1x1
+            
+        Returns:
+            List of uint8 RGBA numpy arrays from largest to smallest
+        """
+        return build_mip_chain(image, levels=0, min_size=min_size, filter=self.lod_filter)
+    
     def box_collision(self, image: Image.Image) -> tuple:
         """
         Generate collision box bounds
@@ -400,11 +434,15 @@ class ImageProcessor:
             Collision box bounds coordinates (left, top, right, bottom)
         """
         try:
-            # Get alpha channel
-            alpha = image.split()[3]
-            
-            # Find bounds of non-transparent area
-            bbox = alpha.getbbox()
+            if self.pixel_kernels and image.mode == 'RGBA':
+                # Reuses the bounds found by earlier stages on this image
+                bbox = pixel_kernels.alpha_bounds(image)
+            else:
+                # Get alpha channel
+                alpha = image.split()[3]
+                
+                # Find bounds of non-transparent area
+                bbox = alpha.getbbox()
             if not bbox:
                 return (0, 0, image.width, image.height)
             
@@ -426,6 +464,9 @@ class ImageProcessor:
             Adjusted Image object
         """
         try:
+            if self.pixel_kernels and image.mode in ('RGBA', 'RGB'):
+                return pixel_kernels.adjust_brightness_contrast(image, brightness, contrast)
+            
             # Convert brightness and contrast values to appropriate factors
             brightness_factor = 1.0 + (brightness / 100.0)
             contrast_factor = 1.0 + (contrast / 100.0)
@@ -467,6 +508,10 @@ class ImageProcessor:
         """
         Batch process multiple images in parallel
         
+        With batch_backend "process", ImageProcessor methods and module-level functions run in
+        worker processes (results come back through shared memory); other callables, such as
+        lambdas, fall back to threads. The throughput report is kept in last_batch_report.
+        
         Args:
             image_paths: List of image file paths
             process_func: Processing function to apply to each image
@@ -475,10 +520,18 @@ class ImageProcessor:
         Returns:
             Dictionary mapping image paths to processed images
         """
+        if self.batch_backend == "process" and len(image_paths) > 1:
+            from modules.batch_engine import BatchEngine
+            operation = BatchEngine.resolve(process_func)
+            if operation is not None:
+                results, self.last_batch_report = self._get_batch_engine().run(image_paths, operation, kwargs)
+                return results
+        
         results = {}
+        started = time.perf_counter()
         
         # Use ThreadPoolExecutor for parallel processing
-        with concurrent.futures.ThreadPoolExecutor(max_workers=os.cpu_count()) as executor:
+        with concurrent.futures.ThreadPoolExecutor(max_workers=self.batch_workers) as executor:
             # Submit all tasks
             future_to_path = {
                 executor.submit(self._process_single_image, path, process_func, **kwargs): path
@@ -495,8 +548,36 @@ class ImageProcessor:
                 except Exception as e:
                     print(f"Failed to process image {path}: {str(e)}")
         
+        seconds = time.perf_counter() - started
+        self.last_batch_report = {
+            "images": len(results),
+            "failed": len(image_paths) - len(results),
+            "workers": self.batch_workers,
+            "seconds": seconds,
+            "images_per_second": len(results) / seconds if seconds > 0 else 0.0
+        }
         return results
     
+    def _get_batch_engine(self):
+        """
+        Start the worker process pool on first use, it is reused by later batches
+        """
+        with self._batch_engine_lock:
+            if self._batch_engine is None:
+                from modules.batch_engine import BatchEngine
+                self._batch_engine = BatchEngine(self.config, self.batch_workers, self.batch_worker_memory_mb)
+                atexit.register(self.shutdown_batch_engine)
+            return self._batch_engine
+    
+    def shutdown_batch_engine(self):
+        """
+        Stop the worker processes and release their shared memory
+        """
+        with self._batch_engine_lock:
+            if self._batch_engine is not None:
+                self._batch_engine.shutdown()
+                self._batch_engine = None
+    
     def _process_single_image(self, image_path: str, process_func: callable, **kwargs) -> Image.Image:
         """
         Process a single image with the specified function
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Inference Executor
+Dedicated worker threads for model inference, one bounded priority queue per workload,
+so interactive requests overtake batch work and a saturated queue rejects instead of piling up
+"""
+
+import time
+import heapq
+import asyncio
+import itertools
+import threading
+import logging
+from concurrent.futures import Future
+from typing import Any, Callable, Dict
+
+logger = logging.getLogger(__name__)
+
+# Priorities, lower runs first
+PRIORITY_INTERACTIVE = 0
+PRIORITY_BATCH = 10
+
+PRIORITIES = {
+    "interactive": PRIORITY_INTERACTIVE,
+    "batch": PRIORITY_BATCH
+}
+
+
+class QueueFullError(Exception):
+    """Raised when a queue is at its pending limit"""
+
+    def __init__(self, queue_name: str, limit: int):
+        super().__init__(f"Inference queue '{queue_name}' is full ({limit} pending)")
+        self.queue_name = queue_name
+        self.limit = limit
+
+
+class _InferenceQueue:
+    """
+    Priority queue served by its own worker threads
+    """
+
+    def __init__(self, name: str, workers: int, max_pending: int):
+        self.name = name
+        self.max_pending = max(1, max_pending)
+        self._heap = []
+        self._sequence = itertools.count()
+        self._condition = threading.Condition()
+        self._running = True
+
+        # Statistics
+        self.active = 0
+        self.completed = 0
+        self.failed = 0
+        self.rejected = 0
+        self.total_wait_ms = 0.0
+        self.total_run_ms = 0.0
+
+        self._threads = [
+            threading.Thread(target=self._worker_loop, name=f"Inference-{name}-{i}", daemon=True)
+            for i in range(max(1, workers))
+        ]
+        for thread in self._threads:
+            thread.start()
+
+    def submit(self, fn: Callable, args: tuple, kwargs: dict, priority: int) -> Future:
+        future = Future()
+        with self._condition:
+            if len(self._heap) >= self.max_pending:
+                self.rejected += 1
+                raise QueueFullError(self.name, self.max_pending)
+            # Sequence number keeps FIFO order within a priority
+            heapq.heappush(self._heap, (priority, next(self._sequence), time.perf_counter(), future, fn, args, kwargs))
+            self._condition.notify()
+        return future
+
+    def _worker_loop(self):
+        while True:
+            with self._condition:
+                while self._running and not self._heap:
+                    self._condition.wait()
+                if not self._running:
+                    return
+                _, _, enqueued, future, fn, args, kwargs = heapq.heappop(self._heap)
+                self.active += 1
+
+            started = time.perf_counter()
+            if future.set_running_or_notify_cancel():
+                try:
+                    future.set_result(fn(*args, **kwargs))
+                    failed = False
+                except BaseException as e:
+                    future.set_exception(e)
+                    failed = True
+            else:
+                failed = False
+            finished = time.perf_counter()
+
+            with self._condition:
+                self.active -= 1
+                self.completed += 1
+                self.failed += int(failed)
+                self.total_wait_ms += (started - enqueued) * 1000.0
+                self.total_run_ms += (finished - started) * 1000.0
+
+    def stop(self):
+        with self._condition:
+            self._running = False
+            for item in self._heap:
+                item[3].cancel()
+            self._heap.clear()
+            self._condition.notify_all()
+
+    def get_stats(self) -> Dict[str, Any]:
+        with self._condition:
+            return {
+                "workers": len(self._threads),
+                "pending": len(self._heap),
+                "max_pending": self.max_pending,
+                "active": self.active,
+                "completed": self.completed,
+                "failed": self.failed,
+                "rejected": self.rejected,
+                "avg_wait_ms": self.total_wait_ms / self.completed if self.completed else 0.0,
+                "avg_run_ms": self.total_run_ms / self.completed if self.completed else 0.0
+            }
+
+
+class InferenceExecutor:
+    """
+    Set of named inference queues (e.g. segment, normal, inpaint)
+    """
+
+    def __init__(self, queues: Dict[str, tuple]):
+        """
+        Args:
+            queues: Dictionary of queue name -> (worker count, max pending requests)
+        """
+        self._queues = {name: _InferenceQueue(name, workers, limit) for name, (workers, limit) in queues.items()}
+
+    def submit(self, queue_name: str, fn: Callable, *args, priority: int = PRIORITY_INTERACTIVE, **kwargs) -> Future:
+        """
+        Queue a call
+
+        Args:
+            queue_name: Target queue
+            fn: Callable to run on a worker thread
+            priority: PRIORITY_INTERACTIVE or PRIORITY_BATCH (lower runs first)
+
+        Returns:
+            Future with the call's result
+
+        Raises:
+            QueueFullError: The queue is at its pending limit
+        """
+        return self._queues[queue_name].submit(fn, args, kwargs, priority)
+
+    async def run(self, queue_name: str, fn: Callable, *args, priority: int = PRIORITY_INTERACTIVE, **kwargs):
+        """
+        Queue a call and await its result from async code
+        """
+        return await asyncio.wrap_future(self.submit(queue_name, fn, *args, priority=priority, **kwargs))
+
+    def get_stats(self) -> Dict[str, Any]:
+        return {name: queue.get_stats() for name, queue in self._queues.items()}
+
+    def shutdown(self):
+        for queue in self._queues.values():
+            queue.stop()
@@ -0,0 +1,354 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Persistent Job Queue
+SQLite-backed queue of workflow jobs, so pending and finished files survive a restart.
+In cluster mode the same store hands out time-limited leases to remote workers
+"""
+
+import os
+import json
+import time
+import sqlite3
+import threading
+import logging
+from typing import Dict, List, Any, Optional
+
+logger = logging.getLogger(__name__)
+
+
+# Columns added after the first schema, created on open for older databases
+_MIGRATIONS = {
+    "requires": "TEXT NOT NULL DEFAULT 'cpu'",
+    "worker_id": "TEXT",
+    "lease_expires": "REAL"
+}
+
+
+class JobQueue:
+    """
+    Durable FIFO job queue
+    Each job is identified by filename plus a content fingerprint (size and mtime),
+    so an unchanged file is never queued twice while a modified file is picked up again.
+    A job records the capability it needs ("cpu" or "gpu"); claims may be restricted to
+    a worker's capabilities and carry a lease that the worker renews with heartbeats
+    """
+
+    def __init__(self, db_path: str):
+        """
+        Open (or create) the job database
+
+        Args:
+            db_path: SQLite database file path
+        """
+        self.db_path = db_path
+        directory = os.path.dirname(db_path)
+        if directory:
+            os.makedirs(directory, exist_ok=True)
+
+        self._lock = threading.Lock()
+        self._conn = sqlite3.connect(db_path, check_same_thread=False, isolation_level=None)
+        self._conn.row_factory = sqlite3.Row
+        self._conn.execute("PRAGMA journal_mode=WAL")
+        self._conn.execute("PRAGMA synchronous=NORMAL")
+        self._conn.execute("""
+            CREATE TABLE IF NOT EXISTS jobs (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                filename TEXT NOT NULL,
+                fingerprint TEXT NOT NULL,
+                status TEXT NOT NULL DEFAULT 'pending',
+                attempts INTEGER NOT NULL DEFAULT 0,
+                enqueued_at REAL NOT NULL,
+                started_at REAL,
+                finished_at REAL,
+                result TEXT,
+                error TEXT,
+                archived INTEGER NOT NULL DEFAULT 0,
+                UNIQUE (filename, fingerprint)
+            )
+        """)
+        columns = {row["name"] for row in self._conn.execute("PRAGMA table_info(jobs)")}
+        for column, definition in _MIGRATIONS.items():
+            if column not in columns:
+                self._conn.execute(f"ALTER TABLE jobs ADD COLUMN {column} {definition}")
+        self._conn.execute("CREATE INDEX IF NOT EXISTS idx_jobs_status ON jobs (status, id)")
+
+    @staticmethod
+    def fingerprint(path: str) -> str:
+        """
+        Compute the fingerprint of a file on disk
+
+        Args:
+            path: File path
+
+        Returns:
+            String combining file size and modification time
+        """
+        stat = os.stat(path)
+        return f"{stat.st_size}:{stat.st_mtime_ns}"
+
+    def enqueue(self, filename: str, fingerprint: str, requires: str = "cpu") -> bool:
+        """
+        Add a job unless the same file version is already known
+
+        Args:
+            filename: File name relative to the watch directory
+            fingerprint: File fingerprint
+            requires: Capability a worker needs to run the job ("cpu" or "gpu")
+
+        Returns:
+            True if a new job was queued
+        """
+        with self._lock:
+            cursor = self._conn.execute(
+                "INSERT OR IGNORE INTO jobs (filename, fingerprint, enqueued_at, requires) VALUES (?, ?, ?, ?)",
+                (filename, fingerprint, time.time(), requires)
+            )
+            return cursor.rowcount == 1
+
+    def claim(self, worker_id: Optional[str] = None, capabilities: Optional[List[str]] = None,
+              lease_seconds: Optional[float] = None) -> Optional[Dict[str, Any]]:
+        """
+        Take the oldest pending job and mark it running
+
+        Args:
+            worker_id: Claiming worker, recorded as the lease holder (None = in-process worker)
+            capabilities: Only claim jobs requiring one of these; GPU-capable workers take GPU jobs first
+                          so CPU-only jobs are left for CPU nodes (None = any job)
+            lease_seconds: Lease length, the job is handed out again if not renewed in time (None = no lease)
+
+        Returns:
+            Job dictionary with "id", "filename", "attempts", "requires" and "enqueued_at",
+            or None if no matching job is pending
+        """
+        query = "SELECT id, filename, fingerprint, attempts, enqueued_at, requires FROM jobs WHERE status = 'pending'"
+        params: List[Any] = []
+        order = "id"
+        if capabilities is not None:
+            query += f" AND requires IN ({','.join('?' * len(capabilities))})"
+            params.extend(capabilities)
+            if "gpu" in capabilities:
+                order = "(requires = 'gpu') DESC, id"
+        now = time.time()
+        lease_expires = now + lease_seconds if lease_seconds else None
+        with self._lock:
+            row = self._conn.execute(f"{query} ORDER BY {order} LIMIT 1", params).fetchone()
+            if row is None:
+                return None
+            self._conn.execute(
+                "UPDATE jobs SET status = 'running', started_at = ?, attempts = attempts + 1, "
+                "worker_id = ?, lease_expires = ? WHERE id = ?",
+                (now, worker_id, lease_expires, row["id"])
+            )
+            job = dict(row)
+            job["attempts"] += 1
+            return job
+
+    def heartbeat(self, worker_id: str, job_ids: List[int], lease_seconds: float) -> List[int]:
+        """
+        Renew the leases a worker holds
+
+        Args:
+            worker_id: Lease holder
+            job_ids: Jobs the worker is running
+            lease_seconds: New lease length from now
+
+        Returns:
+            Ids whose lease was renewed; missing ids were expired and handed to another worker
+        """
+        held = []
+        lease_expires = time.time() + lease_seconds
+        with self._lock:
+            for job_id in job_ids:
+                cursor = self._conn.execute(
+                    "UPDATE jobs SET lease_expires = ? WHERE id = ? AND status = 'running' AND worker_id = ?",
+                    (lease_expires, job_id, worker_id)
+                )
+                if cursor.rowcount == 1:
+                    held.append(job_id)
+        return held
+
+    def expired(self) -> List[Dict[str, Any]]:
+        """
+        Running jobs whose lease has run out
+
+        Returns:
+            Job dictionaries with "id", "filename", "attempts", "worker_id" and "started_at"
+        """
+        with self._lock:
+            rows = self._conn.execute(
+                "SELECT id, filename, attempts, worker_id, started_at FROM jobs "
+                "WHERE status = 'running' AND lease_expires IS NOT NULL AND lease_expires < ? ORDER BY id",
+                (time.time(),)
+            ).fetchall()
+        return [dict(row) for row in rows]
+
+    def retry(self, job_id: int, max_attempts: int, worker_id: Optional[str] = None) -> bool:
+        """
+        Return a running job to the queue unless it has used up its attempts
+
+        Args:
+            job_id: Job id
+            max_attempts: Attempts allowed in total
+            worker_id: Only retry while this worker still holds the job (None = any holder)
+
+        Returns:
+            True if the job was re-queued, False if it is out of attempts or no longer held
+        """
+        query = "UPDATE jobs SET status = 'pending', started_at = NULL, worker_id = NULL, lease_expires = NULL " \
+                "WHERE id = ? AND status = 'running' AND attempts < ?"
+        params: List[Any] = [job_id, max_attempts]
+        if worker_id is not None:
+            query += " AND worker_id = ?"
+            params.append(worker_id)
+        with self._lock:
+            return self._conn.execute(query, params).rowcount == 1
+
+    def get(self, job_id: int) -> Optional[Dict[str, Any]]:
+        """
+        Look up one job
+
+        Returns:
+            Job dictionary without the stored result, or None if the id is unknown
+        """
+        with self._lock:
+            row = self._conn.execute(
+                "SELECT id, filename, fingerprint, status, attempts, requires, worker_id, lease_expires, "
+                "enqueued_at, started_at FROM jobs WHERE id = ?",
+                (job_id,)
+            ).fetchone()
+        return dict(row) if row is not None else None
+
+    def running(self) -> List[Dict[str, Any]]:
+        """
+        Jobs currently running, oldest first
+
+        Returns:
+            Job dictionaries with "id", "filename", "requires", "worker_id", "attempts", "started_at" and "lease_expires"
+        """
+        with self._lock:
+            rows = self._conn.execute(
+                "SELECT id, filename, requires, worker_id, attempts, started_at, lease_expires FROM jobs "
+                "WHERE status = 'running' ORDER BY id"
+            ).fetchall()
+        return [dict(row) for row in rows]
+
+    def complete(self, job_id: int, result: Dict[str, Any], worker_id: Optional[str] = None) -> bool:
+        """
+        Record a finished job
+
+        Args:
+            job_id: Job id returned by claim
+            result: Processing result, its "status" decides completed or failed
+            worker_id: Only accept the result while this worker holds the lease (None = unconditional)
+
+        Returns:
+            True if the result was recorded, False if the lease had already been lost
+        """
+        status = "failed" if result.get("status") == "failed" else "completed"
+        query = "UPDATE jobs SET status = ?, finished_at = ?, result = ?, error = ?, lease_expires = NULL WHERE id = ?"
+        params: List[Any] = [status, time.time(), json.dumps(result, ensure_ascii=False, default=str),
+                             result.get("error"), job_id]
+        if worker_id is not None:
+            query += " AND status = 'running' AND worker_id = ?"
+            params.append(worker_id)
+        with self._lock:
+            return self._conn.execute(query, params).rowcount == 1
+
+    def recover(self, keep_leases: bool = False) -> int:
+        """
+        Return jobs left running by a previous process to the pending state
+
+        Args:
+            keep_leases: Leave jobs leased to remote workers untouched; they are still running
+                         elsewhere and are re-queued by the lease reaper if they are not renewed
+
+        Returns:
+            Number of jobs re-queued
+        """
+        query = "UPDATE jobs SET status = 'pending', started_at = NULL, worker_id = NULL, lease_expires = NULL " \
+                "WHERE status = 'running'"
+        if keep_leases:
+            query += " AND lease_expires IS NULL"
+        with self._lock:
+            cursor = self._conn.execute(query)
+            return cursor.rowcount
+
+    def filenames(self, status: str) -> List[str]:
+        """
+        List the file names of jobs in a given state, oldest first
+
+        Args:
+            status: "pending", "running", "completed" or "failed"
+
+        Returns:
+            List of file names
+        """
+        with self._lock:
+            rows = self._conn.execute("SELECT filename FROM jobs WHERE status = ? ORDER BY id", (status,)).fetchall()
+        return [row["filename"] for row in rows]
+
+    def load_results(self, status: str) -> List[Dict[str, Any]]:
+        """
+        Load stored processing results that have not been cleared
+
+        Args:
+            status: "completed" or "failed"
+
+        Returns:
+            List of result dictionaries, oldest first
+        """
+        with self._lock:
+            rows = self._conn.execute(
+                "SELECT result FROM jobs WHERE status = ? AND archived = 0 AND result IS NOT NULL ORDER BY id",
+                (status,)
+            ).fetchall()
+        results = []
+        for row in rows:
+            try:
+                results.append(json.loads(row["result"]))
+            except ValueError:
+                continue
+        return results
+
+    def archive(self, status: str):
+        """
+        Hide finished jobs from the history while keeping them for de-duplication
+
+        Args:
+            status: "completed" or "failed"
+        """
+        with self._lock:
+            self._conn.execute("UPDATE jobs SET archived = 1 WHERE status = ?", (status,))
+
+    def get_counts(self) -> Dict[str, int]:
+        """
+        Get the number of jobs per state
+
+        Returns:
+            Dictionary with pending, running, completed and failed counts
+        """
+        counts = {"pending": 0, "running": 0, "completed": 0, "failed": 0}
+        with self._lock:
+            for row in self._conn.execute("SELECT status, COUNT(*) AS n FROM jobs GROUP BY status"):
+                counts[row["status"]] = row["n"]
+        return counts
+
+    def get_pending_requirements(self) -> Dict[str, int]:
+        """
+        Get the number of pending jobs per required capability
+
+        Returns:
+            Dictionary such as {"cpu": 3, "gpu": 5}
+        """
+        with self._lock:
+            rows = self._conn.execute(
+                "SELECT requires, COUNT(*) AS n FROM jobs WHERE status = 'pending' GROUP BY requires"
+            ).fetchall()
+        return {row["requires"]: row["n"] for row in rows}
+
+    def close(self):
+        """
+        Close the database connection
+        """
+        with self._lock:
+            self._conn.close()
@@ -0,0 +1,341 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Metrics and Tracing
+Process-wide counters, gauges and histograms rendered in the Prometheus text exposition format,
+plus optional OpenTelemetry spans when the SDK is installed and tracing is enabled
+"""
+
+import sys
+import time
+import math
+import threading
+import contextlib
+import logging
+from typing import Callable, Dict, Any, Iterable, List, Optional, Tuple
+
+logger = logging.getLogger(__name__)
+
+# Latency buckets in seconds, from a cached SAM decode up to a full 8K workflow
+DEFAULT_BUCKETS = (0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0, 120.0)
+# Payload buckets in bytes, 1 KiB to 256 MiB
+BYTE_BUCKETS = tuple(float(1024 * 4 ** i) for i in range(10))
+INF_BUCKET = 'le="+Inf"'
+
+
+def _format_value(value: float) -> str:
+    if value == math.inf:
+        return "+Inf"
+    if value == -math.inf:
+        return "-Inf"
+    if float(value).is_integer():
+        return str(int(value))
+    return repr(float(value))
+
+
+def _format_labels(names: Tuple[str, ...], values: Tuple[str, ...], extra: str = "") -> str:
+    parts = [f'{name}="{_escape(value)}"' for name, value in zip(names, values)]
+    if extra:
+        parts.append(extra)
+    return "{" + ",".join(parts) + "}" if parts else ""
+
+
+def _escape(value: str) -> str:
+    return str(value).replace("\\", "\\\\").replace("\n", "\\n").replace('"', '\\"')
+
+
+class _Metric:
+    """Base class: one metric family, one value per label combination"""
+
+    type = ""
+
+    def __init__(self, name: str, help: str, labels: Iterable[str] = ()):
+        self.name = name
+        self.help = help
+        self.labelnames = tuple(labels)
+        self._values: Dict[Tuple[str, ...], Any] = {}
+        self._lock = threading.Lock()
+
+    def _key(self, labels: Dict[str, Any]) -> Tuple[str, ...]:
+        # Labels not declared by the metric are ignored, missing ones are empty
+        return tuple(str(labels.get(name, "")) for name in self.labelnames)
+
+    def render(self) -> List[str]:
+        lines = [f"# HELP {self.name} {self.help}", f"# TYPE {self.name} {self.type}"]
+        with self._lock:
+            items = list(self._values.items())
+        for key, value in items:
+            lines.append(f"{self.name}{_format_labels(self.labelnames, key)} {_format_value(value)}")
+        return lines
+
+
+class Counter(_Metric):
+    """Monotonically increasing value"""
+
+    type = "counter"
+
+    def inc(self, amount: float = 1.0, **labels):
+        key = self._key(labels)
+        with self._lock:
+            self._values[key] = self._values.get(key, 0.0) + amount
+
+    def get(self, **labels) -> float:
+        with self._lock:
+            return self._values.get(self._key(labels), 0.0)
+
+
+class Gauge(_Metric):
+    """Value that can go up and down"""
+
+    type = "gauge"
+
+    def set(self, value: float, **labels):
+        with self._lock:
+            self._values[self._key(labels)] = value
+
+    def inc(self, amount: float = 1.0, **labels):
+        key = self._key(labels)
+        with self._lock:
+            self._values[key] = self._values.get(key, 0.0) + amount
+
+    def dec(self, amount: float = 1.0, **labels):
+        self.inc(-amount, **labels)
+
+
+class Histogram(_Metric):
+    """Cumulative bucket counts, sum and count per label combination"""
+
+    type = "histogram"
+
+    def __init__(self, name: str, help: str, labels: Iterable[str] = (), buckets: Iterable[float] = DEFAULT_BUCKETS):
+        super().__init__(name, help, labels)
+        self.buckets = tuple(sorted(buckets))
+
+    def observe(self, value: float, **labels):
+        key = self._key(labels)
+        with self._lock:
+            state = self._values.get(key)
+            if state is None:
+                state = self._values[key] = [[0] * len(self.buckets), 0.0, 0]
+            for i, bound in enumerate(self.buckets):
+                if value <= bound:
+                    state[0][i] += 1
+                    break
+            state[1] += value
+            state[2] += 1
+
+    @contextlib.contextmanager
+    def time(self, **labels):
+        """Observe the duration of a block in seconds"""
+        started = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.observe(time.perf_counter() - started, **labels)
+
+    def render(self) -> List[str]:
+        lines = [f"# HELP {self.name} {self.help}", f"# TYPE {self.name} {self.type}"]
+        with self._lock:
+            items = [(key, list(state[0]), state[1], state[2]) for key, state in self._values.items()]
+        for key, counts, total, count in items:
+            cumulative = 0
+            for bound, bucket_count in zip(self.buckets, counts):
+                cumulative += bucket_count
+                le = f'le="{_format_value(bound)}"'
+                lines.append(f"{self.name}_bucket{_format_labels(self.labelnames, key, le)} {cumulative}")
+            lines.append(f"{self.name}_bucket{_format_labels(self.labelnames, key, INF_BUCKET)} {count}")
+            lines.append(f"{self.name}_sum{_format_labels(self.labelnames, key)} {_format_value(total)}")
+            lines.append(f"{self.name}_count{_format_labels(self.labelnames, key)} {count}")
+        return lines
+
+
+# Collector output: (name, type, help, [(labels, value), ...])
+CollectorSample = Tuple[str, str, str, List[Tuple[Dict[str, Any], float]]]
+
+
+class MetricsRegistry:
+    """
+    Named metric families plus collectors evaluated at scrape time
+    (for values another component already tracks, e.g. queue depths and cache hit counts)
+    """
+
+    def __init__(self):
+        self._metrics: Dict[str, _Metric] = {}
+        self._collectors: Dict[str, Callable[[], Iterable[CollectorSample]]] = {}
+        self._lock = threading.Lock()
+
+    def _get_or_create(self, cls, name: str, help: str, labels: Iterable[str], **kwargs) -> _Metric:
+        with self._lock:
+            metric = self._metrics.get(name)
+            if metric is None:
+                metric = self._metrics[name] = cls(name, help, labels, **kwargs)
+            elif not isinstance(metric, cls):
+                raise ValueError(f"Metric {name} already registered as {metric.type}")
+            return metric
+
+    def counter(self, name: str, help: str, labels: Iterable[str] = ()) -> Counter:
+        return self._get_or_create(Counter, name, help, labels)
+
+    def gauge(self, name: str, help: str, labels: Iterable[str] = ()) -> Gauge:
+        return self._get_or_create(Gauge, name, help, labels)
+
+    def histogram(self, name: str, help: str, labels: Iterable[str] = (),
+                  buckets: Iterable[float] = DEFAULT_BUCKETS) -> Histogram:
+        return self._get_or_create(Histogram, name, help, labels, buckets=buckets)
+
+    def register_collector(self, key: str, collector: Callable[[], Iterable[CollectorSample]]):
+        """
+        Register a scrape-time collector; registering the same key again replaces it
+
+        Args:
+            key: Collector identity (e.g. "workflow")
+            collector: Callable returning (name, type, help, samples) tuples
+        """
+        with self._lock:
+            self._collectors[key] = collector
+
+    def render(self) -> str:
+        """
+        Render every metric in the Prometheus text exposition format (version 0.0.4)
+        """
+        with self._lock:
+            metrics = list(self._metrics.values())
+            collectors = list(self._collectors.items())
+        lines = []
+        for metric in metrics:
+            lines.extend(metric.render())
+        for key, collector in collectors:
+            try:
+                families = list(collector())
+            except Exception as e:
+                logger.warning(f"Metrics collector {key} failed: {str(e)}")
+                continue
+            for name, metric_type, help, samples in families:
+                lines.append(f"# HELP {name} {help}")
+                lines.append(f"# TYPE {name} {metric_type}")
+                for labels, value in samples:
+                    names = tuple(labels)
+                    values = tuple(str(labels[n]) for n in names)
+                    lines.append(f"{name}{_format_labels(names, values)} {_format_value(value)}")
+        return "\n".join(lines) + "\n"
+
+
+REGISTRY = MetricsRegistry()
+
+
+def counter(name: str, help: str, labels: Iterable[str] = ()) -> Counter:
+    return REGISTRY.counter(name, help, labels)
+
+
+def gauge(name: str, help: str, labels: Iterable[str] = ()) -> Gauge:
+    return REGISTRY.gauge(name, help, labels)
+
+
+def histogram(name: str, help: str, labels: Iterable[str] = (), buckets: Iterable[float] = DEFAULT_BUCKETS) -> Histogram:
+    return REGISTRY.histogram(name, help, labels, buckets)
+
+
+def _collect_gpu_memory() -> List[CollectorSample]:
+    # Only reported when torch is already loaded by a model, scraping never imports it
+    torch = sys.modules.get("torch")
+    if torch is None or not torch.cuda.is_available():
+        return []
+    allocated, reserved, peak = [], [], []
+    for device in range(torch.cuda.device_count()):
+        labels = {"device": str(device)}
+        allocated.append((labels, torch.cuda.memory_allocated(device)))
+        reserved.append((labels, torch.cuda.memory_reserved(device)))
+        peak.append((labels, torch.cuda.max_memory_allocated(device)))
+    return [
+        ("amber_gpu_memory_allocated_bytes", "gauge", "CUDA memory allocated by tensors", allocated),
+        ("amber_gpu_memory_reserved_bytes", "gauge", "CUDA memory reserved by the caching allocator", reserved),
+        ("amber_gpu_memory_peak_bytes", "gauge", "Peak CUDA memory allocated since start", peak)
+    ]
+
+
+REGISTRY.register_collector("gpu", _collect_gpu_memory)
+
+# Shared by every lazily loaded model (SAM2, LaMa, ...)
+MODEL_LOAD_SECONDS = gauge("amber_model_load_seconds", "Wall time of the last load of each model", ["model"])
+
+
+# ---------------------------------------------------------------------- tracing
+
+_tracer = None
+
+
+def configure_tracing(service_name: str = "amberpipeline", endpoint: str = "") -> bool:
+    """
+    Enable OpenTelemetry spans
+
+    Args:
+        service_name: service.name resource attribute
+        endpoint: OTLP/HTTP traces endpoint (e.g. http://localhost:4318/v1/traces); spans go to stdout when empty
+
+    Returns:
+        True if tracing was enabled, False if the OpenTelemetry SDK is not installed
+    """
+    global _tracer
+    try:
+        from opentelemetry import trace
+        from opentelemetry.sdk.resources import Resource
+        from opentelemetry.sdk.trace import TracerProvider
+        from opentelemetry.sdk.trace.export import BatchSpanProcessor, ConsoleSpanExporter
+    except ImportError:
+        logger.warning("OpenTelemetry SDK not installed, tracing disabled")
+        return False
+
+    exporter = ConsoleSpanExporter()
+    if endpoint:
+        try:
+            from opentelemetry.exporter.otlp.proto.http.trace_exporter import OTLPSpanExporter
+            exporter = OTLPSpanExporter(endpoint=endpoint)
+        except ImportError:
+            logger.warning("OTLP exporter not installed, writing spans to stdout")
+
+    provider = TracerProvider(resource=Resource.create({"service.name": service_name}))
+    provider.add_span_processor(BatchSpanProcessor(exporter))
+    trace.set_tracer_provider(provider)
+    _tracer = trace.get_tracer("amberpipeline")
+    logger.info(f"OpenTelemetry tracing enabled ({endpoint or 'console'})")
+    return True
+
+
+def tracing_enabled() -> bool:
+    return _tracer is not None
+
+
+@contextlib.contextmanager
+def span(name: str, **attributes):
+    """
+    Open a trace span around a block (no-op unless configure_tracing succeeded)
+    Spans started on the same thread nest automatically
+
+    Yields:
+        The OpenTelemetry span, or None when tracing is disabled
+    """
+    if _tracer is None:
+        yield None
+        return
+    attributes = {k: v for k, v in attributes.items() if isinstance(v, (str, bool, int, float))}
+    with _tracer.start_as_current_span(name, attributes=attributes) as current:
+        yield current
+
+
+@contextlib.contextmanager
+def timed(name: str, metric: Optional[Histogram] = None, **attributes):
+    """
+    Trace a block as a span and observe its duration (seconds) in a histogram
+    Attributes double as histogram labels; ones the histogram does not declare are only set on the span
+
+    Yields:
+        Dictionary that receives "seconds" when the block exits
+    """
+    timing = {"seconds": 0.0}
+    started = time.perf_counter()
+    with span(name, **attributes):
+        try:
+            yield timing
+        finally:
+            timing["seconds"] = time.perf_counter() - started
+            if metric is not None:
+                metric.observe(timing["seconds"], **attributes)
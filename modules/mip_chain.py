@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Mip Chain Builder
+Builds a full mip/LOD chain in a single pass: each level is filtered from the
+previous one in premultiplied-alpha float32, so transparent texels never bleed
+their color into visible neighbours
+"""
+
+import numpy as np
+import cv2
+from PIL import Image
+
+# Downsampling filters; OpenCV's area and Lanczos resizers are SIMD-vectorized
+MIP_FILTERS = {
+    "box": cv2.INTER_AREA,
+    "lanczos": cv2.INTER_LANCZOS4
+}
+
+
+def mip_level_count(width: int, height: int, min_size: int = 1) -> int:
+    """
+    Number of levels in a full chain, including the base level
+
+    Args:
+        width: Base level width
+        height: Base level height
+        min_size: Smallest edge length to stop at
+
+    Returns:
+        Level count
+    """
+    count = 1
+    while max(width, height) > min_size:
+        width = max(min_size, width // 2)
+        height = max(min_size, height // 2)
+        count += 1
+    return count
+
+
+def build_mip_chain(image, levels: int = 0, min_size: int = 1, filter: str = "box") -> list:
+    """
+    Build a mip chain
+
+    Args:
+        image: PIL Image or uint8 numpy array (H, W, 4) / (H, W, 3)
+        levels: Number of levels including the base level, 0 for a full chain
+        min_size: Edge lengths are clamped to this value (1 gives a chain down to 1x1)
+        filter: "box" (2x2 area average) or "lanczos"
+
+    Returns:
+        List of uint8 RGBA arrays from largest to smallest; the base level is the input
+    """
+    if isinstance(image, Image.Image):
+        if image.mode != 'RGBA':
+            image = image.convert('RGBA')
+        base = np.asarray(image)
+    else:
+        base = image
+        if base.ndim == 3 and base.shape[2] == 3:
+            base = cv2.cvtColor(base, cv2.COLOR_RGB2RGBA)
+    base = np.ascontiguousarray(base, dtype=np.uint8)
+
+    interpolation = MIP_FILTERS.get(filter, cv2.INTER_AREA)
+    height, width = base.shape[:2]
+    if levels <= 0:
+        levels = mip_level_count(width, height, min_size)
+
+    chain = [base]
+    if levels == 1:
+        return chain
+
+    # Premultiply once; intermediate levels stay float32 so rounding never accumulates
+    current = base.astype(np.float32)
+    alpha = current[:, :, 3:4] * (1.0 / 255.0)
+    current[:, :, :3] *= alpha
+
+    for _ in range(1, levels):
+        width = max(min_size, width // 2)
+        height = max(min_size, height // 2)
+        if (width, height) != (current.shape[1], current.shape[0]):
+            current = cv2.resize(current, (width, height), interpolation=interpolation)
+            if interpolation != cv2.INTER_AREA:
+                # Lanczos overshoots, keep premultiplied values valid
+                np.clip(current, 0.0, 255.0, out=current)
+        chain.append(unpremultiply(current))
+    return chain
+
+
+def unpremultiply(premultiplied: np.ndarray) -> np.ndarray:
+    """
+    Convert a premultiplied float32 level back to straight-alpha uint8
+    """
+    alpha = premultiplied[:, :, 3:4]
+    scale = np.divide(255.0, alpha, out=np.zeros_like(alpha), where=alpha > 0.0)
+    straight = np.empty_like(premultiplied)
+    np.multiply(premultiplied[:, :, :3], scale, out=straight[:, :, :3])
+    straight[:, :, 3:4] = alpha
+    np.clip(straight, 0.0, 255.0, out=straight)
+    return (straight + 0.5).astype(np.uint8)
@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Prepared Model Cache
+On-disk cache of models prepared for fast cold starts: checkpoints converted once to safetensors
+(memory-mapped and loaded straight onto the target device) and torch.compile artifacts stored per
+device and dtype, shared by every process that loads the same checkpoint
+"""
+
+import os
+import json
+import time
+import hashlib
+import logging
+from typing import Dict, Any
+
+logger = logging.getLogger(__name__)
+
+# Checkpoint file name markers and the SAM2 config they use, checked in order (2.1 before 2.0)
+SAM2_CONFIGS = (
+    ("2.1_hiera_tiny", "configs/sam2.1/sam2.1_hiera_t.yaml"),
+    ("2.1_hiera_t", "configs/sam2.1/sam2.1_hiera_t.yaml"),
+    ("2.1_hiera_s", "configs/sam2.1/sam2.1_hiera_s.yaml"),
+    ("2.1_hiera_l", "configs/sam2.1/sam2.1_hiera_l.yaml"),
+    ("2.1_hiera_b", "configs/sam2.1/sam2.1_hiera_b+.yaml"),
+    ("hiera_tiny", "configs/sam2/sam2_hiera_t.yaml"),
+    ("hiera_t", "configs/sam2/sam2_hiera_t.yaml"),
+    ("hiera_s", "configs/sam2/sam2_hiera_s.yaml"),
+    ("hiera_l", "configs/sam2/sam2_hiera_l.yaml"),
+    ("hiera_b", "configs/sam2/sam2_hiera_b+.yaml"),
+)
+DEFAULT_SAM2_CONFIG = "configs/sam2/sam2_hiera_t.yaml"
+
+
+def sam2_config_for(model_path: str, override: str = "") -> str:
+    """
+    SAM2 model config for a checkpoint, relative to the sam2 package
+
+    Args:
+        model_path: Checkpoint path
+        override: Explicit config (sam_model_config), used as-is when set
+
+    Returns:
+        Config name such as "configs/sam2.1/sam2.1_hiera_t.yaml"
+    """
+    if override:
+        return override
+    name = os.path.basename(model_path).lower()
+    for marker, config_name in SAM2_CONFIGS:
+        if marker in name:
+            return config_name
+    return DEFAULT_SAM2_CONFIG
+
+
+class PreparedModelCache:
+    """
+    Content-keyed cache of prepared model artifacts
+    Keys combine the checkpoint path, size and modification time, so replacing a checkpoint
+    invalidates its prepared weights and compiled graphs
+    """
+
+    def __init__(self, cache_dir: str):
+        """
+        Args:
+            cache_dir: Cache directory, created on first write
+        """
+        self.cache_dir = cache_dir
+
+    @staticmethod
+    def source_key(path: str) -> str:
+        """
+        Cache key of a checkpoint file
+        """
+        stat = os.stat(path)
+        identity = f"{os.path.abspath(path)}:{stat.st_size}:{stat.st_mtime_ns}"
+        return hashlib.sha1(identity.encode("utf-8")).hexdigest()[:16]
+
+    def _path(self, source_path: str, suffix: str) -> str:
+        stem = os.path.splitext(os.path.basename(source_path))[0]
+        return os.path.join(self.cache_dir, f"{stem}-{self.source_key(source_path)}{suffix}")
+
+    def load_weights(self, source_path: str, device: str = "cpu") -> Dict[str, Any]:
+        """
+        Load a checkpoint's state dict, preparing the safetensors copy on first use
+
+        Args:
+            source_path: Original .pt checkpoint
+            device: Device the tensors are loaded onto ("cpu", "cuda", ...)
+
+        Returns:
+            State dict (the checkpoint's "model" entry when present)
+        """
+        import torch
+
+        prepared = self._path(source_path, ".safetensors")
+        safetensors = _import_safetensors()
+        if safetensors is not None and os.path.exists(prepared):
+            started = time.perf_counter()
+            # Memory-mapped: only touched pages are read, tensors go straight to the target device
+            state_dict = safetensors.load_file(prepared, device=str(device))
+            logger.info(f"Loaded prepared weights {os.path.basename(prepared)} "
+                        f"({(time.perf_counter() - started) * 1000:.0f} ms)")
+            return state_dict
+
+        checkpoint = _torch_load(torch, source_path)
+        state_dict = checkpoint["model"] if isinstance(checkpoint, dict) and "model" in checkpoint else checkpoint
+        if safetensors is None:
+            logger.info("safetensors not installed, loading the checkpoint without a prepared copy")
+        else:
+            self._store_weights(safetensors, source_path, prepared, state_dict)
+        if str(device) != "cpu":
+            state_dict = {name: tensor.to(device, non_blocking=True) for name, tensor in state_dict.items()}
+        return state_dict
+
+    def _store_weights(self, safetensors, source_path: str, prepared: str, state_dict: Dict[str, Any]):
+        os.makedirs(self.cache_dir, exist_ok=True)
+        partial = f"{prepared}.{os.getpid()}.part"
+        try:
+            # safetensors rejects views and shared storage, every entry is written as its own tensor
+            tensors = {name: tensor.detach().contiguous().clone() for name, tensor in state_dict.items()
+                       if hasattr(tensor, "detach")}
+            safetensors.save_file(tensors, partial, metadata={"source": os.path.basename(source_path)})
+            os.replace(partial, prepared)
+            logger.info(f"Prepared weights written to {prepared}")
+        except Exception as e:
+            logger.warning(f"Could not prepare weights for {source_path}: {str(e)}")
+            if os.path.exists(partial):
+                os.remove(partial)
+
+    def compile_dir(self, source_path: str, device: str, dtype: str) -> str:
+        """
+        Directory holding compiled graphs of one checkpoint for one device kind, dtype and torch version
+        """
+        import torch
+
+        device_kind = str(device).split(":")[0]
+        if device_kind == "cuda" and torch.cuda.is_available():
+            # Kernels are tuned per GPU model, one cache per device name
+            device_kind = torch.cuda.get_device_name(torch.device(device)).replace(" ", "_")
+        tag = f"torch{torch.__version__.split('+')[0]}-{device_kind}-{dtype}"
+        return os.path.join(self._path(source_path, ""), "compiled", tag)
+
+    def enable_compile_cache(self, source_path: str, device: str, dtype: str) -> str:
+        """
+        Point torch.compile's on-disk caches at this model's directory and load saved artifacts,
+        so a later process reuses the compiled graph instead of recompiling it
+
+        Must run before the first call of the compiled module
+
+        Returns:
+            Compile cache directory
+        """
+        import torch
+
+        directory = self.compile_dir(source_path, device, dtype)
+        os.makedirs(directory, exist_ok=True)
+        os.environ.setdefault("TORCHINDUCTOR_CACHE_DIR", os.path.join(directory, "inductor"))
+        os.environ.setdefault("TORCHINDUCTOR_FX_GRAPH_CACHE", "1")
+        os.environ.setdefault("TORCHINDUCTOR_AUTOGRAD_CACHE", "1")
+        try:
+            import torch._inductor.config as inductor_config
+            inductor_config.fx_graph_cache = True
+        except (ImportError, AttributeError):
+            pass
+
+        artifacts = os.path.join(directory, "artifacts.bin")
+        load = getattr(torch.compiler, "load_cache_artifacts", None)
+        if load is not None and os.path.exists(artifacts):
+            try:
+                with open(artifacts, "rb") as f:
+                    load(f.read())
+                logger.info(f"Loaded compiled graph artifacts from {directory}")
+            except Exception as e:
+                logger.warning(f"Ignoring unreadable compile artifacts {artifacts}: {str(e)}")
+        return directory
+
+    def save_compile_artifacts(self, source_path: str, device: str, dtype: str) -> bool:
+        """
+        Store the compile artifacts produced so far (call after the compiled module has run once)
+
+        Returns:
+            True if artifacts were written (needs torch.compiler.save_cache_artifacts, PyTorch 2.7+)
+        """
+        import torch
+
+        save = getattr(torch.compiler, "save_cache_artifacts", None)
+        if save is None:
+            return False
+        saved = save()
+        if not saved:
+            return False
+        data = saved[0]
+        directory = self.compile_dir(source_path, device, dtype)
+        os.makedirs(directory, exist_ok=True)
+        artifacts = os.path.join(directory, "artifacts.bin")
+        partial = f"{artifacts}.{os.getpid()}.part"
+        with open(partial, "wb") as f:
+            f.write(data)
+        os.replace(partial, artifacts)
+        with open(os.path.join(directory, "manifest.json"), "w", encoding="utf-8") as f:
+            json.dump({"source": os.path.abspath(source_path), "device": str(device), "dtype": dtype,
+                       "torch": torch.__version__, "saved_at": time.time(), "bytes": len(data)}, f, indent=2)
+        logger.info(f"Saved compiled graph artifacts ({len(data)} bytes) to {directory}")
+        return True
+
+
+def _import_safetensors():
+    try:
+        import safetensors.torch
+        return safetensors.torch
+    except ImportError:
+        return None
+
+
+def _torch_load(torch, path: str) -> Any:
+    """
+    torch.load with mmap and weights_only where the installed torch supports them
+    """
+    try:
+        return torch.load(path, map_location="cpu", mmap=True, weights_only=True)
+    except TypeError:
+        return torch.load(path, map_location="cpu")
+    except Exception:
+        # Legacy (non-zip) checkpoints cannot be memory-mapped, older ones may hold non-tensor objects
+        return torch.load(path, map_location="cpu", weights_only=False)
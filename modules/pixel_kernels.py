@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Fused Pixel Kernels
+Fast paths for ImageProcessor stages. Every pass runs in native code (PIL/OpenCV, SIMD,
+GIL released) and full-frame temporaries are avoided. The alpha bounds of an image are
+scanned once and passed on to the images derived from it, so align_bottom,
+generate_shadow and box_collision share a single scan.
+"""
+
+import hashlib
+import threading
+from collections import OrderedDict
+from typing import Optional, Tuple
+import numpy as np
+import cv2
+from PIL import Image, ImageDraw
+
+# Rows per seamless blend chunk, bounds the float32 temporaries
+SEAMLESS_CHUNK_ROWS = 128
+
+# Alpha bounds by alpha-channel digest, so an image modified in place is scanned again
+_bounds_cache = OrderedDict()
+_bounds_lock = threading.Lock()
+BOUNDS_CACHE_ENTRIES = 256
+
+
+def _scan_alpha_bounds(image: Image.Image) -> Optional[Tuple[int, int, int, int]]:
+    if image.mode != "RGBA":
+        return image.getbbox()
+    try:
+        return image.getbbox(alpha_only=True)
+    except TypeError:
+        # Pillow < 9.4 has no alpha_only argument
+        return image.getchannel("A").getbbox()
+
+
+def alpha_bounds(image: Image.Image) -> Optional[Tuple[int, int, int, int]]:
+    """
+    Bounds of the non-transparent area, same as image.split()[3].getbbox()
+    Scanned once per image; kernels that produce a new image record its bounds directly
+
+    Args:
+        image: RGBA image
+
+    Returns:
+        (left, top, right, bottom) or None if fully transparent
+    """
+    key = _bounds_key(image)
+    with _bounds_lock:
+        if key in _bounds_cache:
+            _bounds_cache.move_to_end(key)
+            return _bounds_cache[key]
+    bounds = _scan_alpha_bounds(image)
+    _remember_bounds(key, bounds)
+    return bounds
+
+
+def set_alpha_bounds(image: Image.Image, bounds: Optional[Tuple[int, int, int, int]]):
+    """
+    Record the known alpha bounds of an image's current content
+    """
+    _remember_bounds(_bounds_key(image), bounds)
+
+
+def _bounds_key(image: Image.Image) -> tuple:
+    """
+    Content key of the bounds: mode, size and a digest of the channel the bounds derive from
+    """
+    channel = image.getchannel("A") if image.mode == "RGBA" else image
+    digest = hashlib.blake2b(channel.tobytes(), digest_size=16).digest()
+    return image.mode, image.size, digest
+
+
+def _remember_bounds(key: tuple, bounds: Optional[Tuple[int, int, int, int]]):
+    with _bounds_lock:
+        _bounds_cache[key] = bounds
+        _bounds_cache.move_to_end(key)
+        while len(_bounds_cache) > BOUNDS_CACHE_ENTRIES:
+            _bounds_cache.popitem(last=False)
+
+
+def align_bottom(image: Image.Image, padding: int = 0) -> Image.Image:
+    """
+    Bottom-center the non-transparent area (same result as ImageProcessor.align_bottom)
+    """
+    bbox = alpha_bounds(image)
+    if not bbox:
+        return image
+    width, height = bbox[2] - bbox[0], bbox[3] - bbox[1]
+    offset_x = (image.width - width) // 2
+    offset_y = image.height - height - padding
+
+    result = Image.new("RGBA", image.size, (0, 0, 0, 0))
+    result.paste(image.crop(bbox), (offset_x, offset_y))
+
+    # Content moved as a block, so the new bounds are known without another scan
+    left, top = max(0, offset_x), max(0, offset_y)
+    right, bottom = min(image.width, offset_x + width), min(image.height, offset_y + height)
+    set_alpha_bounds(result, (left, top, right, bottom) if left < right and top < bottom else None)
+    return result
+
+
+def generate_shadow(image: Image.Image, shadow_color: tuple = (0, 0, 0, 100),
+                    shadow_size: int = 50) -> Image.Image:
+    """
+    Elliptical shadow under the non-transparent area (same result as ImageProcessor.generate_shadow)
+    Compositing is limited to the shadow's bounding box; the rest of the frame is a plain copy
+    """
+    bbox = alpha_bounds(image)
+    if not bbox:
+        return image
+    shadow_x = (bbox[0] + bbox[2]) // 2 - shadow_size // 2
+    shadow_y = bbox[3] - shadow_size // 4
+    ellipse = [shadow_x, shadow_y, shadow_x + shadow_size, shadow_y + shadow_size // 2]
+
+    result = image.copy()
+    roi = (max(0, ellipse[0]), max(0, ellipse[1]),
+           min(image.width, ellipse[2] + 1), min(image.height, ellipse[3] + 1))
+    bounds = bbox
+    if roi[0] < roi[2] and roi[1] < roi[3]:
+        shadow = Image.new("RGBA", (roi[2] - roi[0], roi[3] - roi[1]), (0, 0, 0, 0))
+        ImageDraw.Draw(shadow).ellipse(
+            [ellipse[0] - roi[0], ellipse[1] - roi[1], ellipse[2] - roi[0], ellipse[3] - roi[1]],
+            fill=shadow_color
+        )
+        result.paste(Image.alpha_composite(shadow, result.crop(roi)), roi[:2])
+
+        shadow_bounds = _scan_alpha_bounds(shadow)
+        if shadow_bounds:
+            bounds = (min(bbox[0], roi[0] + shadow_bounds[0]), min(bbox[1], roi[1] + shadow_bounds[1]),
+                      max(bbox[2], roi[0] + shadow_bounds[2]), max(bbox[3], roi[1] + shadow_bounds[3]))
+    set_alpha_bounds(result, bounds)
+    return result
+
+
+def brightness_contrast_lut(brightness: float, contrast: float) -> np.ndarray:
+    """
+    256-entry table of (v * brightness_factor - 128) * contrast_factor + 128, clipped and truncated
+    like the per-channel float path
+
+    Args:
+        brightness: -100 to 100
+        contrast: -100 to 100
+
+    Returns:
+        uint8 array (256,)
+    """
+    values = np.arange(256, dtype=np.float64)
+    adjusted = (values * (1.0 + brightness / 100.0) - 128.0) * (1.0 + contrast / 100.0) + 128.0
+    return adjusted.clip(0, 255).astype(np.uint8)
+
+
+def adjust_brightness_contrast(image: Image.Image, brightness: float = 0.0, contrast: float = 0.0) -> Image.Image:
+    """
+    Brightness/contrast on the color channels through one LUT pass (alpha untouched)
+    """
+    array = np.array(image)
+    lut = brightness_contrast_lut(brightness, contrast)
+    channels = array.shape[2] if array.ndim == 3 else 1
+    if channels == 4:
+        # Identity table for alpha, so one in-place cv2.LUT covers all four channels
+        table = np.stack([lut, lut, lut, np.arange(256, dtype=np.uint8)], axis=1).reshape(1, 256, 4)
+    else:
+        table = np.ascontiguousarray(np.repeat(lut[:, None], channels, axis=1).reshape(1, 256, channels))
+    cv2.LUT(array, table, dst=array)
+    return Image.fromarray(array, image.mode)
+
+
+def seamless_weights(width: int, height: int) -> Tuple[np.ndarray, np.ndarray]:
+    """
+    Tent weights of the offset-and-blend seamless kernel, zero at the borders
+
+    Returns:
+        (weight_x (W,), weight_y (H,)) float32
+    """
+    weight_x = (1.0 - np.abs(np.arange(width, dtype=np.float32) * (2.0 / max(width - 1, 1)) - 1.0))
+    weight_y = (1.0 - np.abs(np.arange(height, dtype=np.float32) * (2.0 / max(height - 1, 1)) - 1.0))
+    return weight_x, weight_y
+
+
+def _blend_seamless_columns(rows: np.ndarray, weight_x: np.ndarray) -> np.ndarray:
+    """
+    Horizontal pass: premultiplied rows blended with themselves shifted by half the width
+    """
+    premultiplied = rows.astype(np.float32)
+    premultiplied[:, :, :3] *= premultiplied[:, :, 3:4]
+    weight = weight_x[None, :, None]
+    shifted = np.roll(premultiplied, rows.shape[1] // 2, axis=1)
+    premultiplied *= weight
+    shifted *= 1.0 - weight
+    premultiplied += shifted
+    return premultiplied
+
+
+def blend_seamless_rows(original: np.ndarray, rolled: np.ndarray, weight_y: np.ndarray,
+                        weight_x: np.ndarray, out: np.ndarray):
+    """
+    Blend one row chunk of the seamless kernel in premultiplied alpha
+
+    The blend is separable: each row set is first blended with itself shifted by half the
+    width (weight_x), then the two results are blended by weight_y. Each pass takes the
+    unshifted pixels where its shifted copy has the wrap seam and the shifted ones at the
+    borders, so neither the centre cross nor the borders show a seam, including where
+    they meet (a single product weight cannot satisfy both at e.g. (W/2, 0))
+
+    Args:
+        original: uint8 RGBA rows (N, W, 4)
+        rolled: The rows (y - H/2) mod H of the image, not shifted horizontally
+        weight_y: Tent weights of these rows (N,)
+        weight_x: Tent weights of the columns (W,)
+        out: uint8 (N, W, 4) receiving the result
+    """
+    weight = weight_y[:, None, None]
+    blended = _blend_seamless_columns(original, weight_x)
+    blended *= weight
+    shifted = _blend_seamless_columns(rolled, weight_x)
+    shifted *= 1.0 - weight
+    blended += shifted
+
+    color, alpha = blended[:, :, :3], blended[:, :, 3:4]
+    np.divide(color, alpha, out=color, where=alpha > 0)
+    out[:, :, :3] = np.rint(color).clip(0, 255)
+    out[:, :, 3:4] = np.rint(alpha).clip(0, 255)
+
+
+def make_seamless(image: Image.Image) -> Image.Image:
+    """
+    Offset-and-blend seamless tiling
+    The image is blended with itself shifted by half its width, then with that result shifted
+    by half its height, using tent weights that are zero at the borders: opposite edges come
+    from adjacent source pixels and the shifted copies' wrap seams are covered by unshifted
+    pixels, so the result tiles without seams. Blending is done in premultiplied alpha, in row chunks.
+    """
+    rgba = image if image.mode == "RGBA" else image.convert("RGBA")
+    source = np.asarray(rgba)
+    height, width = source.shape[:2]
+    result = np.empty_like(source)
+
+    rows_rolled = (np.arange(height) - height // 2) % height
+    weight_x, weight_y = seamless_weights(width, height)
+
+    for start in range(0, height, SEAMLESS_CHUNK_ROWS):
+        stop = min(height, start + SEAMLESS_CHUNK_ROWS)
+        rolled = source[rows_rolled[start:stop]]
+        blend_seamless_rows(source[start:stop], rolled, weight_y[start:stop], weight_x, result[start:stop])
+
+    return Image.fromarray(result, "RGBA")
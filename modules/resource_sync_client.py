@@ -0,0 +1,333 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Resource Sync Client
+Persistent connection to the ResourceSyncServer running inside the game (generated ResourceSyncServer.h).
+Only changed assets are sent, as block deltas against the version the game already holds,
+together with ID table updates for new names, so textures are hot-swapped without a rebuild
+"""
+
+import os
+import socket
+import struct
+import hashlib
+import threading
+import time
+import logging
+from typing import Dict, Iterable, List, Optional, Tuple
+
+from modules.asset_archive import ASSET_FORMATS, asset_id
+
+logger = logging.getLogger(__name__)
+
+SYNC_MAGIC = b"AMBS"
+SYNC_VERSION = 1
+
+# magic, protocol version, message type, payload length
+FRAME_FORMAT = "<4sHHI"
+FRAME_SIZE = struct.calcsize(FRAME_FORMAT)
+
+# Message types, mirrored by Assets::Sync::Message in the generated server
+MSG_HELLO = 1       # client: empty / server: u32 count + (u32 id, u64 version) per held asset
+MSG_ID_TABLE = 2    # u32 count + (u32 id, u16 name length, name) per entry
+MSG_ASSET = 3       # u32 id, u32 format, u64 version, u64 size, data
+MSG_DELTA = 4       # u32 id, u32 format, u64 base version, u64 version, u64 size, u32 block size,
+                    # u32 block count + (u32 block index, u32 length, data) per changed block
+MSG_REMOVE = 5      # u32 id
+MSG_ACK = 6         # server: u32 id, u64 version, u8 status
+
+ACK_APPLIED = 0
+ACK_NEED_FULL = 1   # The game does not hold the delta base (restarted or diverged), send the full asset
+ACK_ERROR = 2
+
+ASSET_HEADER_FORMAT = "<2I2Q"
+DELTA_HEADER_FORMAT = "<2I3Q2I"
+BLOCK_HEADER_FORMAT = "<2I"
+ACK_FORMAT = "<IQB"
+
+DELTA_BLOCK_SIZE = 4096
+# A delta larger than this share of the asset is sent as a full asset instead
+MAX_DELTA_RATIO = 0.5
+MAX_NAME_BYTES = 0xffff
+
+
+def content_version(data: bytes) -> int:
+    """
+    Version tag of an asset's bytes (BLAKE2b-64), opaque to the game
+    """
+    return int.from_bytes(hashlib.blake2b(data, digest_size=8).digest(), "little")
+
+
+def encode_delta(base: bytes, data: bytes, block_size: int = DELTA_BLOCK_SIZE) -> Tuple[List[Tuple[int, bytes]], int]:
+    """
+    Blocks of data that differ from base
+
+    Args:
+        base: Bytes the game holds
+        data: New bytes
+        block_size: Block granularity
+
+    Returns:
+        ([(block index, block bytes), ...], total payload bytes)
+    """
+    base_view, view = memoryview(base), memoryview(data)
+    blocks = []
+    total = 0
+    for index in range((len(data) + block_size - 1) // block_size):
+        start = index * block_size
+        block = view[start:start + block_size]
+        if base_view[start:start + block_size] != block:
+            blocks.append((index, block))
+            total += len(block) + struct.calcsize(BLOCK_HEADER_FORMAT)
+    return blocks, total
+
+
+class ResourceSyncClient:
+    """
+    Live sync channel to one game instance
+    The last sent bytes of each asset are kept as the delta base; on (re)connect the server reports
+    which versions it holds, so unchanged assets are skipped even after either side restarts
+    """
+
+    def __init__(self, host: str = "localhost", port: int = 8888, timeout: float = 2.0, retry_seconds: float = 2.0):
+        """
+        Args:
+            host: Game host running ResourceSyncServer
+            port: ResourceSyncServer port
+            timeout: Connect and reply timeout in seconds
+            retry_seconds: Minimum interval between reconnect attempts
+        """
+        self.host = host
+        self.port = port
+        self.timeout = timeout
+        self.retry_seconds = retry_seconds
+        self._sock: Optional[socket.socket] = None
+        self._lock = threading.RLock()
+        self._last_attempt = 0.0
+        self._failed_attempts = 0
+        self._server_versions: Dict[int, int] = {}  # held by the game, reported in HELLO and updated by ACKs
+        self._sent: Dict[int, bytes] = {}  # delta bases, valid while the game holds the matching version
+        self._names: Dict[int, str] = {}  # ID table the game has been sent
+        self._files: Dict[str, Tuple[int, int, int]] = {}  # path -> (size, mtime_ns, version), skips rehashing
+        self.stats = {"full": 0, "delta": 0, "unchanged": 0, "bytes": 0, "reconnects": 0}
+
+    # ------------------------------------------------------------------ connection
+
+    def connect(self) -> bool:
+        """
+        Connect and exchange HELLO (no-op when connected)
+
+        Returns:
+            True if connected
+        """
+        with self._lock:
+            if self._sock is not None:
+                return True
+            self._last_attempt = time.monotonic()
+            try:
+                sock = socket.create_connection((self.host, self.port), timeout=self.timeout)
+                sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                self._sock = sock
+                self._send(MSG_HELLO, b"")
+                message, payload = self._receive()
+                if message != MSG_HELLO:
+                    raise ConnectionError(f"Unexpected reply {message} to HELLO")
+                (count,) = struct.unpack_from("<I", payload, 0)
+                self._server_versions = dict(struct.iter_unpack("<IQ", payload[4:4 + count * 12]))
+            except (OSError, struct.error) as e:
+                # The game is often simply not running, only the first failure is reported
+                self._drop(f"connect to {self.host}:{self.port} failed: {str(e)}", quiet=self._failed_attempts > 0)
+                self._failed_attempts += 1
+                return False
+            self._failed_attempts = 0
+            # Delta bases the game no longer holds are useless, the names are re-sent
+            self._sent = {i: data for i, data in self._sent.items()
+                          if self._server_versions.get(i) == content_version(data)}
+            self._names = {}
+            self.stats["reconnects"] += 1
+            logger.info(f"Live sync connected to {self.host}:{self.port} "
+                        f"(game holds {len(self._server_versions)} asset(s))")
+            return True
+
+    def _ensure_connected(self) -> bool:
+        if self._sock is not None:
+            return True
+        if time.monotonic() - self._last_attempt < self.retry_seconds:
+            return False
+        return self.connect()
+
+    def close(self):
+        """
+        Close the connection, delta bases are kept for the next connect
+        """
+        with self._lock:
+            if self._sock is not None:
+                try:
+                    self._sock.close()
+                except OSError:
+                    pass
+                self._sock = None
+
+    def is_connected(self) -> bool:
+        return self._sock is not None
+
+    def _drop(self, reason: str, quiet: bool = False):
+        (logger.debug if quiet else logger.warning)(f"Live sync: {reason}")
+        self.close()
+
+    def _send(self, message: int, payload: bytes):
+        self._sock.sendall(struct.pack(FRAME_FORMAT, SYNC_MAGIC, SYNC_VERSION, message, len(payload)) + payload)
+
+    def _send_parts(self, message: int, parts: List[bytes]):
+        length = sum(len(part) for part in parts)
+        self._sock.sendall(struct.pack(FRAME_FORMAT, SYNC_MAGIC, SYNC_VERSION, message, length))
+        for part in parts:
+            self._sock.sendall(part)
+
+    def _receive(self) -> Tuple[int, bytes]:
+        header = self._receive_exact(FRAME_SIZE)
+        magic, version, message, length = struct.unpack(FRAME_FORMAT, header)
+        if magic != SYNC_MAGIC or version != SYNC_VERSION:
+            raise ConnectionError(f"Protocol mismatch (magic {magic!r}, version {version})")
+        return message, self._receive_exact(length)
+
+    def _receive_exact(self, size: int) -> bytes:
+        chunks = []
+        while size:
+            chunk = self._sock.recv(min(size, 1 << 20))
+            if not chunk:
+                raise ConnectionError("Connection closed by the game")
+            chunks.append(chunk)
+            size -= len(chunk)
+        return b"".join(chunks)
+
+    # ------------------------------------------------------------------ sync
+
+    def sync(self, files: Dict[str, str]) -> Dict[str, int]:
+        """
+        Send the ID table entries and assets the game does not have yet
+
+        Args:
+            files: Entry name -> file path (e.g. from asset_archive.collect_asset_files)
+
+        Returns:
+            Counts of this call: full, delta, unchanged and bytes sent (empty when not connected)
+        """
+        with self._lock:
+            if not self._ensure_connected():
+                return {}
+            before = dict(self.stats)
+            # A connection found broken (game restarted, replaced by another pipeline) is re-established once
+            for attempt in range(2):
+                try:
+                    self._send_names(files)
+                    for name, path in sorted(files.items()):
+                        self._sync_file(name, path)
+                    break
+                except (OSError, struct.error) as e:
+                    self._drop(f"sync failed: {str(e)}", quiet=attempt == 0)
+                    if attempt or not self.connect():
+                        break
+            return {key: self.stats[key] - before[key] for key in ("full", "delta", "unchanged", "bytes")}
+
+    def remove(self, names: Iterable[str]):
+        """
+        Tell the game assets were deleted; their live overrides are dropped
+        """
+        with self._lock:
+            if not self._ensure_connected():
+                return
+            try:
+                for name in names:
+                    entry = asset_id(name)
+                    self._send(MSG_REMOVE, struct.pack("<I", entry))
+                    self._server_versions.pop(entry, None)
+                    self._sent.pop(entry, None)
+            except OSError as e:
+                self._drop(f"remove failed: {str(e)}")
+
+    def _send_names(self, files: Dict[str, str]):
+        entries = []
+        for name in files:
+            entry = asset_id(name)
+            if self._names.get(entry) != name:
+                encoded = name.encode("utf-8")[:MAX_NAME_BYTES]
+                entries.append(struct.pack("<IH", entry, len(encoded)) + encoded)
+                self._names[entry] = name
+        if entries:
+            self._send(MSG_ID_TABLE, struct.pack("<I", len(entries)) + b"".join(entries))
+
+    def _file_version(self, path: str) -> Tuple[Optional[bytes], int]:
+        stat = os.stat(path)
+        cached = self._files.get(path)
+        if cached is not None and cached[:2] == (stat.st_size, stat.st_mtime_ns):
+            return None, cached[2]
+        with open(path, "rb") as f:
+            data = f.read()
+        version = content_version(data)
+        self._files[path] = (stat.st_size, stat.st_mtime_ns, version)
+        return data, version
+
+    def _sync_file(self, name: str, path: str):
+        entry = asset_id(name)
+        data, version = self._file_version(path)
+        if self._server_versions.get(entry) == version:
+            self.stats["unchanged"] += 1
+            return
+        if data is None:
+            with open(path, "rb") as f:
+                data = f.read()
+        asset_format = ASSET_FORMATS.get(os.path.splitext(path)[1].lower(), 0)
+
+        base = self._sent.get(entry)
+        if base is not None:
+            blocks, size = encode_delta(base, data)
+            if size <= len(data) * MAX_DELTA_RATIO:
+                parts = [struct.pack(DELTA_HEADER_FORMAT, entry, asset_format, content_version(base), version,
+                                     len(data), DELTA_BLOCK_SIZE, len(blocks))]
+                for index, block in blocks:
+                    parts.append(struct.pack(BLOCK_HEADER_FORMAT, index, len(block)))
+                    parts.append(block)
+                self._send_parts(MSG_DELTA, parts)
+                status = self._wait_ack(entry)
+                if status == ACK_APPLIED:
+                    self._applied(entry, data, version, "delta", size)
+                    return
+                if status == ACK_ERROR:
+                    raise ConnectionError(f"Game rejected delta of {name}")
+                # ACK_NEED_FULL falls through to a full send
+
+        self._send_parts(MSG_ASSET, [struct.pack(ASSET_HEADER_FORMAT, entry, asset_format, version, len(data)), data])
+        if self._wait_ack(entry) != ACK_APPLIED:
+            raise ConnectionError(f"Game rejected {name}")
+        self._applied(entry, data, version, "full", len(data))
+
+    def _applied(self, entry: int, data: bytes, version: int, kind: str, size: int):
+        self._server_versions[entry] = version
+        self._sent[entry] = data
+        self.stats[kind] += 1
+        self.stats["bytes"] += size
+
+    def _wait_ack(self, entry: int) -> int:
+        message, payload = self._receive()
+        if message != MSG_ACK:
+            raise ConnectionError(f"Unexpected message {message} while waiting for ACK")
+        acked, _, status = struct.unpack(ACK_FORMAT, payload)
+        if acked != entry:
+            raise ConnectionError(f"ACK for asset {acked:#010x}, expected {entry:#010x}")
+        return status
+
+
+# One client per game endpoint, shared by every caller in the process
+_clients: Dict[Tuple[str, int], ResourceSyncClient] = {}
+_clients_lock = threading.Lock()
+
+
+def get_resource_sync_client(host: str = "localhost", port: int = 8888) -> ResourceSyncClient:
+    """
+    Get the shared client for a game endpoint (not connected until first use)
+    """
+    with _clients_lock:
+        client = _clients.get((host, port))
+        if client is None:
+            client = _clients[(host, port)] = ResourceSyncClient(host, port)
+        return client
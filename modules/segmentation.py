@@ -6,16 +6,24 @@ Separates background from target objects
 """
 
 import os
+import time
+import threading
+import contextlib
 import numpy as np
 from PIL import Image
 import torch
-import importlib.util
 
 # Import SAM2 components
 from sam2.build_sam import build_sam2
 from sam2.sam2_image_predictor import SAM2ImagePredictor
 from hydra.core.global_hydra import GlobalHydra
-from hydra import initialize
+from hydra import initialize_config_module
+
+from modules import metrics
+from modules.embedding_cache import EmbeddingCache, _map_tensors
+from modules.model_cache import PreparedModelCache, sam2_config_for
+
+ENCODE_SECONDS = metrics.histogram("amber_sam_encode_duration_seconds", "SAM2 image encoder time", ["mode"])
 
 class SAMSegmenter:
     """SAM2 Semantic Segmentation Class"""
@@ -32,10 +40,72 @@ class SAMSegmenter:
         self.sam2_model = None
         self.sam2_predictor = None
         self._model_initialized = False
+        # The predictor holds per-image state (set_image), so calls are serialized
+        self._predictor_lock = threading.RLock()
+        # Encoder output cache keyed by image content hash
+        spill_dir = getattr(config, "sam_embedding_cache_dir", "")
+        self.embedding_cache = EmbeddingCache(
+            max_entries=getattr(config, "sam_embedding_cache_size", 8),
+            spill_dir=spill_dir or None
+        )
+        self._current_image_id = None  # Key of the image currently set on the predictor
+        # Prepared weights and compiled graphs shared by every process loading this checkpoint
+        model_cache_dir = getattr(config, "sam_model_cache_dir", "")
+        self.model_cache = PreparedModelCache(model_cache_dir) if model_cache_dir else None
+        self._warmup_thread = None
+        if getattr(config, "sam_warmup", False):
+            self.warm_up()
+    
+    def warm_up(self, background: bool = True):
+        """
+        Load the model and run one dummy prediction, so weight loading, graph compilation and
+        kernel selection happen before the first real request
+        
+        Args:
+            background: Run on a daemon thread; the first request waits on the predictor lock if it arrives early
+        """
+        if self._warmup_thread is not None:
+            return
+        
+        def run():
+            try:
+                started = time.perf_counter()
+                blank = np.zeros((64, 64, 3), dtype=np.uint8)
+                if self.predict_mask(blank, [(32, 32)], [1]) is None:
+                    return
+                self.embedding_cache.clear()
+                if self.model_cache is not None and getattr(self.config, "sam_compile", False):
+                    self.model_cache.save_compile_artifacts(self.config.sam_model_path, self.config.sam_device,
+                                                            getattr(self.config, "sam_precision", "fp32"))
+                print(f"✅ SAM2预热完成 ({(time.perf_counter() - started) * 1000:.0f} ms)")
+            except Exception as e:
+                print(f"⚠️  SAM2预热失败: {str(e)}")
+        
+        if background:
+            self._warmup_thread = threading.Thread(target=run, name="SAM2Warmup", daemon=True)
+            self._warmup_thread.start()
+        else:
+            self._warmup_thread = threading.current_thread()
+            run()
     
     def _init_sam_model(self):
         """
-        Initialize SAM2 Model
+        Initialize SAM2 Model (thread-safe, the model is only built once)
+        """
+        if self._model_initialized:
+            return True
+        
+        with self._predictor_lock:
+            started = time.perf_counter()
+            with metrics.span("model.load", model="sam2"):
+                loaded = self._load_sam_model()
+            if loaded:
+                metrics.MODEL_LOAD_SECONDS.set(time.perf_counter() - started, model="sam2")
+            return loaded
+    
+    def _load_sam_model(self):
+        """
+        Build the SAM2 model and predictor, called with the predictor lock held
         """
         if self._model_initialized:
             return True
@@ -50,54 +120,32 @@ class SAMSegmenter:
             print(f"模型路径: {self.config.sam_model_path}")
             print(f"设备: {self.config.sam_device}")
             
-            # 清理Hydra实例
-            if GlobalHydra.instance().is_initialized():
-                print("清理现有的Hydra实例...")
-                GlobalHydra.instance().clear()
-            
-            # 初始化Hydra
-            print("初始化Hydra...")
-            initialize(version_base=None, config_path=None)
-            
-            # 获取sam2模块的安装路径
-            sam2_path = importlib.util.find_spec('sam2').submodule_search_locations[0]
-            
-            # 选择合适的配置文件
-            if "2.1_hiera_tiny" in self.config.sam_model_path.lower() or "2.1_hiera_t" in self.config.sam_model_path.lower():
-                config_name = os.path.join(sam2_path, "configs", "sam2.1", "sam2.1_hiera_t.yaml")
-            elif "2.1_hiera_s" in self.config.sam_model_path.lower():
-                config_name = os.path.join(sam2_path, "configs", "sam2.1", "sam2.1_hiera_s.yaml")
-            elif "2.1_hiera_l" in self.config.sam_model_path.lower():
-                config_name = os.path.join(sam2_path, "configs", "sam2.1", "sam2.1_hiera_l.yaml")
-            elif "2.1_hiera_b" in self.config.sam_model_path.lower():
-                config_name = os.path.join(sam2_path, "configs", "sam2.1", "sam2.1_hiera_b+.yaml")
-            elif "hiera_tiny" in self.config.sam_model_path.lower() or "hiera_t" in self.config.sam_model_path.lower():
-                config_name = os.path.join(sam2_path, "configs", "sam2", "sam2_hiera_t.yaml")
-            elif "hiera_s" in self.config.sam_model_path.lower():
-                config_name = os.path.join(sam2_path, "configs", "sam2", "sam2_hiera_s.yaml")
-            elif "hiera_l" in self.config.sam_model_path.lower():
-                config_name = os.path.join(sam2_path, "configs", "sam2", "sam2_hiera_l.yaml")
-            elif "hiera_b" in self.config.sam_model_path.lower():
-                config_name = os.path.join(sam2_path, "configs", "sam2", "sam2_hiera_b+.yaml")
-            else:
-                config_name = os.path.join(sam2_path, "configs", "sam2", "sam2_hiera_t.yaml")
+            # sam2 在导入时已用自身的配置模块初始化 Hydra，直接复用，不再清理重建
+            if not GlobalHydra.instance().is_initialized():
+                initialize_config_module("sam2", version_base="1.2")
             
+            # 配置文件：sam_model_config 指定，否则按检查点文件名选择
+            config_name = sam2_config_for(self.config.sam_model_path, getattr(self.config, "sam_model_config", ""))
             print(f"使用配置文件: {config_name}")
             
-            # 构建模型结构
+            # 构建模型结构：参数直接在目标设备上创建，随后被权重覆盖
             print("1. 构建SAM2模型结构...")
-            self.sam2_model = build_sam2(
-                config_file=config_name,
-                ckpt_path=None,  # 不直接加载权重
-                device=self.config.sam_device,
-                mode="eval"
-            )
+            with torch.device(self.config.sam_device):
+                self.sam2_model = build_sam2(
+                    config_file=config_name,
+                    ckpt_path=None,  # 不直接加载权重
+                    device=self.config.sam_device,
+                    mode="eval"
+                )
             print("✅ 模型结构构建成功")
             
-            # 加载权重
+            # 加载权重：优先使用准备好的 safetensors（mmap，直接加载到目标设备）
             print("\n2. 加载模型权重...")
-            checkpoint = torch.load(self.config.sam_model_path, map_location="cpu")
-            state_dict = checkpoint["model"] if "model" in checkpoint else checkpoint
+            if self.model_cache is not None:
+                state_dict = self.model_cache.load_weights(self.config.sam_model_path, self.config.sam_device)
+            else:
+                checkpoint = torch.load(self.config.sam_model_path, map_location="cpu")
+                state_dict = checkpoint["model"] if "model" in checkpoint else checkpoint
             print(f"✅ 权重加载成功，共{len(state_dict)}个参数")
             
             # 将权重加载到模型
@@ -105,8 +153,21 @@ class SAMSegmenter:
             self.sam2_model.load_state_dict(state_dict, strict=False)
             print("✅ 权重应用成功")
             
+            # 可选：编译图像编码器
+            if getattr(self.config, "sam_compile", False):
+                print("\n4. 编译SAM2图像编码器 (torch.compile)...")
+                try:
+                    if self.model_cache is not None:
+                        # 按设备和精度复用已编译的图，首次编译后由 warm_up 保存
+                        self.model_cache.enable_compile_cache(self.config.sam_model_path, self.config.sam_device,
+                                                              getattr(self.config, "sam_precision", "fp32"))
+                    self.sam2_model.image_encoder = torch.compile(self.sam2_model.image_encoder, dynamic=False)
+                    print("✅ 图像编码器编译成功")
+                except Exception as compile_error:
+                    print(f"⚠️  图像编码器编译失败，使用eager模式: {str(compile_error)}")
+            
             # 初始化预测器
-            print("\n4. 初始化SAM2预测器...")
+            print("\n5. 初始化SAM2预测器...")
             self.sam2_predictor = SAM2ImagePredictor(self.sam2_model)
             print("✅ 预测器初始化成功")
             
@@ -134,58 +195,9 @@ class SAMSegmenter:
         Returns:
             Segmented Image object with transparent background, or None if failed
         """
-        # Initialize SAM2 model if not already initialized
-        if not self._model_initialized:
-            if not self._init_sam_model():
-                print("SAM2 model initialization failed, cannot perform segmentation")
-                return None
-        
         try:
-            # Load image
-            image = Image.open(image_path)
-            # Convert to RGB format
-            if image.mode == 'RGBA':
-                image = image.convert('RGB')
-            elif image.mode != 'RGB':
-                image = image.convert('RGB')
-            
-            image_np = np.array(image)
-            mask = None
-            
-            # Perform SAM2 segmentation
-            print("Using SAM2 for segmentation")
-            self.sam2_predictor.set_image(image_np)
-            
-            # Use center point as prompt to get the main object
-            h, w, _ = image_np.shape
-            center_point = np.array([[w // 2, h // 2]])
-            center_label = np.array([1])  # 1 for foreground
-            
-            # Generate masks
-            masks, scores, logits = self.sam2_predictor.predict(
-                point_coords=center_point,
-                point_labels=center_label,
-                multimask_output=True
-            )
-            
-            # Select the best mask based on confidence score
-            if masks is not None and len(masks) > 0:
-                best_idx = np.argmax(scores)
-                mask = masks[best_idx]
-            else:
-                print("No valid masks generated by SAM2")
-                return None
-            
-            # Generate segmentation result with transparent background
-            rgba_image = np.zeros((image_np.shape[0], image_np.shape[1], 4), dtype=np.uint8)
-            rgba_image[:, :, :3] = image_np  # Copy RGB channels
-            rgba_image[:, :, 3] = mask.astype(np.uint8) * 255  # Generate Alpha channel
-            
-            # Convert to Image object
-            result_image = Image.fromarray(rgba_image)
-            
-            return result_image
-            
+            rgba = self.segment_array(self.load_rgb(image_path))
+            return Image.fromarray(rgba) if rgba is not None else None
         except Exception as e:
             print(f"Failed to segment image: {image_path}, error: {str(e)}")
             return None
@@ -202,29 +214,65 @@ class SAMSegmenter:
         Returns:
             Segmented Image object with transparent background, or None if failed
         """
+        try:
+            rgba = self.segment_array(self.load_rgb(image_path), points, point_labels)
+            return Image.fromarray(rgba) if rgba is not None else None
+        except Exception as e:
+            print(f"Failed to segment image with point prompts: {image_path}, error: {str(e)}")
+            return None
+    
+    def segment_array(self, image_np: np.ndarray, points: list = None, point_labels: list = None) -> np.ndarray:
+        """
+        Segment an in-memory image
+        
+        Args:
+            image_np: RGB numpy array (H, W, 3)
+            points: Optional point prompts [(x1, y1), ...]; the center point is used if omitted
+            point_labels: Optional labels matching points (1 foreground, 0 background)
+        
+        Returns:
+            RGBA uint8 array (H, W, 4), or None if failed
+        """
+        mask = self.predict_mask(image_np, points, point_labels)
+        if mask is None:
+            return None
+        rgba_image = np.empty((image_np.shape[0], image_np.shape[1], 4), dtype=np.uint8)
+        rgba_image[:, :, :3] = image_np
+        rgba_image[:, :, 3] = mask
+        return rgba_image
+    
+    def predict_mask(self, image_np: np.ndarray, points: list = None, point_labels: list = None) -> np.ndarray:
+        """
+        Predict the best foreground mask for an in-memory image
+        
+        Args:
+            image_np: RGB numpy array (H, W, 3)
+            points: Optional point prompts [(x1, y1), ...]; the center point is used if omitted
+            point_labels: Optional labels matching points (1 foreground, 0 background); all foreground if omitted
+        
+        Returns:
+            Alpha mask as uint8 array (H, W) with values 0/255, or None if failed
+        """
         # Initialize SAM2 model if not already initialized
         if not self._model_initialized:
             if not self._init_sam_model():
                 print("SAM2 model initialization failed, cannot perform segmentation")
                 return None
         
-        try:
-            # Load image
-            image = Image.open(image_path)
-            if image.mode == 'RGBA':
-                image = image.convert('RGB')
-            elif image.mode != 'RGB':
-                image = image.convert('RGB')
-            
-            image_np = np.array(image)
-            
-            # Convert point format
+        if points:
             input_points = np.array(points)
-            input_labels = np.array(point_labels)
-            
-            # Perform SAM2 segmentation with points
+            # Points without labels are foreground prompts, as in segment_batch
+            input_labels = np.array(point_labels) if point_labels is not None else np.ones(len(points), dtype=np.int32)
             print("Using SAM2 for point-based segmentation")
-            self.sam2_predictor.set_image(image_np)
+        else:
+            # Use center point as prompt to get the main object
+            h, w = image_np.shape[:2]
+            input_points = np.array([[w // 2, h // 2]])
+            input_labels = np.array([1])  # 1 for foreground
+            print("Using SAM2 for segmentation")
+        
+        with self._predictor_lock, self._inference_context():
+            self._set_image_cached(image_np)
             
             # Generate masks
             masks, scores, logits = self.sam2_predictor.predict(
@@ -232,20 +280,251 @@ class SAMSegmenter:
                 point_labels=input_labels,
                 multimask_output=True
             )
-            
-            # Select best mask
+        
+        # Select the best mask based on confidence score
+        if masks is None or len(masks) == 0:
+            print("No valid masks generated by SAM2")
+            return None
+        
+        return masks[np.argmax(scores)].astype(np.uint8) * 255
+    
+    def _inference_context(self):
+        """
+        Build the inference context for the configured precision
+        
+        Returns:
+            Context manager that enables inference mode and, for fp16/bf16, autocast
+        """
+        precision = getattr(self.config, "sam_precision", "fp32")
+        dtypes = {"fp16": torch.float16, "bf16": torch.bfloat16}
+        stack = contextlib.ExitStack()
+        stack.enter_context(torch.inference_mode())
+        if precision in dtypes:
+            device_type = "cuda" if str(self.config.sam_device).startswith("cuda") else "cpu"
+            stack.enter_context(torch.autocast(device_type=device_type, dtype=dtypes[precision]))
+        return stack
+    
+    def segment_batch(self, images: list, points_batch: list = None, labels_batch: list = None) -> list:
+        """
+        Perform segmentation on a batch of images with a single image encoder pass
+        
+        Args:
+            images: List of RGB numpy arrays (H, W, 3), sizes may differ
+            points_batch: Optional list of point lists, one per image; None entries use the center point
+            labels_batch: Optional list of label lists matching points_batch; missing labels
+                default to foreground
+        
+        Returns:
+            List of segmented RGBA Image objects (None for images that produced no mask),
+            or None if the model could not be initialized
+        """
+        # Initialize SAM2 model if not already initialized
+        if not self._model_initialized:
+            if not self._init_sam_model():
+                print("SAM2 model initialization failed, cannot perform segmentation")
+                return None
+        
+        if not images:
+            return []
+        
+        # Build one prompt per image, defaulting to the center point
+        coords_batch = []
+        point_labels_batch = []
+        for i, image_np in enumerate(images):
+            points = points_batch[i] if points_batch else None
+            labels = labels_batch[i] if labels_batch else None
+            if points:
+                coords_batch.append(np.array(points))
+                # Points without labels are all foreground
+                point_labels_batch.append(np.array(labels) if labels is not None else np.ones(len(points), dtype=np.int32))
+            else:
+                h, w = image_np.shape[:2]
+                coords_batch.append(np.array([[w // 2, h // 2]]))
+                point_labels_batch.append(np.array([1]))
+        
+        with self._predictor_lock, self._inference_context():
+            # Image encoder runs once for the whole batch
+            with metrics.timed("sam.encode", ENCODE_SECONDS, mode="batch", batch_size=len(images)):
+                self.sam2_predictor.set_image_batch(images)
+            self._current_image_id = None
+            masks_batch, scores_batch, _ = self.sam2_predictor.predict_batch(
+                point_coords_batch=coords_batch,
+                point_labels_batch=point_labels_batch,
+                multimask_output=True
+            )
+        
+        results = []
+        for image_np, masks, scores in zip(images, masks_batch, scores_batch):
+            if masks is None or len(masks) == 0:
+                results.append(None)
+                continue
             best_idx = np.argmax(scores)
-            mask = masks[best_idx]
-            
-            # Generate segmentation result
-            rgba_image = np.zeros((image_np.shape[0], image_np.shape[1], 4), dtype=np.uint8)
-            rgba_image[:, :, :3] = image_np
-            rgba_image[:, :, 3] = mask.astype(np.uint8) * 255
-            
-            result_image = Image.fromarray(rgba_image)
+            results.append(self._compose_rgba(image_np, masks[best_idx]))
+        
+        return results
+    
+    def _compose_rgba(self, image_np: np.ndarray, mask: np.ndarray) -> Image.Image:
+        """
+        Combine RGB pixels and a binary mask into an RGBA image
+        
+        Args:
+            image_np: RGB numpy array (H, W, 3)
+            mask: Binary mask (H, W)
+        
+        Returns:
+            Segmented Image object with transparent background
+        """
+        rgba_image = np.empty((image_np.shape[0], image_np.shape[1], 4), dtype=np.uint8)
+        rgba_image[:, :, :3] = image_np
+        rgba_image[:, :, 3] = mask.astype(np.uint8) * 255
+        return Image.fromarray(rgba_image)
+    
+    def create_session(self, image) -> dict:
+        """
+        Run the image encoder once and cache the embedding for follow-up prompts
+        
+        Args:
+            image: Image file path, PIL Image or RGB numpy array
+        
+        Returns:
+            Dictionary with image_id, width, height and whether the embedding was cached,
+            or None if failed
+        """
+        if not self._model_initialized:
+            if not self._init_sam_model():
+                print("SAM2 model initialization failed, cannot create segmentation session")
+                return None
+        
+        try:
+            image_np = self.load_rgb(image)
+            with self._predictor_lock, self._inference_context():
+                cached = self.embedding_cache.contains(self.embedding_cache.hash_image(image_np))
+                image_id = self._set_image_cached(image_np)
+            return {
+                "image_id": image_id,
+                "width": int(image_np.shape[1]),
+                "height": int(image_np.shape[0]),
+                "cached": cached
+            }
+        except Exception as e:
+            print(f"Failed to create segmentation session: {str(e)}")
+            return None
+    
+    def segment_image_id(self, image_id: str, points: list, point_labels: list) -> Image.Image:
+        """
+        Segment a previously encoded image, running only the mask decoder
+        
+        Args:
+            image_id: Key returned by create_session
+            points: List of point coordinates [(x1, y1), (x2, y2), ...]
+            point_labels: List of point labels [0, 1, ...] 0 for background, 1 for foreground
+        
+        Returns:
+            Segmented Image object with transparent background, or None if the
+            embedding is no longer cached or segmentation failed
+        """
+        result = self.predict_mask_image_id(image_id, points, point_labels, return_image=True)
+        if result is None:
+            return None
+        mask, image_np = result
+        return Image.fromarray(np.dstack((image_np, mask)))
+    
+    def predict_mask_image_id(self, image_id: str, points: list, point_labels: list, return_image: bool = False):
+        """
+        Predict a mask for a previously encoded image, running only the mask decoder
+        
+        Args:
+            image_id: Key returned by create_session
+            points: List of point coordinates [(x1, y1), (x2, y2), ...]
+            point_labels: List of point labels [0, 1, ...] 0 for background, 1 for foreground
+            return_image: Also return the cached RGB pixels
+        
+        Returns:
+            Alpha mask as uint8 array (H, W), or (mask, rgb) if return_image is set;
+            None if the embedding is no longer cached or segmentation failed
+        """
+        if not self._model_initialized:
+            if not self._init_sam_model():
+                print("SAM2 model initialization failed, cannot perform segmentation")
+                return None
+        
+        try:
+            with self._predictor_lock, self._inference_context():
+                entry = self.embedding_cache.get(image_id)
+                if entry is None:
+                    return None
+                if self._current_image_id != image_id:
+                    self._restore_embedding(image_id, entry)
+                
+                masks, scores, logits = self.sam2_predictor.predict(
+                    point_coords=np.array(points),
+                    point_labels=np.array(point_labels),
+                    multimask_output=True
+                )
             
-            return result_image
+            if masks is None or len(masks) == 0:
+                print("No valid masks generated by SAM2")
+                return None
             
+            mask = masks[np.argmax(scores)].astype(np.uint8) * 255
+            return (mask, entry["image"]) if return_image else mask
         except Exception as e:
-            print(f"Failed to segment image with point prompts: {image_path}, error: {str(e)}")
-            return None
\ No newline at end of file
+            print(f"Failed to segment cached image {image_id}: {str(e)}")
+            return None
+    
+    def _set_image_cached(self, image_np: np.ndarray) -> str:
+        """
+        Set an image on the predictor, reusing a cached embedding when available
+        Must be called with the predictor lock held
+        
+        Args:
+            image_np: RGB numpy array (H, W, 3)
+        
+        Returns:
+            Content key of the image
+        """
+        image_id = self.embedding_cache.hash_image(image_np)
+        if image_id == self._current_image_id:
+            return image_id
+        
+        entry = self.embedding_cache.get(image_id)
+        if entry is not None:
+            self._restore_embedding(image_id, entry)
+            return image_id
+        
+        # Cache miss: run the full image encoder
+        with metrics.timed("sam.encode", ENCODE_SECONDS, mode="single"):
+            self.sam2_predictor.set_image(image_np)
+        self.embedding_cache.put(image_id, {
+            "features": self.sam2_predictor._features,
+            "orig_hw": list(self.sam2_predictor._orig_hw),
+            "image": image_np
+        })
+        self._current_image_id = image_id
+        return image_id
+    
+    def _restore_embedding(self, image_id: str, entry: dict):
+        """
+        Load a cached embedding into the predictor without running the encoder
+        """
+        device = next(self.sam2_model.parameters()).device
+        self.sam2_predictor.reset_predictor()
+        self.sam2_predictor._features = _map_tensors(entry["features"], lambda t: t.to(device))
+        self.sam2_predictor._orig_hw = list(entry["orig_hw"])
+        self.sam2_predictor._is_image_set = True
+        self.sam2_predictor._is_batch = False
+        self._current_image_id = image_id
+    
+    @staticmethod
+    def load_rgb(image) -> np.ndarray:
+        """
+        Convert a path, PIL Image or numpy array into the RGB uint8 array the predictor takes
+        (contiguous RGB arrays are returned as-is, without a copy)
+        """
+        if isinstance(image, np.ndarray):
+            return np.ascontiguousarray(image[:, :, :3]) if image.ndim == 3 else np.stack([image] * 3, axis=2)
+        if not isinstance(image, Image.Image):
+            image = Image.open(image)
+        if image.mode != 'RGB':
+            image = image.convert('RGB')
+        return np.asarray(image)
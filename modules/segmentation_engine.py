@@ -0,0 +1,297 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Batched Segmentation Engine
+Groups pending segmentation requests into dynamic batches for the SAM2 image encoder,
+sharing one SAMSegmenter (and one model instance) across the whole process
+"""
+
+import time
+import queue
+import threading
+import logging
+from collections import deque
+from concurrent.futures import Future
+from typing import Dict, Any, List, Optional
+import numpy as np
+from PIL import Image
+
+from modules import metrics
+from modules.segmentation import SAMSegmenter
+
+logger = logging.getLogger(__name__)
+
+BATCH_SECONDS = metrics.histogram("amber_sam_batch_duration_seconds", "SAM2 batch encode + decode time")
+BATCH_SIZE = metrics.histogram("amber_sam_batch_size", "Images per SAM2 batch", buckets=(1, 2, 4, 8, 16, 32))
+BATCH_QUEUE_SECONDS = metrics.histogram("amber_sam_queue_wait_seconds", "Time a segmentation job waited for its batch")
+
+
+class _SegmentationJob:
+    """A single pending segmentation request"""
+
+    __slots__ = ("image", "points", "point_labels", "future", "enqueued_at")
+
+    def __init__(self, image: np.ndarray, points: Optional[list], point_labels: Optional[list]):
+        self.image = image
+        self.points = points
+        self.point_labels = point_labels
+        self.future = Future()
+        self.enqueued_at = time.perf_counter()
+
+
+class SegmentationEngine:
+    """
+    Dynamic batching segmentation service
+    Requests are collected until the batch is full or the batch timeout expires,
+    then run through a single set_image_batch / predict_batch call
+    """
+
+    def __init__(self, config, segmenter: SAMSegmenter = None):
+        """
+        Initialize the segmentation engine
+
+        Args:
+            config: Configuration object
+            segmenter: Shared SAMSegmenter, a new one is created if not given
+        """
+        self.config = config
+        self.segmenter = segmenter or SAMSegmenter(config)
+        self.max_batch_size = max(1, int(getattr(config, "sam_batch_size", 8)))
+        self.batch_timeout = max(0.0, float(getattr(config, "sam_batch_timeout_ms", 20)) / 1000.0)
+
+        self._queue = queue.Queue()
+        self._running = False
+        self._worker = None
+        self._lifecycle_lock = threading.Lock()
+
+        # Statistics
+        self._stats_lock = threading.Lock()
+        self._batch_history = deque(maxlen=100)
+        self._total_batches = 0
+        self._total_images = 0
+        self._total_failures = 0
+        self._busy_time = 0.0
+
+    def start(self):
+        """
+        Start the batching worker thread (called automatically on first submit)
+        """
+        with self._lifecycle_lock:
+            if self._running:
+                return
+            self._running = True
+            self._worker = threading.Thread(target=self._worker_loop, name="SegmentationEngine", daemon=True)
+            self._worker.start()
+            logger.info(f"Segmentation engine started (batch size: {self.max_batch_size}, timeout: {self.batch_timeout * 1000:.0f} ms)")
+
+    def stop(self, timeout: float = 5.0):
+        """
+        Stop the batching worker thread, pending requests are failed
+
+        Args:
+            timeout: Seconds to wait for the worker to finish the current batch
+        """
+        with self._lifecycle_lock:
+            if not self._running:
+                return
+            self._running = False
+            self._queue.put(None)
+            if self._worker:
+                self._worker.join(timeout=timeout)
+            self._worker = None
+
+        # Fail whatever is still queued
+        while True:
+            try:
+                job = self._queue.get_nowait()
+            except queue.Empty:
+                break
+            if job is not None and not job.future.done():
+                job.future.set_exception(RuntimeError("Segmentation engine stopped"))
+        logger.info("Segmentation engine stopped")
+
+    def submit(self, image, points: list = None, point_labels: list = None) -> Future:
+        """
+        Queue an image for segmentation
+
+        Args:
+            image: Image file path, PIL Image or RGB numpy array
+            points: Optional point prompts [(x1, y1), ...]; the center point is used if omitted
+            point_labels: Optional labels matching points (1 foreground, 0 background)
+
+        Returns:
+            Future resolving to the segmented RGBA Image (or None if no mask was produced)
+        """
+        if not self._running:
+            self.start()
+
+        job = _SegmentationJob(self.segmenter.load_rgb(image), points, point_labels)
+        self._queue.put(job)
+        return job.future
+
+    def segment(self, image, points: list = None, point_labels: list = None, timeout: float = None) -> Image.Image:
+        """
+        Segment a single image through the batching queue and wait for the result
+
+        Args:
+            image: Image file path, PIL Image or RGB numpy array
+            points: Optional point prompts
+            point_labels: Optional labels matching points
+            timeout: Optional wait timeout in seconds
+
+        Returns:
+            Segmented RGBA Image object, or None if failed
+        """
+        return self.submit(image, points, point_labels).result(timeout=timeout)
+
+    def segment_files(self, image_paths: List[str]) -> Dict[str, Image.Image]:
+        """
+        Segment a list of image files, letting the engine batch them freely
+
+        Args:
+            image_paths: List of image file paths
+
+        Returns:
+            Dictionary mapping image paths to segmented images (failed images are omitted)
+        """
+        futures = {}
+        for path in image_paths:
+            try:
+                futures[path] = self.submit(path)
+            except Exception as e:
+                logger.error(f"Failed to queue image for segmentation {path}: {str(e)}")
+
+        results = {}
+        for path, future in futures.items():
+            try:
+                result = future.result()
+                if result is not None:
+                    results[path] = result
+            except Exception as e:
+                logger.error(f"Failed to segment image {path}: {str(e)}")
+        return results
+
+    def get_stats(self) -> Dict[str, Any]:
+        """
+        Get batching statistics
+
+        Returns:
+            Dictionary with totals, recent per-batch latency and throughput
+        """
+        with self._stats_lock:
+            recent = list(self._batch_history)
+            throughput = self._total_images / self._busy_time if self._busy_time > 0 else 0.0
+            return {
+                "running": self._running,
+                "queue_depth": self._queue.qsize(),
+                "max_batch_size": self.max_batch_size,
+                "batch_timeout_ms": self.batch_timeout * 1000.0,
+                "precision": getattr(self.config, "sam_precision", "fp32"),
+                "total_batches": self._total_batches,
+                "total_images": self._total_images,
+                "total_failures": self._total_failures,
+                "average_batch_size": (self._total_images / self._total_batches) if self._total_batches else 0.0,
+                "throughput_images_per_sec": throughput,
+                "last_batch": recent[-1] if recent else None,
+                "recent_batches": recent
+            }
+
+    def _collect_batch(self) -> List[_SegmentationJob]:
+        """
+        Block for the first job, then gather more until the batch is full or the timeout expires
+        """
+        first = self._queue.get()
+        if first is None:
+            return []
+
+        batch = [first]
+        deadline = time.perf_counter() + self.batch_timeout
+        while len(batch) < self.max_batch_size:
+            remaining = deadline - time.perf_counter()
+            try:
+                job = self._queue.get(timeout=remaining) if remaining > 0 else self._queue.get_nowait()
+            except queue.Empty:
+                break
+            if job is None:
+                # Stop requested, finish the current batch first
+                self._queue.put(None)
+                break
+            batch.append(job)
+        return batch
+
+    def _worker_loop(self):
+        """
+        Worker thread: run batches until stopped
+        """
+        while self._running:
+            batch = self._collect_batch()
+            if not batch:
+                continue
+            self._run_batch(batch)
+
+    def _run_batch(self, batch: List[_SegmentationJob]):
+        """
+        Run one batch through the segmenter and resolve the job futures
+        """
+        started = time.perf_counter()
+        queue_wait = sum(started - job.enqueued_at for job in batch) / len(batch)
+        failed = 0
+
+        try:
+            with metrics.span("sam.batch", batch_size=len(batch)):
+                results = self.segmenter.segment_batch(
+                    [job.image for job in batch],
+                    [job.points for job in batch],
+                    [job.point_labels for job in batch]
+                )
+            if results is None:
+                raise RuntimeError("SAM2 model initialization failed")
+            for job, result in zip(batch, results):
+                if result is None:
+                    failed += 1
+                job.future.set_result(result)
+        except Exception as e:
+            logger.error(f"Segmentation batch of {len(batch)} failed: {str(e)}")
+            failed = len(batch)
+            for job in batch:
+                if not job.future.done():
+                    job.future.set_exception(e)
+
+        latency = time.perf_counter() - started
+        with self._stats_lock:
+            self._total_batches += 1
+            self._total_images += len(batch)
+            self._total_failures += failed
+            self._busy_time += latency
+            self._batch_history.append({
+                "batch_size": len(batch),
+                "latency_ms": latency * 1000.0,
+                "queue_wait_ms": queue_wait * 1000.0,
+                "images_per_sec": len(batch) / latency if latency > 0 else 0.0,
+                "failures": failed
+            })
+        BATCH_SECONDS.observe(latency)
+        BATCH_SIZE.observe(len(batch))
+        BATCH_QUEUE_SECONDS.observe(queue_wait)
+        logger.info(f"Segmented batch of {len(batch)} in {latency * 1000:.1f} ms")
+
+# Process-wide engine, so every caller shares one model instance
+_engine_instance = None
+_engine_lock = threading.Lock()
+
+
+def get_segmentation_engine(config) -> SegmentationEngine:
+    """
+    Get the shared segmentation engine, creating it on first use
+
+    Args:
+        config: Configuration object
+
+    Returns:
+        Shared SegmentationEngine instance
+    """
+    global _engine_instance
+    if _engine_instance is None:
+        with _engine_lock:
+            if _engine_instance is None:
+                _engine_instance = SegmentationEngine(config)
+    return _engine_instance
@@ -0,0 +1,492 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Stage Graph Executor
+Turns a naming-convention process list into a dependency graph of registered stages
+and runs it with images kept in memory, running independent branches concurrently
+"""
+
+import os
+import time
+import contextlib
+import contextvars
+import threading
+import logging
+import concurrent.futures
+from typing import Callable, Dict, Any, List, Optional
+from PIL import Image
+
+from modules import metrics
+from modules.build_cache import BuildCache
+from modules.texture_export import write_dds_rgba8, write_dds_compressed, write_ktx2
+
+logger = logging.getLogger(__name__)
+
+# Stage kinds
+TRANSFORM = "transform"  # Produces the next working image
+SINK = "sink"            # Reads the working image and writes side outputs (files, details)
+
+STAGE_SECONDS = metrics.histogram("amber_stage_duration_seconds", "Workflow stage run time, excluding slot wait",
+                                  ["stage", "resource", "status"])
+STAGE_WAIT_SECONDS = metrics.histogram("amber_stage_slot_wait_seconds", "Time a stage waited for a CPU/GPU slot",
+                                       ["resource"])
+STAGE_CACHE = metrics.counter("amber_stage_cache_lookups_total", "Build cache lookups per stage", ["stage", "result"])
+
+
+class Stage:
+    """A registered processing stage"""
+
+    __slots__ = ("name", "func", "kind", "resource", "params", "requires")
+
+    def __init__(self, name: str, func: Callable, kind: str = TRANSFORM, resource: str = "cpu",
+                 params: Dict[str, Any] = None, requires: List[str] = None):
+        """
+        Args:
+            name: Process name as used by the naming convention rules
+            func: Callable (context, image) -> Image for transforms, or optional details dict for sinks;
+                  sinks list the files they write under details["outputs"]
+            kind: TRANSFORM or SINK
+            resource: "cpu" or "gpu", used to pick the concurrency limit
+            params: Parameters that affect the output, part of the build cache key
+            requires: Earlier stages whose artifacts this stage reads, waited for when present in the flow
+        """
+        self.name = name
+        self.func = func
+        self.kind = kind
+        self.resource = resource
+        self.params = params or {}
+        self.requires = requires or []
+
+
+class StageContext:
+    """
+    Per-file state shared by all stages of one run
+    """
+
+    def __init__(self, filename: str, input_path: str, output_dir: str, output_stem: str,
+                 naming: Dict[str, str] = None):
+        """
+        Args:
+            filename: Source file name
+            input_path: Full source path
+            output_dir: Directory for side outputs
+            output_stem: File name stem for side outputs
+            naming: Optional overrides for output suffixes ("normal", "lod", "base_color", ...)
+        """
+        self.filename = filename
+        self.input_path = input_path
+        self.output_dir = output_dir
+        self.output_stem = output_stem
+        # base_color / normal_texture follow the TextureSuffix names emitted into AssetIDs.h
+        self.naming = {"normal": "_Normal", "lod": "_lod{index}", "lods": "_lods",
+                       "base_color": "_BC", "normal_texture": "_N"}
+        if naming:
+            self.naming.update(naming)
+        # Intermediate results published by stages (e.g. "lods", "normal_map")
+        self.artifacts: Dict[str, Any] = {}
+        self._lock = threading.Lock()
+
+    def output_path(self, key: str, ext: str = ".png", **fields) -> str:
+        """
+        Build the path of a side output
+
+        Args:
+            key: Naming key ("normal", "lod", "lods")
+            ext: File extension
+            fields: Format fields for the suffix, e.g. index for LODs
+
+        Returns:
+            Full output path
+        """
+        suffix = self.naming[key].format(**fields)
+        return os.path.join(self.output_dir, f"{self.output_stem}{suffix}{ext}")
+
+    def publish(self, key: str, value: Any):
+        """
+        Store an intermediate result for later stages or the caller
+        """
+        with self._lock:
+            self.artifacts[key] = value
+
+
+class StageRegistry:
+    """
+    Name -> Stage mapping, later registrations override earlier ones
+    """
+
+    def __init__(self):
+        self._stages: Dict[str, Stage] = {}
+
+    def register(self, name: str, func: Callable, kind: str = TRANSFORM, resource: str = "cpu",
+                 params: Dict[str, Any] = None, requires: List[str] = None):
+        """
+        Register (or replace) a stage
+
+        Args:
+            name: Process name
+            func: Stage callable, see Stage
+            kind: TRANSFORM or SINK
+            resource: "cpu" or "gpu"
+            params: Parameters that affect the output, see Stage
+            requires: Stages this one waits for, see Stage
+        """
+        self._stages[name] = Stage(name, func, kind, resource, params, requires)
+
+    def get(self, name: str) -> Optional[Stage]:
+        return self._stages.get(name)
+
+    def names(self) -> List[str]:
+        return list(self._stages.keys())
+
+
+class _StageNode:
+    __slots__ = ("index", "name", "stage", "image_from", "requires", "dependents")
+
+    def __init__(self, index: int, name: str, stage: Optional[Stage], image_from: Optional[int]):
+        self.index = index
+        self.name = name
+        self.stage = stage
+        # Node whose output image is this node's input (None = source image)
+        self.image_from = image_from
+        # Additional nodes that must finish first (Stage.requires)
+        self.requires: List[int] = []
+        self.dependents: List[int] = []
+
+    def dependencies(self) -> List[int]:
+        deps = list(self.requires)
+        if self.image_from is not None:
+            deps.append(self.image_from)
+        return deps
+
+
+class StageGraph:
+    """
+    Dependency graph built from a process list
+    Duplicate process names are dropped; each stage depends only on the transform
+    before it, so sinks (and transforms following a sink) can run in parallel
+    """
+
+    def __init__(self, registry: StageRegistry, process_names: List[str]):
+        self.nodes: List[_StageNode] = []
+        index_by_name: Dict[str, int] = {}
+        last_transform = None
+
+        for name in process_names:
+            if name in index_by_name:
+                continue
+
+            stage = registry.get(name)
+            node = _StageNode(len(self.nodes), name, stage, last_transform)
+            if stage is not None:
+                node.requires = [index_by_name[r] for r in stage.requires
+                                 if r in index_by_name and index_by_name[r] != last_transform]
+            for dependency in node.dependencies():
+                self.nodes[dependency].dependents.append(node.index)
+            index_by_name[name] = node.index
+            self.nodes.append(node)
+
+            if stage is not None and stage.kind == TRANSFORM:
+                last_transform = node.index
+
+        self.final_node = last_transform
+
+
+class StageExecutor:
+    """
+    Runs stage graphs on a shared thread pool
+    """
+
+    def __init__(self, max_workers: int = 4, slot_provider: Callable[[Stage], Any] = None):
+        """
+        Args:
+            max_workers: Threads shared by all concurrently running graphs
+            slot_provider: Optional callable returning a context manager that limits a stage's resource
+        """
+        self.slot_provider = slot_provider
+        self._pool = concurrent.futures.ThreadPoolExecutor(max_workers=max(1, max_workers), thread_name_prefix="Stage")
+
+    def stage_keys(self, graph: StageGraph, context: StageContext, source_key: str) -> List[str]:
+        """
+        Compute the build cache key of every stage in a graph
+
+        Args:
+            graph: Stage graph
+            context: Per-file context (sinks are keyed by where they write)
+            source_key: Key of the source image
+
+        Returns:
+            List of keys in node order
+        """
+        keys = []
+        for node in graph.nodes:
+            input_key = source_key if node.image_from is None else keys[node.image_from]
+            if node.stage is None:
+                keys.append(BuildCache.stage_key(input_key, node.name, None, None))
+                continue
+            outputs = None
+            if node.stage.kind == SINK:
+                outputs = [context.output_dir, context.output_stem, context.naming]
+            if node.requires:
+                input_key = BuildCache.combine([input_key] + [keys[r] for r in node.requires])
+            keys.append(BuildCache.stage_key(input_key, node.name, node.stage.kind, node.stage.params, outputs))
+        return keys
+
+    def run(self, graph: StageGraph, context: StageContext, source_image: Image.Image,
+            cache: BuildCache = None, source_key: str = None,
+            progress: Callable[[Dict[str, Any]], None] = None) -> tuple:
+        """
+        Execute a graph
+
+        Args:
+            graph: Stage graph
+            context: Per-file context
+            source_image: Loaded source image
+            cache: Optional build cache; stages whose output is cached are skipped
+            source_key: Key of the source image, required when cache is given
+            progress: Optional callback receiving each stage result as soon as the stage finishes
+
+        Returns:
+            (final working image, list of per-stage results in process order)
+            Each result has name, status, error, duration_ms, wait_ms (time waiting for a resource slot),
+            cached and optional details.
+            A failed transform passes its input image through unchanged.
+            Stages downstream of a failed stage bypass the build cache: their keys assume the failed
+            stage's output, so neither restoring nor storing them would be correct.
+        """
+        results: List[Optional[Dict[str, Any]]] = [None] * len(graph.nodes)
+        images: Dict[int, Image.Image] = {}
+        running = {}
+        keys = self.stage_keys(graph, context, source_key) if cache is not None else None
+        # Nodes that failed or depend (directly or transitively) on a failed node
+        failed = set()
+
+        def input_image(node: _StageNode) -> Image.Image:
+            return source_image if node.image_from is None else images[node.image_from]
+
+        def submit(node: _StageNode):
+            node_cache = cache
+            if any(dependency in failed for dependency in node.dependencies()):
+                failed.add(node.index)
+                node_cache = None
+            key = keys[node.index] if keys and node_cache is not None else None
+            # Run in a copy of the caller's context so stage spans nest under the job span
+            run_in_context = contextvars.copy_context().run
+            running[self._pool.submit(run_in_context, self._run_node, node, context, input_image(node),
+                                      node_cache, key)] = node
+
+        remaining = [len(node.dependencies()) for node in graph.nodes]
+        for node in graph.nodes:
+            if remaining[node.index] == 0:
+                submit(node)
+
+        while running:
+            done, _ = concurrent.futures.wait(running, return_when=concurrent.futures.FIRST_COMPLETED)
+            for future in done:
+                node = running.pop(future)
+                output, result = future.result()
+                results[node.index] = result
+                if result["status"] == "failed":
+                    failed.add(node.index)
+                if progress is not None:
+                    progress(result)
+                if node.stage is not None and node.stage.kind == TRANSFORM:
+                    images[node.index] = output
+                for dependent in node.dependents:
+                    remaining[dependent] -= 1
+                    if remaining[dependent] == 0:
+                        submit(graph.nodes[dependent])
+
+        final_image = source_image if graph.final_node is None else images[graph.final_node]
+        return final_image, results
+
+    def _run_node(self, node: _StageNode, context: StageContext, image: Image.Image,
+                  cache: BuildCache = None, key: str = None) -> tuple:
+        """
+        Run a single stage (or restore it from the build cache) inside a trace span and record its metrics
+        """
+        resource = node.stage.resource if node.stage is not None else "cpu"
+        with metrics.span("stage." + node.name, stage=node.name, resource=resource, filename=context.filename):
+            output, result = self._execute_node(node, context, image, cache, key)
+        status = "cached" if result["cached"] else result["status"]
+        STAGE_SECONDS.observe(result["duration_ms"] / 1000.0, stage=node.name, resource=resource, status=status)
+        STAGE_WAIT_SECONDS.observe(result["wait_ms"] / 1000.0, resource=resource)
+        if cache is not None and node.stage is not None:
+            STAGE_CACHE.inc(stage=node.name, result="hit" if result["cached"] else "miss")
+        return output, result
+
+    def _execute_node(self, node: _StageNode, context: StageContext, image: Image.Image,
+                      cache: BuildCache = None, key: str = None) -> tuple:
+        """
+        Run a single stage (or restore it from the build cache), never raises
+        """
+        result = {"name": node.name, "status": "completed", "error": None, "duration_ms": 0.0, "wait_ms": 0.0,
+                  "cached": False}
+        if node.stage is None:
+            result["status"] = "failed"
+            result["error"] = f"Unknown process: {node.name}"
+            logger.error(result["error"])
+            return image, result
+
+        started = time.perf_counter()
+        if cache is not None:
+            cached = self._restore(node.stage, cache, key, result)
+            if cached is not None:
+                result["duration_ms"] = (time.perf_counter() - started) * 1000.0
+                logger.info(f"Process {node.name} up to date for {context.filename}")
+                return (image if cached is True else cached), result
+
+        slot = self.slot_provider(node.stage) if self.slot_provider else contextlib.nullcontext()
+        output = image
+        try:
+            logger.info(f"Executing process: {node.name} on {context.filename}")
+            waiting = time.perf_counter()
+            with slot:
+                result["wait_ms"] = (time.perf_counter() - waiting) * 1000.0
+                value = node.stage.func(context, image)
+            if node.stage.kind == TRANSFORM:
+                if value is None:
+                    raise Exception(f"{node.name} produced no image")
+                output = value
+            elif value:
+                result["details"] = value
+            if cache is not None:
+                if node.stage.kind == TRANSFORM:
+                    cache.store_image(key, output)
+                else:
+                    details = result.get("details") or {}
+                    cache.store_manifest(key, {"outputs": details.get("outputs", []), "details": details})
+            logger.info(f"Successfully executed process: {node.name}")
+        except Exception as e:
+            logger.error(f"Failed to execute process {node.name}: {str(e)}")
+            result["status"] = "failed"
+            result["error"] = str(e)
+        result["duration_ms"] = (time.perf_counter() - started) * 1000.0 - result["wait_ms"]
+        return output, result
+
+    @staticmethod
+    def _restore(stage: Stage, cache: BuildCache, key: str, result: Dict[str, Any]):
+        """
+        Look up a stage in the build cache
+
+        Returns:
+            Cached image for transforms, True for up-to-date sinks, or None on miss
+        """
+        if stage.kind == TRANSFORM:
+            cached = cache.load_image(key)
+        else:
+            manifest = cache.load_manifest(key)
+            cached = None
+            if manifest is not None:
+                if manifest.get("details"):
+                    result["details"] = manifest["details"]
+                cached = True
+        if cached is not None:
+            result["cached"] = True
+        return cached
+
+    def shutdown(self):
+        self._pool.shutdown(wait=False)
+
+
+def create_default_registry(image_processor, normal_generator, segment: Callable[[Image.Image], Image.Image],
+                            square_size: int = 512) -> StageRegistry:
+    """
+    Build the registry for the processes used by NamingResolver.default_rules
+
+    Args:
+        image_processor: ImageProcessor instance
+        normal_generator: NormalMapGenerator instance
+        segment: Callable taking an image and returning the segmented RGBA image (or None)
+        square_size: Output size of resize_square
+
+    Returns:
+        StageRegistry with segment, align_bottom, generate_shadow, resize_square, sharpen,
+        make_seamless, gen_pbr, gen_lod, export_textures, box_collision and default_process
+    """
+    registry = StageRegistry()
+    config = image_processor.config
+    lod_container = getattr(config, "lod_container", "png")
+    texture_container = getattr(config, "texture_export", "") or "ktx2"
+    texture_workers = getattr(config, "texture_export_workers", 0)
+    normal_params = {
+        "strength": config.normal_strength,
+        "blur": config.normal_blur,
+        "backend": getattr(normal_generator, "backend", "reference")
+    }
+
+    def segment_stage(ctx, image):
+        result = segment(image)
+        if result is None:
+            raise Exception("Segmentation failed")
+        return result
+
+    def gen_pbr(ctx, image):
+        # Normal map straight from the in-memory working image
+        normal_map = normal_generator.generate_from_color(image)
+        if normal_map is None:
+            return None
+        ctx.publish("normal_map", normal_map)
+        normal_path = ctx.output_path("normal")
+        image_processor.save_image(normal_map, normal_path)
+        return {"outputs": [normal_path]}
+
+    def gen_lod(ctx, image):
+        if lod_container == "dds":
+            # Full chain down to 1x1 in a single container
+            chain = image_processor.gen_mip_chain(image)
+            ctx.publish("mip_chain", chain)
+            lod_path = ctx.output_path("lods", ext=".dds")
+            write_dds_rgba8(lod_path, chain)
+            return {"outputs": [lod_path], "levels": len(chain)}
+        
+        lods = image_processor.gen_lod(image, levels=3)
+        ctx.publish("lods", lods)
+        outputs = []
+        for i, lod_image in enumerate(lods):
+            lod_path = ctx.output_path("lod", index=i)
+            image_processor.save_image(lod_image, lod_path)
+            outputs.append(lod_path)
+        return {"outputs": outputs}
+
+    def export_textures(ctx, image):
+        # Mips come from the LOD chain when gen_lod built one, otherwise a full chain is built here
+        chain = ctx.artifacts.get("mip_chain") or image_processor.gen_mip_chain(image)
+        writer = write_ktx2 if texture_container == "ktx2" else write_dds_compressed
+        extension = ".ktx2" if texture_container == "ktx2" else ".dds"
+
+        outputs = [writer(ctx.output_path("base_color", ext=extension), chain, "bc7",
+                          srgb=True, num_workers=texture_workers)]
+
+        normal_map = ctx.artifacts.get("normal_map")
+        if normal_map is None and os.path.exists(ctx.output_path("normal")):
+            # gen_pbr was up to date in the build cache and published nothing
+            normal_map = Image.open(ctx.output_path("normal"))
+        if normal_map is not None:
+            normal_chain = image_processor.gen_mip_chain(normal_map)
+            outputs.append(writer(ctx.output_path("normal_texture", ext=extension), normal_chain, "bc5",
+                                  num_workers=texture_workers))
+        return {"outputs": outputs, "levels": len(chain), "container": texture_container}
+
+    def box_collision(ctx, image):
+        return {"collision_box": image_processor.box_collision(image)}
+
+    def default_process(ctx, image):
+        logger.info("Using default processing")
+        return image
+
+    registry.register("segment", segment_stage, resource="gpu", params={"model": getattr(config, "sam_model_path", "")})
+    registry.register("align_bottom", lambda ctx, image: image_processor.align_bottom(image))
+    registry.register("generate_shadow", lambda ctx, image: image_processor.generate_shadow(image))
+    registry.register("resize_square", lambda ctx, image: image_processor.resize_square(image, target_size=square_size),
+                      params={"size": square_size})
+    registry.register("sharpen", lambda ctx, image: image_processor.sharpen(image))
+    registry.register("make_seamless", lambda ctx, image: image_processor.make_seamless(image),
+                      params={"method": "offset_blend" if image_processor.pixel_kernels else "mirror_blur"})
+    registry.register("gen_pbr", gen_pbr, kind=SINK, params=normal_params)
+    registry.register("gen_lod", gen_lod, kind=SINK,
+                      params={"levels": 3, "filter": image_processor.lod_filter, "container": lod_container})
+    registry.register("export_textures", export_textures, kind=SINK,
+                      params={"container": texture_container, "color": "bc7", "normal": "bc5"},
+                      requires=["gen_pbr", "gen_lod"])
+    registry.register("box_collision", box_collision, kind=SINK)
+    registry.register("default_process", default_process)
+    return registry
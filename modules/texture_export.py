@@ -0,0 +1,459 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Texture Container Export
+Writes a whole mip chain into a single GPU texture container (DDS or KTX2),
+optionally block-compressed to BC7 (color) or BC5 (normal maps)
+
+Levels are numpy arrays, or out-of-core rasters (modules.tiled_processing.DiskRaster)
+that are read and encoded band by band while the file is written
+"""
+
+import os
+import struct
+import concurrent.futures
+import numpy as np
+
+# DDS header flags
+DDSD_CAPS = 0x1
+DDSD_HEIGHT = 0x2
+DDSD_WIDTH = 0x4
+DDSD_PITCH = 0x8
+DDSD_PIXELFORMAT = 0x1000
+DDSD_MIPMAPCOUNT = 0x20000
+DDSD_LINEARSIZE = 0x80000
+
+DDPF_ALPHAPIXELS = 0x1
+DDPF_FOURCC = 0x4
+DDPF_RGB = 0x40
+
+DDSCAPS_COMPLEX = 0x8
+DDSCAPS_TEXTURE = 0x1000
+DDSCAPS_MIPMAP = 0x400000
+
+
+def _dds_header(width: int, height: int, mip_count: int, pitch_or_size: int, pixel_format: bytes,
+                flags: int) -> bytes:
+    """
+    Build the 128-byte DDS magic + header
+    """
+    caps = DDSCAPS_TEXTURE
+    if mip_count > 1:
+        flags |= DDSD_MIPMAPCOUNT
+        caps |= DDSCAPS_MIPMAP | DDSCAPS_COMPLEX
+
+    header = struct.pack(
+        "<4s7I44x32s5I",
+        b"DDS ",
+        124,
+        DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | flags,
+        height,
+        width,
+        pitch_or_size,
+        0,  # depth
+        mip_count,
+        pixel_format,
+        caps, 0, 0, 0, 0
+    )
+    return header
+
+
+# Working set per pixel when an out-of-core level is encoded: float32 blocks plus encoder temporaries
+_BAND_BYTES_PER_PIXEL = 128
+
+
+def _level_bands(level, bytes_per_pixel: int, multiple: int = 1):
+    """
+    Yield a level as row bands; arrays are yielded whole
+    """
+    if isinstance(level, np.ndarray):
+        yield level
+        return
+    rows = level.rows_per_band(bytes_per_pixel, multiple=multiple)
+    for y0 in range(0, level.height, rows):
+        yield level.read_rows(y0, min(level.height, y0 + rows))
+
+
+def write_dds_rgba8(path: str, levels: list) -> str:
+    """
+    Write an uncompressed RGBA8 mip chain as one DDS file
+
+    Args:
+        path: Output file path
+        levels: List of uint8 RGBA arrays (H, W, 4) or rasters, largest first, each half the previous
+
+    Returns:
+        The output path
+    """
+    height, width = levels[0].shape[:2]
+    pixel_format = struct.pack(
+        "<8I",
+        32, DDPF_RGB | DDPF_ALPHAPIXELS, 0, 32,
+        0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000
+    )
+    header = _dds_header(width, height, len(levels), width * 4, pixel_format, DDSD_PITCH)
+
+    parts = [header]
+    for level in levels:
+        parts.append(np.ascontiguousarray(band, dtype=np.uint8).data for band in _level_bands(level, 8))
+    _write_atomic(path, parts)
+    return path
+
+
+# Block-compressed formats: DXGI format (DDS DX10 header) and Vulkan format (KTX2)
+TEXTURE_FORMATS = {
+    "bc7": {"dxgi": 98, "dxgi_srgb": 99, "vk": 145, "vk_srgb": 146},
+    "bc5": {"dxgi": 83, "dxgi_srgb": 83, "vk": 141, "vk_srgb": 141}
+}
+
+# BC7 4-bit index interpolation weights
+_BC7_WEIGHTS = np.array([0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64], dtype=np.float32)
+
+# Blocks per encoding task
+_CHUNK_BLOCKS = 4096
+
+
+def _to_blocks(level: np.ndarray, channels: int) -> tuple:
+    """
+    Pad a level to a multiple of 4 (edge replicate) and split it into 4x4 blocks
+
+    Returns:
+        (blocks float32 (N, 16, channels), blocks_x, blocks_y)
+    """
+    height, width = level.shape[:2]
+    blocks_x, blocks_y = (width + 3) // 4, (height + 3) // 4
+    pad_y, pad_x = blocks_y * 4 - height, blocks_x * 4 - width
+    data = level[:, :, :channels]
+    if pad_x or pad_y:
+        data = np.pad(data, ((0, pad_y), (0, pad_x), (0, 0)), mode='edge')
+    blocks = data.reshape(blocks_y, 4, blocks_x, 4, channels).transpose(0, 2, 1, 3, 4)
+    return blocks.reshape(-1, 16, channels).astype(np.float32), blocks_x, blocks_y
+
+
+def _encode_bc4_channel(values: np.ndarray) -> np.ndarray:
+    """
+    Encode one channel of N blocks as BC4 (8-value mode)
+
+    Args:
+        values: float32 (N, 16)
+
+    Returns:
+        uint8 (N, 8)
+    """
+    e0 = np.round(values.max(axis=1))
+    e1 = np.round(values.min(axis=1))
+    span = np.maximum(e0 - e1, 1.0)
+
+    # Position along e0 -> e1 in sevenths, then map to the BC4 index order (0, 2..7, 1)
+    step = np.clip(np.round((e0[:, None] - values) / span[:, None] * 7.0), 0, 7).astype(np.uint64)
+    indices = np.where(step == 0, 0, np.where(step == 7, 1, step + 1)).astype(np.uint64)
+    indices[e0 == e1] = 0
+
+    bits = np.zeros(len(values), dtype=np.uint64)
+    for i in range(16):
+        bits |= indices[:, i] << np.uint64(3 * i)
+
+    out = np.empty((len(values), 8), dtype=np.uint8)
+    out[:, 0] = e0.astype(np.uint8)
+    out[:, 1] = e1.astype(np.uint8)
+    for i in range(6):
+        out[:, 2 + i] = ((bits >> np.uint64(8 * i)) & np.uint64(0xff)).astype(np.uint8)
+    return out
+
+
+def _encode_bc5_blocks(blocks: np.ndarray) -> np.ndarray:
+    """
+    Encode N RG blocks as BC5 (two BC4 channels)
+
+    Args:
+        blocks: float32 (N, 16, 2+)
+
+    Returns:
+        uint8 (N, 16)
+    """
+    return np.concatenate([_encode_bc4_channel(blocks[:, :, 0]), _encode_bc4_channel(blocks[:, :, 1])], axis=1)
+
+
+def _quantize_bc7_endpoint(endpoint: np.ndarray) -> tuple:
+    """
+    Quantize RGBA endpoints to 7 bits plus a shared p-bit, choosing the p-bit with less error
+
+    Args:
+        endpoint: float32 (N, 4) in 0..255
+
+    Returns:
+        (7-bit values uint64 (N, 4), p-bit uint64 (N,), reconstructed float32 (N, 4))
+    """
+    candidates = []
+    for pbit in (0.0, 1.0):
+        q = np.clip(np.round((endpoint - pbit) / 2.0), 0, 127)
+        value = q * 2.0 + pbit
+        error = ((value - endpoint) ** 2).sum(axis=1)
+        candidates.append((q, value, error))
+    use_one = candidates[1][2] < candidates[0][2]
+    q = np.where(use_one[:, None], candidates[1][0], candidates[0][0])
+    value = np.where(use_one[:, None], candidates[1][1], candidates[0][1])
+    return q.astype(np.uint64), use_one.astype(np.uint64), value.astype(np.float32)
+
+
+def _encode_bc7_blocks(blocks: np.ndarray) -> np.ndarray:
+    """
+    Encode N RGBA blocks as BC7 mode 6 (one subset, 7.7.7.7 endpoints + p-bits, 4-bit indices)
+    Endpoints follow each block's principal axis; indices pick the closest palette entry
+
+    Args:
+        blocks: float32 (N, 16, 4)
+
+    Returns:
+        uint8 (N, 16)
+    """
+    count = len(blocks)
+    mean = blocks.mean(axis=1)
+    centered = blocks - mean[:, None, :]
+
+    # Principal axis by power iteration on the per-block covariance
+    covariance = np.einsum('npi,npj->nij', centered, centered)
+    # Seeded with the max-variance channel: a ones seed can be (nearly) orthogonal to the axis
+    # of anti-correlated channels and collapse to zero
+    seed = np.zeros((count, 4), dtype=np.float32)
+    seed[np.arange(count), np.argmax(np.einsum('nii->ni', covariance), axis=1)] = 1.0
+    axis = seed
+    for _ in range(4):
+        axis = np.einsum('nij,nj->ni', covariance, axis)
+        norm = np.linalg.norm(axis, axis=1, keepdims=True)
+        # Flat blocks have no principal axis, keep the unit seed
+        axis = np.where(norm > 1e-6, axis / np.maximum(norm, 1e-6), seed)
+
+    projection = np.einsum('npi,ni->np', centered, axis)
+    e0 = np.clip(mean + axis * projection.min(axis=1)[:, None], 0, 255)
+    e1 = np.clip(mean + axis * projection.max(axis=1)[:, None], 0, 255)
+
+    q0, p0, v0 = _quantize_bc7_endpoint(e0)
+    q1, p1, v1 = _quantize_bc7_endpoint(e1)
+
+    # 16-entry palette (N, 16, 4) and nearest entry per texel
+    weights = _BC7_WEIGHTS[None, :, None]
+    palette = np.floor(((64.0 - weights) * v0[:, None, :] + weights * v1[:, None, :] + 32.0) / 64.0)
+    distance = ((blocks[:, :, None, :] - palette[:, None, :, :]) ** 2).sum(axis=3)
+    indices = distance.argmin(axis=2).astype(np.uint64)
+
+    # The anchor texel's index MSB is implicit 0: swap endpoints where it is set
+    swap = indices[:, 0] >= 8
+    if swap.any():
+        q0[swap], q1[swap] = q1[swap].copy(), q0[swap].copy()
+        p0[swap], p1[swap] = p1[swap].copy(), p0[swap].copy()
+        indices[swap] = np.uint64(15) - indices[swap]
+
+    lo = np.full(count, 1 << 6, dtype=np.uint64)
+    hi = np.zeros(count, dtype=np.uint64)
+
+    def put(value, offset, width):
+        nonlocal lo, hi
+        if offset >= 64:
+            hi |= value << np.uint64(offset - 64)
+        elif offset + width <= 64:
+            lo |= value << np.uint64(offset)
+        else:
+            low_bits = 64 - offset
+            lo |= (value & np.uint64((1 << low_bits) - 1)) << np.uint64(offset)
+            hi |= value >> np.uint64(low_bits)
+
+    offset = 7
+    for channel in range(4):
+        put(q0[:, channel], offset, 7)
+        put(q1[:, channel], offset + 7, 7)
+        offset += 14
+    put(p0, 63, 1)
+    put(p1, 64, 1)
+    put(indices[:, 0], 65, 3)
+    for i in range(1, 16):
+        put(indices[:, i], 68 + 4 * (i - 1), 4)
+
+    return np.concatenate([lo[:, None].view(np.uint8), hi[:, None].view(np.uint8)], axis=1).reshape(count, 16)
+
+
+def compress_level(level: np.ndarray, texture_format: str, num_workers: int = 0) -> bytes:
+    """
+    Block-compress one mip level on a thread pool
+
+    Args:
+        level: uint8 array (H, W, C); RGBA for bc7, at least RG for bc5
+        texture_format: "bc7" or "bc5"
+        num_workers: Encoder threads (0 = CPU count)
+
+    Returns:
+        Compressed blocks in row-major block order
+    """
+    if texture_format == "bc7":
+        if level.shape[2] == 3:
+            level = np.concatenate([level, np.full(level.shape[:2] + (1,), 255, dtype=np.uint8)], axis=2)
+        blocks, _, _ = _to_blocks(level, 4)
+        encode = _encode_bc7_blocks
+    elif texture_format == "bc5":
+        blocks, _, _ = _to_blocks(level, 2)
+        encode = _encode_bc5_blocks
+    else:
+        raise ValueError(f"Unsupported texture format: {texture_format}")
+
+    chunks = [blocks[i:i + _CHUNK_BLOCKS] for i in range(0, len(blocks), _CHUNK_BLOCKS)]
+    if len(chunks) == 1:
+        return encode(chunks[0]).tobytes()
+    workers = num_workers or os.cpu_count() or 1
+    with concurrent.futures.ThreadPoolExecutor(max_workers=workers) as executor:
+        return b"".join(encoded.tobytes() for encoded in executor.map(encode, chunks))
+
+
+def compressed_size(width: int, height: int) -> int:
+    """
+    Size in bytes of a BC5/BC7 level (16 bytes per 4x4 block)
+    """
+    return ((width + 3) // 4) * ((height + 3) // 4) * 16
+
+
+def _compressed_level(level, texture_format: str, num_workers: int):
+    """
+    Yield the compressed blocks of a level; rasters are encoded in bands of whole block rows,
+    so the concatenation equals compress_level on the full level
+    """
+    for band in _level_bands(level, _BAND_BYTES_PER_PIXEL, multiple=4):
+        yield compress_level(band, texture_format, num_workers)
+
+
+def write_dds_compressed(path: str, levels: list, texture_format: str, srgb: bool = False, num_workers: int = 0) -> str:
+    """
+    Write a block-compressed mip chain as a DDS file with a DX10 header
+
+    Args:
+        path: Output file path
+        levels: List of uint8 arrays or rasters, largest first
+        texture_format: "bc7" or "bc5"
+        srgb: Mark the data as sRGB (color textures)
+        num_workers: Encoder threads (0 = CPU count)
+
+    Returns:
+        The output path
+    """
+    info = TEXTURE_FORMATS[texture_format]
+    height, width = levels[0].shape[:2]
+
+    pixel_format = struct.pack("<2I4s5I", 32, DDPF_FOURCC, b"DX10", 0, 0, 0, 0, 0)
+    header = _dds_header(width, height, len(levels), compressed_size(width, height), pixel_format, DDSD_LINEARSIZE)
+    # DDS_HEADER_DXT10: format, 2D resource dimension, misc flags, array size, alpha mode
+    header += struct.pack("<5I", info["dxgi_srgb"] if srgb else info["dxgi"], 3, 0, 1, 0)
+
+    _write_atomic(path, [header] + [_compressed_level(level, texture_format, num_workers) for level in levels])
+    return path
+
+
+def write_ktx2(path: str, levels: list, texture_format: str, srgb: bool = False, num_workers: int = 0) -> str:
+    """
+    Write a block-compressed mip chain as a KTX2 file
+
+    Args:
+        path: Output file path
+        levels: List of uint8 arrays or rasters, largest first
+        texture_format: "bc7" or "bc5"
+        srgb: Mark the data as sRGB (color textures)
+        num_workers: Encoder threads (0 = CPU count)
+
+    Returns:
+        The output path
+    """
+    info = TEXTURE_FORMATS[texture_format]
+    height, width = levels[0].shape[:2]
+    # Level sizes are known up front, so the index is written before any level is encoded
+    sizes = [compressed_size(level.shape[1], level.shape[0]) for level in levels]
+    dfd = _ktx2_dfd(texture_format, srgb)
+
+    level_count = len(levels)
+    header_size = 80 + 24 * level_count
+    dfd_offset = header_size
+    data_offset = _align(dfd_offset + len(dfd), 16)
+
+    # Level data is stored smallest mip first
+    offsets = [0] * level_count
+    cursor = data_offset
+    for index in reversed(range(level_count)):
+        cursor = _align(cursor, 16)
+        offsets[index] = cursor
+        cursor += sizes[index]
+
+    header = struct.pack(
+        "<12s9I4I2Q",
+        b"\xabKTX 20\xbb\r\n\x1a\n",
+        info["vk_srgb"] if srgb else info["vk"],
+        1,  # typeSize
+        width, height, 0,  # depth
+        0,  # layerCount
+        1,  # faceCount
+        level_count,
+        0,  # supercompressionScheme
+        dfd_offset, len(dfd), 0, 0,  # dfd, kvd
+        0, 0  # sgd
+    )
+    for index in range(level_count):
+        header += struct.pack("<3Q", offsets[index], sizes[index], sizes[index])
+
+    parts = [header, dfd]
+    position = dfd_offset + len(dfd)
+    for index in reversed(range(level_count)):
+        parts.append(b"\0" * (offsets[index] - position))
+        parts.append(_compressed_level(levels[index], texture_format, num_workers))
+        position = offsets[index] + sizes[index]
+
+    _write_atomic(path, parts)
+    return path
+
+
+def _ktx2_dfd(texture_format: str, srgb: bool) -> bytes:
+    """
+    Build the KTX2 Data Format Descriptor (Khronos basic descriptor block)
+    """
+    if texture_format == "bc7":
+        color_model = 134  # KHR_DF_MODEL_BC7
+        samples = [(0, 127, 0)]  # bit offset, bit length - 1, channel
+    else:
+        color_model = 132  # KHR_DF_MODEL_BC5
+        samples = [(0, 63, 0), (64, 63, 1)]
+
+    block_size = 24 + 16 * len(samples)
+    block = struct.pack(
+        "<IHH4B4B8B",
+        0,  # vendor id / descriptor type
+        2,  # version
+        block_size,
+        color_model,
+        1,  # KHR_DF_PRIMARIES_BT709
+        2 if srgb else 1,  # KHR_DF_TRANSFER_SRGB / LINEAR
+        0,  # flags: straight alpha
+        3, 3, 0, 0,  # 4x4 texel block
+        16, 0, 0, 0, 0, 0, 0, 0  # bytes per block in plane 0
+    )
+    for bit_offset, bit_length, channel in samples:
+        block += struct.pack("<HBB4BII", bit_offset, bit_length, channel, 0, 0, 0, 0, 0, 0xffffffff)
+    return struct.pack("<I", 4 + len(block)) + block
+
+
+def _align(value: int, alignment: int) -> int:
+    return (value + alignment - 1) // alignment * alignment
+
+
+def _write_atomic(path: str, parts: list):
+    """
+    Write parts to a temporary file and move it into place
+    A part is a bytes-like object or an iterable of them, consumed while writing
+    """
+    os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+    temp_path = f"{path}.tmp"
+    try:
+        with open(temp_path, "wb") as f:
+            for part in parts:
+                if isinstance(part, (bytes, bytearray, memoryview)):
+                    f.write(part)
+                else:
+                    for chunk in part:
+                        f.write(chunk)
+    except BaseException:
+        if os.path.exists(temp_path):
+            os.remove(temp_path)
+        raise
+    os.replace(temp_path, path)
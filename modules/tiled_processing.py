@@ -0,0 +1,804 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Out-of-Core Tiled Processing
+Streaming path for source images too large to hold in memory. The decoded source is
+spilled to a raw raster file, and the tile-friendly stages (sharpen, make_seamless,
+gen_pbr, gen_lod, export_textures) read it back in row bands with a halo and write
+their results band by band. The working set therefore follows the configured memory
+cap instead of the image size.
+"""
+
+import os
+import uuid
+import zlib
+import struct
+import shutil
+from io import BytesIO
+import logging
+import threading
+from typing import Any, Callable, Dict, List
+import numpy as np
+import cv2
+from PIL import Image, ImageFilter
+
+from modules.stage_graph import StageRegistry, StageGraph, SINK
+from modules.mip_chain import mip_level_count, unpremultiply
+from modules.texture_export import write_dds_rgba8, write_dds_compressed, write_ktx2
+from modules import metrics, pixel_kernels
+
+logger = logging.getLogger(__name__)
+
+# Stages with a streaming implementation; a flow containing anything else runs in memory
+TILED_STAGES = {"sharpen", "make_seamless", "gen_pbr", "gen_lod", "export_textures", "default_process"}
+
+# Rough in-memory cost per source pixel: decoded source, RGBA working image, normal map and
+# the float32 premultiplied mip level; auto mode switches to tiles when this exceeds the cap
+IN_MEMORY_BYTES_PER_PIXEL = 32
+
+# Working set per pixel of a band: uint8 rows in and out plus float32 temporaries
+_SHARPEN_BYTES_PER_PIXEL = 16
+_SEAMLESS_BYTES_PER_PIXEL = 96
+# Per output texel: the float32 source rows (up to 3x3 taps on odd sizes), the vertical
+# pass, the float32 level and its uint8 copy
+_MIP_BYTES_PER_PIXEL = 192
+
+# UnsharpMask(radius=2) blurs with three box passes of under 3 pixels each, so 16 rows of
+# context reproduce the full-frame filter exactly
+_SHARPEN_HALO = 16
+
+_PNG_COLOR_TYPES = {1: 0, 3: 2, 4: 6}
+_PNG_SIGNATURE = b"\x89PNG\r\n\x1a\n"
+# Bytes per pixel of 8-bit PNG color types (gray, RGB, palette, gray+alpha, RGBA)
+_PNG_CHANNELS = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}
+# Chunks a band decode needs besides IHDR/IDAT
+_PNG_BAND_CHUNKS = (b"PLTE", b"tRNS")
+# Per pixel of a streamed PNG band: filtered and re-wrapped scanlines, the decoded band,
+# its RGBA conversion and the array written to the raster
+_PNG_STREAM_BYTES_PER_PIXEL = 24
+
+
+class DiskRaster:
+    """
+    (H, W, C) array stored row-major in a raw file, read and written in row bands
+    Reads and writes are positional, so several stages may read one raster concurrently
+    """
+
+    def __init__(self, path: str, width: int, height: int, channels: int = 4, dtype=np.uint8,
+                 budget_bytes: int = 256 * 1024 * 1024):
+        """
+        Args:
+            path: Backing file, created (or truncated) here
+            width: Width in pixels
+            height: Height in pixels
+            channels: Channels per pixel
+            dtype: Element type
+            budget_bytes: Working-set budget for one band of a stage reading this raster
+        """
+        self.path = path
+        self.width = int(width)
+        self.height = int(height)
+        self.channels = int(channels)
+        self.dtype = np.dtype(dtype)
+        self.budget_bytes = int(budget_bytes)
+        self.row_bytes = self.width * self.channels * self.dtype.itemsize
+        self._file = open(path, "w+b")
+        self._file.truncate(self.row_bytes * self.height)
+        self._lock = threading.Lock()
+
+    @property
+    def shape(self) -> tuple:
+        return self.height, self.width, self.channels
+
+    def rows_per_band(self, bytes_per_pixel: int, multiple: int = 1, halo: int = 0) -> int:
+        """
+        Band height that keeps a stage within the budget
+
+        Args:
+            bytes_per_pixel: Stage working set per pixel of a band
+            multiple: Band heights are rounded down to a multiple of this (e.g. 4 for block rows)
+            halo: Context rows read above and below each band
+
+        Returns:
+            Rows per band, at least one multiple and never more than the raster height
+        """
+        rows = self.budget_bytes // max(1, self.width * bytes_per_pixel) - 2 * halo
+        rows = max(multiple, rows // multiple * multiple)
+        return min(rows, max(multiple, self.height))
+
+    def read_rows(self, y0: int, y1: int) -> np.ndarray:
+        """
+        Read rows [y0, y1) into a new array
+        """
+        data = bytearray(self.row_bytes * (y1 - y0))
+        offset = self.row_bytes * y0
+        if hasattr(os, "preadv"):
+            os.preadv(self._file.fileno(), [data], offset)
+        else:
+            with self._lock:
+                self._file.seek(offset)
+                self._file.readinto(data)
+        return np.frombuffer(data, dtype=self.dtype).reshape(y1 - y0, self.width, self.channels)
+
+    def write_rows(self, y0: int, rows: np.ndarray):
+        """
+        Write rows starting at y0
+        """
+        data = memoryview(np.ascontiguousarray(rows, dtype=self.dtype)).cast("B")
+        offset = self.row_bytes * y0
+        if hasattr(os, "pwrite"):
+            while data:
+                written = os.pwrite(self._file.fileno(), data, offset)
+                data, offset = data[written:], offset + written
+        else:
+            with self._lock:
+                self._file.seek(offset)
+                self._file.write(data)
+
+    def close(self):
+        self._file.close()
+
+
+class TiledWorkspace:
+    """
+    Temporary directory holding the rasters of one tiled job, removed on close
+    """
+
+    def __init__(self, root: str, budget_bytes: int):
+        self.path = os.path.join(root, uuid.uuid4().hex)
+        self.budget_bytes = budget_bytes
+        self._rasters: List[DiskRaster] = []
+        self._lock = threading.Lock()
+        os.makedirs(self.path, exist_ok=True)
+
+    def raster(self, width: int, height: int, channels: int = 4, dtype=np.uint8) -> DiskRaster:
+        """
+        Allocate a new raster in the workspace
+        """
+        raster = DiskRaster(os.path.join(self.path, f"{uuid.uuid4().hex}.raw"), width, height, channels,
+                            dtype, self.budget_bytes)
+        with self._lock:
+            self._rasters.append(raster)
+        return raster
+
+    def close(self):
+        with self._lock:
+            for raster in self._rasters:
+                raster.close()
+            self._rasters = []
+        shutil.rmtree(self.path, ignore_errors=True)
+
+
+def load_raster(path: str, workspace: TiledWorkspace) -> DiskRaster:
+    """
+    Decode an image into an RGBA raster
+
+    Non-interlaced 8-bit PNGs (what the pipeline and most painting tools write) are decoded
+    band by band with PNGStreamReader, so only one band is resident. Other formats, and
+    interlaced or 16-bit PNGs, are decoded once in their stored mode by PIL (which has no
+    row-streaming decoder, so that decoded frame is resident until this returns) and
+    converted to RGBA strip by strip.
+    """
+    reader = PNGStreamReader.open(path)
+    if reader is not None:
+        with reader:
+            raster = workspace.raster(reader.width, reader.height, 4)
+            for y0, band in reader.read_bands(raster.rows_per_band(_PNG_STREAM_BYTES_PER_PIXEL)):
+                raster.write_rows(y0, np.asarray(band if band.mode == "RGBA" else band.convert("RGBA")))
+        return raster
+
+    with Image.open(path) as image:
+        width, height = image.size
+        raster = workspace.raster(width, height, 4)
+        rows = raster.rows_per_band(8)
+        for y0 in range(0, height, rows):
+            y1 = min(height, y0 + rows)
+            strip = image.crop((0, y0, width, y1))
+            if strip.mode != "RGBA":
+                strip = strip.convert("RGBA")
+            raster.write_rows(y0, np.asarray(strip))
+    return raster
+
+
+class PNGStreamWriter:
+    """
+    Writes a PNG row band by row band, deflating as it goes
+    Rows use the Up filter, which is a single vectorized subtraction per band
+    """
+
+    def __init__(self, path: str, width: int, height: int, channels: int = 4, compress_level: int = 6):
+        """
+        Args:
+            path: Output path, written to a temporary file and moved into place on close
+            width: Width in pixels
+            height: Height in pixels
+            channels: 1 (gray), 3 (RGB) or 4 (RGBA)
+            compress_level: zlib level
+        """
+        self.path = path
+        self.width = width
+        self.height = height
+        self.channels = channels
+        self.rows_written = 0
+        self._previous = np.zeros((1, width * channels), dtype=np.uint8)
+        self._compressor = zlib.compressobj(compress_level)
+        os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+        self._temp_path = f"{path}.tmp"
+        self._file = open(self._temp_path, "wb")
+        self._file.write(b"\x89PNG\r\n\x1a\n")
+        self._chunk(b"IHDR", struct.pack(">2I5B", width, height, 8, _PNG_COLOR_TYPES[channels], 0, 0, 0))
+
+    def _chunk(self, tag: bytes, data: bytes):
+        self._file.write(struct.pack(">I", len(data)) + tag + data)
+        self._file.write(struct.pack(">I", zlib.crc32(tag + data) & 0xffffffff))
+
+    def write_rows(self, rows: np.ndarray):
+        """
+        Append the next rows (N, W, C) uint8
+        """
+        flat = np.ascontiguousarray(rows, dtype=np.uint8).reshape(-1, self.width * self.channels)
+        filtered = np.empty((flat.shape[0], flat.shape[1] + 1), dtype=np.uint8)
+        filtered[:, 0] = 2  # Up
+        np.subtract(flat[:1], self._previous, out=filtered[:1, 1:])
+        np.subtract(flat[1:], flat[:-1], out=filtered[1:, 1:])
+        self._previous = flat[-1:].copy()
+        self.rows_written += flat.shape[0]
+
+        data = self._compressor.compress(filtered.data)
+        if data:
+            self._chunk(b"IDAT", data)
+
+    def close(self):
+        if self.rows_written != self.height:
+            self.abort()
+            raise ValueError(f"PNG stream got {self.rows_written} of {self.height} rows")
+        self._chunk(b"IDAT", self._compressor.flush())
+        self._chunk(b"IEND", b"")
+        self._file.close()
+        os.replace(self._temp_path, self.path)
+
+    def abort(self):
+        self._file.close()
+        if os.path.exists(self._temp_path):
+            os.remove(self._temp_path)
+
+
+class PNGStreamReader:
+    """
+    Reads a non-interlaced 8-bit PNG row band by row band, the counterpart of PNGStreamWriter
+
+    IDAT data is inflated incrementally. PNG filters only reference the previous row, so each
+    band's filtered scanlines are wrapped, behind the previous band's last (unfiltered) row, in
+    a small stored-deflate PNG that PIL's native decoder unfilters; only one band is resident.
+    """
+
+    def __init__(self, file, header: tuple, band_chunks: List[tuple], first_idat: int):
+        self._file = file
+        self.width, self.height, _, self.color_type = header[:4]
+        self.stride = self.width * _PNG_CHANNELS[self.color_type]
+        self._band_chunks = band_chunks
+        self._first_idat = first_idat
+
+    @classmethod
+    def open(cls, path: str):
+        """
+        Open a PNG for streaming
+
+        Returns:
+            PNGStreamReader, or None when the file is not a PNG this reader handles
+            (interlaced, bit depth other than 8, or not a PNG at all)
+        """
+        f = open(path, "rb")
+        try:
+            if f.read(8) != _PNG_SIGNATURE:
+                f.close()
+                return None
+            header = None
+            band_chunks = []
+            while True:
+                position = f.tell()
+                length, tag = struct.unpack(">I4s", f.read(8))
+                if tag == b"IDAT":
+                    break
+                data = f.read(length)
+                f.seek(4, os.SEEK_CUR)  # CRC
+                if tag == b"IHDR":
+                    header = struct.unpack(">2I5B", data)
+                elif tag in _PNG_BAND_CHUNKS:
+                    band_chunks.append((tag, data))
+                elif tag == b"IEND":
+                    raise ValueError("PNG without image data")
+        except (OSError, struct.error, ValueError):
+            f.close()
+            return None
+        if header is None or header[2] != 8 or header[3] not in _PNG_CHANNELS or header[6] != 0:
+            f.close()
+            return None
+        return cls(f, header, band_chunks, position)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self):
+        self._file.close()
+
+    def _idat(self, chunk_bytes: int = 1 << 20):
+        """
+        Compressed image data of the consecutive IDAT chunks, in pieces of at most chunk_bytes
+        """
+        self._file.seek(self._first_idat)
+        while True:
+            header = self._file.read(8)
+            if len(header) < 8:
+                return
+            length, tag = struct.unpack(">I4s", header)
+            if tag != b"IDAT":
+                return
+            while length:
+                piece = self._file.read(min(length, chunk_bytes))
+                if not piece:
+                    return
+                length -= len(piece)
+                yield piece
+            self._file.seek(4, os.SEEK_CUR)  # CRC
+
+    def read_bands(self, rows: int):
+        """
+        Decode the image in bands
+
+        Args:
+            rows: Rows per band
+
+        Yields:
+            (first row, PIL Image of the band in the file's mode, palette and transparency kept)
+        """
+        line = self.stride + 1
+        band_bytes = line * rows
+        inflater = zlib.decompressobj()
+        pending = bytearray()
+        previous = bytes(self.stride)  # Row -1 is all zeros for the Up, Average and Paeth filters
+        y = 0
+
+        def bands(final: bool):
+            nonlocal previous, y
+            while y < self.height and (len(pending) >= band_bytes or (final and len(pending) >= line)):
+                count = min(rows, self.height - y, len(pending) // line)
+                band, previous = self._decode_band(previous, pending[:count * line], count)
+                del pending[:count * line]
+                yield y, band
+                y += count
+
+        for compressed in self._idat():
+            # Bounded inflate: a highly compressible stream never expands past one band at once
+            while compressed:
+                pending += inflater.decompress(compressed, band_bytes)
+                compressed = inflater.unconsumed_tail
+                yield from bands(False)
+        pending += inflater.flush()
+        yield from bands(True)
+        if y != self.height:
+            raise ValueError(f"PNG stream ended after {y} of {self.height} rows")
+
+    def _chunk(self, tag: bytes, data: bytes) -> bytes:
+        return struct.pack(">I", len(data)) + tag + data + struct.pack(">I", zlib.crc32(tag + data) & 0xffffffff)
+
+    def _decode_band(self, previous: bytes, scanlines: bytearray, count: int):
+        # Row 0 is the previous band's last row, stored unfiltered, so the band's filters resolve
+        raw = b"\x00" + previous + scanlines
+        png = b"".join([
+            _PNG_SIGNATURE,
+            self._chunk(b"IHDR", struct.pack(">2I5B", self.width, count + 1, 8, self.color_type, 0, 0, 0)),
+            *(self._chunk(tag, data) for tag, data in self._band_chunks),
+            self._chunk(b"IDAT", zlib.compress(raw, 0)),
+            self._chunk(b"IEND", b""),
+        ])
+        image = Image.open(BytesIO(png))
+        image.load()
+        band = image.crop((0, 1, self.width, count + 1))
+        return band, image.crop((0, count, self.width, count + 1)).tobytes()
+
+
+def save_raster_png(raster: DiskRaster, path: str) -> str:
+    """
+    Stream a uint8 raster into a PNG file
+    """
+    writer = PNGStreamWriter(path, raster.width, raster.height, raster.channels)
+    try:
+        rows = raster.rows_per_band(2 * raster.channels)
+        for y0 in range(0, raster.height, rows):
+            writer.write_rows(raster.read_rows(y0, min(raster.height, y0 + rows)))
+    except BaseException:
+        writer.abort()
+        raise
+    writer.close()
+    return path
+
+
+class StreamingCLAHE:
+    """
+    OpenCV's CLAHE split into a histogram pass and a per-band apply pass
+
+    Tile geometry, histogram clipping, lookup tables and bilinear interpolation follow
+    cv2.createCLAHE().apply, including its reflect-101 padding when the frame is not a
+    multiple of the grid, so a streamed frame matches the in-memory equalization up to
+    float rounding.
+    """
+
+    def __init__(self, width: int, height: int, clip_limit: float = 0.03, grid: tuple = (8, 8)):
+        """
+        Args:
+            width: Frame width
+            height: Frame height
+            clip_limit: Same meaning as cv2.createCLAHE clipLimit
+            grid: (tiles_x, tiles_y)
+        """
+        self.width = width
+        self.height = height
+        self.tiles_x, self.tiles_y = grid
+        self.clip_limit = clip_limit
+        if width % self.tiles_x == 0 and height % self.tiles_y == 0:
+            ext_width, ext_height = width, height
+        else:
+            ext_width = width + self.tiles_x - width % self.tiles_x
+            ext_height = height + self.tiles_y - height % self.tiles_y
+        self.ext_width, self.ext_height = ext_width, ext_height
+        self.tile_width = ext_width // self.tiles_x
+        self.tile_height = ext_height // self.tiles_y
+        self.luts = None
+
+        # Column interpolation is the same for every row
+        txf = np.arange(width, dtype=np.float32) * np.float32(1.0 / self.tile_width) - np.float32(0.5)
+        tx1 = np.floor(txf).astype(np.int32)
+        self._xa = (txf - tx1).astype(np.float32)
+        self._tx1 = np.maximum(tx1, 0)
+        self._tx2 = np.minimum(tx1 + 1, self.tiles_x - 1)
+
+    def _source_row(self, y: int) -> int:
+        # Reflect-101 padding below the frame
+        return y if y < self.height else 2 * (self.height - 1) - y
+
+    def fit(self, read_gray: Callable[[int, int], np.ndarray], rows: int):
+        """
+        Gather the tile histograms and build the lookup tables
+
+        Args:
+            read_gray: Callable (y0, y1) -> uint8 gray rows of the frame
+            rows: Rows per band
+        """
+        histograms = np.zeros((self.tiles_y, self.tiles_x * 256), dtype=np.int64)
+        offsets = (np.arange(self.tiles_x, dtype=np.int32) * 256)[None, :, None]
+
+        def accumulate(y0: int, gray: np.ndarray):
+            if gray.shape[1] < self.ext_width:
+                gray = cv2.copyMakeBorder(gray, 0, 0, 0, self.ext_width - gray.shape[1], cv2.BORDER_REFLECT_101)
+            gray = gray[:, :self.tiles_x * self.tile_width]
+            y = y0
+            while y < y0 + gray.shape[0]:
+                tile_row = y // self.tile_height
+                stop = min(y0 + gray.shape[0], (tile_row + 1) * self.tile_height)
+                segment = gray[y - y0:stop - y0].reshape(stop - y, self.tiles_x, self.tile_width).astype(np.int32)
+                segment += offsets
+                histograms[tile_row] += np.bincount(segment.ravel(), minlength=self.tiles_x * 256)
+                y = stop
+
+        for y0 in range(0, self.height, rows):
+            accumulate(y0, read_gray(y0, min(self.height, y0 + rows)))
+        for y in range(self.height, self.ext_height):
+            source_row = self._source_row(y)
+            accumulate(y, read_gray(source_row, source_row + 1))
+
+        self.luts = self._build_luts(histograms.reshape(self.tiles_y, self.tiles_x, 256))
+
+    def _build_luts(self, histograms: np.ndarray) -> np.ndarray:
+        tile_area = self.tile_width * self.tile_height
+        limit = max(int(self.clip_limit * tile_area / 256), 1) if self.clip_limit > 0 else 0
+        scale = np.float32(255.0 / tile_area)
+        luts = np.empty(histograms.shape, dtype=np.uint8)
+        for ty in range(self.tiles_y):
+            for tx in range(self.tiles_x):
+                hist = histograms[ty, tx].copy()
+                if limit:
+                    clipped = int(np.maximum(hist - limit, 0).sum())
+                    np.minimum(hist, limit, out=hist)
+                    batch, residual = divmod(clipped, 256)
+                    hist += batch
+                    if residual:
+                        step = max(256 // residual, 1)
+                        hist[np.arange(0, 256, step)[:residual]] += 1
+                luts[ty, tx] = np.rint(np.cumsum(hist).astype(np.float32) * scale).clip(0, 255)
+        return luts
+
+    def apply(self, y0: int, gray: np.ndarray) -> np.ndarray:
+        """
+        Equalize a band of rows starting at frame row y0 (fit must have run)
+        """
+        tyf = np.arange(y0, y0 + gray.shape[0], dtype=np.float32) * np.float32(1.0 / self.tile_height) - np.float32(0.5)
+        ty1 = np.floor(tyf).astype(np.int32)
+        ya = (tyf - ty1).astype(np.float32)[:, None]
+        ty2 = np.minimum(ty1 + 1, self.tiles_y - 1)[:, None]
+        ty1 = np.maximum(ty1, 0)[:, None]
+        tx1, tx2, xa = self._tx1[None, :], self._tx2[None, :], self._xa[None, :]
+
+        top = self.luts[ty1, tx1, gray] * (1.0 - xa) + self.luts[ty1, tx2, gray] * xa
+        bottom = self.luts[ty2, tx1, gray] * (1.0 - xa) + self.luts[ty2, tx2, gray] * xa
+        result = top * (1.0 - ya) + bottom * ya
+        return np.rint(result).clip(0, 255).astype(np.uint8)
+
+
+def sharpen_raster(source: DiskRaster, output: DiskRaster):
+    """
+    ImageProcessor.sharpen (UnsharpMask radius 2, 150%, threshold 3) in row bands
+    """
+    rows = source.rows_per_band(_SHARPEN_BYTES_PER_PIXEL, halo=_SHARPEN_HALO)
+    for y0 in range(0, source.height, rows):
+        y1 = min(source.height, y0 + rows)
+        sy0, sy1 = max(0, y0 - _SHARPEN_HALO), min(source.height, y1 + _SHARPEN_HALO)
+        window = Image.fromarray(source.read_rows(sy0, sy1), "RGBA")
+        sharpened = np.asarray(window.filter(ImageFilter.UnsharpMask(radius=2, percent=150, threshold=3)))
+        output.write_rows(y0, sharpened[y0 - sy0:y1 - sy0])
+
+
+def make_seamless_raster(source: DiskRaster, output: DiskRaster):
+    """
+    Offset-and-blend seamless tiling (pixel_kernels.make_seamless) in row bands
+    """
+    height, width = source.height, source.width
+    weight_x, weight_y = pixel_kernels.seamless_weights(width, height)
+    rows = source.rows_per_band(_SEAMLESS_BYTES_PER_PIXEL)
+    shift_y = height // 2
+
+    for start in range(0, height, rows):
+        stop = min(height, start + rows)
+        # Rows (y - H/2) mod H: at most two contiguous runs of the source
+        first = (start - shift_y) % height
+        count = stop - start
+        if first + count <= height:
+            rolled = source.read_rows(first, first + count)
+        else:
+            rolled = np.concatenate([source.read_rows(first, height), source.read_rows(0, first + count - height)])
+        result = np.empty((count, width, 4), dtype=np.uint8)
+        pixel_kernels.blend_seamless_rows(source.read_rows(start, stop), rolled, weight_y[start:stop], weight_x, result)
+        output.write_rows(start, result)
+
+
+def _resize_taps(source: int, target: int):
+    """
+    Source indices and weights of cv2.resize INTER_AREA along one axis, which build_mip_chain
+    uses: when shrinking, target sample i averages the source interval [i * s, (i + 1) * s)
+    with s = source / target (a plain 2-tap box when s is 2, fractional weights on odd sizes);
+    when growing (min_size clamps) it interpolates linearly
+
+    Returns:
+        (index (target, taps) int64, weights (target, taps) float32)
+    """
+    if target == source:
+        return np.arange(target)[:, None], np.ones((target, 1), dtype=np.float32)
+    if target > source:
+        position = np.maximum((np.arange(target) + 0.5) * (source / target) - 0.5, 0.0)
+        first = np.minimum(np.floor(position).astype(np.int64), source - 1)
+        fraction = position - first
+        index = np.stack([first, np.minimum(first + 1, source - 1)], axis=1)
+        return index, np.stack([1.0 - fraction, fraction], axis=1).astype(np.float32)
+
+    scale = source / target
+    start = np.arange(target) * scale
+    index = np.floor(start).astype(np.int64)[:, None] + np.arange(int(np.ceil(scale)) + 1)[None, :]
+    overlap = np.minimum(index + 1, start[:, None] + scale) - np.maximum(index, start[:, None])
+    weights = np.clip(overlap, 0.0, None) / scale
+    # Drop taps no target sample uses (e.g. the third tap of an exact 2x reduction)
+    used = weights.max(axis=0) > 1e-6
+    return np.minimum(index[:, used], source - 1), weights[:, used].astype(np.float32)
+
+
+def build_mip_chain_tiled(base: DiskRaster, workspace: TiledWorkspace, levels: int = 0,
+                          min_size: int = 1) -> List[DiskRaster]:
+    """
+    Out-of-core mip_chain.build_mip_chain with the box filter
+
+    Each level is a premultiplied area average of the previous float32 level (2x2 on even
+    sizes, fractional INTER_AREA weights on odd ones, so no row or column is dropped), done
+    separably in bands of output rows. The float32 levels live in the workspace as well.
+
+    Returns:
+        List of uint8 RGBA rasters from largest to smallest; the base level is the input
+    """
+    width, height = base.width, base.height
+    if levels <= 0:
+        levels = mip_level_count(width, height, min_size)
+
+    chain = [base]
+    previous = None  # Premultiplied float32 level
+    for _ in range(1, levels):
+        source_width, source_height = width, height
+        width = max(min_size, width // 2)
+        height = max(min_size, height // 2)
+        row_index, row_weights = _resize_taps(source_height, height)
+        column_index, column_weights = _resize_taps(source_width, width)
+        premultiplied = workspace.raster(width, height, 4, np.float32)
+        level = workspace.raster(width, height, 4)
+        rows = premultiplied.rows_per_band(_MIP_BYTES_PER_PIXEL)
+
+        for y0 in range(0, height, rows):
+            y1 = min(height, y0 + rows)
+            taps = row_index[y0:y1]
+            first, last = int(taps.min()), int(taps.max()) + 1
+            if previous is None:
+                source = base.read_rows(first, last).astype(np.float32)
+                source[:, :, :3] *= source[:, :, 3:4] * (1.0 / 255.0)
+            else:
+                source = previous.read_rows(first, last)
+
+            vertical = np.zeros((y1 - y0, source_width, 4), dtype=np.float32)
+            for k in range(taps.shape[1]):
+                vertical += source[taps[:, k] - first] * row_weights[y0:y1, k, None, None]
+            band = np.zeros((y1 - y0, width, 4), dtype=np.float32)
+            for k in range(column_index.shape[1]):
+                band += vertical[:, column_index[:, k]] * column_weights[None, :, k, None]
+
+            premultiplied.write_rows(y0, band)
+            level.write_rows(y0, unpremultiply(band))
+
+        chain.append(level)
+        previous = premultiplied
+    return chain
+
+
+def create_tiled_registry(image_processor, normal_generator) -> StageRegistry:
+    """
+    Streaming counterparts of the tile-friendly stages of create_default_registry
+    Stages pass DiskRasters instead of images and allocate from ctx.artifacts["workspace"]
+    """
+    registry = StageRegistry()
+    config = image_processor.config
+    lod_container = getattr(config, "lod_container", "png")
+    texture_container = getattr(config, "texture_export", "") or "ktx2"
+    texture_workers = getattr(config, "texture_export_workers", 0)
+
+    def allocate_like(ctx, raster: DiskRaster) -> DiskRaster:
+        return ctx.artifacts["workspace"].raster(raster.width, raster.height, raster.channels)
+
+    def sharpen(ctx, raster):
+        output = allocate_like(ctx, raster)
+        sharpen_raster(raster, output)
+        return output
+
+    def make_seamless(ctx, raster):
+        output = allocate_like(ctx, raster)
+        make_seamless_raster(raster, output)
+        return output
+
+    def gen_pbr(ctx, raster):
+        normal_map = allocate_like(ctx, raster)
+        normal_generator.generate_tiled(raster, normal_map)
+        ctx.publish("normal_map", normal_map)
+        normal_path = ctx.output_path("normal")
+        save_raster_png(normal_map, normal_path)
+        return {"outputs": [normal_path]}
+
+    def gen_lod(ctx, raster):
+        workspace = ctx.artifacts["workspace"]
+        if lod_container == "dds":
+            chain = build_mip_chain_tiled(raster, workspace)
+            ctx.publish("mip_chain", chain)
+            lod_path = ctx.output_path("lods", ext=".dds")
+            write_dds_rgba8(lod_path, chain)
+            return {"outputs": [lod_path], "levels": len(chain)}
+
+        outputs = []
+        for i, level in enumerate(build_mip_chain_tiled(raster, workspace, levels=3, min_size=32)):
+            lod_path = ctx.output_path("lod", index=i)
+            save_raster_png(level, lod_path)
+            outputs.append(lod_path)
+        return {"outputs": outputs}
+
+    def export_textures(ctx, raster):
+        workspace = ctx.artifacts["workspace"]
+        chain = ctx.artifacts.get("mip_chain") or build_mip_chain_tiled(raster, workspace)
+        writer = write_ktx2 if texture_container == "ktx2" else write_dds_compressed
+        extension = ".ktx2" if texture_container == "ktx2" else ".dds"
+
+        outputs = [writer(ctx.output_path("base_color", ext=extension), chain, "bc7",
+                          srgb=True, num_workers=texture_workers)]
+
+        normal_map = ctx.artifacts.get("normal_map")
+        if normal_map is None and os.path.exists(ctx.output_path("normal")):
+            normal_map = load_raster(ctx.output_path("normal"), workspace)
+        if normal_map is not None:
+            normal_chain = build_mip_chain_tiled(normal_map, workspace)
+            outputs.append(writer(ctx.output_path("normal_texture", ext=extension), normal_chain, "bc5",
+                                  num_workers=texture_workers))
+        return {"outputs": outputs, "levels": len(chain), "container": texture_container}
+
+    registry.register("sharpen", sharpen)
+    registry.register("make_seamless", make_seamless)
+    registry.register("gen_pbr", gen_pbr, kind=SINK)
+    registry.register("gen_lod", gen_lod, kind=SINK)
+    registry.register("export_textures", export_textures, kind=SINK, requires=["gen_pbr", "gen_lod"])
+    registry.register("default_process", lambda ctx, raster: raster)
+    return registry
+
+
+class TiledProcessor:
+    """
+    Decides when a workflow job goes out of core and runs it through the tiled registry
+    """
+
+    def __init__(self, config, image_processor, normal_generator):
+        """
+        Args:
+            config: Configuration object (tiled_mode, tiled_memory_mb, temp_dir)
+            image_processor: ImageProcessor instance
+            normal_generator: NormalMapGenerator instance
+        """
+        self.mode = getattr(config, "tiled_mode", "auto")
+        self.budget_bytes = max(16, int(getattr(config, "tiled_memory_mb", 512))) * 1024 * 1024
+        self.temp_dir = os.path.join(getattr(config, "temp_dir", "Temp"), "tiled")
+        self.registry = create_tiled_registry(image_processor, normal_generator)
+
+    def should_tile(self, input_path: str, output_path: str, processes: List[str]) -> bool:
+        """
+        Whether a job should run out of core
+
+        Args:
+            input_path: Source image (only the header is read)
+            output_path: Final output path, must be a PNG
+            processes: Process list of the job
+
+        Returns:
+            True for "always", or for "auto" when the in-memory path would exceed the memory cap
+        """
+        if self.mode not in ("auto", "always"):
+            return False
+        unsupported = [name for name in processes if name not in TILED_STAGES]
+        if unsupported or os.path.splitext(output_path)[1].lower() != ".png":
+            if self.mode == "always":
+                logger.warning(f"Tiled mode unavailable for {os.path.basename(input_path)} "
+                               f"(in-memory stages: {unsupported or 'non-PNG output'})")
+            return False
+        if self.mode == "always":
+            return True
+        try:
+            with Image.open(input_path) as image:
+                width, height = image.size
+        except Exception:
+            return False
+        return width * height * IN_MEMORY_BYTES_PER_PIXEL > self.budget_bytes
+
+    def run(self, processes: List[str], context, executor, output_path: str,
+            progress: Callable[[Dict[str, Any]], None] = None,
+            timings: Dict[str, float] = None) -> List[Dict[str, Any]]:
+        """
+        Run a job out of core
+
+        Args:
+            processes: Process list
+            context: StageContext of the job
+            executor: StageExecutor
+            output_path: Final PNG output
+            progress: Optional per-stage callback, see StageExecutor.run
+            timings: Optional dictionary receiving load_ms, stages_ms and save_ms
+
+        Returns:
+            Per-stage results
+        """
+        workspace = TiledWorkspace(self.temp_dir, self.budget_bytes)
+        try:
+            timings = {} if timings is None else timings
+            context.publish("workspace", workspace)
+            with metrics.timed("workflow.load", filename=context.filename, tiled=True) as timing:
+                source = load_raster(context.input_path, workspace)
+            timings["load_ms"] = timing["seconds"] * 1000.0
+            logger.info(f"Tiled mode: {context.filename} ({source.width}x{source.height}, "
+                        f"{self.budget_bytes // (1024 * 1024)} MB per stage)")
+            graph = StageGraph(self.registry, processes)
+            with metrics.timed("workflow.stages", tiled=True) as timing:
+                final, results = executor.run(graph, context, source, progress=progress)
+            timings["stages_ms"] = timing["seconds"] * 1000.0
+            with metrics.timed("workflow.save", filename=context.filename, tiled=True) as timing:
+                save_raster_png(final, output_path)
+            timings["save_ms"] = timing["seconds"] * 1000.0
+            return results
+        finally:
+            workspace.close()
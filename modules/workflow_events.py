@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""
+AmberPipeline AI - Workflow Event Bus
+Numbered workflow events (job state transitions, per-stage progress) pushed to subscribers,
+with a bounded replay buffer so a reconnecting client resumes from its last event ID
+"""
+
+import time
+import asyncio
+import threading
+import itertools
+from collections import deque
+from typing import Any, Dict, List, Optional
+
+
+class WorkflowEventSubscription:
+    """
+    Subscriber-side queue bound to the asyncio loop that created it
+    """
+
+    def __init__(self, loop: asyncio.AbstractEventLoop, max_pending: int):
+        self.loop = loop
+        self.queue: asyncio.Queue = asyncio.Queue(maxsize=max_pending)
+        # Set when the subscriber fell behind; it must resynchronize from a snapshot
+        self.overflowed = False
+
+    def _deliver(self, event: Dict[str, Any]):
+        if self.overflowed:
+            return
+        try:
+            self.queue.put_nowait(event)
+        except asyncio.QueueFull:
+            # Drop the backlog and wake the consumer, which then sends a fresh snapshot
+            self.overflowed = True
+            while not self.queue.empty():
+                self.queue.get_nowait()
+            self.queue.put_nowait(None)
+
+    async def get(self, timeout: float) -> Optional[Dict[str, Any]]:
+        """
+        Wait for the next event
+
+        Returns:
+            Event dictionary, or None on timeout or overflow (check overflowed)
+        """
+        try:
+            return await asyncio.wait_for(self.queue.get(), timeout)
+        except asyncio.TimeoutError:
+            return None
+
+
+class WorkflowEventBus:
+    """
+    Thread-safe publisher: workflow worker threads publish, async HTTP handlers subscribe
+    """
+
+    def __init__(self, history_size: int = 1000, max_pending: int = 256):
+        """
+        Args:
+            history_size: Events kept for replay after a reconnect
+            max_pending: Undelivered events per subscriber before it is marked overflowed
+        """
+        self.max_pending = max_pending
+        self._history = deque(maxlen=history_size)
+        self._sequence = itertools.count(1)
+        self._subscribers: List[WorkflowEventSubscription] = []
+        self._lock = threading.Lock()
+
+    def publish(self, event_type: str, data: Dict[str, Any]) -> Dict[str, Any]:
+        """
+        Publish an event from any thread
+
+        Args:
+            event_type: e.g. job_queued, job_started, stage_progress, job_finished, scheduler
+            data: JSON-serializable payload
+
+        Returns:
+            The event with its id and timestamp
+        """
+        with self._lock:
+            event = {"id": next(self._sequence), "type": event_type, "time": time.time(), "data": data}
+            self._history.append(event)
+            subscribers = list(self._subscribers)
+        for subscription in subscribers:
+            try:
+                subscription.loop.call_soon_threadsafe(subscription._deliver, event)
+            except RuntimeError:
+                # Loop already closed, the subscriber is gone
+                self.unsubscribe(subscription)
+        return event
+
+    def subscribe(self, last_event_id: Optional[int] = None) -> tuple:
+        """
+        Register a subscriber on the running asyncio loop
+
+        Args:
+            last_event_id: Last event the client has seen, None for a fresh connection
+
+        Returns:
+            (subscription, replayed events) -- replayed is None when the requested events are
+            no longer buffered (or no id was given) and the client needs a full snapshot
+        """
+        subscription = WorkflowEventSubscription(asyncio.get_running_loop(), self.max_pending)
+        with self._lock:
+            self._subscribers.append(subscription)
+            replay = None
+            # IDs restart with the process, so an ID newer than ours also needs a snapshot
+            if last_event_id is not None and self._history:
+                if self._history[0]["id"] - 1 <= last_event_id <= self._history[-1]["id"]:
+                    replay = [event for event in self._history if event["id"] > last_event_id]
+        return subscription, replay
+
+    def unsubscribe(self, subscription: WorkflowEventSubscription):
+        with self._lock:
+            if subscription in self._subscribers:
+                self._subscribers.remove(subscription)
+
+    @property
+    def last_event_id(self) -> int:
+        with self._lock:
+            return self._history[-1]["id"] if self._history else 0
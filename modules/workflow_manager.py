@@ -10,14 +10,26 @@ import time
 import threading
 import logging
 import json
+import contextlib
+from collections import Counter
+from io import BytesIO
 from typing import Dict, List, Any, Optional
 from PIL import Image
 
 # Import modules
-from modules.segmentation import SAMSegmenter
+from modules import metrics
+from modules.segmentation_engine import get_segmentation_engine
 from modules.image_processing import ImageProcessor
 from modules.naming_resolver import NamingResolver
 from modules.normal_map import NormalMapGenerator
+from modules.job_queue import JobQueue
+from modules.file_ingest import FileIngestWatcher
+from modules.stage_graph import StageContext, StageGraph, StageExecutor, create_default_registry
+from modules.build_cache import BuildCache
+from modules.tiled_processing import TiledProcessor
+from modules.workflow_events import WorkflowEventBus
+from modules.admission import AdmissionScheduler, CostModel, JobCost
+from modules.cluster import ClusterCoordinator
 
 # Configure logging
 logging.basicConfig(
@@ -26,6 +38,16 @@ logging.basicConfig(
 )
 logger = logging.getLogger(__name__)
 
+JOB_SECONDS = metrics.histogram("amber_workflow_job_duration_seconds", "Workflow job time from slot acquired to done",
+                                ["type", "status"])
+JOB_QUEUE_SECONDS = metrics.histogram("amber_workflow_queue_wait_seconds", "Time a job waited before processing began",
+                                      ["type"])
+JOB_IO_SECONDS = metrics.histogram("amber_workflow_io_duration_seconds", "Source decode and final PNG encode time",
+                                   ["op", "type"])
+JOB_BYTES = metrics.histogram("amber_workflow_file_bytes", "Source and output file sizes", ["direction", "type"],
+                              buckets=metrics.BYTE_BUCKETS)
+JOBS_TOTAL = metrics.counter("amber_workflow_jobs_total", "Finished workflow jobs", ["type", "status"])
+
 class WorkflowManager:
     """
     Automatic Workflow Manager
@@ -41,25 +63,68 @@ class WorkflowManager:
         """
         self.config = config
         self.running = False
-        self.monitor_thread = None
+        self.ingest = None
+        self.workers = []
         self.processing_queue = []
-        self.processed_files = []
-        self.failed_files = []
         self.current_process = None
         self.models_loaded = False
-        # Batch configuration
-        self.max_parallel_tasks = 4  # Default value to prevent VRAM overflow
+        # Batch configuration: upper bound on concurrent jobs, the admission scheduler decides within it
+        self.max_parallel_tasks = getattr(config, "max_parallel_tasks", 4)
         self.current_running_tasks = 0
         self.batch_condition = threading.Condition()  # 使用Condition替代Lock，更适合等待条件变化
         
+        # Per-stage concurrency limits, GPU stages default to one SAM batch worth of requests
+        self.cpu_slots = int(getattr(config, "workflow_cpu_slots", 0)) or os.cpu_count() or 1
+        self.gpu_slots = int(getattr(config, "workflow_gpu_slots", 0)) or int(getattr(config, "sam_batch_size", 1))
+        self.cpu_semaphore = threading.BoundedSemaphore(self.cpu_slots)
+        self.gpu_semaphore = threading.BoundedSemaphore(self.gpu_slots)
+        
+        # Durable job queue, finished results are restored so history survives a restart
+        self.job_queue = JobQueue(getattr(config, "workflow_queue_path", os.path.abspath("workflow_jobs.db")))
+        self.job_condition = threading.Condition()
+        self.processed_files = self.job_queue.load_results("completed")
+        self.failed_files = self.job_queue.load_results("failed")
+        # Per-asset-type counts of the history, kept incrementally so status stays O(1)
+        self.type_counts = {
+            "completed": Counter(self._file_type(r["filename"]) for r in self.processed_files),
+            "failed": Counter(self._file_type(r["filename"]) for r in self.failed_files)
+        }
+        
+        # Pushed job transitions and stage progress, replaces polling the full status
+        self.events = WorkflowEventBus()
+        
         # Initialize components - SAM模型延迟加载
         self.naming_resolver = NamingResolver()
         self.image_processor = ImageProcessor(config)
         self.normal_map_generator = NormalMapGenerator(config)
-        self.sam_segmenter = None  # SAM模型延迟加载
+        self.segmentation_engine = None  # SAM模型延迟加载，进程内共享
+        
+        # Stage graph: registered stages, executed with per-stage CPU/GPU limits
+        self.stage_registry = create_default_registry(self.image_processor, self.normal_map_generator, self._segment)
+        self.stage_executor = StageExecutor(max_workers=self.cpu_slots + self.gpu_slots, slot_provider=self._stage_slot)
+        # Out-of-core path for sources whose in-memory flow would exceed tiled_memory_mb
+        self.tiled_processor = TiledProcessor(config, self.image_processor, self.normal_map_generator)
+        
+        # Memory/VRAM-aware admission: jobs are costed from image size and process list
+        stage_kinds = {name: self.stage_registry.get(name).kind for name in self.stage_registry.names()}
+        self.cost_model = CostModel(config, stage_kinds)
+        self.scheduler = AdmissionScheduler(config, max_jobs=self.max_parallel_tasks)
+        
+        # Incremental build cache, unchanged assets and stages are skipped
+        self.build_cache = None
+        if getattr(config, "incremental_build", False):
+            self.build_cache = BuildCache(config.build_cache_dir, int(config.build_cache_max_mb * 1024 * 1024))
+        
+        # Cluster coordinator: jobs are leased to remote workers instead of local worker threads
+        self.cluster = None
+        if getattr(config, "cluster_role", "standalone") == "coordinator":
+            self.cluster = ClusterCoordinator(self, config)
         
         # Ensure directories exist
         self._ensure_directories()
+        
+        # Queue depth and slot usage are read at scrape time
+        metrics.REGISTRY.register_collector("workflow", self._collect_metrics)
     
     def _ensure_directories(self):
         """
@@ -85,63 +150,187 @@ class WorkflowManager:
             logger.warning("Workflow manager is already running")
             return
         
+        if self.cluster is not None:
+            # Coordinator: no local models or workers, running leases stay with their workers
+            self.running = True
+            recovered = self.job_queue.recover(keep_leases=True)
+            if recovered:
+                logger.info(f"Resuming {recovered} interrupted local job(s)")
+            self.cluster.start()
+            self._start_ingest()
+            return
+        
         # 加载AI模型（延迟加载，只在首次启动监控时加载）
         if not self.models_loaded:
             logger.info("Loading AI models...")
-            from modules.segmentation import SAMSegmenter
-            self.sam_segmenter = SAMSegmenter(self.config)
+            self.segmentation_engine = get_segmentation_engine(self.config)
+            self.segmentation_engine.start()
             self.models_loaded = True
             logger.info("AI models loaded successfully")
         
         self.running = True
-        self.monitor_thread = threading.Thread(target=self._monitor_directory, daemon=True)
-        self.monitor_thread.start()
+        
+        # Jobs interrupted by a previous shutdown go back to the queue
+        recovered = self.job_queue.recover()
+        if recovered:
+            logger.info(f"Resuming {recovered} interrupted job(s)")
+        
+        self._ensure_workers()
+        self._start_ingest()
+    
+    def _start_ingest(self):
+        """
+        Start watching the watch directory and announce the running state
+        """
+        # Files already in the directory are queued too; known versions are skipped by fingerprint
+        self.ingest = FileIngestWatcher(
+            self.config.watch_dir,
+            self._enqueue_file,
+            settle_seconds=float(getattr(self.config, "ingest_settle_ms", 500)) / 1000.0
+        )
+        self.ingest.start()
+        self.events.publish("workflow_state", {"is_running": True})
         logger.info(f"Started monitoring directory: {self.config.watch_dir}")
     
     def stop_monitoring(self):
         """
         Stop monitoring the watch directory
+        Running jobs finish; queued jobs stay on disk for the next start
         """
         self.running = False
-        if self.monitor_thread:
-            self.monitor_thread.join(timeout=5)
+        if self.ingest:
+            self.ingest.stop()
+            self.ingest = None
+        if self.cluster is not None:
+            self.cluster.stop()
+        with self.job_condition:
+            self.job_condition.notify_all()
+        with self.batch_condition:
+            self.batch_condition.notify_all()
+        for worker in self.workers:
+            worker.join(timeout=5)
+        self.workers = []
+        self.events.publish("workflow_state", {"is_running": False})
         logger.info("Stopped monitoring directory")
     
-    def _monitor_directory(self):
+    def _enqueue_file(self, file_path: str):
         """
-        Monitor the watch directory for new files
+        Queue a completely written file from the watch directory
+        
+        Args:
+            file_path: Full path of the file
         """
-        processed_filenames = set()
+        filename = os.path.basename(file_path)
+        try:
+            fingerprint = JobQueue.fingerprint(file_path)
+        except OSError:
+            return
         
+        if self.job_queue.enqueue(filename, fingerprint, self._job_requirement(filename)):
+            logger.info(f"New file detected: {filename}")
+            self.events.publish("job_queued", {"filename": filename})
+            with self.job_condition:
+                self.job_condition.notify()
+    
+    def _job_requirement(self, filename: str) -> str:
+        """
+        Capability a worker needs for a file: "gpu" if any of its stages runs on the GPU, else "cpu"
+        """
+        try:
+            processes = self._job_processes(self.naming_resolver.resolve(filename))
+        except Exception:
+            return "cpu"
+        for name in processes:
+            stage = self.stage_registry.get(name)
+            if stage is not None and stage.resource == "gpu":
+                return "gpu"
+        return "cpu"
+    
+    def _ensure_workers(self):
+        """
+        Start worker threads up to max_parallel_tasks
+        """
+        if self.cluster is not None:
+            return
+        self.workers = [w for w in self.workers if w.is_alive()]
+        while len(self.workers) < self.max_parallel_tasks:
+            worker = threading.Thread(
+                target=self._worker_loop,
+                name=f"WorkflowWorker-{len(self.workers)}",
+                daemon=True
+            )
+            worker.start()
+            self.workers.append(worker)
+    
+    def _worker_loop(self):
+        """
+        Worker thread: claim queued jobs and process them until stopped
+        """
         while self.running:
-            try:
-                # Get all files in the watch directory
-                files = [f for f in os.listdir(self.config.watch_dir) 
-                        if os.path.isfile(os.path.join(self.config.watch_dir, f))]
-                
-                # Process new files
-                for filename in files:
-                    if filename not in processed_filenames:
-                        logger.info(f"New file detected: {filename}")
-                        self.process_file(filename)
-                        processed_filenames.add(filename)
-                
-                # Sleep for a short interval
-                time.sleep(1)
+            # Only claim a job when a task slot is free, so lowering max_parallel_tasks takes effect
+            with self.batch_condition:
+                while self.running and self.current_running_tasks >= self.max_parallel_tasks:
+                    self.batch_condition.wait(timeout=1.0)
+            if not self.running:
+                break
+            
+            job = self.job_queue.claim()
+            if job is None:
+                with self.job_condition:
+                    if self.running:
+                        self.job_condition.wait(timeout=1.0)
+                continue
             
-            except Exception as e:
-                logger.error(f"Error monitoring directory: {str(e)}")
-                time.sleep(5)
+            result = self.process_file(job["filename"], queued_at=job["enqueued_at"])
+            self.job_queue.complete(job["id"], result)
     
-    def process_file(self, filename: str) -> Dict[str, Any]:
+    def _stage_slot(self, stage) -> threading.BoundedSemaphore:
+        """
+        Get the concurrency limit guarding a processing stage
+        """
+        return self.gpu_semaphore if stage.resource == "gpu" else self.cpu_semaphore
+    
+    def _segment(self, image: Image.Image) -> Image.Image:
+        """
+        Segment an in-memory image through the shared batching engine
+        """
+        if self.segmentation_engine is None:
+            self.segmentation_engine = get_segmentation_engine(self.config)
+        return self.segmentation_engine.segment(image)
+    
+    def process_file(self, filename: str, queued_at: Optional[float] = None) -> Dict[str, Any]:
         """
         Process a single file based on its filename
         
         Args:
             filename: Name of the file to process
+            queued_at: Time the job entered the durable queue, counted in the queue wait
             
         Returns:
-            Dictionary containing processing results
+            Dictionary containing processing results, with per-phase "timings" in milliseconds
+            (queue_ms, load_ms, stages_ms, save_ms, total_ms) and bytes_in / bytes_out
+        """
+        file_type = self._file_type(filename)
+        with metrics.span("workflow.job", filename=filename, type=file_type):
+            result = self._process_file(filename, queued_at)
+        
+        timings = result["timings"]
+        JOBS_TOTAL.inc(type=file_type, status=result["status"])
+        JOB_QUEUE_SECONDS.observe(timings.get("queue_ms", 0.0) / 1000.0, type=file_type)
+        if "total_ms" in timings:
+            JOB_SECONDS.observe(timings["total_ms"] / 1000.0, type=file_type, status=result["status"])
+        for op in ("load", "save"):
+            if op + "_ms" in timings:
+                JOB_IO_SECONDS.observe(timings[op + "_ms"] / 1000.0, op=op, type=file_type)
+        if result["bytes_in"]:
+            JOB_BYTES.observe(result["bytes_in"], direction="in", type=file_type)
+        if result["bytes_out"]:
+            JOB_BYTES.observe(result["bytes_out"], direction="out", type=file_type)
+        return result
+    
+    def _process_file(self, filename: str, queued_at: Optional[float]) -> Dict[str, Any]:
+        """
+        Body of process_file, runs inside the job span
         """
         # Add to processing queue
         self.processing_queue.append(filename)
@@ -152,37 +341,47 @@ class WorkflowManager:
             "start_time": time.time(),
             "end_time": None,
             "processes": [],
-            "error": None
+            "error": None,
+            "timings": {},
+            "bytes_in": 0,
+            "bytes_out": 0
         }
+        timings = result["timings"]
+        admission = contextlib.ExitStack()
+        counted = False
         
         try:
-            # 检查并等待可用的并行任务槽位
             logger.info(f"Attempting to process file: {filename}")
             
-            # 使用Condition确保线程安全和高效等待
+            # Resolve processing flow based on filename, admission is costed from it
+            file_info = self.naming_resolver.resolve(filename)
+            logger.info(f"File info: {file_info}")
+            cost = self._estimate_cost(filename, file_info)
+            result["estimated_cost"] = cost.to_dict()
+            
+            # 等待调度器按内存/显存预算放行（大任务等待，小任务可先行）
+            admission.enter_context(self.scheduler.admit(filename, cost))
+            self.events.publish("scheduler", self.scheduler.get_stats())
             with self.batch_condition:
-                while self.current_running_tasks >= self.max_parallel_tasks:
-                    logger.info(f"Max parallel tasks reached ({self.current_running_tasks}/{self.max_parallel_tasks}). Waiting for available slot...")
-                    # 等待直到有任务完成
-                    self.batch_condition.wait()
-                
-                # 增加当前运行任务计数
                 self.current_running_tasks += 1
+                counted = True
                 logger.info(f"Started processing file: {filename} (Tasks: {self.current_running_tasks}/{self.max_parallel_tasks})")
-            
-            # Resolve processing flow based on filename
-            file_info = self.naming_resolver.resolve(filename)
-            logger.info(f"File info: {file_info}")
+            # 排队时间：持久队列中的等待 + 等待调度器放行
+            started = time.perf_counter()
+            timings["queue_ms"] = (time.time() - (queued_at or result["start_time"])) * 1000.0
+            self.events.publish("job_started", {"filename": filename, "start_time": result["start_time"]})
             
             # Execute processing flow
-            result["processes"] = self._execute_processing_flow(filename, file_info)
+            result["processes"] = self._execute_processing_flow(filename, file_info, result)
             
             # Update result
             result["status"] = "completed"
             result["end_time"] = time.time()
+            timings["total_ms"] = (time.perf_counter() - started) * 1000.0
             
             # Add to processed files
             self.processed_files.append(result)
+            self.type_counts["completed"][self._file_type(filename)] += 1
             
             logger.info(f"Successfully processed file: {filename}")
             
@@ -193,151 +392,296 @@ class WorkflowManager:
             result["status"] = "failed"
             result["end_time"] = time.time()
             result["error"] = str(e)
+            if "queue_ms" in timings:
+                timings["total_ms"] = (time.perf_counter() - started) * 1000.0
             
             # Add to failed files
             self.failed_files.append(result)
+            self.type_counts["failed"][self._file_type(filename)] += 1
         finally:
+            admission.close()
+            self.events.publish("scheduler", self.scheduler.get_stats())
             # 使用Condition确保线程安全地减少当前运行任务计数并通知等待的线程
             with self.batch_condition:
-                if self.current_running_tasks > 0:
+                if counted:
                     self.current_running_tasks -= 1
                 logger.info(f"Finished processing file: {filename} (Tasks: {self.current_running_tasks}/{self.max_parallel_tasks})")
                 # 通知等待的线程有任务槽位可用
-                self.batch_condition.notify()
+                self.batch_condition.notify_all()
             
             # Remove from processing queue
             if filename in self.processing_queue:
                 self.processing_queue.remove(filename)
+            self.events.publish("job_finished", result)
         
         return result
     
-    def _execute_processing_flow(self, filename: str, file_info: Dict[str, Any]) -> List[Dict[str, Any]]:
+    def _execute_processing_flow(self, filename: str, file_info: Dict[str, Any],
+                                 job: Dict[str, Any]) -> List[Dict[str, Any]]:
         """
         Execute the processing flow based on file information
         
         Args:
             filename: Name of the file to process
             file_info: Dictionary containing file information
+            job: Job result, receives phase timings and byte counts
             
         Returns:
-            List of processing results
+            List of processing results, each with its duration_ms
         """
-        processes = []
+        input_path, output_path = self._job_paths(filename)
+        processed_filename = os.path.basename(output_path)
+        
+        context = StageContext(filename, input_path, self.config.output_dir, os.path.splitext(processed_filename)[0])
+        processes = self._job_processes(file_info)
+        graph = StageGraph(self.stage_registry, processes)
+        progress = self._stage_progress_reporter(filename, len(graph.nodes))
+        timings = job["timings"]
+        job["bytes_in"] = os.path.getsize(input_path)
+        
+        if self.tiled_processor.should_tile(input_path, output_path, processes):
+            # Streams rasters through disk, so the in-memory build cache is not consulted
+            processes = self.tiled_processor.run(processes, context, self.stage_executor, output_path,
+                                                 progress=progress, timings=timings)
+            job["bytes_out"] = self._output_bytes(output_path, processes)
+            return processes
+        
+        if self.build_cache is None:
+            # Current working image
+            current_image = self._timed_io("load", filename, timings, self.image_processor.load_image, input_path)
+            if current_image is None:
+                raise Exception("Failed to load image")
+            
+            # Run the stage graph, images stay in memory between stages
+            with metrics.timed("workflow.stages") as stages:
+                current_image, processes = self.stage_executor.run(graph, context, current_image, progress=progress)
+            timings["stages_ms"] = stages["seconds"] * 1000.0
+            
+            # Save the final processed image
+            self._timed_io("save", filename, timings, self.image_processor.save_image, current_image, output_path)
+            job["bytes_out"] = self._output_bytes(output_path, processes)
+            return processes
         
-        # Get full input path
-        input_path = os.path.join(self.config.watch_dir, filename)
+        # Incremental build: key the whole flow on source bytes, process list and stage parameters
+        with open(input_path, 'rb') as f:
+            source_data = f.read()
+        source_key = BuildCache.source_key(source_data)
+        build_key = BuildCache.combine(self.stage_executor.stage_keys(graph, context, source_key) + [output_path])
         
-        # Create processed filename
-        processed_filename = f"processed_{filename}"
-        output_path = os.path.join(self.config.output_dir, processed_filename)
+        manifest = self.build_cache.load_manifest(build_key)
+        if manifest is not None:
+            logger.info(f"Up to date, skipping: {filename}")
+            return [dict(process, cached=True, duration_ms=0.0) for process in manifest["processes"]]
         
-        # Current working image
-        current_image = self.image_processor.load_image(input_path)
+        current_image = self._timed_io("load", filename, timings, self.image_processor.load_image, BytesIO(source_data))
         if current_image is None:
             raise Exception("Failed to load image")
         
-        # Execute each process in the flow
-        for process_name in file_info["processes"]:
-            process_result = {
-                "name": process_name,
-                "status": "completed",
-                "error": None
-            }
-            
-            try:
-                logger.info(f"Executing process: {process_name} on {filename}")
-                
-                if process_name == "segment":
-                    # Perform segmentation using SAM
-                    segment_result = self.sam_segmenter.segment(input_path)
-                    if segment_result is None:
-                        raise Exception("Segmentation failed")
-                    current_image = segment_result
-                    
-                elif process_name == "align_bottom":
-                    # Align to bottom
-                    current_image = self.image_processor.align_bottom(current_image)
-                    
-                elif process_name == "generate_shadow":
-                    # Generate shadow
-                    current_image = self.image_processor.generate_shadow(current_image)
-                    
-                elif process_name == "resize_square":
-                    # Resize to square
-                    current_image = self.image_processor.resize_square(current_image, target_size=512)
-                    
-                elif process_name == "sharpen":
-                    # Sharpen image
-                    current_image = self.image_processor.sharpen(current_image)
-                    
-                elif process_name == "make_seamless":
-                    # Make image seamless
-                    current_image = self.image_processor.make_seamless(current_image)
-                    
-                elif process_name == "gen_lod":
-                    # Generate LOD levels
-                    lods = self.image_processor.gen_lod(current_image, levels=3)
-                    # Save LOD levels
-                    for i, lod_image in enumerate(lods):
-                        lod_filename = f"{os.path.splitext(processed_filename)[0]}_lod{i}.png"
-                        lod_path = os.path.join(self.config.output_dir, lod_filename)
-                        self.image_processor.save_image(lod_image, lod_path)
-                    
-                elif process_name == "gen_pbr":
-                    # Generate PBR normal map
-                    temp_path = os.path.join(self.config.temp_dir, f"temp_{filename}")
-                    self.image_processor.save_image(current_image, temp_path)
-                    normal_map = self.normal_map_generator.generate(temp_path)
-                    if normal_map:
-                        # Save normal map
-                        normal_filename = f"{os.path.splitext(processed_filename)[0]}_Normal.png"
-                        normal_path = os.path.join(self.config.output_dir, normal_filename)
-                        self.image_processor.save_image(normal_map, normal_path)
-                    
-                elif process_name == "box_collision":
-                    # Generate collision box
-                    bbox = self.image_processor.box_collision(current_image)
-                    process_result["details"] = {"collision_box": bbox}
-                    
-                elif process_name == "default_process":
-                    # Default processing
-                    logger.info("Using default processing")
-                
-                logger.info(f"Successfully executed process: {process_name}")
-                
-            except Exception as e:
-                logger.error(f"Failed to execute process {process_name}: {str(e)}")
-                process_result["status"] = "failed"
-                process_result["error"] = str(e)
-            
-            processes.append(process_result)
+        with metrics.timed("workflow.stages") as stages:
+            current_image, processes = self.stage_executor.run(graph, context, current_image, self.build_cache,
+                                                               source_key, progress=progress)
+        timings["stages_ms"] = stages["seconds"] * 1000.0
+        self._timed_io("save", filename, timings, self.image_processor.save_image, current_image, output_path)
+        job["bytes_out"] = self._output_bytes(output_path, processes)
         
-        # Save the final processed image
-        self.image_processor.save_image(current_image, output_path)
+        # Record the build only when every stage succeeded, so failures are retried next time
+        if all(process["status"] == "completed" for process in processes):
+            outputs = [output_path]
+            for process in processes:
+                outputs.extend((process.get("details") or {}).get("outputs", []))
+            self.build_cache.store_manifest(build_key, {"outputs": outputs, "processes": processes})
         
         return processes
     
-    def get_workflow_status(self) -> Dict[str, Any]:
+    @staticmethod
+    def _timed_io(op: str, filename: str, timings: Dict[str, float], func, *args):
+        """
+        Run a source decode or final encode inside a span and record its time as timings[op + "_ms"]
+        """
+        with metrics.timed("workflow." + op, filename=filename) as timing:
+            value = func(*args)
+        timings[op + "_ms"] = timing["seconds"] * 1000.0
+        return value
+    
+    def job_outputs(self, filename: str, processes: List[Dict[str, Any]]) -> List[str]:
+        """
+        Files a finished job wrote: the final image and every stage side output
+        """
+        return self._outputs(self._job_paths(filename)[1], processes)
+    
+    @staticmethod
+    def _outputs(output_path: str, processes: List[Dict[str, Any]]) -> List[str]:
+        paths = [output_path]
+        for process in processes:
+            paths.extend((process.get("details") or {}).get("outputs", []))
+        return paths
+    
+    @staticmethod
+    def _output_bytes(output_path: str, processes: List[Dict[str, Any]]) -> int:
+        """
+        Total size of the final image and every stage side output
+        """
+        total = 0
+        for path in WorkflowManager._outputs(output_path, processes):
+            try:
+                total += os.path.getsize(path)
+            except (OSError, TypeError):
+                pass
+        return total
+    
+    def _job_paths(self, filename: str) -> tuple:
+        """
+        (input path, final output path) of a job
+        """
+        return (os.path.join(self.config.watch_dir, filename),
+                os.path.join(self.config.output_dir, f"processed_{filename}"))
+    
+    def _job_processes(self, file_info: Dict[str, Any]) -> List[str]:
+        """
+        Process list of a job: the naming-convention processes plus configured exports
+        """
+        processes = list(file_info["processes"])
+        if getattr(self.config, "texture_export", ""):
+            processes.append("export_textures")
+        return processes
+    
+    def _estimate_cost(self, filename: str, file_info: Dict[str, Any]) -> JobCost:
+        """
+        Estimate a job's peak RAM/VRAM and run time for admission (reads only the image header)
+        """
+        input_path, output_path = self._job_paths(filename)
+        processes = self._job_processes(file_info)
+        tiled = self.tiled_processor.should_tile(input_path, output_path, processes)
+        return self.cost_model.estimate_file(input_path, processes, tiled)
+    
+    def _stage_progress_reporter(self, filename: str, total: int):
+        """
+        Build the per-stage callback passed to StageExecutor.run
+        """
+        completed = [0]
+        
+        def report(result: Dict[str, Any]):
+            completed[0] += 1
+            self.events.publish("stage_progress", {
+                "filename": filename,
+                "stage": result["name"],
+                "status": result["status"],
+                "error": result["error"],
+                "duration_ms": result["duration_ms"],
+                "cached": result["cached"],
+                "completed": completed[0],
+                "total": total
+            })
+        
+        return report
+    
+    def _collect_metrics(self):
+        """
+        Scrape-time workflow gauges: queue depth per state and task/slot usage
+        """
+        counts = self.job_queue.get_counts()
+        return [
+            ("amber_workflow_queue_depth", "gauge", "Durable workflow jobs per state",
+             [({"state": state}, count) for state, count in counts.items() if state in ("pending", "running")]),
+            ("amber_workflow_running_tasks", "gauge", "Workflow jobs currently holding a task slot",
+             [({}, self.current_running_tasks)]),
+            ("amber_workflow_max_parallel_tasks", "gauge", "Configured workflow task slots",
+             [({}, self.max_parallel_tasks)]),
+            ("amber_workflow_stage_slots", "gauge", "Concurrent stage slots per resource",
+             [({"resource": "cpu"}, self.cpu_slots), ({"resource": "gpu"}, self.gpu_slots)])
+        ]
+    
+    @staticmethod
+    def _file_type(filename: str) -> str:
+        """
+        Asset type of a file: first naming segment, lower-cased (chr, ui, env, prp, ...)
+        """
+        return filename.split("_", 1)[0].lower()
+    
+    def record_remote_result(self, result: Dict[str, Any]):
+        """
+        Add a result reported by a cluster worker to the history
+        
+        Args:
+            result: process_file result from the worker, paths already rebased to this node
+        """
+        status = "failed" if result["status"] == "failed" else "completed"
+        (self.failed_files if status == "failed" else self.processed_files).append(result)
+        self.type_counts[status][self._file_type(result["filename"])] += 1
+        JOBS_TOTAL.inc(type=self._file_type(result["filename"]), status=result["status"])
+        self.events.publish("job_finished", result)
+    
+    def get_workflow_status(self, history_limit: Optional[int] = None) -> Dict[str, Any]:
         """
         Get the current workflow status
         
+        Args:
+            history_limit: Only include the most recent N processed/failed results (None = all)
+            
         Returns:
             Dictionary containing workflow status information
         """
         total_files = len(self.processed_files) + len(self.failed_files)
         success_rate = (len(self.processed_files) / total_files * 100) if total_files > 0 else 0.0
         
-        return {
+        if history_limit is None:
+            processed_files = self.processed_files.copy()
+            failed_files = self.failed_files.copy()
+        else:
+            limit = max(0, history_limit)
+            processed_files = self.processed_files[-limit:] if limit else []
+            failed_files = self.failed_files[-limit:] if limit else []
+        
+        # With a coordinator the running jobs are on remote workers, the job store is the source of truth
+        processing = self.job_queue.filenames("running") if self.cluster is not None else self.processing_queue.copy()
+        
+        status = {
             "is_running": self.running,
-            "processing_queue": self.processing_queue.copy(),
-            "processed_files": self.processed_files.copy(),
-            "failed_files": self.failed_files.copy(),
+            "processing_queue": processing + self.job_queue.filenames("pending"),
+            "processed_files": processed_files,
+            "failed_files": failed_files,
+            "processed_count": len(self.processed_files),
+            "failed_count": len(self.failed_files),
+            "file_type_counts": dict(self.type_counts["completed"] + self.type_counts["failed"]),
             "total_files": total_files,
             "success_rate": success_rate,
+            "last_event_id": self.events.last_event_id,
             "batch_config": {
                 "max_parallel_tasks": self.max_parallel_tasks,
-                "current_running_tasks": self.current_running_tasks
-            }
+                "current_running_tasks": self.current_running_tasks,
+                "cpu_slots": self.cpu_slots,
+                "gpu_slots": self.gpu_slots
+            },
+            "job_queue": self.job_queue.get_counts(),
+            "scheduler": self.scheduler.get_stats()
+        }
+        if self.cluster is not None:
+            status["cluster"] = self.cluster.get_status()
+        return status
+    
+    def get_history(self, status: str = "completed", offset: int = 0, limit: int = 50) -> Dict[str, Any]:
+        """
+        Get one page of the processing history, newest first
+        
+        Args:
+            status: "completed" or "failed"
+            offset: Results to skip from the newest
+            limit: Page size
+            
+        Returns:
+            Dictionary with items, total, offset and limit
+        """
+        history = self.failed_files if status == "failed" else self.processed_files
+        total = len(history)
+        offset = max(0, offset)
+        limit = max(0, limit)
+        end = max(0, total - offset)
+        start = max(0, end - limit)
+        return {
+            "items": history[start:end][::-1],
+            "total": total,
+            "offset": offset,
+            "limit": limit
         }
     
     def clear_processed_files(self):
@@ -345,6 +689,12 @@ class WorkflowManager:
         Clear the list of processed files
         """
         self.processed_files = []
+        self.type_counts["completed"] = Counter()
+        self.job_queue.archive("completed")
+        self.events.publish("history_cleared", {
+            "status": "completed",
+            "file_type_counts": dict(self.type_counts["completed"] + self.type_counts["failed"])
+        })
         logger.info("Cleared processed files list")
     
     def clear_failed_files(self):
@@ -352,6 +702,12 @@ class WorkflowManager:
         Clear the list of failed files
         """
         self.failed_files = []
+        self.type_counts["failed"] = Counter()
+        self.job_queue.archive("failed")
+        self.events.publish("history_cleared", {
+            "status": "failed",
+            "file_type_counts": dict(self.type_counts["completed"] + self.type_counts["failed"])
+        })
         logger.info("Cleared failed files list")
     
     def set_batch_config(self, max_parallel_tasks: int) -> Dict[str, Any]:
@@ -366,11 +722,18 @@ class WorkflowManager:
         """
         try:
             # Validate the value
-            if not isinstance(max_parallel_tasks, int) or max_parallel_tasks < 1 or max_parallel_tasks > 10:
-                raise ValueError("max_parallel_tasks must be an integer between 1 and 10")
+            # Memory is guarded by the admission scheduler, so the bound only caps concurrency
+            if not isinstance(max_parallel_tasks, int) or max_parallel_tasks < 1 or max_parallel_tasks > 32:
+                raise ValueError("max_parallel_tasks must be an integer between 1 and 32")
             
             self.max_parallel_tasks = max_parallel_tasks
+            self.scheduler.set_max_jobs(max_parallel_tasks)
+            if self.running:
+                self._ensure_workers()
+            with self.batch_condition:
+                self.batch_condition.notify_all()
             logger.info(f"Batch configuration updated: max_parallel_tasks = {max_parallel_tasks}")
+            self.events.publish("batch_config", {"max_parallel_tasks": self.max_parallel_tasks})
             
             return {
                 "success": True,